@@ -0,0 +1,225 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "archive/leveldb/archive.h"
+#include "archive/sqlite/archive.h"
+#include "benchmark/benchmark.h"
+#include "common/benchmark.h"
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "common/type.h"
+#include "state/update.h"
+
+namespace carmen::archive {
+namespace {
+
+// To run benchmarks, use the following command:
+//    bazel run -c opt //archive:archive_benchmark
+
+// Defines the list of configurations to be benchmarked.
+BENCHMARK_TYPE_LIST(ArchiveConfigList, leveldb::LevelDbArchive,
+                    sqlite::SqliteArchive);
+
+// The number of distinct accounts touched by the benchmarks.
+constexpr int kNumAccounts = 1000;
+
+// The number of distinct storage slots per account.
+constexpr int kNumSlots = 16;
+
+// The number of account updates per block used to fill archives for read
+// benchmarks.
+constexpr int kAccountsPerBlock = 100;
+
+// The number of blocks in archives used for read benchmarks.
+constexpr BlockId kHistoryLength = 1024;
+
+// Defines the list of block sizes (= accounts updated per block).
+const auto kBlockSizes = std::vector<int64_t>({1, 10, 100, 1000});
+
+// Defines the list of query depths (= distance to the head of the history).
+const auto kDepths = std::vector<int64_t>({0, 16, 256, 1000});
+
+// Defines the list of history lengths for whole-archive operations.
+const auto kHistoryLengths = std::vector<int64_t>({1 << 6, 1 << 10});
+
+template <typename T>
+T ToBytes(std::uint32_t value) {
+  T res;
+  res[0] = value >> 24;
+  res[1] = value >> 16;
+  res[2] = value >> 8;
+  res[3] = value;
+  return res;
+}
+
+Address ToAddress(int i) { return ToBytes<Address>(i % kNumAccounts); }
+
+// Creates an update of the given block touching the balance, nonce and one
+// storage slot of `block_size` distinct accounts. Successive blocks touch
+// overlapping sets of accounts.
+Update CreateUpdate(BlockId block, int block_size) {
+  Update update;
+  auto first = static_cast<int>(block) * 7;
+  for (int i = 0; i < block_size; i++) {
+    auto addr = ToAddress(first + i);
+    update.Set(addr, ToBytes<Balance>(block + 1));
+    update.Set(addr, ToBytes<Nonce>(block + 1));
+    update.Set(addr, ToBytes<Key>((block + i) % kNumSlots),
+               ToBytes<Value>(block + 1));
+  }
+  return update;
+}
+
+// Fills the given archive with `num_blocks` blocks, the first creating all
+// accounts touched by the benchmarks.
+template <typename Archive>
+void InitArchive(Archive& archive, BlockId num_blocks) {
+  Update genesis;
+  for (int i = 0; i < kNumAccounts; i++) {
+    genesis.Create(ToAddress(i));
+  }
+  ASSERT_OK(archive.Add(0, genesis));
+  for (BlockId block = 1; block < num_blocks; block++) {
+    ASSERT_OK(archive.Add(block, CreateUpdate(block, kAccountsPerBlock)));
+  }
+}
+
+// Benchmarks the throughput of adding blocks of various sizes.
+template <typename Archive>
+void BM_Add(benchmark::State& state) {
+  auto block_size = state.range(0);
+
+  // Updates are prepared ahead of time to only measure the archive.
+  constexpr int kNumUpdates = 16;
+  std::vector<Update> updates;
+  for (int i = 0; i < kNumUpdates; i++) {
+    updates.push_back(CreateUpdate(i, block_size));
+  }
+
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto archive, Archive::Open(dir));
+  BlockId block = 0;
+  for (auto _ : state) {
+    ASSERT_OK(archive.Add(block, updates[block % kNumUpdates]));
+    block++;
+  }
+  state.SetItemsProcessed(state.iterations() * block_size);
+  ASSERT_OK(archive.Close());
+}
+
+BENCHMARK_ALL(BM_Add, ArchiveConfigList)->ArgList(kBlockSizes);
+
+// Benchmarks random historic balance lookups at a given depth.
+template <typename Archive>
+void BM_GetBalance(benchmark::State& state) {
+  auto block = kHistoryLength - 1 - state.range(0);
+
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto archive, Archive::Open(dir));
+  InitArchive(archive, kHistoryLength);
+
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<> dist(0, kNumAccounts - 1);
+  for (auto _ : state) {
+    auto balance = archive.GetBalance(block, ToAddress(dist(gen)));
+    benchmark::DoNotOptimize(balance);
+  }
+  ASSERT_OK(archive.Close());
+}
+
+BENCHMARK_ALL(BM_GetBalance, ArchiveConfigList)->ArgList(kDepths);
+
+// Benchmarks random historic storage lookups at a given depth.
+template <typename Archive>
+void BM_GetStorage(benchmark::State& state) {
+  auto block = kHistoryLength - 1 - state.range(0);
+
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto archive, Archive::Open(dir));
+  InitArchive(archive, kHistoryLength);
+
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<> account_dist(0, kNumAccounts - 1);
+  std::uniform_int_distribution<> slot_dist(0, kNumSlots - 1);
+  for (auto _ : state) {
+    auto value = archive.GetStorage(block, ToAddress(account_dist(gen)),
+                                    ToBytes<Key>(slot_dist(gen)));
+    benchmark::DoNotOptimize(value);
+  }
+  ASSERT_OK(archive.Close());
+}
+
+BENCHMARK_ALL(BM_GetStorage, ArchiveConfigList)->ArgList(kDepths);
+
+// Benchmarks the computation of the archive hash at the head of histories of
+// various lengths.
+template <typename Archive>
+void BM_GetHash(benchmark::State& state) {
+  auto num_blocks = state.range(0);
+
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto archive, Archive::Open(dir));
+  InitArchive(archive, num_blocks);
+
+  for (auto _ : state) {
+    auto hash = archive.GetHash(num_blocks - 1);
+    benchmark::DoNotOptimize(hash);
+  }
+  ASSERT_OK(archive.Close());
+}
+
+BENCHMARK_ALL(BM_GetHash, ArchiveConfigList)->ArgList(kHistoryLengths);
+
+// Benchmarks the listing of all accounts at the head of histories of various
+// lengths.
+template <typename Archive>
+void BM_GetAccountList(benchmark::State& state) {
+  auto num_blocks = state.range(0);
+
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto archive, Archive::Open(dir));
+  InitArchive(archive, num_blocks);
+
+  for (auto _ : state) {
+    auto list = archive.GetAccountList(num_blocks - 1);
+    benchmark::DoNotOptimize(list);
+  }
+  ASSERT_OK(archive.Close());
+}
+
+BENCHMARK_ALL(BM_GetAccountList, ArchiveConfigList)->ArgList(kHistoryLengths);
+
+// Benchmarks the verification of histories of various lengths.
+template <typename Archive>
+void BM_Verify(benchmark::State& state) {
+  auto num_blocks = state.range(0);
+
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto archive, Archive::Open(dir));
+  InitArchive(archive, num_blocks);
+  ASSERT_OK_AND_ASSIGN(auto hash, archive.GetHash(num_blocks - 1));
+
+  for (auto _ : state) {
+    auto status = archive.Verify(num_blocks - 1, hash);
+    benchmark::DoNotOptimize(status);
+  }
+  ASSERT_OK(archive.Close());
+}
+
+BENCHMARK_ALL(BM_Verify, ArchiveConfigList)->ArgList(kHistoryLengths);
+
+}  // namespace
+}  // namespace carmen::archive
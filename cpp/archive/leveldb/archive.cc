@@ -12,6 +12,7 @@
 
 #include <filesystem>
 #include <limits>
+#include <memory_resource>
 #include <memory>
 #include <span>
 #include <type_traits>
@@ -172,9 +173,11 @@ class Archive {
       return absl::OkStatus();
     }
 
-    // Compute hashes of account updates.
+    // Compute hashes of account updates. The account updates are only needed
+    // for this step and are thus allocated in an arena local to this block.
     absl::btree_map<Address, Hash> diff_hashes;
-    for (const auto& [addr, diff] : AccountUpdate::From(update)) {
+    std::pmr::monotonic_buffer_resource arena;
+    for (const auto& [addr, diff] : AccountUpdate::From(update, &arena)) {
       diff_hashes[addr] = diff.GetHash();
     }
 
@@ -11,6 +11,7 @@
 #include "archive/sqlite/archive.h"
 
 #include <algorithm>
+#include <memory_resource>
 #include <queue>
 
 #include "absl/container/btree_map.h"
@@ -111,9 +112,11 @@ class Archive {
       return absl::OkStatus();
     }
 
-    // Compute hashes of account updates.
+    // Compute hashes of account updates. The account updates are only needed
+    // for this step and are thus allocated in an arena local to this block.
     absl::btree_map<Address, Hash> diff_hashes;
-    for (const auto& [addr, diff] : AccountUpdate::From(update)) {
+    std::pmr::monotonic_buffer_resource arena;
+    for (const auto& [addr, diff] : AccountUpdate::From(update, &arena)) {
       diff_hashes[addr] = diff.GetHash();
     }
 
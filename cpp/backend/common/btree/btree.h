@@ -10,13 +10,19 @@
 
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
 #include <optional>
+#include <span>
+#include <vector>
 
+#include "absl/container/btree_set.h"
 #include "absl/status/statusor.h"
 #include "backend/common/btree/entry.h"
 #include "backend/common/btree/nodes.h"
+#include "backend/common/page.h"
 #include "backend/common/page_manager.h"
+#include "common/memory_usage.h"
 #include "common/type.h"
 #include "common/variant_util.h"
 
@@ -70,6 +76,9 @@ class BTree {
   // For debugging: Prints the content of this tree to std::cout.
   void Print() const;
 
+  // Summarizes the memory usage of this tree.
+  MemoryFootprint GetMemoryFootprint() const;
+
  protected:
   using LeafNode = btree::LeafNode<Key, Value, Comparator, max_keys>;
   using InnerNode = btree::InnerNode<LeafNode, max_elements>;
@@ -116,18 +125,83 @@ class BTree {
   // to go all the way to the leaf node to get the value.
   absl::StatusOr<Iterator> Find(const Key& key) const;
 
+  // Returns an iterator pointing to the first element with a key not less than
+  // the given key, or End() if there is no such element. This is the starting
+  // point for scanning a range of keys.
+  absl::StatusOr<Iterator> LowerBound(const Key& key) const;
+
   // Inserts the given entry. This function is intended to be used by derived
-  // implementations, customized for their use case.
-  absl::StatusOr<bool> Insert(const Entry<Key, Value>& entry);
+  // implementations, customized for their use case. If the key is already
+  // present and `present` is not null, the present entry is copied to it
+  // within the same descent of the tree.
+  absl::StatusOr<bool> Insert(const Entry<Key, Value>& entry,
+                              Entry<Key, Value>* present = nullptr);
+
+  // Inserts the given entry or, if its key is already present, replaces the
+  // value associated to it. Returns true if the entry was inserted, false if
+  // an existing value was replaced.
+  absl::StatusOr<bool> InsertOrAssign(const Entry<Key, Value>& entry)
+    requires(!LeafNode::kIsSet);
+
+  // Enables the recording of the IDs of modified pages, to be consumed through
+  // TakeModifiedPages(). This allows derived implementations to maintain
+  // information derived from page content, like hashes. The meta data page is
+  // not included.
+  void TrackModifiedPages() { track_modified_pages_ = true; }
+
+  // Returns the IDs of all pages modified since the last call, in ascending
+  // order. This includes newly allocated pages.
+  std::vector<PageId> TakeModifiedPages();
+
+  // Provides the raw content of the given page. The returned view is only
+  // valid until the next access to a page of this tree.
+  absl::StatusOr<std::span<const std::byte>> GetPageData(PageId id) const;
 
  private:
+  // A view on the page manager of a tree handed to nodes while modifying
+  // them, recording the pages touched in the process if enabled.
+  class TrackingPageManager {
+   public:
+    TrackingPageManager(BTree& tree) : tree_(tree) {}
+
+    template <Page Page>
+    StatusOrRef<Page> Get(PageId id) const {
+      return tree_.page_manager_.template Get<Page>(id);
+    }
+
+    template <Page Page>
+    auto New() {
+      auto res = tree_.page_manager_.template New<Page>();
+      if (res.ok()) {
+        Record(res->id);
+      }
+      return res;
+    }
+
+    void MarkAsDirty(PageId id) {
+      tree_.page_manager_.MarkAsDirty(id);
+      Record(id);
+    }
+
+   private:
+    void Record(PageId id) {
+      if (tree_.track_modified_pages_) {
+        tree_.modified_pages_.insert(id);
+      }
+    }
+
+    BTree& tree_;
+  };
+
   // A special page type used to store tree meta data. This node type is always
   // at page 0 of a file.
   struct MetaData : public btree::internal::Node<MetaData> {
     PageId root;
     std::uint64_t num_entries;
     std::uint32_t height;
-    // TODO: include page manager state!
+    // The state of the page manager allocating the pages of this tree. Trees
+    // written before this was recorded have a zero next page here.
+    PageManagerState page_manager;
   };
 
   BTree(const MetaData& data, PageManager<PagePool> page_manager);
@@ -144,6 +218,12 @@ class BTree {
 
   // The page manager handling the allocation of nodes (=pages).
   PageManager<PagePool> page_manager_;
+
+  // Whether modified pages are recorded, see TrackModifiedPages().
+  bool track_modified_pages_ = false;
+
+  // The pages modified since the last call to TakeModifiedPages().
+  absl::btree_set<PageId> modified_pages_;
 };
 
 // ----------------------------------------------------------------------------
@@ -162,12 +242,20 @@ absl::StatusOr<Derived> BTree<Key, Value, PagePool, Comparator, max_keys,
     meta.root = 1;
     meta.num_entries = 0;
     meta.height = 0;
-    num_pages++;  // Page 0 is implicitly used for meta data.
+    // Page 0 is implicitly used for meta data, page 1 for the root.
+    meta.page_manager =
+        PageManagerState{.next = 2, .free_list = 0, .num_free = 0};
   } else {
     RETURN_IF_ERROR(file.LoadPage(0, meta));
   }
   PagePool pool(std::make_unique<typename PagePool::File>(std::move(file)));
-  return Derived(meta, PageManager(std::move(pool), num_pages + 1));
+  if (meta.page_manager.next == 0) {
+    return Derived(meta, PageManager(std::move(pool), num_pages + 1));
+  }
+  ASSIGN_OR_RETURN(auto manager,
+                   PageManager<PagePool>::Open(std::move(pool),
+                                               meta.page_manager));
+  return Derived(meta, std::move(manager));
 }
 
 template <Trivial Key, Trivial Value, typename PagePool, typename Comparator,
@@ -253,21 +341,50 @@ BTree<Key, Value, PagePool, Comparator, max_keys, max_elements>::Find(
   return Iterator(&page_manager_, &leaf, pos);
 }
 
+template <Trivial Key, Trivial Value, typename PagePool, typename Comparator,
+          std::size_t max_keys, std::size_t max_elements>
+absl::StatusOr<typename BTree<Key, Value, PagePool, Comparator, max_keys,
+                              max_elements>::Iterator>
+BTree<Key, Value, PagePool, Comparator, max_keys, max_elements>::LowerBound(
+    const Key& key) const {
+  PageId leaf_id = root_id_;
+  if (height_ > 0) {
+    ASSIGN_OR_RETURN(InnerNode & inner,
+                     page_manager_.template Get<InnerNode>(root_id_));
+    ASSIGN_OR_RETURN(leaf_id, inner.FindLeaf(height_, key, page_manager_));
+  }
+  ASSIGN_OR_RETURN(LeafNode & leaf,
+                   page_manager_.template Get<LeafNode>(leaf_id));
+  auto pos = leaf.LowerBound(key);
+  if (pos < leaf.Size()) {
+    return Iterator(&page_manager_, &leaf, pos);
+  }
+  // All keys of the leaf are less than the given key, so the range starts with
+  // the first entry of the successor, if there is any.
+  PageId next = leaf.GetSuccessor();
+  if (next == 0) {
+    return End();
+  }
+  ASSIGN_OR_RETURN(LeafNode & successor,
+                   page_manager_.template Get<LeafNode>(next));
+  return Iterator(&page_manager_, &successor, 0);
+}
+
 template <Trivial Key, Trivial Value, typename PagePool, typename Comparator,
           std::size_t max_keys, std::size_t max_elements>
 absl::StatusOr<bool>
 BTree<Key, Value, PagePool, Comparator, max_keys, max_elements>::Insert(
-    const Entry<Key, Value>& entry) {
+    const Entry<Key, Value>& entry, Entry<Key, Value>* present) {
+  TrackingPageManager manager(*this);
   btree::InsertResult<Key> result;
   if (height_ > 0) {
     ASSIGN_OR_RETURN(InnerNode & inner,
-                     page_manager_.template Get<InnerNode>(root_id_));
+                     manager.template Get<InnerNode>(root_id_));
     ASSIGN_OR_RETURN(result,
-                     inner.Insert(root_id_, height_, entry, page_manager_));
+                     inner.Insert(root_id_, height_, entry, manager, present));
   } else {
-    ASSIGN_OR_RETURN(LeafNode & leaf,
-                     page_manager_.template Get<LeafNode>(root_id_));
-    ASSIGN_OR_RETURN(result, leaf.Insert(root_id_, entry, page_manager_));
+    ASSIGN_OR_RETURN(LeafNode & leaf, manager.template Get<LeafNode>(root_id_));
+    ASSIGN_OR_RETURN(result, leaf.Insert(root_id_, entry, manager, present));
   }
   return std::visit(
       match{
@@ -278,8 +395,8 @@ BTree<Key, Value, PagePool, Comparator, max_keys, max_elements>::Insert(
           },
           [&](const btree::Split<Key>& split) -> absl::StatusOr<bool> {
             ASSIGN_OR_RETURN((auto [id, inner]),
-                             page_manager_.template New<InnerNode>());
-            page_manager_.MarkAsDirty(id);
+                             manager.template New<InnerNode>());
+            manager.MarkAsDirty(id);
             inner.Init(root_id_, split.key, split.new_tree);
             root_id_ = id;
             height_++;
@@ -290,16 +407,69 @@ BTree<Key, Value, PagePool, Comparator, max_keys, max_elements>::Insert(
       result);
 }
 
+template <Trivial Key, Trivial Value, typename PagePool, typename Comparator,
+          std::size_t max_keys, std::size_t max_elements>
+absl::StatusOr<bool>
+BTree<Key, Value, PagePool, Comparator, max_keys, max_elements>::InsertOrAssign(
+    const Entry<Key, Value>& entry)
+  requires(!LeafNode::kIsSet)
+{
+  PageId leaf_id = root_id_;
+  if (height_ > 0) {
+    ASSIGN_OR_RETURN(InnerNode & inner,
+                     page_manager_.template Get<InnerNode>(root_id_));
+    ASSIGN_OR_RETURN(leaf_id,
+                     inner.FindLeaf(height_, entry.key, page_manager_));
+  }
+  ASSIGN_OR_RETURN(LeafNode & leaf,
+                   page_manager_.template Get<LeafNode>(leaf_id));
+  auto pos = leaf.Find(entry.key);
+  if (pos >= leaf.Size()) {
+    return Insert(entry);
+  }
+  leaf.Assign(pos, entry.value);
+  TrackingPageManager(*this).MarkAsDirty(leaf_id);
+  return false;
+}
+
+template <Trivial Key, Trivial Value, typename PagePool, typename Comparator,
+          std::size_t max_keys, std::size_t max_elements>
+std::vector<PageId> BTree<Key, Value, PagePool, Comparator, max_keys,
+                          max_elements>::TakeModifiedPages() {
+  std::vector<PageId> res(modified_pages_.begin(), modified_pages_.end());
+  modified_pages_.clear();
+  return res;
+}
+
+template <Trivial Key, Trivial Value, typename PagePool, typename Comparator,
+          std::size_t max_keys, std::size_t max_elements>
+absl::StatusOr<std::span<const std::byte>>
+BTree<Key, Value, PagePool, Comparator, max_keys, max_elements>::GetPageData(
+    PageId id) const {
+  // All node types fill an entire page, so any of them provides a view on the
+  // raw page content.
+  ASSIGN_OR_RETURN(const LeafNode& node,
+                   page_manager_.template Get<LeafNode>(id));
+  return std::span<const std::byte>(
+      std::span<const std::byte, kFileSystemPageSize>(node));
+}
+
 template <Trivial Key, Trivial Value, typename PagePool, typename Comparator,
           std::size_t max_keys, std::size_t max_elements>
 absl::Status
 BTree<Key, Value, PagePool, Comparator, max_keys, max_elements>::Flush() {
+  // All other pages, including the free list, are written by SaveState()
+  // before the meta data page referring to them is updated.
+  ASSIGN_OR_RETURN(auto state, page_manager_.SaveState());
   ASSIGN_OR_RETURN(MetaData & meta, page_manager_.template Get<MetaData>(0));
+  meta.page_manager = state;
   meta.root = root_id_;
   meta.num_entries = num_entries_;
   meta.height = height_;
   page_manager_.MarkAsDirty(0);
-  return page_manager_.Flush();
+  RETURN_IF_ERROR(page_manager_.Flush());
+  page_manager_.CommitState();
+  return absl::OkStatus();
 }
 
 template <Trivial Key, Trivial Value, typename PagePool, typename Comparator,
@@ -310,6 +480,16 @@ BTree<Key, Value, PagePool, Comparator, max_keys, max_elements>::Close() {
   return page_manager_.Close();
 }
 
+template <Trivial Key, Trivial Value, typename PagePool, typename Comparator,
+          std::size_t max_keys, std::size_t max_elements>
+MemoryFootprint BTree<Key, Value, PagePool, Comparator, max_keys,
+                      max_elements>::GetMemoryFootprint() const {
+  MemoryFootprint res(*this);
+  res.Add("page_manager", page_manager_.GetMemoryFootprint());
+  res.Add("modified_pages", SizeOf<PageId>() * modified_pages_.size());
+  return res;
+}
+
 template <Trivial Key, Trivial Value, typename PagePool, typename Comparator,
           std::size_t max_keys, std::size_t max_elements>
 absl::Status
@@ -11,11 +11,13 @@
 #pragma once
 
 #include <filesystem>
+#include <utility>
 
 #include "absl/status/statusor.h"
 #include "backend/common/btree/btree.h"
 #include "backend/common/btree/nodes.h"
 #include "backend/common/page_manager.h"
+#include "common/status_util.h"
 #include "common/type.h"
 #include "common/variant_util.h"
 
@@ -58,10 +60,35 @@ class BTreeMap : public btree::BTree<Key, Value, PagePool, Comparator, max_keys,
     return super::Insert(entry_t{key, value});
   }
 
+  // Inserts the given key/value pair into this map if the given key is not yet
+  // present. Returns the value associated to the key after the call and
+  // whether the pair was inserted. Unlike a Find(..) followed by an Insert(..),
+  // this descends the tree only once.
+  absl::StatusOr<std::pair<Value, bool>> InsertOrGet(const Key& key,
+                                                     const Value& value) {
+    entry_t present{key, value};
+    ASSIGN_OR_RETURN(auto inserted,
+                     super::Insert(entry_t{key, value}, &present));
+    // Entries are packed, so the value is copied before forming the pair.
+    Value result = present.value;
+    return std::pair{result, inserted};
+  }
+
+  // Associates the given value to the given key, replacing any value the key
+  // may have been mapped to before. Returns true if the key was added, false if
+  // it was already present.
+  absl::StatusOr<bool> InsertOrAssign(const Key& key, const Value& value) {
+    return super::InsertOrAssign(entry_t{key, value});
+  }
+
   // Attempts to locate the given key in the map and returns the associated
   // value, or std::nullopt if there is no such key in the map.
   using super::Find;
 
+  // Returns an iterator pointing to the first element with a key not less than
+  // the given key, or End() if there is no such element.
+  using super::LowerBound;
+
   // Make the BTree's Begin and End members public accessible.
   using super::Begin;
   using super::End;
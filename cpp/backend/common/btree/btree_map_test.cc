@@ -22,6 +22,7 @@ namespace {
 using ::testing::FieldsAre;
 using ::testing::IsOkAndHolds;
 using ::testing::Optional;
+using ::testing::Pair;
 using ::testing::Pointee;
 
 using TestPagePool = PagePool<InMemoryFile<kFileSystemPageSize>>;
@@ -83,6 +84,68 @@ void RunInsertionAndLookupTest(const std::vector<int>& data) {
   }
 }
 
+TEST(BTreeMap, InsertOrAssignReplacesValuesOfPresentKeys) {
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto map, (TestBTreeMap<int, int>::Open(dir)));
+  EXPECT_THAT(map.InsertOrAssign(12, 14), IsOkAndHolds(true));
+  EXPECT_THAT(map.Find(12), IsOkAndHolds(Pointee(FieldsAre(12, 14))));
+  EXPECT_THAT(map.InsertOrAssign(12, 16), IsOkAndHolds(false));
+  EXPECT_THAT(map.Find(12), IsOkAndHolds(Pointee(FieldsAre(12, 16))));
+  EXPECT_EQ(map.Size(), 1);
+}
+
+TEST(BTreeMap, InsertOrAssignWorksInDeepTrees) {
+  constexpr int N = 1000;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto map, (TestBTreeMap<int, int, 3, 3>::Open(dir)));
+  for (int i = 0; i < N; i++) {
+    EXPECT_THAT(map.InsertOrAssign((i * 7) % N, i), IsOkAndHolds(true));
+  }
+  for (int i = 0; i < N; i++) {
+    EXPECT_THAT(map.InsertOrAssign(i, 2 * i), IsOkAndHolds(false));
+  }
+  EXPECT_OK(map.Check());
+  EXPECT_EQ(map.Size(), N);
+  for (int i = 0; i < N; i++) {
+    EXPECT_THAT(map.Find(i), IsOkAndHolds(Pointee(FieldsAre(i, 2 * i))));
+  }
+}
+
+TEST(BTreeMap, InsertOrGetReturnsValuesOfPresentKeysInDeepTrees) {
+  // With narrow nodes, many keys are also present in inner nodes.
+  constexpr int N = 1000;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto map, (TestBTreeMap<int, int, 3, 3>::Open(dir)));
+  for (int i = 0; i < N; i++) {
+    EXPECT_THAT(map.InsertOrGet((i * 7) % N, i), IsOkAndHolds(Pair(i, true)));
+  }
+  for (int i = 0; i < N; i++) {
+    EXPECT_THAT(map.InsertOrGet((i * 7) % N, N + i),
+                IsOkAndHolds(Pair(i, false)));
+  }
+  EXPECT_OK(map.Check());
+  EXPECT_EQ(map.Size(), N);
+}
+
+TEST(BTreeMap, LowerBoundLocatesStartOfKeyRanges) {
+  // With narrow nodes, ranges start in the middle or at the end of leafs.
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto map, (TestBTreeMap<int, int, 3, 3>::Open(dir)));
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(map.Insert(2 * i, i));
+  }
+  ASSERT_OK_AND_ASSIGN(auto end, map.End());
+  for (int i = -1; i < 199; i++) {
+    ASSERT_OK_AND_ASSIGN(auto pos, map.LowerBound(i));
+    ASSERT_NE(pos, end) << i;
+    int expected = i < 0 ? 0 : (i + 1) / 2;
+    EXPECT_EQ((*pos).key, 2 * expected) << i;
+    EXPECT_EQ((*pos).value, expected) << i;
+  }
+  EXPECT_THAT(map.LowerBound(199), IsOkAndHolds(end));
+  EXPECT_THAT(map.LowerBound(500), IsOkAndHolds(end));
+}
+
 TEST(BTreeMap, OrderedInsertsRetainInvariants) {
   RunInsertionAndLookupTest<TestBTreeMap<int, int>>(GetSequence(10000));
 }
@@ -10,6 +10,7 @@
 
 #include "backend/common/btree/btree_set.h"
 
+#include <filesystem>
 #include <vector>
 
 #include "backend/common/btree/test_util.h"
@@ -225,5 +226,32 @@ TEST(BTreeSet, ClosingAndReopeningProducesSameSet) {
   RunClosingAndReopeningTest<BTreeSet<int, Pool, std::less<int>, 10, 11>>();
 }
 
+TEST(BTreeSet, ReopeningDoesNotSkipPages) {
+  using Set = BTreeSet<int, PagePool<SingleFile<kFileSystemPageSize>>,
+                       std::less<int>, 3, 3>;
+  const int N = 1000;
+
+  // Fill a set in a single session as a reference.
+  TempFile reference;
+  {
+    ASSERT_OK_AND_ASSIGN(auto set, Set::Open(reference));
+    for (int i = 0; i < N; i++) {
+      ASSERT_OK(set.Insert(i));
+    }
+    EXPECT_OK(set.Close());
+  }
+
+  // Fill a set with the same elements, reopening it between insertions.
+  TempFile file;
+  for (int i = 0; i < N; i++) {
+    ASSERT_OK_AND_ASSIGN(auto set, Set::Open(file));
+    ASSERT_OK(set.Insert(i));
+    EXPECT_OK(set.Close());
+  }
+
+  EXPECT_EQ(std::filesystem::file_size(file.GetPath()),
+            std::filesystem::file_size(reference.GetPath()));
+}
+
 }  // namespace
 }  // namespace carmen::backend
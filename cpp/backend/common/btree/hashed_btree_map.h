@@ -0,0 +1,137 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "backend/common/btree/btree.h"
+#include "backend/common/btree/entry.h"
+#include "backend/common/file.h"
+#include "backend/common/page.h"
+#include "backend/common/page_pool.h"
+#include "backend/store/hash_tree.h"
+#include "backend/structure.h"
+#include "common/hash.h"
+#include "common/memory_usage.h"
+#include "common/status_util.h"
+#include "common/type.h"
+
+namespace carmen::backend {
+
+// A HashedBTreeMap is an ordered map of key/value pairs backed by a BTree whose
+// pages are covered by a hash tree. Keys sharing a common prefix in the order
+// of the map are kept on the same or on neighboring pages, which makes it a
+// suitable container for data accessed in clusters, like the storage of
+// individual accounts.
+//
+// The hash of the map is computed over the content of the pages of the tree,
+// excluding the meta data page. Thus, it depends on the layout of the tree,
+// which is deterministic for a given sequence of insertions, including across
+// reopening the map.
+template <Trivial Key, Trivial Value, template <std::size_t> class F,
+          typename Comparator = std::less<Key>>
+class HashedBTreeMap
+    : public btree::BTree<Key, Value, PagePool<F<kFileSystemPageSize>>,
+                          Comparator> {
+  using super =
+      btree::BTree<Key, Value, PagePool<F<kFileSystemPageSize>>, Comparator>;
+
+ public:
+  using key_type = Key;
+  using value_type = Value;
+
+  // Opens the map stored in the given directory. If no data is found, an empty
+  // map is created.
+  static absl::StatusOr<HashedBTreeMap> Open(
+      Context&, const std::filesystem::path& directory) {
+    RETURN_IF_ERROR(CreateDirectory(directory));
+    ASSIGN_OR_RETURN(auto map,
+                     super::template Open<HashedBTreeMap>(directory /
+                                                          "tree.dat"));
+    map.TrackModifiedPages();
+    map.hash_file_ = directory / "hash.dat";
+    if (std::filesystem::exists(map.hash_file_)) {
+      RETURN_IF_ERROR(map.hashes_.LoadFromFile(map.hash_file_));
+    }
+    return map;
+  }
+
+  // Associates the given value to the given key. Returns true if the key was
+  // added to the map, false if the value of an existing key was replaced.
+  absl::StatusOr<bool> InsertOrAssign(const Key& key, const Value& value) {
+    return super::InsertOrAssign(btree::Entry<Key, Value>{key, value});
+  }
+
+  // Make the lookup and iteration members of the BTree public accessible.
+  using super::Begin;
+  using super::End;
+  using super::Find;
+
+  // Computes a hash over the full content of this map.
+  absl::StatusOr<Hash> GetHash() {
+    for (PageId id : super::TakeModifiedPages()) {
+      ASSIGN_OR_RETURN(auto data, super::GetPageData(id));
+      hashes_.UpdateHash(id, data);
+    }
+    return hashes_.GetHash();
+  }
+
+  // Flushes the tree and the page hashes to disk.
+  absl::Status Flush() {
+    RETURN_IF_ERROR(GetHash());
+    RETURN_IF_ERROR(super::Flush());
+    return hashes_.SaveToFile(hash_file_);
+  }
+
+  // Flushes all data to disk and closes the underlying file.
+  absl::Status Close() {
+    RETURN_IF_ERROR(Flush());
+    return super::Close();
+  }
+
+  // Summarizes the memory usage of this map.
+  MemoryFootprint GetMemoryFootprint() const {
+    MemoryFootprint res(*this);
+    res.Add("tree", super::GetMemoryFootprint());
+    res.Add("hashes", hashes_.GetMemoryFootprint());
+    return res;
+  }
+
+ private:
+  // Hashes are always updated from the pages modified since the last hash
+  // computation. The only page the hash tree may request is the meta data page,
+  // which is excluded from the hash by presenting it as a page of zeros.
+  class ZeroPageSource : public store::PageSource {
+   public:
+    absl::StatusOr<std::span<const std::byte>> GetPageData(PageId) override {
+      static const std::array<std::byte, kFileSystemPageSize> kZeroPage{};
+      return kZeroPage;
+    }
+  };
+
+  // Inherit the constructors of the generic BTree implementation.
+  using super::BTree;
+
+  // The hashes of the pages of the tree.
+  store::HashTree hashes_{std::make_unique<ZeroPageSource>()};
+
+  // The file the page hashes are persisted in.
+  std::filesystem::path hash_file_;
+};
+
+}  // namespace carmen::backend
@@ -0,0 +1,116 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/btree/hashed_btree_map.h"
+
+#include "backend/common/file.h"
+#include "backend/structure.h"
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "common/type.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend {
+namespace {
+
+using ::testing::IsOkAndHolds;
+using ::testing::Not;
+
+using TestMap = HashedBTreeMap<int, Value, InMemoryFile>;
+using FileMap = HashedBTreeMap<int, Value, SingleFile>;
+
+TEST(HashedBTreeMap, ValuesCanBeInsertedAndReplaced) {
+  TempDir dir;
+  Context context;
+  ASSERT_OK_AND_ASSIGN(auto map, TestMap::Open(context, dir));
+  EXPECT_THAT(map.InsertOrAssign(1, Value{1}), IsOkAndHolds(true));
+  EXPECT_THAT(map.InsertOrAssign(2, Value{2}), IsOkAndHolds(true));
+  EXPECT_THAT(map.InsertOrAssign(1, Value{3}), IsOkAndHolds(false));
+  ASSERT_OK_AND_ASSIGN(auto pos, map.Find(1));
+  EXPECT_EQ((*pos).value, Value{3});
+  ASSERT_OK_AND_ASSIGN(pos, map.Find(2));
+  EXPECT_EQ((*pos).value, Value{2});
+  EXPECT_THAT(map.Find(3), map.End());
+  EXPECT_EQ(map.Size(), 2);
+}
+
+TEST(HashedBTreeMap, EmptyMapHasZeroHash) {
+  TempDir dir;
+  Context context;
+  ASSERT_OK_AND_ASSIGN(auto map, TestMap::Open(context, dir));
+  EXPECT_THAT(map.GetHash(), IsOkAndHolds(Hash{}));
+}
+
+TEST(HashedBTreeMap, HashesFollowUpdates) {
+  TempDir dir;
+  Context context;
+  ASSERT_OK_AND_ASSIGN(auto map, TestMap::Open(context, dir));
+  ASSERT_OK(map.InsertOrAssign(1, Value{1}));
+  ASSERT_OK_AND_ASSIGN(auto hash_a, map.GetHash());
+  EXPECT_NE(hash_a, Hash{});
+  ASSERT_OK(map.InsertOrAssign(1, Value{2}));
+  ASSERT_OK_AND_ASSIGN(auto hash_b, map.GetHash());
+  EXPECT_NE(hash_a, hash_b);
+  ASSERT_OK(map.InsertOrAssign(1, Value{1}));
+  EXPECT_THAT(map.GetHash(), IsOkAndHolds(hash_a));
+}
+
+TEST(HashedBTreeMap, SameUpdatesProduceSameHashes) {
+  constexpr int kNumElements = 10000;
+  TempDir dir;
+  Context context;
+  ASSERT_OK_AND_ASSIGN(auto a, TestMap::Open(context, dir.GetPath() / "a"));
+  ASSERT_OK_AND_ASSIGN(auto b, TestMap::Open(context, dir.GetPath() / "b"));
+  for (int i = 0; i < kNumElements; i++) {
+    int key = (i * 7919) % kNumElements;
+    ASSERT_OK(a.InsertOrAssign(key, Value{static_cast<std::uint8_t>(i)}));
+    ASSERT_OK(b.InsertOrAssign(key, Value{static_cast<std::uint8_t>(i)}));
+    if (i % 1000 == 0) {
+      // Hashing at different points in time does not alter the result.
+      ASSERT_OK(a.GetHash());
+    }
+  }
+  ASSERT_OK_AND_ASSIGN(auto hash, a.GetHash());
+  EXPECT_THAT(b.GetHash(), IsOkAndHolds(hash));
+  ASSERT_OK(b.InsertOrAssign(kNumElements, Value{}));
+  EXPECT_THAT(b.GetHash(), IsOkAndHolds(Not(hash)));
+}
+
+TEST(HashedBTreeMap, ClosingAndReopeningPreservesContentAndHash) {
+  constexpr int kNumElements = 10000;
+  TempDir dir;
+  Context context;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto map, FileMap::Open(context, dir));
+    for (int i = 0; i < kNumElements; i++) {
+      ASSERT_OK(map.InsertOrAssign(i, Value{static_cast<std::uint8_t>(i)}));
+    }
+    ASSERT_OK_AND_ASSIGN(hash, map.GetHash());
+    ASSERT_OK(map.Close());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto map, FileMap::Open(context, dir));
+    EXPECT_EQ(map.Size(), kNumElements);
+    EXPECT_THAT(map.GetHash(), IsOkAndHolds(hash));
+    ASSERT_OK_AND_ASSIGN(auto end, map.End());
+    for (int i = 0; i < kNumElements; i++) {
+      ASSERT_OK_AND_ASSIGN(auto pos, map.Find(i));
+      ASSERT_NE(pos, end);
+      EXPECT_EQ((*pos).value, Value{static_cast<std::uint8_t>(i)});
+    }
+    ASSERT_OK(map.InsertOrAssign(0, Value{1}));
+    EXPECT_THAT(map.GetHash(), IsOkAndHolds(Not(hash)));
+  }
+}
+
+}  // namespace
+}  // namespace carmen::backend
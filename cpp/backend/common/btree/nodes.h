@@ -97,22 +97,36 @@ class LeafNode final
   // returns a value >= Size() if not found.
   std::uint16_t Find(const Key& key) const;
 
+  // Finds the position of the first entry with a key not less than the given
+  // key in this node, or returns Size() if there is no such entry.
+  std::uint16_t LowerBound(const Key& key) const;
+
   // Inserts the given entry into this node. Entries are identified by their
   // key. If the same key was already present, no operation is conducted.
   // Possible returns are `EntryPresent`, indicating that no modifiacation was
   // necessary, `EntryAdded` stating that the entry was added in the node,
   // growing it by one entry but not exceeding its capacity, and `Split`
   // signaling that the node had to be split to include the new entry and that
-  // the split key should be inserted in the parent.
+  // the split key should be inserted in the parent. If the key was present and
+  // `present` is not null, the present entry is copied to it.
   template <typename PageManager>
   absl::StatusOr<InsertResult<Key>> Insert(PageId this_page_id,
                                            const entry_t& entry,
-                                           PageManager& manager);
+                                           PageManager& manager,
+                                           entry_t* present = nullptr);
 
   // Obtains a reference to the value at the given position. No bounds are
   // checked.
   const entry_t& At(int pos) const { return entries_[pos]; }
 
+  // Replaces the value of the entry at the given position. No bounds are
+  // checked. It is the task of the caller to mark this node as dirty.
+  void Assign(int pos, const value_t& value)
+    requires(!kIsSet)
+  {
+    entries_[pos].value = value;
+  }
+
   // Returns the predecessor of this node, 0 if there is none.
   PageId GetPredecessor() const { return prev_; }
 
@@ -216,15 +230,25 @@ class InnerNode final : public internal::Node<InnerNode<LeafNode, max_keys>> {
   absl::StatusOr<std::pair<const LeafNode*, std::uint16_t>> Find(
       std::uint16_t level, const key_t& key, PageManager& manager) const;
 
+  // Finds the ID of the leaf page in the sub-tree rooted by this node which
+  // contains the given key, if present at all. The parameters are the same as
+  // for the Contains(..) above.
+  template <typename PageManager>
+  absl::StatusOr<PageId> FindLeaf(std::uint16_t level, const key_t& key,
+                                  PageManager& manager) const;
+
   // Inserts the given entry in this node or one of its sub-trees. The level is
   // required to identify the leaf level, and the page manager is used to
   // resolve child nodes as required. The result range may be the same as for
-  // leaf nodes: EntryAdded, EntryPresent, or Split.
+  // leaf nodes: EntryAdded, EntryPresent, or Split. If the key was present and
+  // `present` is not null, the present entry is copied to it. If the key is
+  // found in this node, this requires descending to the leaf holding it.
   template <typename PageManager>
   absl::StatusOr<InsertResult<key_t>> Insert(PageId this_page_id,
                                              std::uint16_t level,
                                              const entry_t& entry,
-                                             PageManager& manager);
+                                             PageManager& manager,
+                                             entry_t* present = nullptr);
 
   // Checks internal invariants of this node and its child nodes. Those
   // invariants include the minimum number of keys and their ordering
@@ -302,12 +326,24 @@ std::uint16_t LeafNode<Key, Value, Less, max_entries>::Find(
   return pos - begin;
 }
 
+template <Trivial Key, Trivial Value, typename Less, std::size_t max_entries>
+std::uint16_t LeafNode<Key, Value, Less, max_entries>::LowerBound(
+    const key_t& key) const {
+  auto begin = entries_.begin();
+  auto end = begin + num_entries_;
+  auto pos = std::lower_bound(
+      begin, end, entry_t{key},
+      [](const entry_t& a, const entry_t& b) { return kLess(a.key, b.key); });
+  return pos - begin;
+}
+
 template <Trivial Key, Trivial Value, typename Less, std::size_t max_entries>
 template <typename PageManager>
 absl::StatusOr<InsertResult<Key>>
 LeafNode<Key, Value, Less, max_entries>::Insert(PageId this_page_id,
                                                 const entry_t& entry,
-                                                PageManager& context) {
+                                                PageManager& context,
+                                                entry_t* present) {
   // Elements are inserted in-order.
   // The first step is to find the insertion position.
   auto begin = entries_.begin();
@@ -317,7 +353,12 @@ LeafNode<Key, Value, Less, max_entries>::Insert(PageId this_page_id,
       [](const entry_t& a, const entry_t& b) { return kLess(a.key, b.key); });
 
   // If the key is already present, we are done.
-  if (pos < end && pos->key == entry.key) return EntryPresent{};
+  if (pos < end && pos->key == entry.key) {
+    if (present != nullptr) {
+      *present = *pos;
+    }
+    return EntryPresent{};
+  }
 
   // At this point it is clear that the node needs to be modified.
   context.MarkAsDirty(this_page_id);
@@ -501,16 +542,37 @@ InnerNode<LeafNode, max_keys>::Find(std::uint16_t level, const key_t& key,
   }
 }
 
+template <Page LeafNode, std::size_t max_keys>
+template <typename PageManager>
+absl::StatusOr<PageId> InnerNode<LeafNode, max_keys>::FindLeaf(
+    std::uint16_t level, const key_t& key, PageManager& manager) const {
+  // Like for Find(..), the upper bound of the key range identifies the path.
+  auto begin = keys_.begin();
+  auto end = begin + num_keys_;
+  auto pos = std::upper_bound(begin, end, key, LeafNode::kLess);
+  PageId next = children_[pos - begin];
+  if (level > 1) {
+    ASSIGN_OR_RETURN(InnerNode & node, manager.template Get<InnerNode>(next));
+    return node.FindLeaf(level - 1, key, manager);
+  }
+  return next;
+}
+
 template <Page LeafNode, std::size_t max_keys>
 template <typename PageManager>
 absl::StatusOr<InsertResult<typename LeafNode::key_t>>
 InnerNode<LeafNode, max_keys>::Insert(PageId this_page_id, std::uint16_t level,
                                       const entry_t& entry,
-                                      PageManager& manager) {
+                                      PageManager& manager, entry_t* present) {
   auto begin = keys_.begin();
   auto end = begin + num_keys_;
   auto pos = std::lower_bound(begin, end, entry.key, LeafNode::kLess);
   if (pos < end && *pos == entry.key) {
+    if (present != nullptr) {
+      ASSIGN_OR_RETURN((auto [leaf, index]), Find(level, entry.key, manager));
+      assert(leaf != nullptr);
+      *present = leaf->At(index);
+    }
     return EntryPresent{};
   }
   auto next = children_[pos - begin];
@@ -519,11 +581,12 @@ InnerNode<LeafNode, max_keys>::Insert(PageId this_page_id, std::uint16_t level,
   if (level > 1) {
     // Next level is a inner node, insert there.
     ASSIGN_OR_RETURN(InnerNode & node, (manager.template Get<InnerNode>(next)));
-    ASSIGN_OR_RETURN(result, node.Insert(next, level - 1, entry, manager));
+    ASSIGN_OR_RETURN(result,
+                     node.Insert(next, level - 1, entry, manager, present));
   } else {
     // Next level is a leaf node, insert there.
     ASSIGN_OR_RETURN(LeafNode & node, (manager.template Get<LeafNode>(next)));
-    ASSIGN_OR_RETURN(result, node.Insert(next, entry, manager));
+    ASSIGN_OR_RETURN(result, node.Insert(next, entry, manager, present));
   }
 
   // At this point *this page may have been replaced in the page pool!
@@ -0,0 +1,90 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/compressed_page_cache.h"
+
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <string>
+#include <utility>
+
+#include "backend/common/page_id.h"
+#include "common/memory_usage.h"
+#include "snappy.h"
+
+namespace carmen::backend {
+
+CompressedPageCache::CompressedPageCache(std::size_t capacity)
+    : capacity_(capacity) {}
+
+bool CompressedPageCache::Add(PageId id, std::span<const std::byte> page) {
+  Remove(id);
+
+  std::string data;
+  snappy::Compress(reinterpret_cast<const char*>(page.data()), page.size(),
+                   &data);
+  if (data.size() >= page.size() || data.size() > capacity_) {
+    return false;
+  }
+
+  // Drop the oldest pages until the new one fits.
+  while (size_ + data.size() > capacity_) {
+    Drop(entries_.find(order_.front()));
+  }
+
+  size_ += data.size();
+  order_.push_back(id);
+  data.shrink_to_fit();
+  entries_.emplace(id, Entry{std::move(data), std::prev(order_.end())});
+  return true;
+}
+
+bool CompressedPageCache::Take(PageId id, std::span<std::byte> page) {
+  auto pos = entries_.find(id);
+  if (pos == entries_.end()) {
+    return false;
+  }
+  const std::string& data = pos->second.data;
+  std::size_t length;
+  bool success =
+      snappy::GetUncompressedLength(data.data(), data.size(), &length) &&
+      length == page.size() &&
+      snappy::RawUncompress(data.data(), data.size(),
+                            reinterpret_cast<char*>(page.data()));
+  Drop(pos);
+  return success;
+}
+
+void CompressedPageCache::Remove(PageId id) {
+  auto pos = entries_.find(id);
+  if (pos != entries_.end()) {
+    Drop(pos);
+  }
+}
+
+MemoryFootprint CompressedPageCache::GetMemoryFootprint() const {
+  MemoryFootprint res(*this);
+  res.Add("data", Memory(size_));
+  res.Add("entries", SizeOf(entries_));
+  // Each list node holds the ID and two links.
+  res.Add("order",
+          Memory((sizeof(PageId) + 2 * sizeof(void*)) * order_.size()));
+  return res;
+}
+
+void CompressedPageCache::Drop(
+    absl::flat_hash_map<PageId, Entry>::iterator entry) {
+  size_ -= entry->second.data.size();
+  order_.erase(entry->second.position);
+  entries_.erase(entry);
+}
+
+}  // namespace carmen::backend
@@ -0,0 +1,89 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <span>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "backend/common/page_id.h"
+#include "common/memory_usage.h"
+
+namespace carmen::backend {
+
+// A CompressedPageCache retains snappy-compressed copies of pages evicted from
+// a PagePool, acting as a second cache tier in-between the pool and its file.
+// Since many pages compress well, this increases the number of pages that can
+// be served from memory for a given memory budget.
+//
+// The cache is exclusive: a page is removed from it when being fetched, since
+// it is then held by the pool and may get modified there. Only clean pages,
+// whose content matches the file, may be added. If the capacity is exceeded,
+// the pages added the longest time ago are dropped.
+class CompressedPageCache {
+ public:
+  // Creates a cache retaining up to the given number of bytes of compressed
+  // page data.
+  explicit CompressedPageCache(std::size_t capacity);
+
+  // Returns the maximum number of bytes of compressed data to be retained.
+  std::size_t GetCapacity() const { return capacity_; }
+
+  // Returns the number of bytes of compressed data currently retained.
+  std::size_t GetSize() const { return size_; }
+
+  // Returns the number of pages currently retained.
+  std::size_t GetNumPages() const { return entries_.size(); }
+
+  // Adds a compressed copy of the given page, replacing any previous copy.
+  // Pages not getting smaller through compression are not retained. Returns
+  // true if the page got added.
+  bool Add(PageId id, std::span<const std::byte> page);
+
+  // Moves the page with the given ID out of the cache by decompressing it into
+  // the given buffer. Returns false if the page is not present, in which case
+  // the buffer content is undefined and the page needs to be loaded from the
+  // file.
+  bool Take(PageId id, std::span<std::byte> page);
+
+  // Drops the page with the given ID, if present.
+  void Remove(PageId id);
+
+  // Summarizes the memory usage of this instance.
+  MemoryFootprint GetMemoryFootprint() const;
+
+ private:
+  struct Entry {
+    // The compressed content of the page.
+    std::string data;
+    // The position of the page in the insertion order.
+    std::list<PageId>::iterator position;
+  };
+
+  // Drops the given entry and updates the size of the cache.
+  void Drop(absl::flat_hash_map<PageId, Entry>::iterator entry);
+
+  // The maximum number of bytes of compressed data to be retained.
+  std::size_t capacity_;
+
+  // The number of bytes of compressed data currently retained.
+  std::size_t size_ = 0;
+
+  // The retained pages, indexed by their ID.
+  absl::flat_hash_map<PageId, Entry> entries_;
+
+  // The IDs of the retained pages, ordered from oldest to newest.
+  std::list<PageId> order_;
+};
+
+}  // namespace carmen::backend
@@ -0,0 +1,153 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/compressed_page_cache.h"
+
+#include <array>
+#include <cstddef>
+#include <random>
+
+#include "gtest/gtest.h"
+
+namespace carmen::backend {
+namespace {
+
+constexpr std::size_t kPageSize = 4096;
+
+using TestPage = std::array<std::byte, kPageSize>;
+
+// Creates a page that compresses well, with content depending on the seed.
+// Pages of non-zero seeds all compress to the same size.
+TestPage CreatePage(int seed) {
+  TestPage page{};
+  for (std::size_t i = 0; i < page.size(); i += 64) {
+    page[i] = std::byte(seed);
+  }
+  return page;
+}
+
+TEST(CompressedPageCacheTest, NewCacheIsEmpty) {
+  CompressedPageCache cache(1 << 20);
+  EXPECT_EQ(cache.GetCapacity(), 1 << 20);
+  EXPECT_EQ(cache.GetSize(), 0);
+  EXPECT_EQ(cache.GetNumPages(), 0);
+  TestPage page;
+  EXPECT_FALSE(cache.Take(0, page));
+}
+
+TEST(CompressedPageCacheTest, AddedPagesCanBeTaken) {
+  CompressedPageCache cache(1 << 20);
+  EXPECT_TRUE(cache.Add(1, CreatePage(1)));
+  EXPECT_TRUE(cache.Add(2, CreatePage(2)));
+  EXPECT_EQ(cache.GetNumPages(), 2);
+
+  TestPage page;
+  EXPECT_TRUE(cache.Take(1, page));
+  EXPECT_EQ(page, CreatePage(1));
+  EXPECT_TRUE(cache.Take(2, page));
+  EXPECT_EQ(page, CreatePage(2));
+}
+
+TEST(CompressedPageCacheTest, PagesAreCompressed) {
+  CompressedPageCache cache(1 << 20);
+  EXPECT_TRUE(cache.Add(1, CreatePage(1)));
+  EXPECT_GT(cache.GetSize(), 0);
+  EXPECT_LT(cache.GetSize(), kPageSize);
+}
+
+TEST(CompressedPageCacheTest, TakenPagesAreRemoved) {
+  CompressedPageCache cache(1 << 20);
+  EXPECT_TRUE(cache.Add(1, CreatePage(1)));
+  TestPage page;
+  EXPECT_TRUE(cache.Take(1, page));
+  EXPECT_FALSE(cache.Take(1, page));
+  EXPECT_EQ(cache.GetNumPages(), 0);
+  EXPECT_EQ(cache.GetSize(), 0);
+}
+
+TEST(CompressedPageCacheTest, AddingReplacesPreviousCopy) {
+  CompressedPageCache cache(1 << 20);
+  EXPECT_TRUE(cache.Add(1, CreatePage(1)));
+  EXPECT_TRUE(cache.Add(1, CreatePage(2)));
+  EXPECT_EQ(cache.GetNumPages(), 1);
+  TestPage page;
+  EXPECT_TRUE(cache.Take(1, page));
+  EXPECT_EQ(page, CreatePage(2));
+}
+
+TEST(CompressedPageCacheTest, RemovedPagesAreDropped) {
+  CompressedPageCache cache(1 << 20);
+  EXPECT_TRUE(cache.Add(1, CreatePage(1)));
+  cache.Remove(1);
+  cache.Remove(2);
+  EXPECT_EQ(cache.GetNumPages(), 0);
+  EXPECT_EQ(cache.GetSize(), 0);
+  TestPage page;
+  EXPECT_FALSE(cache.Take(1, page));
+}
+
+TEST(CompressedPageCacheTest, IncompressiblePagesAreNotRetained) {
+  std::mt19937 gen(42);
+  TestPage page;
+  for (auto& cur : page) {
+    cur = std::byte(gen());
+  }
+  CompressedPageCache cache(1 << 20);
+  EXPECT_FALSE(cache.Add(1, page));
+  EXPECT_EQ(cache.GetNumPages(), 0);
+  EXPECT_EQ(cache.GetSize(), 0);
+}
+
+TEST(CompressedPageCacheTest, PagesExceedingTheCapacityAreNotRetained) {
+  CompressedPageCache cache(1);
+  EXPECT_FALSE(cache.Add(1, CreatePage(1)));
+  EXPECT_EQ(cache.GetNumPages(), 0);
+}
+
+TEST(CompressedPageCacheTest, OldestPagesAreDroppedWhenFull) {
+  CompressedPageCache probe(1 << 20);
+  ASSERT_TRUE(probe.Add(0, CreatePage(1)));
+  auto compressed_size = probe.GetSize();
+
+  // All test pages compress to the same size, so three of them fit.
+  CompressedPageCache cache(3 * compressed_size);
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(cache.Add(i, CreatePage(i + 1)));
+    EXPECT_LE(cache.GetSize(), cache.GetCapacity());
+  }
+  EXPECT_EQ(cache.GetNumPages(), 3);
+
+  TestPage page;
+  EXPECT_FALSE(cache.Take(0, page));
+  EXPECT_FALSE(cache.Take(1, page));
+  for (int i = 2; i < 5; i++) {
+    EXPECT_TRUE(cache.Take(i, page));
+    EXPECT_EQ(page, CreatePage(i + 1));
+  }
+}
+
+TEST(CompressedPageCacheTest, PagesOfWrongSizeAreNotRestored) {
+  CompressedPageCache cache(1 << 20);
+  EXPECT_TRUE(cache.Add(1, CreatePage(1)));
+  std::array<std::byte, kPageSize / 2> page;
+  EXPECT_FALSE(cache.Take(1, page));
+  EXPECT_EQ(cache.GetNumPages(), 0);
+}
+
+TEST(CompressedPageCacheTest, MemoryFootprintCoversCompressedData) {
+  CompressedPageCache cache(1 << 20);
+  auto empty = cache.GetMemoryFootprint().GetTotal();
+  EXPECT_TRUE(cache.Add(1, CreatePage(1)));
+  EXPECT_GE(cache.GetMemoryFootprint().GetTotal().bytes(),
+            empty.bytes() + cache.GetSize());
+}
+
+}  // namespace
+}  // namespace carmen::backend
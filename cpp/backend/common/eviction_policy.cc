@@ -10,6 +10,8 @@
 
 #include "backend/common/eviction_policy.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
 #include <cstdlib>
 #include <optional>
@@ -167,4 +169,84 @@ void LeastRecentlyUsedEvictionPolicy::Dump() {
   std::cout << "\n\n";
 }
 
+LeastCostlyEvictionPolicy::LeastCostlyEvictionPolicy(std::size_t size,
+                                                     std::size_t window_size)
+    : window_size_(std::max<std::size_t>(window_size, 1)), entries_(size) {}
+
+void LeastCostlyEvictionPolicy::Read(std::size_t position) {
+  assert(position < entries_.size());
+  Entry* cur = &entries_[position];
+  if (head_ == cur) {
+    return;
+  }
+  Unlink(cur);
+  cur->succ = head_;
+  if (head_) {
+    head_->pred = cur;
+  }
+  head_ = cur;
+  if (tail_ == nullptr) {
+    tail_ = cur;
+  }
+}
+
+void LeastCostlyEvictionPolicy::Written(std::size_t position) {
+  Read(position);
+  entries_[position].dirty = true;
+}
+
+void LeastCostlyEvictionPolicy::Removed(std::size_t position) {
+  assert(position < entries_.size());
+  Entry* cur = &entries_[position];
+  Unlink(cur);
+  cur->dirty = false;
+  cur->pending_work = false;
+}
+
+void LeastCostlyEvictionPolicy::Cleaned(std::size_t position) {
+  assert(position < entries_.size());
+  entries_[position].dirty = false;
+}
+
+void LeastCostlyEvictionPolicy::SetPendingWork(std::size_t position,
+                                               bool pending) {
+  assert(position < entries_.size());
+  entries_[position].pending_work = pending;
+}
+
+std::optional<std::size_t> LeastCostlyEvictionPolicy::GetPageToEvict() {
+  if (tail_ == nullptr) {
+    return std::nullopt;
+  }
+  // Starting with the least recently used slot, the first slot of minimal cost
+  // within the window is selected.
+  Entry* best = tail_;
+  Entry* cur = tail_->pred;
+  for (std::size_t i = 1;
+       i < window_size_ && cur != nullptr && best->GetCost() != Cost::kClean;
+       i++, cur = cur->pred) {
+    if (cur->GetCost() < best->GetCost()) {
+      best = cur;
+    }
+  }
+  return best - &entries_[0];
+}
+
+void LeastCostlyEvictionPolicy::Unlink(Entry* cur) {
+  if (cur->pred) {
+    cur->pred->succ = cur->succ;
+  }
+  if (cur->succ) {
+    cur->succ->pred = cur->pred;
+  }
+  if (head_ == cur) {
+    head_ = cur->succ;
+  }
+  if (tail_ == cur) {
+    tail_ = cur->pred;
+  }
+  cur->pred = nullptr;
+  cur->succ = nullptr;
+}
+
 }  // namespace carmen::backend
@@ -12,8 +12,10 @@
 
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <optional>
+#include <vector>
 
 #include "absl/container/btree_set.h"
 #include "backend/common/access_pattern.h"
@@ -35,6 +37,17 @@ concept EvictionPolicy = requires(P a) {
   { a.GetPageToEvict() } -> std::same_as<std::optional<std::size_t>>;
 };
 
+// An extension of the eviction policy concept for policies considering the
+// costs of evicting slots. Beyond writing back dirty pages, evicting a slot may
+// involve pending work performed by pool listeners, like updating hashes.
+template <typename P>
+concept CostAwareEvictionPolicy = EvictionPolicy<P> && requires(P a) {
+  // Informs the policy that a dirty page slot has been written back.
+  { a.Cleaned(std::size_t{}) } -> std::same_as<void>;
+  // Informs the policy whether work is pending for evicting the slot.
+  { a.SetPendingWork(std::size_t{}, bool{}) } -> std::same_as<void>;
+};
+
 // Implements a random eviction policy. Pages are grouped into two categories:
 // dirty pages and clean pages. When picking a page to be evicted, the clean
 // pages are considered first. If there are clean pages, a random entry is
@@ -84,4 +97,62 @@ class LeastRecentlyUsedEvictionPolicy {
   Entry* tail_ = nullptr;
 };
 
+// Implements a cost-aware variant of the least-recently-used eviction policy.
+// Among the least recently used slots within a window of a fixed size, the
+// cheapest slot to be evicted is selected. Clean slots are cheaper than dirty
+// slots, which are cheaper than dirty slots with pending work. Ties are broken
+// in favour of the least recently used slot. Thus, recency is traded against
+// eviction costs only within the window.
+class LeastCostlyEvictionPolicy {
+ public:
+  // The default number of least recently used slots considered for eviction.
+  constexpr static std::size_t kDefaultWindowSize = 16;
+
+  LeastCostlyEvictionPolicy(std::size_t size = 100,
+                            std::size_t window_size = kDefaultWindowSize);
+  void Read(std::size_t);
+  void Written(std::size_t);
+  void Removed(std::size_t);
+  void Cleaned(std::size_t);
+  void SetPendingWork(std::size_t, bool);
+  std::optional<std::size_t> GetPageToEvict();
+
+ private:
+  // The costs of evicting a slot, in increasing order.
+  enum class Cost : std::uint8_t {
+    kClean,
+    kDirty,
+    kDirtyWithPendingWork,
+  };
+
+  // Entries used to form a double-linked list of least-recently-used positions.
+  struct Entry {
+    Entry* succ = nullptr;
+    Entry* pred = nullptr;
+    bool dirty = false;
+    bool pending_work = false;
+
+    Cost GetCost() const {
+      return !dirty         ? Cost::kClean
+             : pending_work ? Cost::kDirtyWithPendingWork
+                            : Cost::kDirty;
+    }
+  };
+
+  // Removes the given entry from the list, if present.
+  void Unlink(Entry* entry);
+
+  // The number of least recently used slots considered for eviction.
+  std::size_t window_size_;
+
+  // A list of all entries, indexed by the pool position.
+  std::vector<Entry> entries_;
+
+  // A pointer to the most recently used entry.
+  Entry* head_ = nullptr;
+
+  // A pointer to the least recently used entry.
+  Entry* tail_ = nullptr;
+};
+
 }  // namespace carmen::backend
@@ -160,5 +160,96 @@ TEST(LeastRecentlyUsedEvictionPolicyTest, MiddleElementCanBeRemoved) {
   EXPECT_EQ(policy.GetPageToEvict(), std::nullopt);
 }
 
+TEST(LeastCostlyEvictionPolicyTest, IsCostAwareEvictionPolicy) {
+  EXPECT_TRUE(EvictionPolicy<LeastCostlyEvictionPolicy>);
+  EXPECT_TRUE(CostAwareEvictionPolicy<LeastCostlyEvictionPolicy>);
+  EXPECT_FALSE(CostAwareEvictionPolicy<LeastRecentlyUsedEvictionPolicy>);
+}
+
+TEST(LeastCostlyEvictionPolicyTest, ReturnsNullOptIfNothingIsUsed) {
+  LeastCostlyEvictionPolicy policy;
+  EXPECT_EQ(policy.GetPageToEvict(), std::nullopt);
+}
+
+TEST(LeastCostlyEvictionPolicyTest, CleanPagesAreEvictedInLeastRecentlyUsedOrder) {
+  LeastCostlyEvictionPolicy policy;
+  for (std::size_t i = 0; i < 10; i++) {
+    policy.Read(i);
+  }
+  policy.Read(0);  // now: 0, 9, 8, ..., 1
+  for (std::size_t i = 1; i < 10; i++) {
+    EXPECT_EQ(policy.GetPageToEvict(), i);
+    policy.Removed(i);
+  }
+  EXPECT_EQ(policy.GetPageToEvict(), 0);
+  policy.Removed(0);
+  EXPECT_EQ(policy.GetPageToEvict(), std::nullopt);
+}
+
+TEST(LeastCostlyEvictionPolicyTest, CheaperPagesAreEvictedFirst) {
+  LeastCostlyEvictionPolicy policy;
+  policy.Written(1);
+  policy.SetPendingWork(1, true);
+  policy.Written(2);
+  policy.Read(3);  // now: 3 (clean), 2 (dirty), 1 (dirty with pending work)
+
+  EXPECT_EQ(policy.GetPageToEvict(), 3);
+  policy.Removed(3);
+  EXPECT_EQ(policy.GetPageToEvict(), 2);
+  policy.Removed(2);
+  EXPECT_EQ(policy.GetPageToEvict(), 1);
+  policy.Removed(1);
+  EXPECT_EQ(policy.GetPageToEvict(), std::nullopt);
+}
+
+TEST(LeastCostlyEvictionPolicyTest, CleanedPagesAreCheap) {
+  LeastCostlyEvictionPolicy policy;
+  policy.Written(1);
+  policy.Written(2);  // now: 2, 1 (both dirty)
+  EXPECT_EQ(policy.GetPageToEvict(), 1);
+  policy.Cleaned(2);
+  EXPECT_EQ(policy.GetPageToEvict(), 2);
+  policy.Written(2);
+  EXPECT_EQ(policy.GetPageToEvict(), 1);
+}
+
+TEST(LeastCostlyEvictionPolicyTest, PendingWorkCanBeResolved) {
+  LeastCostlyEvictionPolicy policy;
+  policy.Written(1);
+  policy.SetPendingWork(1, true);
+  policy.Written(2);
+  policy.SetPendingWork(2, true);  // now: 2, 1 (both with pending work)
+  EXPECT_EQ(policy.GetPageToEvict(), 1);
+  policy.SetPendingWork(2, false);
+  EXPECT_EQ(policy.GetPageToEvict(), 2);
+}
+
+TEST(LeastCostlyEvictionPolicyTest, OnlySlotsWithinWindowAreConsidered) {
+  LeastCostlyEvictionPolicy policy(100, 4);
+  policy.Read(0);
+  for (std::size_t i = 1; i <= 4; i++) {
+    policy.Written(i);
+  }  // now: 4, 3, 2, 1 (dirty), 0 (clean)
+  policy.Read(0);  // now: 0 (clean), 4, 3, 2, 1 (dirty)
+  EXPECT_EQ(policy.GetPageToEvict(), 1);
+
+  policy.Cleaned(2);
+  EXPECT_EQ(policy.GetPageToEvict(), 2);
+}
+
+TEST(LeastCostlyEvictionPolicyTest, RemovedSlotsAreReset) {
+  LeastCostlyEvictionPolicy policy;
+  policy.Written(1);
+  policy.SetPendingWork(1, true);
+  policy.Read(2);
+  policy.Removed(1);
+  policy.Removed(2);
+
+  // Slot 1 is reused as a clean slot.
+  policy.Read(1);
+  policy.Written(2);
+  EXPECT_EQ(policy.GetPageToEvict(), 1);
+}
+
 }  // namespace
 }  // namespace carmen::backend
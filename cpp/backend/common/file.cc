@@ -13,6 +13,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 
@@ -65,6 +66,52 @@ namespace {
 // Retain a 256 KiB aligned buffer of zeros for initializing disk space.
 alignas(kFileSystemPageSize) static const std::array<char, 1 << 18> kZeros{};
 
+// Disk space is reserved beyond the end of growing files in steps proportional
+// to the file size, such that the number of reservations only grows
+// logarithmically with the final file size. The steps are bounded to limit the
+// space held by small files and the latency of individual reservations.
+constexpr std::size_t kMinPreallocationStep = 1 << 20;  // 1 MiB
+constexpr std::size_t kMaxPreallocationStep = 1 << 26;  // 64 MiB
+
+// Reserves disk space for the given file beyond `end`, unless this has been
+// covered by a previous reservation ending at `reserved`. The file size is not
+// modified. Reservations are an optimization only; if one fails, `enabled` is
+// cleared to disable further attempts for the file.
+void ReserveSpace(int fd, std::size_t end, std::size_t& reserved,
+                  bool& enabled) {
+#ifdef FALLOC_FL_KEEP_SIZE
+  if (!enabled || end <= reserved) {
+    return;
+  }
+  auto step =
+      std::clamp(end / 2, kMinPreallocationStep, kMaxPreallocationStep);
+  if (fallocate(fd, FALLOC_FL_KEEP_SIZE, end, step) != 0) {
+    enabled = false;
+    return;
+  }
+  reserved = end + step;
+#else
+  enabled = false;
+#endif
+}
+
+// Releases disk space reserved beyond the end of the given file. Truncating a
+// file to its current size drops blocks beyond its end on most file systems,
+// while others require the reserved range to be punched out explicitly.
+void ReleaseSpace(int fd, std::size_t size, std::size_t reserved) {
+  if (reserved <= size) {
+    return;
+  }
+  // This is best effort; unused reservations only waste disk space.
+  if (ftruncate(fd, size) != 0) {
+    return;
+  }
+#if defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+  fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, size,
+            reserved - size);
+#endif
+}
+
 }  // namespace
 
 absl::StatusOr<FStreamFile> FStreamFile::Open(
@@ -151,10 +198,13 @@ absl::StatusOr<CFile> CFile::Open(const std::filesystem::path& path) {
 }
 
 CFile::CFile(std::FILE* file, std::size_t file_size)
-    : file_size_(file_size), file_(file) {}
+    : file_size_(file_size), reserved_size_(file_size), file_(file) {}
 
 CFile::CFile(CFile&& file) noexcept
-    : file_size_(file.file_size_), file_(file.file_) {
+    : file_size_(file.file_size_),
+      reserved_size_(file.reserved_size_),
+      preallocate_(file.preallocate_),
+      file_(file.file_) {
   file.file_ = nullptr;
 }
 
@@ -199,7 +249,7 @@ absl::Status CFile::Write(std::size_t pos, std::span<const std::byte> span) {
     return absl::InternalError("File is not open.");
   }
   // Grow file as needed.
-  RETURN_IF_ERROR(GrowFileIfNeeded(pos + span.size()));
+  RETURN_IF_ERROR(GrowFileIfNeeded(pos, pos + span.size()));
   if (std::fseek(file_, pos, SEEK_SET) != 0) {
     return absl::InternalError(
         absl::StrFormat("Failed to seek to position %d.", pos));
@@ -215,6 +265,7 @@ absl::Status CFile::Write(std::size_t pos, std::span<const std::byte> span) {
                         " Requested: %d, Written: %d.",
                         span.size(), len));
   }
+  file_size_ = std::max(file_size_, pos + span.size());
   return absl::OkStatus();
 }
 
@@ -228,6 +279,7 @@ absl::Status CFile::Flush() {
 absl::Status CFile::Close() {
   if (file_ != nullptr) {
     RETURN_IF_ERROR(Flush());
+    ReleaseSpace(fileno(file_), file_size_, reserved_size_);
     if (std::fclose(file_) == EOF) {
       return absl::InternalError("Failed to close file.");
     }
@@ -236,16 +288,30 @@ absl::Status CFile::Close() {
   return absl::OkStatus();
 }
 
-absl::Status CFile::GrowFileIfNeeded(std::size_t needed) {
-  if (file_size_ >= needed) {
+absl::Status CFile::GrowFileIfNeeded(std::size_t pos, std::size_t end) {
+  if (file_size_ >= end) {
+    return absl::OkStatus();
+  }
+  ReserveSpace(fileno(file_), end, reserved_size_, preallocate_);
+  if (file_size_ >= pos) {
+    return absl::OkStatus();
+  }
+  // Buffered data needs to be written before the file is resized underneath.
+  if (std::fflush(file_) == EOF) {
+    return absl::InternalError("Failed to flush file.");
+  }
+  // The gap up to the write position is filled by a sparse region.
+  if (ftruncate(fileno(file_), pos) == 0) {
+    file_size_ = pos;
     return absl::OkStatus();
   }
+  // If this is not supported by the file system, zeros are written instead.
   if (std::fseek(file_, 0, SEEK_END) != 0) {
     return absl::InternalError(
         absl::StrFormat("Failed to seek to end of file."));
   }
-  while (file_size_ < needed) {
-    auto step = std::min(kZeros.size(), needed - file_size_);
+  while (file_size_ < pos) {
+    auto step = std::min(kZeros.size(), pos - file_size_);
     auto len = std::fwrite(kZeros.data(), sizeof(std::byte), step, file_);
     if (len != step) {
       if (std::ferror(file_)) {
@@ -289,10 +355,13 @@ absl::StatusOr<PosixFile> PosixFile::Open(const std::filesystem::path& path) {
 }
 
 PosixFile::PosixFile(int fd, std::size_t file_size)
-    : file_size_(file_size), fd_(fd) {}
+    : file_size_(file_size), reserved_size_(file_size), fd_(fd) {}
 
 PosixFile::PosixFile(PosixFile&& file) noexcept
-    : file_size_(file.file_size_), fd_(file.fd_) {
+    : file_size_(file.file_size_),
+      reserved_size_(file.reserved_size_),
+      preallocate_(file.preallocate_),
+      fd_(file.fd_) {
   file.fd_ = -1;
 }
 
@@ -309,7 +378,6 @@ absl::Status PosixFile::Read(std::size_t pos, std::span<std::byte> span) {
     std::memset(span.data(), 0, span.size());
     return absl::OkStatus();
   }
-  RETURN_IF_ERROR(GrowFileIfNeeded(pos + span.size()));
   if (lseek(fd_, pos, SEEK_SET) == -1) {
     return GetStatusWithSystemError(
         absl::StatusCode::kInternal, errno,
@@ -334,7 +402,7 @@ absl::Status PosixFile::Write(std::size_t pos,
     return absl::InternalError("File is not open.");
   }
   // Grow file as needed.
-  RETURN_IF_ERROR(GrowFileIfNeeded(pos + span.size()));
+  RETURN_IF_ERROR(GrowFileIfNeeded(pos, pos + span.size()));
   if (lseek(fd_, pos, SEEK_SET) == -1) {
     return GetStatusWithSystemError(
         absl::StatusCode::kInternal, errno,
@@ -348,6 +416,7 @@ absl::Status PosixFile::Write(std::size_t pos,
                         "Wrote %d, requested %d.",
                         len, span.size()));
   }
+  file_size_ = std::max(file_size_, pos + span.size());
   return absl::OkStatus();
 }
 
@@ -362,6 +431,7 @@ absl::Status PosixFile::Flush() {
 absl::Status PosixFile::Close() {
   if (fd_ >= 0) {
     RETURN_IF_ERROR(Flush());
+    ReleaseSpace(fd_, file_size_, reserved_size_);
     if (close(fd_) == -1) {
       return GetStatusWithSystemError(absl::StatusCode::kInternal, errno,
                                       "Failed to close file.");
@@ -371,10 +441,20 @@ absl::Status PosixFile::Close() {
   return absl::OkStatus();
 }
 
-absl::Status PosixFile::GrowFileIfNeeded(std::size_t needed) {
-  if (file_size_ >= needed) {
+absl::Status PosixFile::GrowFileIfNeeded(std::size_t pos, std::size_t end) {
+  if (file_size_ >= end) {
+    return absl::OkStatus();
+  }
+  ReserveSpace(fd_, end, reserved_size_, preallocate_);
+  if (file_size_ >= pos) {
     return absl::OkStatus();
   }
+  // The gap up to the write position is filled by a sparse region.
+  if (ftruncate(fd_, pos) == 0) {
+    file_size_ = pos;
+    return absl::OkStatus();
+  }
+  // If this is not supported by the file system, zeros are written instead.
   auto offset = lseek(fd_, 0, SEEK_END);
   if (offset != static_cast<off_t>(file_size_)) {
     return GetStatusWithSystemError(
@@ -383,8 +463,8 @@ absl::Status PosixFile::GrowFileIfNeeded(std::size_t needed) {
             "Failed to seek to end of file. Expected offset %d, got %d.",
             file_size_, offset));
   }
-  while (file_size_ < needed) {
-    auto step = std::min(kZeros.size(), needed - file_size_);
+  while (file_size_ < pos) {
+    auto step = std::min(kZeros.size(), pos - file_size_);
     auto len = write(fd_, kZeros.data(), step);
     if (len != static_cast<ssize_t>(step)) {
       return GetStatusWithSystemError(
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cassert>
 #include <concepts>
 #include <cstdint>
 #include <cstdio>
@@ -154,6 +155,10 @@ class FStreamFile {
 };
 
 // A CFile provides raw read/write access to a file C's stdio.h header.
+//
+// Like the PosixFile below, the file is grown through sparse regions instead
+// of writing zeros, and disk space is reserved ahead of the end of the file
+// in geometrically growing steps if supported by the file system.
 class CFile {
  public:
   // Opens the given file in read/write mode. If it does not exist, the file is
@@ -188,14 +193,27 @@ class CFile {
  private:
   CFile(std::FILE* file, std::size_t file_size);
 
-  // Grows the underlying file to the given size.
-  absl::Status GrowFileIfNeeded(std::size_t needed);
+  // Prepares the underlying file for writing the byte range [pos, end). The
+  // gap between the current end of the file and `pos` is filled with zeros,
+  // while bytes in the range are expected to be written by the caller.
+  absl::Status GrowFileIfNeeded(std::size_t pos, std::size_t end);
 
   std::size_t file_size_;
+  // The end of the disk space reserved for this file, which may exceed the
+  // file size due to preallocation.
+  std::size_t reserved_size_;
+  // Set to false if the file system does not support preallocation.
+  bool preallocate_ = true;
   std::FILE* file_;
 };
 
 // A PosixFile provides raw read/write access to a file through POSIX API.
+//
+// Files are grown by extending them with ftruncate, leaving a sparse region
+// that reads as zeros without writing any data. Additionally, disk space is
+// reserved beyond the end of the file using fallocate in steps proportional
+// to the file size, reducing the number of extent allocations of growing
+// files. Where those operations are not supported, zeros are written instead.
 class PosixFile {
  public:
   // Opens the given file in read/write mode. If it does not exist, the file is
@@ -230,10 +248,17 @@ class PosixFile {
  private:
   PosixFile(int fd, std::size_t file_size);
 
-  // Grows the underlying file to the given size.
-  absl::Status GrowFileIfNeeded(std::size_t needed);
+  // Prepares the underlying file for writing the byte range [pos, end). The
+  // gap between the current end of the file and `pos` is filled with zeros,
+  // while bytes in the range are expected to be written by the caller.
+  absl::Status GrowFileIfNeeded(std::size_t pos, std::size_t end);
 
   std::size_t file_size_;
+  // The end of the disk space reserved for this file, which may exceed the
+  // file size due to preallocation.
+  std::size_t reserved_size_;
+  // Set to false if the file system does not support preallocation.
+  bool preallocate_ = true;
   int fd_;
 };
 
@@ -262,6 +287,14 @@ class SingleFileBase {
     return file_.Write(id * page_size, src);
   }
 
+  // Stores a range of consecutive pages starting at the given page using a
+  // single write operation. The size of the range must be a multiple of the
+  // page size. See StorePages(..) below.
+  absl::Status StorePages(PageId first, std::span<const std::byte> src) {
+    assert(src.size() % page_size == 0);
+    return file_.Write(first * page_size, src);
+  }
+
   absl::Status Flush() { return file_.Flush(); }
 
   absl::Status Close() { return file_.Close(); }
@@ -281,6 +314,25 @@ class SingleFileBase {
 template <std::size_t page_size>
 using SingleFile = SingleFileBase<page_size, internal::CFile>;
 
+// Stores a range of consecutive pages starting at the given page in the given
+// file. The size of the range must be a multiple of the file's page size.
+// Files offering a StorePages(..) member function write the full range in a
+// single operation, which is intended for sequentially filling files with
+// large writes. For all other files, pages are stored one by one.
+template <File F>
+absl::Status StorePages(F& file, PageId first, std::span<const std::byte> src) {
+  assert(src.size() % F::kPageSize == 0);
+  if constexpr (requires { file.StorePages(first, src); }) {
+    return file.StorePages(first, src);
+  } else {
+    for (std::size_t i = 0; i < src.size() / F::kPageSize; i++) {
+      auto page = src.subspan(i * F::kPageSize).template first<F::kPageSize>();
+      RETURN_IF_ERROR(file.StorePage(first + i, page));
+    }
+    return absl::OkStatus();
+  }
+}
+
 // ------------------------------- Definitions --------------------------------
 
 template <std::size_t page_size>
@@ -10,8 +10,13 @@
 
 #include "backend/common/file.h"
 
+#include <sys/stat.h>
+
+#include <cstddef>
 #include <filesystem>
+#include <span>
 #include <sstream>
+#include <vector>
 
 #include "backend/common/page.h"
 #include "common/file_util.h"
@@ -118,6 +123,24 @@ TEST(InMemoryFileTest, LoadingUninitializedPagesLeadsToZeros) {
   EXPECT_EQ(zero, loaded);
 }
 
+TEST(InMemoryFileTest, RangesOfPagesCanBeStored) {
+  using Page = Page<kFileSystemPageSize>;
+  ASSERT_OK_AND_ASSIGN(auto file, InMemoryFile<Page::kPageSize>::Open(""));
+
+  std::vector<Page> pages(3);
+  for (std::size_t i = 0; i < pages.size(); i++) {
+    pages[i].fill(std::byte(i + 1));
+  }
+  ASSERT_OK(StorePages(file, 1, std::as_bytes(std::span(pages))));
+  EXPECT_EQ(4, file.GetNumPages());
+
+  Page restored;
+  for (std::size_t i = 0; i < pages.size(); i++) {
+    ASSERT_OK(file.LoadPage(i + 1, restored));
+    EXPECT_EQ(pages[i], restored);
+  }
+}
+
 template <typename F>
 class SingleFileTest : public testing::Test {};
 
@@ -236,6 +259,29 @@ TYPED_TEST_P(SingleFileTest, LoadingUninitializedPagesLeadsToZeros) {
   EXPECT_EQ(zero, loaded);
 }
 
+TYPED_TEST_P(SingleFileTest, RangesOfPagesCanBeStored) {
+  using Page = Page<kFileSystemPageSize>;
+  using File = SingleFileBase<Page::kPageSize, TypeParam>;
+  TempFile temp_file;
+  ASSERT_OK_AND_ASSIGN(auto file, File::Open(temp_file.GetPath()));
+
+  std::vector<Page> pages(3);
+  for (std::size_t i = 0; i < pages.size(); i++) {
+    pages[i].fill(std::byte(i + 1));
+  }
+  ASSERT_OK(StorePages(file, 1, std::as_bytes(std::span(pages))));
+  EXPECT_EQ(4, file.GetNumPages());
+
+  Page zero{};
+  Page restored;
+  ASSERT_OK(file.LoadPage(0, restored));
+  EXPECT_EQ(zero, restored);
+  for (std::size_t i = 0; i < pages.size(); i++) {
+    ASSERT_OK(file.LoadPage(i + 1, restored));
+    EXPECT_EQ(pages[i], restored);
+  }
+}
+
 TYPED_TEST_P(SingleFileTest, EmptyFileCanBeClosedAndReopenedAsEmpty) {
   using Page = Page<kFileSystemPageSize>;
   using File = SingleFileBase<Page::kPageSize, TypeParam>;
@@ -275,6 +321,27 @@ TYPED_TEST_P(SingleFileTest,
   }
 }
 
+TYPED_TEST_P(SingleFileTest, ReservedSpaceIsNotPartOfTheFileSize) {
+  using Page = Page<kFileSystemPageSize>;
+  using File = SingleFileBase<Page::kPageSize, TypeParam>;
+  TempFile temp_file;
+  Page content{std::byte{0x01}, std::byte{0x02}};
+  {
+    ASSERT_OK_AND_ASSIGN(auto file, File::Open(temp_file));
+    for (int i = 0; i < 10; i++) {
+      EXPECT_OK(file.StorePage(i, content));
+    }
+    EXPECT_EQ(file.GetNumPages(), 10);
+    EXPECT_OK(file.Close());
+  }
+  EXPECT_EQ(std::filesystem::file_size(temp_file), 10 * Page::kPageSize);
+  {
+    ASSERT_OK_AND_ASSIGN(auto file, File::Open(temp_file));
+    EXPECT_EQ(file.GetNumPages(), 10);
+    EXPECT_OK(file.Close());
+  }
+}
+
 TYPED_TEST_P(SingleFileTest, OpenFileErrorIsHandled) {
   using Page = Page<kFileSystemPageSize>;
   using File = SingleFileBase<Page::kPageSize, TypeParam>;
@@ -292,14 +359,44 @@ REGISTER_TYPED_TEST_SUITE_P(SingleFileTest, IsFile, ExistingFileCanBeOpened,
                             PagesAreDifferentiated,
                             WritingPagesCreatesImplicitEmptyPages,
                             LoadingUninitializedPagesLeadsToZeros,
+                            RangesOfPagesCanBeStored,
                             EmptyFileCanBeClosedAndReopenedAsEmpty,
                             NonEmptyFileCanBeClosedAndReopenedWithSameContent,
+                            ReservedSpaceIsNotPartOfTheFileSize,
                             OpenFileErrorIsHandled);
 
 using RawFileTypes = ::testing::Types<internal::FStreamFile, internal::CFile,
                                       internal::PosixFile>;
 INSTANTIATE_TYPED_TEST_SUITE_P(My, SingleFileTest, RawFileTypes);
 
+template <typename F>
+class SparseFileTest : public testing::Test {};
+
+using SparseFileTypes = ::testing::Types<internal::CFile, internal::PosixFile>;
+TYPED_TEST_SUITE(SparseFileTest, SparseFileTypes);
+
+TYPED_TEST(SparseFileTest, GapsAreNotWrittenToDisk) {
+  using Page = Page<kFileSystemPageSize>;
+  using File = SingleFileBase<Page::kPageSize, TypeParam>;
+  constexpr std::size_t kFileSize = 1 << 26;
+  TempFile temp_file;
+  Page content{std::byte{0x01}, std::byte{0x02}};
+  {
+    ASSERT_OK_AND_ASSIGN(auto file, File::Open(temp_file));
+    EXPECT_OK(file.StorePage(kFileSize / Page::kPageSize - 1, content));
+    Page restored;
+    EXPECT_OK(file.LoadPage(kFileSize / Page::kPageSize / 2, restored));
+    EXPECT_EQ(restored, Page{});
+    EXPECT_OK(file.Close());
+  }
+  EXPECT_EQ(std::filesystem::file_size(temp_file), kFileSize);
+
+  // Only the last page and some file system metadata should occupy disk space.
+  struct stat info;
+  ASSERT_EQ(stat(temp_file.GetPath().c_str(), &info), 0);
+  EXPECT_LT(info.st_blocks * 512, kFileSize / 16);
+}
+
 class MockErrorFile {
  public:
   static absl::StatusOr<MockErrorFile> Open(const std::filesystem::path&) {
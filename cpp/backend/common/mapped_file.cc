@@ -0,0 +1,81 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+
+namespace carmen::backend {
+
+absl::StatusOr<MappedFile> MappedFile::Open(const std::filesystem::path& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return absl::InternalError(absl::StrCat(
+        "Failed to open file ", path.string(), ": ", std::strerror(errno)));
+  }
+  std::error_code error;
+  std::size_t size = std::filesystem::file_size(path, error);
+  if (error) {
+    close(fd);
+    return absl::InternalError(absl::StrCat("Failed to get size of file ",
+                                            path.string(), ": ",
+                                            error.message()));
+  }
+  // Empty files can not be mapped, but there is also nothing to be accessed.
+  if (size == 0) {
+    close(fd);
+    return MappedFile(nullptr, 0);
+  }
+  void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping remains valid after closing the file descriptor.
+  close(fd);
+  if (data == MAP_FAILED) {
+    return absl::InternalError(absl::StrCat(
+        "Failed to map file ", path.string(), ": ", std::strerror(errno)));
+  }
+  return MappedFile(static_cast<const std::byte*>(data), size);
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+  if (this != &other) {
+    Release();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() { Release(); }
+
+void MappedFile::Release() {
+  if (data_ != nullptr) {
+    munmap(const_cast<std::byte*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+}  // namespace carmen::backend
@@ -0,0 +1,53 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+#include "absl/status/statusor.h"
+
+namespace carmen::backend {
+
+// A MappedFile provides read-only access to the content of a file by mapping
+// it into the address space of the process. Pages of the file are loaded by
+// the operating system when being accessed for the first time and may be
+// evicted from memory under memory pressure, like any other cached file data.
+// Thus, large immutable data structures may be accessed in place, without
+// occupying heap memory or being loaded up front.
+//
+// The mapped file must not be modified while being mapped.
+class MappedFile {
+ public:
+  // Maps the content of the given file into memory.
+  static absl::StatusOr<MappedFile> Open(const std::filesystem::path& path);
+
+  MappedFile(MappedFile&&);
+  MappedFile& operator=(MappedFile&&);
+  ~MappedFile();
+
+  // Provides access to the content of the file. The start of the data is
+  // aligned to a file system page.
+  std::span<const std::byte> GetData() const { return {data_, size_}; }
+
+ private:
+  MappedFile(const std::byte* data, std::size_t size)
+      : data_(data), size_(size) {}
+
+  // Releases the held mapping, if any.
+  void Release();
+
+  const std::byte* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+}  // namespace carmen::backend
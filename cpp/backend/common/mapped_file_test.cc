@@ -0,0 +1,76 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/mapped_file.h"
+
+#include <cstddef>
+#include <fstream>
+#include <type_traits>
+#include <utility>
+
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::StatusIs;
+
+TEST(MappedFileTest, TypeProperties) {
+  EXPECT_FALSE(std::is_default_constructible_v<MappedFile>);
+  EXPECT_FALSE(std::is_copy_constructible_v<MappedFile>);
+  EXPECT_TRUE(std::is_move_constructible_v<MappedFile>);
+  EXPECT_TRUE(std::is_move_assignable_v<MappedFile>);
+}
+
+TEST(MappedFileTest, ContentOfFileCanBeRead) {
+  TempFile file;
+  {
+    std::ofstream out(file.GetPath(), std::ios::binary);
+    out << "abc";
+  }
+  ASSERT_OK_AND_ASSIGN(auto mapped, MappedFile::Open(file.GetPath()));
+  EXPECT_THAT(mapped.GetData(),
+              ElementsAre(std::byte{'a'}, std::byte{'b'}, std::byte{'c'}));
+}
+
+TEST(MappedFileTest, EmptyFilesCanBeMapped) {
+  TempFile file;
+  { std::ofstream out(file.GetPath(), std::ios::binary); }
+  ASSERT_OK_AND_ASSIGN(auto mapped, MappedFile::Open(file.GetPath()));
+  EXPECT_THAT(mapped.GetData(), IsEmpty());
+}
+
+TEST(MappedFileTest, MissingFilesAreReported) {
+  TempDir dir;
+  EXPECT_THAT(MappedFile::Open(dir.GetPath() / "missing"),
+              StatusIs(absl::StatusCode::kInternal, _));
+}
+
+TEST(MappedFileTest, MovingTransfersOwnership) {
+  TempFile file;
+  {
+    std::ofstream out(file.GetPath(), std::ios::binary);
+    out << "x";
+  }
+  ASSERT_OK_AND_ASSIGN(auto a, MappedFile::Open(file.GetPath()));
+  auto* data = a.GetData().data();
+  MappedFile b(std::move(a));
+  EXPECT_EQ(b.GetData().data(), data);
+  EXPECT_THAT(a.GetData(), IsEmpty());
+}
+
+}  // namespace
+}  // namespace carmen::backend
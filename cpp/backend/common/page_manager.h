@@ -10,22 +10,58 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "absl/container/btree_set.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
 #include "backend/common/page.h"
 #include "backend/common/page_id.h"
 #include "backend/common/page_pool.h"
+#include "common/memory_usage.h"
 #include "common/status_util.h"
 
 namespace carmen::backend {
 
+// The allocation state of a PageManager, to be persisted by the owner of the
+// manager, e.g. as part of the meta data page of a structure. Together with
+// the free list pages it refers to, it describes the full allocator state. The
+// free list pages are written to disk before the state is handed out, such
+// that a single page write of the owner's meta data switches from the previous
+// to the new allocator state.
+struct PageManagerState {
+  // The next fresh page ID to be used for allocating a page.
+  PageId next;
+  // The first page of the persisted list of free pages, or 0 if there are
+  // none. Page 0 can not be a free list page since it is never freed.
+  PageId free_list;
+  // The number of free pages recorded in the persisted free list.
+  std::uint64_t num_free;
+};
+
 // A page manager is like a memory manager organizing the life cycle of pages in
 // a single file, accessed through a page pool. It allows to create (=allocate)
 // new pages, resolve PageIDs to Pages (=dereferencing), and the freeing and
 // reusing of pages.
 //
+// Freed pages are retained in a free list and reused by subsequent
+// allocations, lowest ID first, such that new pages are placed close to the
+// start of the file and pages allocated in sequence are likely adjacent. Freed
+// pages at the end of the used range are dropped from the free list instead,
+// shrinking the range of used pages. When saving the manager's state, the free
+// list is written into free pages themselves, so it occupies no extra space.
+// Pages holding a saved free list are not reused before the owner confirmed
+// the persistence of a newer state, such that an interrupted flush leaves the
+// previously persisted state intact.
+//
 // NOTE: this is still work in progress; missing features:
-//  - free lists, for releasing and re-using pages
-//  - support for serializing the page managers state
 //  - support for computing the managers memory footprint
 //  - pinning of pages
 //
@@ -35,6 +71,11 @@ class PageManager {
   PageManager(PagePool pool = PagePool{}, PageId next = 0)
       : next_(next), pool_(std::move(pool)) {}
 
+  // Creates a page manager using the given pool and restores the allocation
+  // state previously obtained from SaveState() on a pool of the same file.
+  static absl::StatusOr<PageManager> Open(PagePool pool,
+                                          const PageManagerState& state);
+
   // The type returned when allocating a new page, including the new page's id
   // and a reference to the new page.
   template <Page Page>
@@ -45,14 +86,27 @@ class PageManager {
     Page& page;
   };
 
-  // Creates a new page and returns the new page's ID and a page reference.
+  // Creates a new page and returns the new page's ID and a page reference. The
+  // new page is zero-initialized and marked as dirty.
   template <Page Page>
-  absl::StatusOr<NewPage<Page>> New() {
-    PageId id = next_++;
-    ASSIGN_OR_RETURN(Page & page, pool_.template Get<Page>(id));
-    return NewPage<Page>{id, page};
+  absl::StatusOr<NewPage<Page>> New();
+
+  // Releases the given page, making it available for future allocations. It
+  // is the task of the caller to no longer use the page afterwards. Freeing
+  // pages that are not allocated is an error. Page 0 is reserved for meta data
+  // of the owner and can not be freed.
+  absl::Status Free(PageId id);
+
+  // Returns the number of pages currently in the free list, including pages
+  // holding a saved free list.
+  std::size_t GetNumFreePages() const {
+    return free_.size() + list_pages_.size() + pending_list_pages_.size();
   }
 
+  // Returns the ID of the page following the used range of pages. All pages
+  // with IDs below this are either allocated or in the free list.
+  PageId GetEndOfUsedPages() const { return next_; }
+
   // Resolves a page ID to a page reference. It is the task of the caller to
   // ensure the consistent usage of page types.
   template <Page Page>
@@ -64,18 +118,207 @@ class PageManager {
   // written back to the disk before being evicted or during a flush.
   void MarkAsDirty(PageId id) { pool_.MarkAsDirty(id); }
 
+  // Writes the free list into free pages, flushes all managed pages to disk,
+  // and returns the state to be persisted by the owner of this manager to
+  // restore it using Open(). Pages holding the free list of this or any
+  // previously saved state are not reused until CommitState() is called.
+  absl::StatusOr<PageManagerState> SaveState();
+
+  // Informs this manager that the owner has persisted the state returned by
+  // the last SaveState() call. Pages holding older free lists are released for
+  // reuse.
+  void CommitState();
+
   // Flushes the content of all managed pages to disk.
   absl::Status Flush() { return pool_.Flush(); }
 
   // Closes the underlying pool manager after flushing its content.
   absl::Status Close() { return pool_.Close(); }
 
+  // Summarizes the memory usage of this instance.
+  MemoryFootprint GetMemoryFootprint() const {
+    MemoryFootprint res(*this);
+    res.Add("pool", pool_.GetMemoryFootprint());
+    res.Add("free_list", SizeOf<PageId>() * free_.size());
+    return res;
+  }
+
  private:
+  // The page format used for persisting the free list. The first element is
+  // the ID of the next page of the list, or 0 for the last page, the second the
+  // number of IDs in this page, followed by the IDs of free pages. It is only
+  // resolved when being used, since not all pools define a File type.
+  template <typename Pool = PagePool>
+  using FreeListPage =
+      ArrayPage<PageId, Pool::File::kPageSize / sizeof(PageId)>;
+
+  // The number of free page IDs stored in a single free list page.
+  template <typename Pool = PagePool>
+  constexpr static std::size_t kIdsPerFreeListPage =
+      FreeListPage<Pool>::kNumElementsPerPage - 2;
+
   // The next page ID to be used for allocating a page.
   PageId next_;
 
+  // Drops free pages at the end of the used range from the free list.
+  void ReleaseTrailingPages();
+
+  // The IDs of freed pages below next_ available for reuse, ordered to reuse
+  // them in physical order.
+  absl::btree_set<PageId> free_;
+
+  // Free pages holding free lists that may still be referenced by the state
+  // persisted by the owner. They are listed as free in saved states, but not
+  // reused before the next CommitState().
+  std::vector<PageId> list_pages_;
+
+  // Free pages holding the free list written by the last SaveState() call,
+  // replacing list_pages_ on the next CommitState().
+  std::vector<PageId> pending_list_pages_;
+
   // The underlying page pool managing the actual file accesses.
   mutable PagePool pool_;
 };
 
+// ------------------------------- Definitions --------------------------------
+
+template <typename PagePool>
+absl::StatusOr<PageManager<PagePool>> PageManager<PagePool>::Open(
+    PagePool pool, const PageManagerState& state) {
+  PageManager manager(std::move(pool), state.next);
+  PageId cur = state.free_list;
+  while (cur != 0) {
+    manager.list_pages_.push_back(cur);
+    ASSIGN_OR_RETURN(FreeListPage<> & page,
+                     manager.template Get<FreeListPage<>>(cur));
+    if (page[1] > kIdsPerFreeListPage<>) {
+      return absl::InternalError("Invalid free list page.");
+    }
+    for (std::size_t i = 0; i < page[1]; i++) {
+      if (page[i + 2] == 0 || page[i + 2] >= state.next) {
+        return absl::InternalError("Invalid page ID in free list.");
+      }
+      manager.free_.insert(page[i + 2]);
+    }
+    cur = page[0];
+    if (manager.free_.size() > state.num_free ||
+        manager.list_pages_.size() > state.num_free) {
+      return absl::InternalError("Free list exceeds recorded size.");
+    }
+  }
+  if (manager.free_.size() != state.num_free) {
+    return absl::InternalError("Free list does not match recorded size.");
+  }
+  // The pages holding the list are retained until a new state is committed.
+  for (PageId id : manager.list_pages_) {
+    if (manager.free_.erase(id) == 0) {
+      return absl::InternalError("Free list page is not listed as free.");
+    }
+  }
+  return manager;
+}
+
+template <typename PagePool>
+template <Page Page>
+absl::StatusOr<typename PageManager<PagePool>::template NewPage<Page>>
+PageManager<PagePool>::New() {
+  PageId id = free_.empty() ? next_ : *free_.begin();
+  ASSIGN_OR_RETURN(Page & page, pool_.template Get<Page>(id));
+  if (free_.empty()) {
+    next_++;
+  } else {
+    free_.erase(free_.begin());
+  }
+  // Pages may have been used before, either from the free list or beyond the
+  // end of a shrunk range of used pages, so they need to be cleared.
+  std::ranges::fill(std::span<std::byte, sizeof(Page)>(page), std::byte{0});
+  pool_.MarkAsDirty(id);
+  return NewPage<Page>{id, page};
+}
+
+template <typename PagePool>
+absl::Status PageManager<PagePool>::Free(PageId id) {
+  if (id == 0 || id >= next_) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Unable to free page %d.", id));
+  }
+  if (std::ranges::find(list_pages_, id) != list_pages_.end() ||
+      std::ranges::find(pending_list_pages_, id) !=
+          pending_list_pages_.end() ||
+      !free_.insert(id).second) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Page %d is already free.", id));
+  }
+  ReleaseTrailingPages();
+  return absl::OkStatus();
+}
+
+template <typename PagePool>
+void PageManager<PagePool>::ReleaseTrailingPages() {
+  // Pages at the end of the used range are released entirely.
+  while (!free_.empty() && *free_.rbegin() == next_ - 1) {
+    free_.erase(std::prev(free_.end()));
+    next_--;
+  }
+}
+
+template <typename PagePool>
+absl::StatusOr<PageManagerState> PageManager<PagePool>::SaveState() {
+  // If the state of the last call was not committed, the owner may have
+  // persisted either this or the state before, so both lists are retained.
+  list_pages_.insert(list_pages_.end(), pending_list_pages_.begin(),
+                     pending_list_pages_.end());
+  pending_list_pages_.clear();
+
+  // The list is stored in the free pages with the highest IDs, since those are
+  // the last to be reused. Pages holding saved lists are not overwritten. If
+  // there are not enough other free pages, fresh pages are appended to the
+  // used range. The list pages themselves are listed as well.
+  std::vector<PageId> list;
+  auto candidate = free_.rbegin();
+  PageId end = next_;
+  while (list.size() * kIdsPerFreeListPage<> <
+         free_.size() + list_pages_.size() + (end - next_)) {
+    list.push_back(candidate != free_.rend() ? *candidate++ : end++);
+  }
+  for (; next_ < end; next_++) {
+    free_.insert(next_);
+  }
+
+  PageManagerState state{.next = next_,
+                         .free_list = 0,
+                         .num_free = free_.size() + list_pages_.size()};
+  std::vector<PageId> ids(free_.begin(), free_.end());
+  ids.insert(ids.end(), list_pages_.begin(), list_pages_.end());
+  auto entry = ids.begin();
+  for (PageId page_id : list) {
+    ASSIGN_OR_RETURN(FreeListPage<> & page,
+                     pool_.template Get<FreeListPage<>>(page_id));
+    page[0] = state.free_list;
+    page[1] = 0;
+    for (; entry != ids.end() && page[1] < kIdsPerFreeListPage<>; entry++) {
+      page[2 + page[1]++] = *entry;
+    }
+    pool_.MarkAsDirty(page_id);
+    state.free_list = page_id;
+  }
+
+  // The new list pages are not reused from here on, since the list may be
+  // partially written to disk by the following flush.
+  for (PageId page_id : list) {
+    free_.erase(page_id);
+  }
+  pending_list_pages_ = std::move(list);
+  RETURN_IF_ERROR(pool_.Flush());
+  return state;
+}
+
+template <typename PagePool>
+void PageManager<PagePool>::CommitState() {
+  free_.insert(list_pages_.begin(), list_pages_.end());
+  list_pages_ = std::move(pending_list_pages_);
+  pending_list_pages_.clear();
+  ReleaseTrailingPages();
+}
+
 }  // namespace carmen::backend
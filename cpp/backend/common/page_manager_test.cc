@@ -10,17 +10,29 @@
 
 #include "backend/common/page_manager.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <utility>
+
 #include "backend/common/file.h"
 #include "backend/common/page.h"
 #include "backend/common/page_id.h"
+#include "backend/common/page_pool.h"
+#include "common/file_util.h"
 #include "common/status_test_util.h"
+#include "common/status_util.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace carmen::backend {
 namespace {
 
+using ::testing::_;
 using ::testing::FieldsAre;
+using ::testing::HasSubstr;
 using ::testing::IsOkAndHolds;
 using ::testing::Return;
 using ::testing::StatusIs;
@@ -64,6 +76,226 @@ TEST(PageManager, PageIdsAreResolvedToCorrespondingPages) {
   EXPECT_EQ(&page2, &reload2);
 }
 
+TEST(PageManager, NewPagesAreZeroInitialized) {
+  TestPageManager manager;
+  for (int i = 0; i < 3; i++) {
+    ASSERT_OK_AND_ASSIGN(Page & page, manager.New<Page>());
+    page[0] = std::byte{1};
+    page[10] = std::byte{2};
+  }
+
+  // Page 1 is reused from the free list, page 2 beyond the used range.
+  ASSERT_OK(manager.Free(1));
+  ASSERT_OK(manager.Free(2));
+  for (int i = 1; i < 3; i++) {
+    ASSERT_OK_AND_ASSIGN((auto [id, page]), manager.New<Page>());
+    EXPECT_EQ(id, i);
+    EXPECT_EQ(page[0], std::byte{0});
+    EXPECT_EQ(page[10], std::byte{0});
+  }
+}
+
+TEST(PageManager, FreedPagesAreReusedInPhysicalOrder) {
+  TestPageManager manager;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(manager.New<Page>());
+  }
+  ASSERT_OK(manager.Free(7));
+  ASSERT_OK(manager.Free(2));
+  ASSERT_OK(manager.Free(5));
+  EXPECT_EQ(manager.GetNumFreePages(), 3);
+
+  EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(2, _)));
+  EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(5, _)));
+  EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(7, _)));
+  EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(10, _)));
+  EXPECT_EQ(manager.GetNumFreePages(), 0);
+}
+
+TEST(PageManager, FreeingTrailingPagesShrinksUsedRange) {
+  TestPageManager manager;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(manager.New<Page>());
+  }
+  EXPECT_EQ(manager.GetEndOfUsedPages(), 10);
+  ASSERT_OK(manager.Free(8));
+  ASSERT_OK(manager.Free(6));
+  EXPECT_EQ(manager.GetEndOfUsedPages(), 10);
+  ASSERT_OK(manager.Free(9));
+  EXPECT_EQ(manager.GetEndOfUsedPages(), 8);
+  ASSERT_OK(manager.Free(7));
+  EXPECT_EQ(manager.GetEndOfUsedPages(), 6);
+  EXPECT_EQ(manager.GetNumFreePages(), 0);
+  EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(6, _)));
+}
+
+TEST(PageManager, InvalidFreeOperationsAreRejected) {
+  TestPageManager manager;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(manager.New<Page>());
+  }
+  EXPECT_THAT(manager.Free(0), StatusIs(absl::StatusCode::kInvalidArgument,
+                                        HasSubstr("page 0")));
+  EXPECT_THAT(manager.Free(10), StatusIs(absl::StatusCode::kInvalidArgument,
+                                         HasSubstr("page 10")));
+  ASSERT_OK(manager.Free(4));
+  EXPECT_THAT(manager.Free(4), StatusIs(absl::StatusCode::kInvalidArgument,
+                                        HasSubstr("already free")));
+}
+
+TEST(PageManager, EmptyStateCanBeSavedAndRestored) {
+  TestPageManager manager;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(manager.New<Page>());
+  }
+  ASSERT_OK_AND_ASSIGN(auto state, manager.SaveState());
+  EXPECT_EQ(state.next, 10);
+  EXPECT_EQ(state.free_list, 0);
+  EXPECT_EQ(state.num_free, 0);
+
+  ASSERT_OK_AND_ASSIGN(auto restored,
+                       TestPageManager::Open(TestPagePool(), state));
+  EXPECT_EQ(restored.GetEndOfUsedPages(), 10);
+  EXPECT_EQ(restored.GetNumFreePages(), 0);
+}
+
+using FilePool = PagePool<SingleFile<kFileSystemPageSize>>;
+
+absl::StatusOr<FilePool> OpenPool(const std::filesystem::path& path) {
+  ASSIGN_OR_RETURN(auto file, SingleFile<kFileSystemPageSize>::Open(path));
+  return FilePool(
+      std::make_unique<SingleFile<kFileSystemPageSize>>(std::move(file)));
+}
+
+TEST(PageManager, FreeListCanBeSavedAndRestored) {
+  constexpr int kNumPages = 5000;
+  TempFile file;
+  PageManagerState state;
+
+  // Free every third page, requiring multiple free list pages.
+  {
+    ASSERT_OK_AND_ASSIGN(auto pool, OpenPool(file));
+    PageManager<FilePool> manager(std::move(pool));
+    for (int i = 0; i < kNumPages; i++) {
+      ASSERT_OK(manager.New<Page>());
+    }
+    for (int i = 1; i < kNumPages - 1; i += 3) {
+      ASSERT_OK(manager.Free(i));
+    }
+    ASSERT_OK_AND_ASSIGN(state, manager.SaveState());
+    EXPECT_EQ(state.next, kNumPages);
+    EXPECT_NE(state.free_list, 0);
+    EXPECT_EQ(state.num_free, manager.GetNumFreePages());
+    ASSERT_OK(manager.Close());
+  }
+
+  // The 1666 free page IDs are stored in the 4 free pages with the highest
+  // IDs, which are not reused before a new state is committed.
+  constexpr int kNumListPages = 4;
+  ASSERT_OK_AND_ASSIGN(auto pool, OpenPool(file));
+  ASSERT_OK_AND_ASSIGN(auto manager,
+                       PageManager<FilePool>::Open(std::move(pool), state));
+  EXPECT_EQ(manager.GetEndOfUsedPages(), kNumPages);
+  EXPECT_EQ(manager.GetNumFreePages(), state.num_free);
+  for (int i = 1; i < kNumPages - 1 - 3 * kNumListPages; i += 3) {
+    EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(i, _)));
+  }
+  EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(kNumPages, _)));
+  EXPECT_EQ(manager.GetNumFreePages(), kNumListPages);
+}
+
+TEST(PageManager, InterruptedSaveKeepsPersistedStateRestorable) {
+  TempFile file;
+  PageManagerState persisted;
+  PageManagerState interrupted;
+  {
+    ASSERT_OK_AND_ASSIGN(auto pool, OpenPool(file));
+    PageManager<FilePool> manager(std::move(pool));
+    for (int i = 0; i < 10; i++) {
+      ASSERT_OK(manager.New<Page>());
+    }
+    ASSERT_OK(manager.Free(3));
+    ASSERT_OK(manager.Free(5));
+    ASSERT_OK_AND_ASSIGN(persisted, manager.SaveState());
+    manager.CommitState();
+
+    // The owner fails to persist the next state. Meanwhile, new pages are
+    // allocated and written to disk, without reusing any list page.
+    ASSERT_OK(manager.Free(7));
+    ASSERT_OK_AND_ASSIGN(interrupted, manager.SaveState());
+    EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(3, _)));
+    EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(10, _)));
+    for (PageId id : {3, 10}) {
+      ASSERT_OK_AND_ASSIGN(Page & page, manager.Get<Page>(id));
+      std::ranges::fill(std::span<std::byte, sizeof(Page)>(page),
+                        std::byte{0xFF});
+      manager.MarkAsDirty(id);
+    }
+    ASSERT_OK(manager.Close());
+  }
+
+  // Both the persisted and the interrupted state can be restored.
+  ASSERT_OK_AND_ASSIGN(auto pool, OpenPool(file));
+  ASSERT_OK_AND_ASSIGN(auto manager,
+                       PageManager<FilePool>::Open(std::move(pool), persisted));
+  EXPECT_EQ(manager.GetEndOfUsedPages(), 10);
+  EXPECT_EQ(manager.GetNumFreePages(), 2);
+
+  ASSERT_OK_AND_ASSIGN(pool, OpenPool(file));
+  ASSERT_OK_AND_ASSIGN(
+      manager, PageManager<FilePool>::Open(std::move(pool), interrupted));
+  EXPECT_EQ(manager.GetEndOfUsedPages(), 10);
+  EXPECT_EQ(manager.GetNumFreePages(), 3);
+}
+
+TEST(PageManager, ListPagesAreReusedOnceNewerStateIsCommitted) {
+  TestPageManager manager;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(manager.New<Page>());
+  }
+  ASSERT_OK(manager.Free(3));
+  ASSERT_OK(manager.Free(5));
+  ASSERT_OK(manager.SaveState());
+  manager.CommitState();
+
+  // Page 5 holds the committed list, page 3 the new one.
+  ASSERT_OK(manager.SaveState());
+  manager.CommitState();
+  EXPECT_EQ(manager.GetNumFreePages(), 2);
+  EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(5, _)));
+  EXPECT_THAT(manager.New<Page>(), IsOkAndHolds(FieldsAre(10, _)));
+}
+
+TEST(PageManager, InconsistentStateIsDetectedOnRestore) {
+  TempFile file;
+  PageManagerState state;
+  {
+    ASSERT_OK_AND_ASSIGN(auto pool, OpenPool(file));
+    PageManager<FilePool> manager(std::move(pool));
+    for (int i = 0; i < 10; i++) {
+      ASSERT_OK(manager.New<Page>());
+    }
+    ASSERT_OK(manager.Free(3));
+    ASSERT_OK(manager.Free(5));
+    ASSERT_OK_AND_ASSIGN(state, manager.SaveState());
+    ASSERT_OK(manager.Close());
+  }
+
+  // A mismatch in the number of free pages is detected.
+  auto wrong_size = state;
+  wrong_size.num_free = 1;
+  ASSERT_OK_AND_ASSIGN(auto pool, OpenPool(file));
+  EXPECT_THAT(PageManager<FilePool>::Open(std::move(pool), wrong_size),
+              StatusIs(absl::StatusCode::kInternal, HasSubstr("size")));
+
+  // Free pages beyond the end of the used range are detected.
+  auto wrong_end = state;
+  wrong_end.next = 4;
+  ASSERT_OK_AND_ASSIGN(pool, OpenPool(file));
+  EXPECT_THAT(PageManager<FilePool>::Open(std::move(pool), wrong_end),
+              StatusIs(absl::StatusCode::kInternal, HasSubstr("page ID")));
+}
+
 // A mock version of a page pool to test PageManager internals.
 class MockPagePool {
  public:
@@ -100,6 +332,8 @@ TEST(PageManager, NewPageProducesFreshIdAndLoadsMatchingPage) {
   Page page1;
   EXPECT_CALL(mock, Get(0)).WillOnce(Return(StatusOrRef<Page>(page0)));
   EXPECT_CALL(mock, Get(1)).WillOnce(Return(StatusOrRef<Page>(page1)));
+  EXPECT_CALL(mock, MarkAsDirty(0));
+  EXPECT_CALL(mock, MarkAsDirty(1));
 
   EXPECT_THAT(manager.New<Page>(),
               IsOkAndHolds(FieldsAre(0, testing::Address(&page0))));
@@ -116,6 +350,8 @@ TEST(PageManager, StartingOffsetOfPageManagerIsUsed) {
   Page page43;
   EXPECT_CALL(mock, Get(42)).WillOnce(Return(StatusOrRef<Page>(page42)));
   EXPECT_CALL(mock, Get(43)).WillOnce(Return(StatusOrRef<Page>(page43)));
+  EXPECT_CALL(mock, MarkAsDirty(42));
+  EXPECT_CALL(mock, MarkAsDirty(43));
 
   EXPECT_THAT(manager.New<Page>(),
               IsOkAndHolds(FieldsAre(42, testing::Address(&page42))));
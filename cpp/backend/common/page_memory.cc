@@ -0,0 +1,148 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/page_memory.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+#include <utility>
+
+#include "backend/common/page.h"
+
+namespace carmen::backend {
+
+namespace {
+
+// Rounds the given size up to the next multiple of the given alignment.
+std::size_t RoundUp(std::size_t size, std::size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// Maps a block of anonymous memory of the given size using the given extra
+// flags. Returns nullptr if the mapping failed.
+std::byte* Map(std::size_t size, int flags) {
+  void* res = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+  return res == MAP_FAILED ? nullptr : static_cast<std::byte*>(res);
+}
+
+// Maps a block of anonymous memory of the given size starting at an address
+// aligned to the given alignment. This is achieved by mapping a larger block
+// and unmapping the excess memory before and after the aligned range. Returns
+// nullptr if the mapping failed.
+std::byte* MapAligned(std::size_t size, std::size_t alignment) {
+  std::byte* raw = Map(size + alignment, 0);
+  if (raw == nullptr) {
+    return nullptr;
+  }
+  auto begin = reinterpret_cast<std::uintptr_t>(raw);
+  auto head = RoundUp(begin, alignment) - begin;
+  auto tail = alignment - head;
+  if (head > 0) {
+    munmap(raw, head);
+  }
+  if (tail > 0) {
+    munmap(raw + head + size, tail);
+  }
+  return raw + head;
+}
+
+}  // namespace
+
+std::ostream& operator<<(std::ostream& out, HugePages mode) {
+  switch (mode) {
+    case HugePages::kDisabled:
+      return out << "disabled";
+    case HugePages::kTransparent:
+      return out << "transparent";
+    case HugePages::kExplicit:
+      return out << "explicit";
+  }
+  return out << "unknown";
+}
+
+PageMemory::PageMemory(std::size_t size, HugePages requested) {
+  // Huge pages are only worth it if at least one of them can be filled.
+  auto huge_pages = size < kHugePageSize ? HugePages::kDisabled : requested;
+
+#ifdef MAP_HUGETLB
+  // Explicit huge pages need to be reserved by the system administrator. If
+  // there are not enough of those available, the mapping fails.
+  if (huge_pages == HugePages::kExplicit) {
+    size_ = RoundUp(size, kHugePageSize);
+    data_ = Map(size_, MAP_HUGETLB);
+    if (data_ != nullptr) {
+      huge_pages_ = HugePages::kExplicit;
+      return;
+    }
+    huge_pages = HugePages::kTransparent;
+  }
+#endif
+
+#ifdef MADV_HUGEPAGE
+  // Transparent huge pages can only be used for ranges aligned to huge pages.
+  if (huge_pages != HugePages::kDisabled) {
+    size_ = RoundUp(size, kHugePageSize);
+    data_ = MapAligned(size_, kHugePageSize);
+    if (data_ != nullptr) {
+      madvise(data_, size_, MADV_HUGEPAGE);
+      huge_pages_ = HugePages::kTransparent;
+      return;
+    }
+  }
+#endif
+
+  size_ = RoundUp(std::max<std::size_t>(size, 1), kFileSystemPageSize);
+  data_ = Map(size_, 0);
+  if (data_ == nullptr) {
+    throw std::bad_alloc();
+  }
+  huge_pages_ = HugePages::kDisabled;
+
+#ifdef MADV_NOHUGEPAGE
+  // Systems may be configured to use transparent huge pages by default. If
+  // regular pages are explicitly requested, this default is disabled.
+  if (requested == HugePages::kDisabled) {
+    madvise(data_, size_, MADV_NOHUGEPAGE);
+  }
+#endif
+}
+
+PageMemory::PageMemory(PageMemory&& other)
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      huge_pages_(other.huge_pages_) {}
+
+PageMemory& PageMemory::operator=(PageMemory&& other) {
+  if (this != &other) {
+    Release();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    huge_pages_ = other.huge_pages_;
+  }
+  return *this;
+}
+
+PageMemory::~PageMemory() { Release(); }
+
+void PageMemory::Release() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+}  // namespace carmen::backend
@@ -0,0 +1,73 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+
+namespace carmen::backend {
+
+// The size of huge pages requested from the operating system.
+constexpr static const std::size_t kHugePageSize = 1 << 21;  // 2 MiB
+
+// Defines the preferred kind of memory pages backing a PageMemory block.
+enum class HugePages {
+  // Only regular pages of the OS are used.
+  kDisabled,
+  // Transparent huge pages are requested through madvise.
+  kTransparent,
+  // Explicitly reserved huge pages are used if available; otherwise falls back
+  // to transparent huge pages.
+  kExplicit,
+};
+
+std::ostream& operator<<(std::ostream& out, HugePages mode);
+
+// A PageMemory is a contiguous block of anonymous memory mapped into the
+// address space of the process, intended to hold large collections of pages
+// like the content of a PagePool. The memory is zero-initialized and only
+// committed by the operating system when being touched for the first time.
+//
+// Blocks of at least kHugePageSize bytes may be backed by huge pages, reducing
+// the number of TLB entries required for accessing them. If the requested kind
+// of huge pages is not supported by the system, regular pages are used.
+class PageMemory {
+ public:
+  // Maps a block of at least the given number of bytes. Throws std::bad_alloc
+  // if the memory can not be mapped.
+  explicit PageMemory(std::size_t size,
+                      HugePages huge_pages = HugePages::kExplicit);
+
+  PageMemory(PageMemory&&);
+  PageMemory& operator=(PageMemory&&);
+  ~PageMemory();
+
+  // Provides access to the start of the memory block, aligned to a file system
+  // page, or to a huge page if huge pages are used.
+  std::byte* Data() const { return data_; }
+
+  // Returns the size of this memory block in bytes.
+  std::size_t GetSize() const { return size_; }
+
+  // Returns the kind of huge pages backing this block. For transparent huge
+  // pages this is a hint only, since the OS may decide not to follow it.
+  HugePages GetHugePages() const { return huge_pages_; }
+
+ private:
+  // Releases the held memory block, if any.
+  void Release();
+
+  std::byte* data_ = nullptr;
+  std::size_t size_ = 0;
+  HugePages huge_pages_ = HugePages::kDisabled;
+};
+
+}  // namespace carmen::backend
@@ -0,0 +1,116 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/page_memory.h"
+
+#include <cstdint>
+#include <sstream>
+#include <type_traits>
+#include <utility>
+
+#include "backend/common/page.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend {
+namespace {
+
+using ::testing::AnyOf;
+using ::testing::Eq;
+using ::testing::Ge;
+
+TEST(PageMemoryTest, TypeProperties) {
+  EXPECT_FALSE(std::is_default_constructible_v<PageMemory>);
+  EXPECT_FALSE(std::is_copy_constructible_v<PageMemory>);
+  EXPECT_TRUE(std::is_move_constructible_v<PageMemory>);
+  EXPECT_FALSE(std::is_copy_assignable_v<PageMemory>);
+  EXPECT_TRUE(std::is_move_assignable_v<PageMemory>);
+}
+
+TEST(PageMemoryTest, HugePagesCanBePrinted) {
+  std::stringstream out;
+  out << HugePages::kDisabled << "," << HugePages::kTransparent << ","
+      << HugePages::kExplicit;
+  EXPECT_EQ(out.str(), "disabled,transparent,explicit");
+}
+
+TEST(PageMemoryTest, SmallBlocksUseRegularPages) {
+  for (auto mode : {HugePages::kDisabled, HugePages::kTransparent,
+                    HugePages::kExplicit}) {
+    PageMemory memory(3 * kFileSystemPageSize, mode);
+    EXPECT_EQ(memory.GetSize(), 3 * kFileSystemPageSize);
+    EXPECT_EQ(memory.GetHugePages(), HugePages::kDisabled);
+  }
+}
+
+TEST(PageMemoryTest, SizeIsRoundedUpToFullPages) {
+  PageMemory memory(1, HugePages::kDisabled);
+  EXPECT_EQ(memory.GetSize(), kFileSystemPageSize);
+}
+
+TEST(PageMemoryTest, RegularPagesCanBeRequested) {
+  PageMemory memory(4 * kHugePageSize, HugePages::kDisabled);
+  EXPECT_EQ(memory.GetSize(), 4 * kHugePageSize);
+  EXPECT_EQ(memory.GetHugePages(), HugePages::kDisabled);
+}
+
+TEST(PageMemoryTest, HugePagesAreUsedIfSupported) {
+  PageMemory memory(4 * kHugePageSize + 1, HugePages::kTransparent);
+  EXPECT_THAT(memory.GetHugePages(),
+              AnyOf(Eq(HugePages::kTransparent), Eq(HugePages::kDisabled)));
+  if (memory.GetHugePages() == HugePages::kTransparent) {
+    EXPECT_EQ(memory.GetSize(), 5 * kHugePageSize);
+  }
+}
+
+TEST(PageMemoryTest, MemoryIsAlignedToUsedPageSize) {
+  for (auto mode : {HugePages::kDisabled, HugePages::kTransparent,
+                    HugePages::kExplicit}) {
+    PageMemory memory(8 * kHugePageSize, mode);
+    auto address = reinterpret_cast<std::uintptr_t>(memory.Data());
+    EXPECT_EQ(address % kFileSystemPageSize, 0);
+    if (memory.GetHugePages() != HugePages::kDisabled) {
+      EXPECT_EQ(address % kHugePageSize, 0);
+    }
+  }
+}
+
+TEST(PageMemoryTest, MemoryIsZeroInitializedAndWritable) {
+  for (auto mode : {HugePages::kDisabled, HugePages::kTransparent,
+                    HugePages::kExplicit}) {
+    PageMemory memory(2 * kHugePageSize, mode);
+    ASSERT_THAT(memory.GetSize(), Ge(2 * kHugePageSize));
+    for (std::size_t i = 0; i < memory.GetSize(); i += kFileSystemPageSize) {
+      EXPECT_EQ(memory.Data()[i], std::byte{0});
+      memory.Data()[i] = std::byte{1};
+    }
+    for (std::size_t i = 0; i < memory.GetSize(); i += kFileSystemPageSize) {
+      EXPECT_EQ(memory.Data()[i], std::byte{1});
+    }
+  }
+}
+
+TEST(PageMemoryTest, MovingTransfersOwnership) {
+  PageMemory a(kFileSystemPageSize, HugePages::kDisabled);
+  a.Data()[0] = std::byte{42};
+  auto* data = a.Data();
+
+  PageMemory b(std::move(a));
+  EXPECT_EQ(b.Data(), data);
+  EXPECT_EQ(b.Data()[0], std::byte{42});
+
+  PageMemory c(kFileSystemPageSize, HugePages::kDisabled);
+  c = std::move(b);
+  EXPECT_EQ(c.Data(), data);
+  EXPECT_EQ(c.Data()[0], std::byte{42});
+}
+
+}  // namespace
+}  // namespace carmen::backend
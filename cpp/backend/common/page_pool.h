@@ -12,14 +12,17 @@
 
 #include <memory>
 #include <optional>
+#include <span>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "backend/common/compressed_page_cache.h"
 #include "backend/common/eviction_policy.h"
 #include "backend/common/file.h"
 #include "backend/common/page.h"
+#include "backend/common/page_memory.h"
+#include "backend/common/page_table.h"
 #include "common/memory_usage.h"
 #include "common/status_util.h"
 
@@ -46,11 +49,14 @@ class PagePool {
   using EvictionPolicy = E;
 
   // Creates a pool backed by a default instance of the pools File
-  // implementation.
-  PagePool(std::size_t pool_size = 100000);
+  // implementation. The memory of the pool is backed by huge pages if
+  // available, see PageMemory.
+  PagePool(std::size_t pool_size = 100000,
+           HugePages huge_pages = HugePages::kExplicit);
 
   // Creates a pool instance backed by the provided File.
-  PagePool(std::unique_ptr<File> file, std::size_t pool_size = 100000);
+  PagePool(std::unique_ptr<File> file, std::size_t pool_size = 100000,
+           HugePages huge_pages = HugePages::kExplicit);
 
   // Returns the maximum number of pages to be retained in this pool.
   std::size_t GetPoolSize() const { return pool_size_; }
@@ -67,9 +73,26 @@ class PagePool {
   // TODO: find an implicit way to trace dirty pages
   void MarkAsDirty(PageId id);
 
+  // Informs the pool whether evicting the given page involves work beyond
+  // writing it back, e.g. hashing performed by listeners. This is forwarded to
+  // cost aware eviction policies; other policies ignore it.
+  void SetPendingWork(PageId id, bool pending);
+
   // Registers a page pool listener monitoring events.
   void AddListener(std::unique_ptr<Listener> listener);
 
+  // Enables a second cache tier retaining compressed copies of evicted pages
+  // using up to the given number of bytes, see CompressedPageCache. Pages found
+  // in this tier are not reloaded from the file. A capacity of zero disables
+  // the tier, which is the default. File-based structures enable it according
+  // to the PagePoolOptions of the context they are opened with.
+  void EnableCompressedCache(std::size_t capacity);
+
+  // Returns the compressed second cache tier, or nullptr if it is disabled.
+  const CompressedPageCache* GetCompressedCache() const {
+    return compressed_cache_.get();
+  }
+
   // Synchronizes all pages in the pool by writing all dirty pages out to disk.
   // Does not affect the content of the pool, nor are page accesses reported to
   // the pool policies.
@@ -95,11 +118,14 @@ class PagePool {
   // The file used for loading and storing pages.
   std::unique_ptr<File> file_;
 
-  // The page pool, containing the actual data. It is using a pointer instead of
-  // a vector because this makes its initialization faster (vector is
-  // initializing each individual page).
-  // TODO: test whether this is still fast during initialization.
-  std::unique_ptr<RawPage<F::kPageSize>[]> pool_;
+  // The memory backing the page pool. It is mapped without being initialized
+  // and committed by the OS as slots get used for the first time. Slots are
+  // handed out in address order, such that the committed range grows
+  // incrementally.
+  PageMemory memory_;
+
+  // The page pool, containing the actual data, located in memory_.
+  RawPage<F::kPageSize>* pool_;
 
   // The number of pages in this pool.
   std::size_t pool_size_;
@@ -111,8 +137,9 @@ class PagePool {
   // stored to disk before being evicted.
   std::vector<bool> dirty_;
 
-  // Indexes recording which page is in which pool position.
-  absl::flat_hash_map<PageId, int> pages_to_index_;
+  // Indexes recording which page is in which pool position. Since page IDs are
+  // usually dense, the page table is mostly a plain array.
+  PageTable pages_to_index_;
   std::vector<PageId> index_to_pages_;
 
   // A list of free slots, used like a FIFO.
@@ -120,6 +147,10 @@ class PagePool {
 
   // A list of listeners observing the page pool state.
   std::vector<std::unique_ptr<Listener>> listeners_;
+
+  // An optional second cache tier holding compressed copies of clean pages
+  // evicted from this pool.
+  std::unique_ptr<CompressedPageCache> compressed_cache_;
 };
 
 // A PagePoolListener provides an observer interface to the activities within a
@@ -139,18 +170,20 @@ class PagePoolListener {
 // ------------------------------- Definitions --------------------------------
 
 template <File F, EvictionPolicy E>
-PagePool<F, E>::PagePool(std::size_t pool_size)
-    : PagePool(std::make_unique<File>(), pool_size) {}
+PagePool<F, E>::PagePool(std::size_t pool_size, HugePages huge_pages)
+    : PagePool(std::make_unique<File>(), pool_size, huge_pages) {}
 
 template <File F, EvictionPolicy E>
-PagePool<F, E>::PagePool(std::unique_ptr<File> file, std::size_t pool_size)
+PagePool<F, E>::PagePool(std::unique_ptr<File> file, std::size_t pool_size,
+                         HugePages huge_pages)
     : file_(std::move(file)),
-      pool_(new RawPage<F::kPageSize>[pool_size]),
+      memory_(sizeof(RawPage<F::kPageSize>) * pool_size, huge_pages),
+      pool_(reinterpret_cast<RawPage<F::kPageSize>*>(memory_.Data())),
       pool_size_(pool_size),
-      eviction_policy_(pool_size) {
+      eviction_policy_(pool_size),
+      pages_to_index_(pool_size, sizeof(RawPage<F::kPageSize>)) {
   dirty_.resize(pool_size);
   index_to_pages_.resize(pool_size);
-  pages_to_index_.reserve(pool_size);
   free_list_.reserve(pool_size);
   for (std::size_t i = 0; i < pool_size; i++) {
     free_list_.push_back(pool_size - i - 1);
@@ -161,17 +194,21 @@ template <File F, EvictionPolicy E>
 template <Page Page>
 StatusOrRef<Page> PagePool<F, E>::Get(PageId id) {
   // Try to locate the page in the pool first.
-  auto pos = pages_to_index_.find(id);
-  if (pos != pages_to_index_.end()) {
-    eviction_policy_.Read(pos->second);
-    return pool_[pos->second].template As<Page>();
+  auto pos = pages_to_index_.Find(id);
+  if (pos != PageTable::kNoSlot) {
+    eviction_policy_.Read(pos);
+    return pool_[pos].template As<Page>();
   }
 
-  // The page is missing, so we need to load it from disk.
+  // The page is missing, so we need to load it from the compressed cache or
+  // from disk.
   ASSIGN_OR_RETURN(auto idx, GetFreeSlot());
   Page& page = pool_[idx].template As<Page>();
-  RETURN_IF_ERROR(file_->LoadPage(id, page));
-  pages_to_index_[id] = idx;
+  std::span<std::byte, F::kPageSize> data = pool_[idx];
+  if (!compressed_cache_ || !compressed_cache_->Take(id, data)) {
+    RETURN_IF_ERROR(file_->LoadPage(id, page));
+  }
+  pages_to_index_.Insert(id, idx);
   index_to_pages_[idx] = id;
   eviction_policy_.Read(idx);
 
@@ -185,10 +222,20 @@ StatusOrRef<Page> PagePool<F, E>::Get(PageId id) {
 
 template <File F, EvictionPolicy E>
 void PagePool<F, E>::MarkAsDirty(PageId id) {
-  auto pos = pages_to_index_.find(id);
-  if (pos != pages_to_index_.end()) {
-    dirty_[pos->second] = true;
-    eviction_policy_.Written(pos->second);
+  auto pos = pages_to_index_.Find(id);
+  if (pos != PageTable::kNoSlot) {
+    dirty_[pos] = true;
+    eviction_policy_.Written(pos);
+  }
+}
+
+template <File F, EvictionPolicy E>
+void PagePool<F, E>::SetPendingWork(PageId id, bool pending) {
+  if constexpr (CostAwareEvictionPolicy<E>) {
+    auto pos = pages_to_index_.Find(id);
+    if (pos != PageTable::kNoSlot) {
+      eviction_policy_.SetPendingWork(pos, pending);
+    }
   }
 }
 
@@ -199,6 +246,15 @@ void PagePool<F, E>::AddListener(std::unique_ptr<Listener> listener) {
   }
 }
 
+template <File F, EvictionPolicy E>
+void PagePool<F, E>::EnableCompressedCache(std::size_t capacity) {
+  if (capacity == 0) {
+    compressed_cache_.reset();
+  } else {
+    compressed_cache_ = std::make_unique<CompressedPageCache>(capacity);
+  }
+}
+
 template <File F, EvictionPolicy E>
 absl::Status PagePool<F, E>::Flush() {
   if (!file_) {
@@ -208,6 +264,9 @@ absl::Status PagePool<F, E>::Flush() {
     if (!dirty_[i]) continue;
     RETURN_IF_ERROR(file_->StorePage(index_to_pages_[i], pool_[i]));
     dirty_[i] = false;
+    if constexpr (CostAwareEvictionPolicy<E>) {
+      eviction_policy_.Cleaned(i);
+    }
   }
   return absl::OkStatus();
 }
@@ -226,10 +285,13 @@ MemoryFootprint PagePool<F, E>::GetMemoryFootprint() const {
   MemoryFootprint res(*this);
   res.Add("pool", Memory(F::kPageSize * pool_size_));
   res.Add("dirty", Memory(dirty_.size() / 8 + 1));
-  res.Add("pages_to_index", SizeOf(pages_to_index_));
+  res.Add("pages_to_index", pages_to_index_.GetMemoryFootprint());
   res.Add("index_to_pages", SizeOf(index_to_pages_));
   res.Add("free_list", SizeOf(free_list_));
   res.Add("listeners", SizeOf(listeners_));
+  if (compressed_cache_) {
+    res.Add("compressed_cache", compressed_cache_->GetMemoryFootprint());
+  }
   return res;
 }
 
@@ -270,8 +332,14 @@ absl::Status PagePool<F, E>::EvictSlot(int pos) {
     dirty_[pos] = false;
   }
 
+  // Retain a compressed copy of the now clean page.
+  if (compressed_cache_) {
+    compressed_cache_->Add(
+        page_id, std::span<const std::byte, F::kPageSize>(pool_[pos]));
+  }
+
   // Erase page ID association of slot.
-  pages_to_index_.erase(page_id);
+  pages_to_index_.Erase(page_id);
   eviction_policy_.Removed(pos);
   return absl::OkStatus();
 }
@@ -14,6 +14,7 @@
 #include "backend/common/access_pattern.h"
 #include "backend/common/eviction_policy.h"
 #include "backend/common/page.h"
+#include "backend/common/page_memory.h"
 #include "backend/common/page_pool.h"
 #include "benchmark/benchmark.h"
 #include "common/status_test_util.h"
@@ -119,5 +120,35 @@ BENCHMARK(BM_WriteTest<Exponential, RandomEvictionPolicy>)
 BENCHMARK(BM_WriteTest<Exponential, LeastRecentlyUsedEvictionPolicy>)
     ->Range(kMinPoolSize, kMaxPoolSize);
 
+// Evaluates the performance of accessing pages already present in page pools of
+// different sizes backed by different kinds of memory pages. Since no page is
+// evicted, this is dominated by the lookup of pages and the address
+// translation for accessing their content, which for large pools is limited
+// by the reach of the TLB.
+template <HugePages huge_pages>
+void BM_PoolSizeVsTlb(benchmark::State& state) {
+  auto pool_size = state.range(0);
+  TestPool<LeastRecentlyUsedEvictionPolicy> pool(pool_size, huge_pages);
+
+  // Warm-up by touching each page once.
+  for (int64_t i = 0; i < pool_size; i++) {
+    ASSERT_OK(pool.template Get<Page>(i));
+  }
+
+  Uniform order(pool_size);
+  for (auto _ : state) {
+    auto pos = order.Next();
+    ASSERT_OK_AND_ASSIGN(Page & page, pool.template Get<Page>(pos));
+    benchmark::DoNotOptimize(page[pos % Page::kNumElementsPerPage]);
+  }
+}
+
+BENCHMARK(BM_PoolSizeVsTlb<HugePages::kDisabled>)
+    ->Range(kMinPoolSize, kMaxPoolSize);
+BENCHMARK(BM_PoolSizeVsTlb<HugePages::kTransparent>)
+    ->Range(kMinPoolSize, kMaxPoolSize);
+BENCHMARK(BM_PoolSizeVsTlb<HugePages::kExplicit>)
+    ->Range(kMinPoolSize, kMaxPoolSize);
+
 }  // namespace
 }  // namespace carmen::backend
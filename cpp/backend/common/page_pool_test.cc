@@ -219,6 +219,73 @@ TEST(PagePoolTest, ClosingPoolFlushesPagesAndClosesFile) {
   ASSERT_OK(pool.Close());
 }
 
+TEST(PagePoolTest, CompressedCacheIsDisabledByDefault) {
+  TestPool pool(2);
+  EXPECT_EQ(pool.GetCompressedCache(), nullptr);
+  pool.EnableCompressedCache(1 << 20);
+  ASSERT_NE(pool.GetCompressedCache(), nullptr);
+  EXPECT_EQ(pool.GetCompressedCache()->GetCapacity(), 1 << 20);
+  pool.EnableCompressedCache(0);
+  EXPECT_EQ(pool.GetCompressedCache(), nullptr);
+}
+
+TEST(PagePoolTest, EvictedPagesAreServedFromCompressedCache) {
+  auto file = std::make_unique<MockFile>();
+  auto& mock = *file;
+  PagePool<MockFile> pool(std::move(file), 1);
+  pool.EnableCompressedCache(1 << 20);
+
+  // Each page is only loaded once from the file.
+  EXPECT_CALL(mock, LoadPage(0, _));
+  EXPECT_CALL(mock, LoadPage(1, _));
+
+  ASSERT_OK_AND_ASSIGN(Page & page, pool.Get<Page>(0));
+  page[0] = 42;
+  pool.MarkAsDirty(0);
+
+  // Evicting the dirty page 0 writes it to the file before compressing it.
+  EXPECT_CALL(mock, StorePage(0, _));
+  ASSERT_OK(pool.Get<Page>(1));
+  EXPECT_EQ(pool.GetCompressedCache()->GetNumPages(), 1);
+
+  ASSERT_OK_AND_ASSIGN(Page & restored, pool.Get<Page>(0));
+  EXPECT_EQ(restored[0], 42);
+  EXPECT_EQ(pool.GetCompressedCache()->GetNumPages(), 1);
+  ASSERT_OK(pool.Get<Page>(1));
+}
+
+TEST(PagePoolTest, ListenersAreNotifiedOnLoadFromCompressedCache) {
+  TestPool pool(1);
+  pool.EnableCompressedCache(1 << 20);
+  auto listener = std::make_unique<NiceMock<MockListener>>();
+  MockListener& mock = *listener.get();
+  pool.AddListener(std::move(listener));
+
+  Sequence s;
+  EXPECT_CALL(mock, AfterLoad(0, _)).InSequence(s);
+  EXPECT_CALL(mock, AfterLoad(1, _)).InSequence(s);
+  EXPECT_CALL(mock, AfterLoad(0, _)).InSequence(s);
+
+  ASSERT_OK(pool.Get<Page>(0));
+  ASSERT_OK(pool.Get<Page>(1));
+  ASSERT_OK(pool.Get<Page>(0));
+}
+
+TEST(PagePoolTest, PagesModifiedAfterLeavingCompressedCacheAreNotLost) {
+  constexpr int kNumPages = 8;
+  TestPool pool(2);
+  pool.EnableCompressedCache(1 << 20);
+
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < kNumPages; i++) {
+      ASSERT_OK_AND_ASSIGN(Page & page, pool.Get<Page>(i));
+      EXPECT_EQ(page[0], round * i);
+      page[0] = (round + 1) * i;
+      pool.MarkAsDirty(i);
+    }
+  }
+}
+
 class MockEvictionPolicy {
  public:
   MockEvictionPolicy(std::size_t = 0) {}
@@ -308,6 +375,72 @@ TEST(PagePoolTest, OnFallBackEvictionPolicyIsInformed) {
   ASSERT_OK(pool.Get<Page>(30));
 }
 
+TEST(PagePoolTest, SparsePagesAreCachedAndFlushed) {
+  auto file = std::make_unique<MockFile>();
+  auto& mock = *file;
+  PagePool<MockFile> pool(std::move(file), 2);
+
+  // Page IDs exceeding the range covered by a direct-mapped page table.
+  constexpr PageId kFar = PageId(1) << 40;
+  EXPECT_CALL(mock, LoadPage(1, _));
+  EXPECT_CALL(mock, LoadPage(kFar, _));
+  EXPECT_CALL(mock, StorePage(1, _));
+  EXPECT_CALL(mock, StorePage(kFar, _));
+
+  ASSERT_OK_AND_ASSIGN(Page & page_1, pool.Get<Page>(1));
+  page_1[0] = 1;
+  pool.MarkAsDirty(1);
+  ASSERT_OK_AND_ASSIGN(Page & page_far, pool.Get<Page>(kFar));
+  page_far[0] = 2;
+  pool.MarkAsDirty(kFar);
+
+  // Both pages are still cached.
+  ASSERT_OK_AND_ASSIGN(Page & cached_1, pool.Get<Page>(1));
+  EXPECT_EQ(cached_1[0], 1);
+  ASSERT_OK_AND_ASSIGN(Page & cached_far, pool.Get<Page>(kFar));
+  EXPECT_EQ(cached_far[0], 2);
+
+  ASSERT_OK(pool.Flush());
+}
+
+class MockCostAwareEvictionPolicy : public MockEvictionPolicy {
+ public:
+  MockCostAwareEvictionPolicy(std::size_t size = 100)
+      : MockEvictionPolicy(size) {}
+  MOCK_METHOD(void, Cleaned, (std::size_t));
+  MOCK_METHOD(void, SetPendingWork, (std::size_t, bool));
+};
+
+TEST(MockCostAwareEvictionPolicy, IsCostAwareEvictionPolicy) {
+  EXPECT_TRUE(CostAwareEvictionPolicy<MockCostAwareEvictionPolicy>);
+}
+
+TEST(PagePoolTest, CostAwareEvictionPolicyIsInformedAboutCosts) {
+  PagePool<InMemoryFile<sizeof(Page)>, NiceMock<MockCostAwareEvictionPolicy>>
+      pool(2);
+  auto& mock = pool.GetEvictionPolicy();
+
+  // This assumes that unused pages are used in order.
+  {
+    InSequence s;
+    EXPECT_CALL(mock, SetPendingWork(0, true));
+    EXPECT_CALL(mock, Cleaned(0));
+    EXPECT_CALL(mock, SetPendingWork(0, false));
+  }
+  EXPECT_CALL(mock, Cleaned(1)).Times(0);
+
+  ASSERT_OK(pool.Get<Page>(10));
+  ASSERT_OK(pool.Get<Page>(20));
+  pool.MarkAsDirty(10);
+  pool.SetPendingWork(10, true);
+
+  // Pending work for pages not in the pool is ignored.
+  pool.SetPendingWork(30, true);
+
+  ASSERT_OK(pool.Flush());
+  pool.SetPendingWork(10, false);
+}
+
 TEST(PagePoolTest, GetPageErrorIsForwarded) {
   auto file = std::make_unique<MockFile>();
   auto& mock = *file;
@@ -0,0 +1,55 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/page_table.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "common/memory_usage.h"
+
+namespace carmen::backend {
+
+PageTable::PageTable(std::size_t num_slots, std::size_t slot_size)
+    : max_entries_(std::max(
+          kMinMaxEntries,
+          num_slots * slot_size / (kMaxOverhead * sizeof(int)))) {}
+
+bool PageTable::Grow(PageId id) {
+  if (id < max_entries_) {
+    // Grow geometrically to amortize the cost of copying the array.
+    slots_.resize(std::min(max_entries_, std::max(id + 1, 2 * slots_.size())),
+                  kNoSlot);
+    return true;
+  }
+
+  // The IDs are too sparse, so the mapped IDs are moved to a hash map.
+  std::size_t count = std::count_if(slots_.begin(), slots_.end(),
+                                    [](int slot) { return slot != kNoSlot; });
+  sparse_.reserve(count);
+  for (PageId i = 0; i < slots_.size(); i++) {
+    if (slots_[i] != kNoSlot) {
+      sparse_[i] = slots_[i];
+    }
+  }
+  direct_ = false;
+  slots_ = std::vector<int>();
+  return false;
+}
+
+MemoryFootprint PageTable::GetMemoryFootprint() const {
+  MemoryFootprint res(*this);
+  res.Add("slots", SizeOf(slots_));
+  res.Add("sparse", SizeOf(sparse_));
+  return res;
+}
+
+}  // namespace carmen::backend
@@ -0,0 +1,104 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "backend/common/page_id.h"
+#include "common/memory_usage.h"
+
+namespace carmen::backend {
+
+// A PageTable maps page IDs to the slots of a page pool holding those pages.
+//
+// Since page IDs are dense and start at zero, the table starts out as a
+// growable array indexed by the page ID, such that a lookup is a single indexed
+// load. Array entries are retained for every page ID up to the largest one
+// seen, so if IDs get too sparse relative to the number of slots, the table
+// switches permanently to a hash map containing only the mapped IDs. The array
+// is limited to a fraction of the memory of the slots it is indexing.
+class PageTable {
+ public:
+  // The value reported for pages not mapped to any slot.
+  constexpr static const int kNoSlot = -1;
+
+  // The array may use up to 1/kMaxOverhead of the memory of the indexed slots
+  // before the table switches to a hash map.
+  constexpr static const std::size_t kMaxOverhead = 16;
+
+  // The minimum number of array entries allowed irrespective of the size of
+  // the pool, to avoid switching small pools to a hash map too early.
+  constexpr static const std::size_t kMinMaxEntries = 1 << 16;
+
+  // Creates a table for a pool with the given number of slots of the given
+  // size in bytes.
+  PageTable(std::size_t num_slots, std::size_t slot_size);
+
+  // Returns the slot the given page is mapped to, or kNoSlot if it is not
+  // mapped.
+  int Find(PageId id) const {
+    if (direct_) {
+      return id < slots_.size() ? slots_[id] : kNoSlot;
+    }
+    auto pos = sparse_.find(id);
+    return pos == sparse_.end() ? kNoSlot : pos->second;
+  }
+
+  // Maps the given page to the given slot.
+  void Insert(PageId id, int slot) {
+    if (direct_ && (id < slots_.size() || Grow(id))) {
+      slots_[id] = slot;
+      return;
+    }
+    sparse_[id] = slot;
+  }
+
+  // Removes the mapping of the given page, if present.
+  void Erase(PageId id) {
+    if (direct_) {
+      if (id < slots_.size()) {
+        slots_[id] = kNoSlot;
+      }
+      return;
+    }
+    sparse_.erase(id);
+  }
+
+  // Returns true if page IDs are resolved through an array, false if a hash map
+  // is used.
+  bool IsDirectMapped() const { return direct_; }
+
+  // Summarizes the memory usage of this instance.
+  MemoryFootprint GetMemoryFootprint() const;
+
+ private:
+  // Extends the array to cover the given ID. If this would exceed the maximum
+  // array size, the table is converted to a hash map and false is returned.
+  bool Grow(PageId id);
+
+  // The maximum number of entries of the array.
+  std::size_t max_entries_;
+
+  // True while page IDs are resolved through slots_, false once sparse_ is
+  // used instead.
+  bool direct_ = true;
+
+  // The array mapping page IDs to slots, used in direct mode.
+  std::vector<int> slots_;
+
+  // The hash map mapping page IDs to slots, used in sparse mode.
+  absl::flat_hash_map<PageId, int> sparse_;
+};
+
+}  // namespace carmen::backend
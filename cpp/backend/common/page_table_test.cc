@@ -0,0 +1,94 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/page_table.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend {
+namespace {
+
+TEST(PageTableTest, UnknownPagesAreNotMapped) {
+  PageTable table(10, 4096);
+  EXPECT_EQ(table.Find(0), PageTable::kNoSlot);
+  EXPECT_EQ(table.Find(12), PageTable::kNoSlot);
+}
+
+TEST(PageTableTest, PagesCanBeMappedAndUnmapped) {
+  PageTable table(10, 4096);
+  table.Insert(4, 1);
+  table.Insert(2, 7);
+  EXPECT_EQ(table.Find(4), 1);
+  EXPECT_EQ(table.Find(2), 7);
+  EXPECT_EQ(table.Find(3), PageTable::kNoSlot);
+
+  table.Erase(4);
+  EXPECT_EQ(table.Find(4), PageTable::kNoSlot);
+  EXPECT_EQ(table.Find(2), 7);
+
+  // Erasing unknown pages is a no-op.
+  table.Erase(1000000);
+  EXPECT_EQ(table.Find(2), 7);
+}
+
+TEST(PageTableTest, DensePagesAreDirectMapped) {
+  PageTable table(10, 4096);
+  for (int i = 0; i < 1000; i++) {
+    table.Insert(i, i % 10);
+  }
+  EXPECT_TRUE(table.IsDirectMapped());
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ(table.Find(i), i % 10);
+  }
+}
+
+TEST(PageTableTest, SparsePagesSwitchToHashMap) {
+  PageTable table(10, 4096);
+  table.Insert(1, 1);
+  table.Insert(2, 2);
+  EXPECT_TRUE(table.IsDirectMapped());
+
+  const PageId far = PageTable::kMinMaxEntries;
+  table.Insert(far, 3);
+  EXPECT_FALSE(table.IsDirectMapped());
+  EXPECT_EQ(table.Find(1), 1);
+  EXPECT_EQ(table.Find(2), 2);
+  EXPECT_EQ(table.Find(far), 3);
+  EXPECT_EQ(table.Find(0), PageTable::kNoSlot);
+
+  table.Erase(far);
+  EXPECT_EQ(table.Find(far), PageTable::kNoSlot);
+}
+
+TEST(PageTableTest, DirectMappedRangeScalesWithPoolMemory) {
+  constexpr std::size_t kNumSlots = 1 << 16;
+  constexpr std::size_t kSlotSize = 4096;
+  constexpr PageId kMaxEntries =
+      kNumSlots * kSlotSize / (PageTable::kMaxOverhead * sizeof(int));
+  PageTable table(kNumSlots, kSlotSize);
+  table.Insert(kMaxEntries - 1, 1);
+  EXPECT_TRUE(table.IsDirectMapped());
+  table.Insert(kMaxEntries, 2);
+  EXPECT_FALSE(table.IsDirectMapped());
+  EXPECT_EQ(table.Find(kMaxEntries - 1), 1);
+  EXPECT_EQ(table.Find(kMaxEntries), 2);
+}
+
+TEST(PageTableTest, MemoryFootprintCoversArray) {
+  PageTable table(10, 4096);
+  auto empty = table.GetMemoryFootprint().GetTotal();
+  table.Insert(1000, 1);
+  EXPECT_GE(table.GetMemoryFootprint().GetTotal().bytes(),
+            empty.bytes() + 1000 * sizeof(int));
+}
+
+}  // namespace
+}  // namespace carmen::backend
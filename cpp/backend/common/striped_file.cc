@@ -0,0 +1,100 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/striped_file.h"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "backend/common/file.h"
+#include "common/status_util.h"
+
+namespace carmen::backend {
+
+namespace {
+
+// Writes a manifest listing the given stripe files to the given path.
+absl::Status WriteManifest(const std::filesystem::path& path,
+                           std::span<const std::filesystem::path> stripes) {
+  RETURN_IF_ERROR(CreateDirectory(path.parent_path()));
+  std::ofstream out(path, std::ios::trunc);
+  for (const auto& stripe : stripes) {
+    out << stripe.string() << "\n";
+  }
+  out.close();
+  if (!out.good()) {
+    return absl::InternalError(
+        absl::StrFormat("Failed to write stripe manifest %s.", path));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::Status ConfigureStripedFile(
+    const std::filesystem::path& path,
+    std::span<const std::filesystem::path> directories) {
+  if (directories.empty()) {
+    return absl::InvalidArgumentError("At least one stripe is required.");
+  }
+  if (std::filesystem::exists(path)) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Stripes of %s can not be changed after creation.", path));
+  }
+  // Stripe names are derived from the full path of the file to avoid
+  // collisions of files with the same name sharing a stripe directory.
+  auto id = std::hash<std::string>{}(std::filesystem::absolute(path).string());
+  std::vector<std::filesystem::path> stripes;
+  for (std::size_t i = 0; i < directories.size(); i++) {
+    RETURN_IF_ERROR(CreateDirectory(path.parent_path() / directories[i]));
+    stripes.push_back(directories[i] /
+                      absl::StrFormat("%s.%016x.stripe-%d",
+                                      path.filename().string(), id, i));
+  }
+  return WriteManifest(path, stripes);
+}
+
+namespace internal {
+
+absl::StatusOr<std::vector<std::filesystem::path>> GetStripePaths(
+    const std::filesystem::path& path) {
+  if (!std::filesystem::exists(path)) {
+    std::filesystem::path stripe = path.filename().string() + ".stripe-0";
+    RETURN_IF_ERROR(WriteManifest(path, std::span(&stripe, 1)));
+  }
+  std::ifstream in(path);
+  if (!in.is_open()) {
+    return absl::InternalError(
+        absl::StrFormat("Failed to open stripe manifest %s.", path));
+  }
+  std::vector<std::filesystem::path> res;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    res.push_back(path.parent_path() / line);
+  }
+  if (res.empty()) {
+    return absl::InternalError(
+        absl::StrFormat("Stripe manifest %s lists no stripes.", path));
+  }
+  return res;
+}
+
+}  // namespace internal
+}  // namespace carmen::backend
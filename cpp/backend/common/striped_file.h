@@ -0,0 +1,453 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "backend/common/file.h"
+#include "backend/common/page_id.h"
+#include "common/status_util.h"
+
+namespace carmen::backend {
+
+// ------------------------------- Declarations -------------------------------
+
+// Defines the stripes of the StripedFile at the given path to be located in
+// the given directories, one stripe per listed directory. Relative directories
+// are interpreted relative to the directory containing the path. Missing
+// directories are created. This needs to be called before the file is opened
+// for the first time; an error is returned if the file has already been
+// configured or opened.
+absl::Status ConfigureStripedFile(
+    const std::filesystem::path& path,
+    std::span<const std::filesystem::path> directories);
+
+namespace internal {
+
+// Obtains the paths of the stripe files listed in the manifest at the given
+// path. If there is no manifest yet, a manifest listing a single stripe next to
+// the manifest is created.
+absl::StatusOr<std::vector<std::filesystem::path>> GetStripePaths(
+    const std::filesystem::path& path);
+
+}  // namespace internal
+
+// A StripedFile is an implementation of the File concept distributing pages
+// over a list of stripe files, e.g. located on different devices. Chunks of
+// kPagesPerChunk consecutive pages are assigned to stripes in a round-robin
+// fashion, such that sequential as well as random accesses are spread evenly.
+//
+// Each stripe is served by a worker thread. Stored pages are copied into one
+// of a fixed set of write buffers of their stripe and written by its worker in
+// the background, such that writing a sequence of pages, e.g. when flushing a
+// page pool, keeps all stripes busy concurrently. Loading a page with a
+// pending write is served from its write buffer, other loads only wait for a
+// write in progress on the same stripe. Flush and Close operations are
+// performed by all workers in parallel.
+//
+// A page whose write fails is retained in its write buffer, such that its
+// content is not lost. Its write is retried by the next Flush or Close, which
+// report an error naming the page if it fails again. Storing the page again
+// replaces the retained content and retries the write as well.
+//
+// The list of stripe files is recorded in a manifest file at the path the
+// StripedFile is opened with. Use ConfigureStripedFile to place stripes in
+// specific directories before opening a file for the first time; otherwise a
+// single stripe next to the manifest is used.
+template <std::size_t page_size, typename RawFile>
+class StripedFileBase {
+ public:
+  constexpr static std::size_t kPageSize = page_size;
+
+  // The number of consecutive pages stored in the same stripe.
+  constexpr static std::size_t kPagesPerChunk = 16;
+
+  static absl::StatusOr<StripedFileBase> Open(
+      const std::filesystem::path& path);
+
+  std::size_t GetNumPages() const;
+
+  absl::Status LoadPage(PageId id, std::span<std::byte, page_size> trg) const {
+    auto [stripe, pos] = Locate(id);
+    return stripes_[stripe]->Load(pos, trg);
+  }
+
+  absl::Status StorePage(PageId id, std::span<const std::byte, page_size> src) {
+    auto [stripe, pos] = Locate(id);
+    return stripes_[stripe]->Store(id, pos, src);
+  }
+
+  absl::Status Flush() {
+    return ForEachStripe([](RawFile& file) { return file.Flush(); });
+  }
+
+  absl::Status Close() {
+    return ForEachStripe([](RawFile& file) { return file.Close(); });
+  }
+
+  // Returns the number of stripes the pages of this file are distributed over.
+  std::size_t GetNumStripes() const { return stripes_.size(); }
+
+ private:
+  // A stripe file and the worker thread performing operations on it. The file
+  // is accessed by the worker and by loads of pages without pending writes,
+  // which are serialized by the stripe's file lock.
+  class Stripe {
+   public:
+    explicit Stripe(RawFile file);
+
+    // Waits for pending operations and stops the worker.
+    ~Stripe();
+
+    // Copies the given page into a write buffer to be written at the given
+    // position by the worker. Blocks while all write buffers are in use, and
+    // fails if all of them retain pages whose writes failed.
+    absl::Status Store(PageId id, std::size_t pos,
+                       std::span<const std::byte, page_size> src);
+
+    // Loads the page at the given position, which is served from its write
+    // buffer if it has a pending write.
+    absl::Status Load(std::size_t pos, std::span<std::byte, page_size> trg);
+
+    // Returns the number of pages of this stripe, including pending writes.
+    std::size_t GetNumPages();
+
+    // Queues the given operation to be run by the worker once all pending
+    // writes are completed. Failed writes are retried before.
+    void Submit(std::function<absl::Status(RawFile&)> op);
+
+    // Waits for the operation queued by Submit to complete. Returns an error
+    // if a page could not be written, the result of the operation otherwise.
+    absl::Status Wait();
+
+   private:
+    // The number of write buffers per stripe, bounding the memory used for
+    // copies of pages to be written.
+    constexpr static std::size_t kNumBuffers = 64;
+
+    // A buffer retaining the content of a page until it has been written.
+    struct Buffer {
+      PageId id = 0;
+      std::size_t pos = 0;
+      // True while the worker writes the content of this buffer.
+      bool writing = false;
+      // The result of the last failed write, OK if none failed.
+      absl::Status error;
+      std::array<std::byte, page_size> data;
+    };
+
+    // The main loop of the worker thread.
+    void Run();
+
+    // Returns an error describing a failed write, if any. Requires mutex_.
+    absl::Status GetWriteError() const;
+
+    RawFile file_;
+    // Serializes accesses to the file.
+    std::mutex file_mutex_;
+    // Protects all other fields.
+    std::mutex mutex_;
+    // Signaled when writes or operations are queued or the worker is to be
+    // stopped.
+    std::condition_variable work_;
+    // Signaled when a write or an operation has been completed.
+    std::condition_variable done_;
+    std::unique_ptr<Buffer[]> buffers_;
+    // The indexes of buffers not holding a page.
+    std::vector<std::size_t> free_buffers_;
+    // Maps positions of pages with pending or failed writes to their buffer.
+    absl::flat_hash_map<std::size_t, std::size_t> pending_;
+    // The indexes of buffers waiting to be written.
+    std::deque<std::size_t> queue_;
+    // The operation queued by Submit and its result once completed.
+    std::optional<std::function<absl::Status(RawFile&)>> op_;
+    std::optional<absl::Status> op_result_;
+    bool stop_ = false;
+    std::thread worker_;
+  };
+
+  StripedFileBase(std::vector<std::unique_ptr<Stripe>> stripes)
+      : stripes_(std::move(stripes)) {}
+
+  // Computes the stripe and the position within this stripe of the given page.
+  std::pair<std::size_t, std::size_t> Locate(PageId id) const {
+    auto chunk = id / kPagesPerChunk;
+    auto offset = id % kPagesPerChunk;
+    return {chunk % stripes_.size(),
+            chunk / stripes_.size() * kPagesPerChunk + offset};
+  }
+
+  // Runs the given operation on all stripes in parallel using their workers.
+  // If operations fail, the error of the first failing stripe is returned.
+  absl::Status ForEachStripe(std::function<absl::Status(RawFile&)> op);
+
+  // The stripes are kept in unique pointers to retain the address referenced
+  // by their workers when this file is moved.
+  std::vector<std::unique_ptr<Stripe>> stripes_;
+};
+
+// Defines the default StripedFile format to use the C API for its stripes,
+// matching the SingleFile format.
+template <std::size_t page_size>
+using StripedFile = StripedFileBase<page_size, internal::CFile>;
+
+// ------------------------------- Definitions --------------------------------
+
+template <std::size_t page_size, typename RawFile>
+absl::StatusOr<StripedFileBase<page_size, RawFile>>
+StripedFileBase<page_size, RawFile>::Open(const std::filesystem::path& path) {
+  ASSIGN_OR_RETURN(auto paths, internal::GetStripePaths(path));
+  std::vector<std::unique_ptr<Stripe>> stripes;
+  stripes.reserve(paths.size());
+  for (const auto& stripe_path : paths) {
+    ASSIGN_OR_RETURN(auto stripe, RawFile::Open(stripe_path));
+    stripes.push_back(std::make_unique<Stripe>(std::move(stripe)));
+  }
+  return StripedFileBase(std::move(stripes));
+}
+
+template <std::size_t page_size, typename RawFile>
+std::size_t StripedFileBase<page_size, RawFile>::GetNumPages() const {
+  // The number of pages is defined by the last page of any stripe.
+  std::size_t res = 0;
+  for (std::size_t i = 0; i < stripes_.size(); i++) {
+    auto num_pages = stripes_[i]->GetNumPages();
+    if (num_pages == 0) {
+      continue;
+    }
+    auto last = num_pages - 1;
+    auto chunk = last / kPagesPerChunk * stripes_.size() + i;
+    res = std::max(res, chunk * kPagesPerChunk + last % kPagesPerChunk + 1);
+  }
+  return res;
+}
+
+template <std::size_t page_size, typename RawFile>
+absl::Status StripedFileBase<page_size, RawFile>::ForEachStripe(
+    std::function<absl::Status(RawFile&)> op) {
+  for (auto& stripe : stripes_) {
+    stripe->Submit(op);
+  }
+  absl::Status res;
+  for (auto& stripe : stripes_) {
+    auto result = stripe->Wait();
+    if (res.ok()) {
+      res = result;
+    }
+  }
+  return res;
+}
+
+template <std::size_t page_size, typename RawFile>
+StripedFileBase<page_size, RawFile>::Stripe::Stripe(RawFile file)
+    : file_(std::move(file)),
+      buffers_(std::make_unique<Buffer[]>(kNumBuffers)) {
+  free_buffers_.reserve(kNumBuffers);
+  for (std::size_t i = 0; i < kNumBuffers; i++) {
+    free_buffers_.push_back(i);
+  }
+  pending_.reserve(kNumBuffers);
+  worker_ = std::thread([this] { Run(); });
+}
+
+template <std::size_t page_size, typename RawFile>
+StripedFileBase<page_size, RawFile>::Stripe::~Stripe() {
+  {
+    std::lock_guard guard(mutex_);
+    stop_ = true;
+  }
+  work_.notify_one();
+  worker_.join();
+}
+
+template <std::size_t page_size, typename RawFile>
+absl::Status StripedFileBase<page_size, RawFile>::Stripe::Store(
+    PageId id, std::size_t pos, std::span<const std::byte, page_size> src) {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    // A page with a pending write is updated in its buffer, unless the buffer
+    // is currently being written.
+    if (auto it = pending_.find(pos); it != pending_.end()) {
+      Buffer& buffer = buffers_[it->second];
+      if (buffer.writing) {
+        done_.wait(lock);
+        continue;
+      }
+      std::copy(src.begin(), src.end(), buffer.data.begin());
+      if (!buffer.error.ok()) {
+        buffer.error = absl::OkStatus();
+        queue_.push_back(it->second);
+        work_.notify_one();
+      }
+      return absl::OkStatus();
+    }
+    if (!free_buffers_.empty()) {
+      break;
+    }
+    // If no buffer is waiting to be written, all of them retain pages whose
+    // writes failed, and no buffer would be freed.
+    if (queue_.empty() &&
+        std::none_of(buffers_.get(), buffers_.get() + kNumBuffers,
+                     [](const Buffer& buffer) { return buffer.writing; })) {
+      return GetWriteError();
+    }
+    done_.wait(lock);
+  }
+  auto index = free_buffers_.back();
+  free_buffers_.pop_back();
+  Buffer& buffer = buffers_[index];
+  buffer.id = id;
+  buffer.pos = pos;
+  buffer.error = absl::OkStatus();
+  std::copy(src.begin(), src.end(), buffer.data.begin());
+  pending_[pos] = index;
+  queue_.push_back(index);
+  work_.notify_one();
+  return absl::OkStatus();
+}
+
+template <std::size_t page_size, typename RawFile>
+absl::Status StripedFileBase<page_size, RawFile>::Stripe::Load(
+    std::size_t pos, std::span<std::byte, page_size> trg) {
+  {
+    std::lock_guard lock(mutex_);
+    if (auto it = pending_.find(pos); it != pending_.end()) {
+      const Buffer& buffer = buffers_[it->second];
+      std::copy(buffer.data.begin(), buffer.data.end(), trg.begin());
+      return absl::OkStatus();
+    }
+  }
+  std::lock_guard file_lock(file_mutex_);
+  return file_.Read(pos * page_size, trg);
+}
+
+template <std::size_t page_size, typename RawFile>
+std::size_t StripedFileBase<page_size, RawFile>::Stripe::GetNumPages() {
+  std::lock_guard lock(mutex_);
+  std::size_t res;
+  {
+    std::lock_guard file_lock(file_mutex_);
+    res = file_.GetFileSize() / page_size;
+  }
+  for (const auto& [pos, _] : pending_) {
+    res = std::max(res, pos + 1);
+  }
+  return res;
+}
+
+template <std::size_t page_size, typename RawFile>
+void StripedFileBase<page_size, RawFile>::Stripe::Submit(
+    std::function<absl::Status(RawFile&)> op) {
+  std::lock_guard lock(mutex_);
+  for (const auto& [pos, index] : pending_) {
+    Buffer& buffer = buffers_[index];
+    if (!buffer.error.ok()) {
+      buffer.error = absl::OkStatus();
+      queue_.push_back(index);
+    }
+  }
+  op_ = std::move(op);
+  op_result_.reset();
+  work_.notify_one();
+}
+
+template <std::size_t page_size, typename RawFile>
+absl::Status StripedFileBase<page_size, RawFile>::Stripe::Wait() {
+  std::unique_lock lock(mutex_);
+  done_.wait(lock, [&] { return op_result_.has_value(); });
+  auto result = *std::move(op_result_);
+  op_result_.reset();
+  RETURN_IF_ERROR(GetWriteError());
+  return result;
+}
+
+template <std::size_t page_size, typename RawFile>
+absl::Status StripedFileBase<page_size, RawFile>::Stripe::GetWriteError()
+    const {
+  for (const auto& [pos, index] : pending_) {
+    const Buffer& buffer = buffers_[index];
+    if (!buffer.error.ok()) {
+      return absl::Status(
+          buffer.error.code(),
+          absl::StrFormat("Failed to write page %d: %s", buffer.id,
+                          buffer.error.message()));
+    }
+  }
+  return absl::OkStatus();
+}
+
+template <std::size_t page_size, typename RawFile>
+void StripedFileBase<page_size, RawFile>::Stripe::Run() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    work_.wait(lock,
+               [&] { return stop_ || !queue_.empty() || op_.has_value(); });
+    // Pending writes are completed before operations are run and before the
+    // worker is stopped.
+    if (!queue_.empty()) {
+      auto index = queue_.front();
+      queue_.pop_front();
+      Buffer& buffer = buffers_[index];
+      buffer.writing = true;
+      lock.unlock();
+      absl::Status status;
+      {
+        std::lock_guard file_lock(file_mutex_);
+        status = file_.Write(buffer.pos * page_size,
+                             std::span<const std::byte>(buffer.data));
+      }
+      lock.lock();
+      buffer.writing = false;
+      if (status.ok()) {
+        pending_.erase(buffer.pos);
+        free_buffers_.push_back(index);
+      } else {
+        buffer.error = std::move(status);
+      }
+      done_.notify_all();
+      continue;
+    }
+    if (op_.has_value()) {
+      auto op = *std::move(op_);
+      op_.reset();
+      lock.unlock();
+      absl::Status status;
+      {
+        std::lock_guard file_lock(file_mutex_);
+        status = op(file_);
+      }
+      lock.lock();
+      op_result_ = std::move(status);
+      done_.notify_all();
+      continue;
+    }
+    return;
+  }
+}
+
+}  // namespace carmen::backend
@@ -0,0 +1,311 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/common/striped_file.h"
+
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "backend/common/file.h"
+#include "backend/common/page.h"
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend {
+namespace {
+
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::StatusIs;
+
+constexpr std::size_t kPageSize = kFileSystemPageSize;
+
+// A page format used for the tests.
+class alignas(kFileSystemPageSize) Page
+    : public std::array<std::byte, kPageSize> {
+ public:
+  explicit Page(int value = 0) { fill(std::byte(value)); }
+
+  operator std::span<const std::byte, kPageSize>() const {
+    return std::span<const std::byte, kPageSize>{data(), kPageSize};
+  }
+
+  operator std::span<std::byte, kPageSize>() {
+    return std::span<std::byte, kPageSize>{data(), kPageSize};
+  }
+};
+
+using TestFile = StripedFile<kPageSize>;
+constexpr std::size_t kChunk = TestFile::kPagesPerChunk;
+
+// A raw file failing writes while fail_writes is set.
+class FlakyFile {
+ public:
+  static std::atomic<bool> fail_writes;
+
+  static absl::StatusOr<FlakyFile> Open(const std::filesystem::path& path) {
+    ASSIGN_OR_RETURN(auto file, internal::CFile::Open(path));
+    return FlakyFile(std::move(file));
+  }
+
+  std::size_t GetFileSize() const { return file_.GetFileSize(); }
+
+  absl::Status Read(std::size_t pos, std::span<std::byte> span) {
+    return file_.Read(pos, span);
+  }
+
+  absl::Status Write(std::size_t pos, std::span<const std::byte> span) {
+    if (fail_writes) {
+      return absl::InternalError("Injected write failure.");
+    }
+    return file_.Write(pos, span);
+  }
+
+  absl::Status Flush() { return file_.Flush(); }
+
+  absl::Status Close() { return file_.Close(); }
+
+ private:
+  explicit FlakyFile(internal::CFile file) : file_(std::move(file)) {}
+
+  internal::CFile file_;
+};
+
+std::atomic<bool> FlakyFile::fail_writes = false;
+
+TEST(StripedFileTest, IsFile) {
+  EXPECT_TRUE(File<TestFile>);
+  EXPECT_TRUE((File<StripedFileBase<kPageSize, internal::PosixFile>>));
+}
+
+TEST(StripedFileTest, UnconfiguredFileUsesSingleStripe) {
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto file, TestFile::Open(dir.GetPath() / "data.dat"));
+  EXPECT_EQ(file.GetNumStripes(), 1);
+  EXPECT_EQ(file.GetNumPages(), 0);
+  ASSERT_OK(file.StorePage(3, Page(1)));
+  EXPECT_EQ(file.GetNumPages(), 4);
+  EXPECT_TRUE(std::filesystem::exists(dir.GetPath() / "data.dat.stripe-0"));
+  ASSERT_OK(file.Close());
+}
+
+TEST(StripedFileTest, PagesCanBeWrittenAndRead) {
+  TempDir dir;
+  auto path = dir.GetPath() / "data.dat";
+  std::vector<std::filesystem::path> stripes = {"a", "b", "c"};
+  ASSERT_OK(ConfigureStripedFile(path, stripes));
+  ASSERT_OK_AND_ASSIGN(auto file, TestFile::Open(path));
+  EXPECT_EQ(file.GetNumStripes(), 3);
+
+  constexpr int kNumPages = 5 * kChunk + 3;
+  for (int i = 0; i < kNumPages; i++) {
+    ASSERT_OK(file.StorePage(i, Page(i)));
+    EXPECT_EQ(file.GetNumPages(), i + 1);
+  }
+  for (int i = 0; i < kNumPages; i++) {
+    Page restored;
+    ASSERT_OK(file.LoadPage(i, restored));
+    EXPECT_EQ(restored, Page(i));
+  }
+  Page restored(1);
+  ASSERT_OK(file.LoadPage(kNumPages, restored));
+  EXPECT_EQ(restored, Page(0));
+  ASSERT_OK(file.Close());
+}
+
+TEST(StripedFileTest, PendingWritesAreObservedByReads) {
+  TempDir dir;
+  auto path = dir.GetPath() / "data.dat";
+  std::vector<std::filesystem::path> stripes = {"a", "b"};
+  ASSERT_OK(ConfigureStripedFile(path, stripes));
+  ASSERT_OK_AND_ASSIGN(auto file, TestFile::Open(path));
+
+  // Pages are overwritten repeatedly, exceeding the capacity of the queues of
+  // the stripe workers, such that writes are in flight while reading.
+  constexpr int kNumPages = 4 * kChunk;
+  for (int round = 0; round < 5; round++) {
+    for (int i = 0; i < kNumPages; i++) {
+      ASSERT_OK(file.StorePage(i, Page(i + round)));
+    }
+    for (int i = kNumPages - 1; i >= 0; i--) {
+      Page restored;
+      ASSERT_OK(file.LoadPage(i, restored));
+      EXPECT_EQ(restored, Page(i + round));
+    }
+  }
+  ASSERT_OK(file.Flush());
+  EXPECT_EQ(file.GetNumPages(), kNumPages);
+}
+
+TEST(StripedFileTest, ChunksAreDistributedRoundRobin) {
+  TempDir dir;
+  auto path = dir.GetPath() / "data.dat";
+  std::vector<std::filesystem::path> stripes = {"a", "b", "c"};
+  ASSERT_OK(ConfigureStripedFile(path, stripes));
+  {
+    ASSERT_OK_AND_ASSIGN(auto file, TestFile::Open(path));
+    for (std::size_t i = 0; i < 4 * kChunk; i++) {
+      ASSERT_OK(file.StorePage(i, Page(i)));
+    }
+    ASSERT_OK(file.Close());
+  }
+  // Stripe a holds chunks 0 and 3, b holds chunk 1, and c holds chunk 2.
+  std::vector<std::size_t> sizes;
+  for (const auto& stripe : stripes) {
+    for (const auto& entry :
+         std::filesystem::directory_iterator(dir.GetPath() / stripe)) {
+      sizes.push_back(std::filesystem::file_size(entry));
+    }
+  }
+  EXPECT_EQ(sizes, (std::vector<std::size_t>{2 * kChunk * kPageSize,
+                                             kChunk * kPageSize,
+                                             kChunk * kPageSize}));
+}
+
+TEST(StripedFileTest, WritingPagesCreatesImplicitEmptyPages) {
+  TempDir dir;
+  auto path = dir.GetPath() / "data.dat";
+  std::vector<std::filesystem::path> stripes = {"a", "b"};
+  ASSERT_OK(ConfigureStripedFile(path, stripes));
+  ASSERT_OK_AND_ASSIGN(auto file, TestFile::Open(path));
+
+  // The page is located in the second stripe, while the first stays empty.
+  ASSERT_OK(file.StorePage(kChunk + 2, Page(1)));
+  EXPECT_EQ(file.GetNumPages(), kChunk + 3);
+  for (std::size_t i = 0; i < kChunk + 2; i++) {
+    Page restored(1);
+    ASSERT_OK(file.LoadPage(i, restored));
+    EXPECT_EQ(restored, Page(0));
+  }
+  ASSERT_OK(file.Close());
+}
+
+TEST(StripedFileTest, ContentIsPreservedWhenReopened) {
+  TempDir dir;
+  auto path = dir.GetPath() / "data.dat";
+  std::vector<std::filesystem::path> stripes = {"a", "b", "c", "d"};
+  ASSERT_OK(ConfigureStripedFile(path, stripes));
+  constexpr int kNumPages = 7 * kChunk + 5;
+  {
+    ASSERT_OK_AND_ASSIGN(auto file, TestFile::Open(path));
+    for (int i = 0; i < kNumPages; i++) {
+      ASSERT_OK(file.StorePage(i, Page(i)));
+    }
+    ASSERT_OK(file.Close());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto file, TestFile::Open(path));
+    EXPECT_EQ(file.GetNumStripes(), 4);
+    EXPECT_EQ(file.GetNumPages(), kNumPages);
+    for (int i = 0; i < kNumPages; i++) {
+      Page restored;
+      ASSERT_OK(file.LoadPage(i, restored));
+      EXPECT_EQ(restored, Page(i));
+    }
+    ASSERT_OK(file.Close());
+  }
+}
+
+TEST(StripedFileTest, StripesCanBeLocatedInAbsoluteDirectories) {
+  TempDir dir;
+  TempDir other;
+  auto path = dir.GetPath() / "data.dat";
+  std::vector<std::filesystem::path> stripes = {other.GetPath(), "local"};
+  ASSERT_OK(ConfigureStripedFile(path, stripes));
+  ASSERT_OK_AND_ASSIGN(auto file, TestFile::Open(path));
+  ASSERT_OK(file.StorePage(0, Page(1)));
+  ASSERT_OK(file.Close());
+  EXPECT_FALSE(std::filesystem::is_empty(other.GetPath()));
+}
+
+TEST(StripedFileTest, FilesWithTheSameNameCanShareStripeDirectories) {
+  TempDir dir;
+  TempDir shared;
+  std::vector<std::filesystem::path> stripes = {shared.GetPath()};
+  auto path_a = dir.GetPath() / "a" / "data.dat";
+  auto path_b = dir.GetPath() / "b" / "data.dat";
+  ASSERT_OK(ConfigureStripedFile(path_a, stripes));
+  ASSERT_OK(ConfigureStripedFile(path_b, stripes));
+  ASSERT_OK_AND_ASSIGN(auto file_a, TestFile::Open(path_a));
+  ASSERT_OK_AND_ASSIGN(auto file_b, TestFile::Open(path_b));
+  ASSERT_OK(file_a.StorePage(0, Page(1)));
+  ASSERT_OK(file_b.StorePage(0, Page(2)));
+  Page restored;
+  ASSERT_OK(file_a.LoadPage(0, restored));
+  EXPECT_EQ(restored, Page(1));
+  ASSERT_OK(file_a.Close());
+  ASSERT_OK(file_b.Close());
+}
+
+TEST(StripedFileTest, ConfiguringStripesCreatesTheirDirectories) {
+  TempDir dir;
+  auto path = dir.GetPath() / "data.dat";
+  std::vector<std::filesystem::path> stripes = {"a", "b/c"};
+  ASSERT_OK(ConfigureStripedFile(path, stripes));
+  EXPECT_TRUE(std::filesystem::is_directory(dir.GetPath() / "a"));
+  EXPECT_TRUE(std::filesystem::is_directory(dir.GetPath() / "b" / "c"));
+}
+
+TEST(StripedFileTest, FailedWritesAreReportedForTheFailingPageAndRetried) {
+  TempDir dir;
+  auto path = dir.GetPath() / "data.dat";
+  {
+    ASSERT_OK_AND_ASSIGN(auto file,
+                         (StripedFileBase<kPageSize, FlakyFile>::Open(path)));
+    FlakyFile::fail_writes = true;
+    ASSERT_OK(file.StorePage(5, Page(5)));
+    EXPECT_THAT(file.Flush(), StatusIs(absl::StatusCode::kInternal,
+                                       HasSubstr("page 5")));
+
+    // The content of the failed page is retained.
+    Page restored;
+    ASSERT_OK(file.LoadPage(5, restored));
+    EXPECT_EQ(restored, Page(5));
+    EXPECT_EQ(file.GetNumPages(), 6);
+
+    FlakyFile::fail_writes = false;
+    ASSERT_OK(file.Close());
+  }
+  ASSERT_OK_AND_ASSIGN(auto file, TestFile::Open(path));
+  Page restored;
+  ASSERT_OK(file.LoadPage(5, restored));
+  EXPECT_EQ(restored, Page(5));
+  ASSERT_OK(file.Close());
+}
+
+TEST(StripedFileTest, StripesCanNotBeChangedAfterCreation) {
+  TempDir dir;
+  auto path = dir.GetPath() / "data.dat";
+  std::vector<std::filesystem::path> stripes = {"a", "b"};
+  ASSERT_OK(ConfigureStripedFile(path, stripes));
+  EXPECT_THAT(ConfigureStripedFile(path, stripes),
+              StatusIs(absl::StatusCode::kFailedPrecondition, _));
+}
+
+TEST(StripedFileTest, AtLeastOneStripeIsRequired) {
+  TempDir dir;
+  EXPECT_THAT(ConfigureStripedFile(dir.GetPath() / "data.dat", {}),
+              StatusIs(absl::StatusCode::kInvalidArgument, _));
+}
+
+TEST(StripedFileTest, EmptyManifestIsAnError) {
+  TempDir dir;
+  auto path = dir.GetPath() / "data.dat";
+  { std::ofstream out(path); }
+  EXPECT_THAT(TestFile::Open(path),
+              StatusIs(absl::StatusCode::kInternal, _));
+}
+
+}  // namespace
+}  // namespace carmen::backend
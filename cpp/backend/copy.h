@@ -0,0 +1,155 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "backend/depot/depot.h"
+#include "backend/index/index.h"
+#include "backend/multimap/multimap.h"
+#include "backend/store/store.h"
+#include "backend/structure.h"
+#include "common/status_util.h"
+
+namespace carmen::backend {
+
+// This file provides utilities for copying the content of a data structure
+// into a new structure of a possibly different implementation, e.g. to convert
+// the structures of a state from one configuration into another. Copies keep
+// the ordinals of indexes and reproduce the hashes of their sources, as long as
+// source and target hash their content the same way (e.g. use the same page
+// sizes). Where supported by the target, bulk-load paths are used instead of
+// individual updates.
+//
+// All Copy functions create the target structure in the given directory, which
+// must not contain any data yet.
+
+// Creates a snapshot of the keys of the given index. Some indexes produce
+// snapshots infallibly, others may fail doing so. This function provides a
+// uniform interface for both.
+template <typename Index>
+absl::StatusOr<std::unique_ptr<index::IndexSnapshot<typename Index::key_type>>>
+GetSnapshot(const Index& index) {
+  return index.CreateSnapshot();
+}
+
+// Copies the keys of the given index into a new index of type Target. The
+// source needs to support the creation of snapshots.
+template <index::Index Target, typename Source>
+absl::StatusOr<Target> Copy(Context& context, const Source& source,
+                            const std::filesystem::path& directory) {
+  using K = typename Target::key_type;
+  ASSIGN_OR_RETURN(std::unique_ptr<index::IndexSnapshot<K>> snapshot,
+                   GetSnapshot(source));
+  const std::size_t size = snapshot->GetSize();
+
+  if constexpr (requires(std::span<const K> keys) {
+                  Target::BulkLoad(context, directory, keys);
+                }) {
+    return Target::BulkLoad(context, directory, snapshot->GetKeys(0, size));
+  } else {
+    constexpr static std::size_t kBlockSize = 1 << 16;
+    ASSIGN_OR_RETURN(auto target, Target::Open(context, directory));
+    for (std::size_t from = 0; from < size; from += kBlockSize) {
+      auto keys = snapshot->GetKeys(from, std::min(from + kBlockSize, size));
+      for (std::size_t i = 0; i < keys.size(); i++) {
+        ASSIGN_OR_RETURN(auto result, target.GetOrAdd(keys[i]));
+        if (!result.second ||
+            static_cast<std::size_t>(result.first) != from + i) {
+          return absl::FailedPreconditionError(
+              "Target index is not empty or keys are not unique.");
+        }
+      }
+    }
+    return target;
+  }
+}
+
+// Copies the values of the given store into a new store of type Target. All
+// keys below the key bound of the source are visited.
+template <store::Store Target, typename Source>
+absl::StatusOr<Target> Copy(Context& context, const Source& source,
+                            const std::filesystem::path& directory) {
+  using K = typename Target::key_type;
+  using V = typename Target::value_type;
+  const std::size_t bound = source.GetKeyBound();
+
+  // Zero values do not need to be copied, except for the one of the last key,
+  // which makes the target cover the same range of pages as the source.
+  auto copy = [&](auto& target) -> absl::Status {
+    for (std::size_t key = 0; key < bound; key++) {
+      ASSIGN_OR_RETURN(V value, source.Get(static_cast<K>(key)));
+      if (value == V{} && key + 1 < bound) {
+        continue;
+      }
+      RETURN_IF_ERROR(target.Set(static_cast<K>(key), value));
+    }
+    return absl::OkStatus();
+  };
+
+  if constexpr (requires { Target::CreateBulkWriter(context, directory); }) {
+    ASSIGN_OR_RETURN(auto writer, Target::CreateBulkWriter(context, directory));
+    RETURN_IF_ERROR(copy(writer));
+    return writer.Finish();
+  } else {
+    ASSIGN_OR_RETURN(auto target, Target::Open(context, directory));
+    RETURN_IF_ERROR(copy(target));
+    return target;
+  }
+}
+
+// Copies the values of the given depot into a new depot of type Target. All
+// keys below the key bound of the source are visited.
+template <depot::Depot Target, typename Source>
+absl::StatusOr<Target> Copy(Context& context, const Source& source,
+                            const std::filesystem::path& directory) {
+  using K = typename Target::key_type;
+  ASSIGN_OR_RETURN(auto target, Target::Open(context, directory));
+  const std::size_t bound = source.GetKeyBound();
+  for (std::size_t key = 0; key < bound; key++) {
+    // Like for stores, only the last key is copied if it is empty.
+    auto data = source.Get(static_cast<K>(key));
+    if (absl::IsNotFound(data.status())) {
+      data = std::span<const std::byte>();
+    }
+    RETURN_IF_ERROR(data);
+    if (data->empty() && key + 1 < bound) {
+      continue;
+    }
+    RETURN_IF_ERROR(target.Set(static_cast<K>(key), *data));
+  }
+  return target;
+}
+
+// Copies all key/value pairs of the given multimap into a new multimap of type
+// Target. The source needs to support the enumeration of all its entries.
+template <multimap::MultiMap Target, typename Source>
+absl::StatusOr<Target> Copy(Context& context, const Source& source,
+                            const std::filesystem::path& directory) {
+  ASSIGN_OR_RETURN(auto target, Target::Open(context, directory));
+  absl::Status status;
+  source.ForEach([&](const auto& key, const auto& value) {
+    if (status.ok()) {
+      status = target.Insert(key, value).status();
+    }
+  });
+  RETURN_IF_ERROR(status);
+  return target;
+}
+
+}  // namespace carmen::backend
@@ -0,0 +1,169 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/copy.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "backend/common/file.h"
+#include "backend/depot/file/depot.h"
+#include "backend/depot/memory/depot.h"
+#include "backend/index/cache/cache.h"
+#include "backend/index/file/index.h"
+#include "backend/index/memory/index.h"
+#include "backend/multimap/memory/multimap.h"
+#include "backend/store/file/store.h"
+#include "backend/store/memory/store.h"
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "common/type.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::IsOkAndHolds;
+using ::testing::StatusIs;
+
+using MemoryIndex = index::InMemoryIndex<Address, std::uint32_t>;
+using FileIndex = index::Cached<
+    index::FileIndex<Address, std::uint32_t, SingleFile, kFileSystemPageSize>>;
+
+using MemoryStore = store::InMemoryStore<std::uint32_t, Value, 256>;
+using FileStore = store::EagerFileStore<std::uint32_t, Value, SingleFile, 256>;
+
+using MemoryDepot = depot::InMemoryDepot<std::uint32_t>;
+using FileDepot = depot::FileDepot<std::uint32_t>;
+
+using MultiMap = multimap::InMemoryMultiMap<std::uint32_t, std::uint32_t>;
+
+template <typename Index>
+void CheckAddresses(const Index& index, int num_addresses) {
+  for (int i = 0; i < num_addresses; i++) {
+    EXPECT_THAT(index.Get(Address{static_cast<std::uint8_t>(i >> 8),
+                                  static_cast<std::uint8_t>(i)}),
+                IsOkAndHolds(i));
+  }
+}
+
+TEST(CopyTest, IndexesCanBeBulkLoadedFromOtherIndexes) {
+  constexpr int kNumAddresses = 1000;
+  TempDir dir;
+  Context context;
+  ASSERT_OK_AND_ASSIGN(auto source,
+                       MemoryIndex::Open(context, dir.GetPath() / "source"));
+  for (int i = 0; i < kNumAddresses; i++) {
+    ASSERT_OK(source.GetOrAdd(Address{static_cast<std::uint8_t>(i >> 8),
+                                      static_cast<std::uint8_t>(i)}));
+  }
+  ASSERT_OK_AND_ASSIGN(
+      auto copy, Copy<FileIndex>(context, source, dir.GetPath() / "copy"));
+  CheckAddresses(copy, kNumAddresses);
+  ASSERT_OK_AND_ASSIGN(auto hash, source.GetHash());
+  EXPECT_THAT(copy.GetHash(), IsOkAndHolds(hash));
+
+  // The copy can be copied back without a bulk-load path.
+  ASSERT_OK_AND_ASSIGN(
+      auto back, Copy<MemoryIndex>(context, copy, dir.GetPath() / "b"));
+  CheckAddresses(back, kNumAddresses);
+  EXPECT_THAT(back.GetHash(), IsOkAndHolds(hash));
+}
+
+TEST(CopyTest, IndexesCanOnlyBeCopiedIntoEmptyIndexes) {
+  TempDir dir;
+  Context context;
+  ASSERT_OK_AND_ASSIGN(auto source,
+                       MemoryIndex::Open(context, dir.GetPath() / "source"));
+  ASSERT_OK(source.GetOrAdd(Address{1}));
+  {
+    ASSERT_OK_AND_ASSIGN(
+        auto target, MemoryIndex::Open(context, dir.GetPath() / "trg"));
+    ASSERT_OK(target.GetOrAdd(Address{2}));
+    ASSERT_OK(target.Close());
+  }
+  EXPECT_THAT(Copy<MemoryIndex>(context, source, dir.GetPath() / "trg"),
+              StatusIs(absl::StatusCode::kFailedPrecondition, _));
+}
+
+TEST(CopyTest, StoresCanBeCopiedIncludingTrailingEmptyPages) {
+  TempDir dir;
+  Context context;
+  ASSERT_OK_AND_ASSIGN(auto source,
+                       MemoryStore::Open(context, dir.GetPath() / "source"));
+  ASSERT_OK(source.Set(3, Value{1}));
+  ASSERT_OK(source.Set(70, Value{2}));
+  // The last page of the source only contains zero values.
+  ASSERT_OK(source.Set(1000, Value{}));
+  ASSERT_OK_AND_ASSIGN(auto hash, source.GetHash());
+
+  ASSERT_OK_AND_ASSIGN(
+      auto copy, Copy<FileStore>(context, source, dir.GetPath() / "copy"));
+  EXPECT_EQ(copy.GetKeyBound(), source.GetKeyBound());
+  EXPECT_THAT(copy.Get(3), IsOkAndHolds(Value{1}));
+  EXPECT_THAT(copy.Get(70), IsOkAndHolds(Value{2}));
+  EXPECT_THAT(copy.GetHash(), IsOkAndHolds(hash));
+
+  ASSERT_OK_AND_ASSIGN(
+      auto back, Copy<MemoryStore>(context, copy, dir.GetPath() / "b"));
+  EXPECT_EQ(back.GetKeyBound(), source.GetKeyBound());
+  EXPECT_THAT(back.GetHash(), IsOkAndHolds(hash));
+}
+
+TEST(CopyTest, DepotsCanBeCopied) {
+  TempDir dir;
+  Context context;
+  ASSERT_OK_AND_ASSIGN(auto source,
+                       MemoryDepot::Open(context, dir.GetPath() / "source"));
+  std::array<std::byte, 3> data{std::byte{1}, std::byte{2}, std::byte{3}};
+  ASSERT_OK(source.Set(1, data));
+  ASSERT_OK(source.Set(9, std::span(data).first(1)));
+  ASSERT_OK(source.Set(20, std::span<const std::byte>()));
+  ASSERT_OK_AND_ASSIGN(auto hash, source.GetHash());
+
+  ASSERT_OK_AND_ASSIGN(
+      auto copy, Copy<FileDepot>(context, source, dir.GetPath() / "copy"));
+  EXPECT_EQ(copy.GetKeyBound(), source.GetKeyBound());
+  EXPECT_THAT(copy.Get(1), IsOkAndHolds(ElementsAre(std::byte{1}, std::byte{2},
+                                                    std::byte{3})));
+  EXPECT_THAT(copy.Get(9), IsOkAndHolds(ElementsAre(std::byte{1})));
+  EXPECT_THAT(copy.GetHash(), IsOkAndHolds(hash));
+}
+
+TEST(CopyTest, MultiMapsCanBeCopied) {
+  TempDir dir;
+  Context context;
+  ASSERT_OK_AND_ASSIGN(auto source,
+                       MultiMap::Open(context, dir.GetPath() / "source"));
+  ASSERT_OK(source.Insert(1, 2));
+  ASSERT_OK(source.Insert(1, 3));
+  ASSERT_OK(source.Insert(4, 5));
+
+  ASSERT_OK_AND_ASSIGN(
+      auto copy, Copy<MultiMap>(context, source, dir.GetPath() / "copy"));
+  std::vector<std::uint32_t> values;
+  ASSERT_OK(copy.ForEach(1, [&](std::uint32_t value) {
+    values.push_back(value);
+  }));
+  EXPECT_THAT(values, ElementsAre(2, 3));
+  values.clear();
+  ASSERT_OK(copy.ForEach(4, [&](std::uint32_t value) {
+    values.push_back(value);
+  }));
+  EXPECT_THAT(values, ElementsAre(5));
+}
+
+}  // namespace
+}  // namespace carmen::backend
@@ -82,6 +82,9 @@ class Cached {
     return absl::OkStatus();
   }
 
+  // Returns an upper bound for the keys of all values in the wrapped depot.
+  std::size_t GetKeyBound() const { return depot_.GetKeyBound(); }
+
   // Computes a hash over the full content of this depot.
   absl::StatusOr<Hash> GetHash() const {
     if (hash_.has_value()) {
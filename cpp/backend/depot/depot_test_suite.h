@@ -196,11 +196,26 @@ TYPED_TEST_P(DepotTest, HashesEqualReferenceImplementation) {
   }
 }
 
+TYPED_TEST_P(DepotTest, KeyBoundCoversAllValues) {
+  ASSERT_OK_AND_ASSIGN(auto wrapper, TypeParam::Create());
+  auto& depot = wrapper.GetDepot();
+  EXPECT_EQ(depot.GetKeyBound(), 0);
+
+  std::array<std::byte, 2> value{std::byte{1}, std::byte{2}};
+  ASSERT_OK(depot.Set(10, value));
+  EXPECT_GT(depot.GetKeyBound(), 10);
+  ASSERT_OK(depot.Set(3, value));
+  EXPECT_GT(depot.GetKeyBound(), 10);
+  ASSERT_OK(depot.Set(1000, value));
+  EXPECT_GT(depot.GetKeyBound(), 1000);
+}
+
 REGISTER_TYPED_TEST_SUITE_P(DepotTest, TypeProperties, EmptyCodeCanBeStored,
                             DataCanBeAddedAndRetrieved, EntriesCanBeUpdated,
                             SizeCanBeFatched, EmptyDepotHasZeroHash,
                             NonEmptyDepotHasHash, HashChangesBack,
                             KnownHashesAreReproduced,
-                            HashesEqualReferenceImplementation);
+                            HashesEqualReferenceImplementation,
+                            KeyBoundCoversAllValues);
 }  // namespace
 }  // namespace carmen::backend::depot
@@ -143,6 +143,13 @@ class FileDepot {
     return res;
   }
 
+  // Returns an upper bound for the keys of all values in this depot, being the
+  // number of keys in the hash boxes covered by the depot's hash. Keys below
+  // this bound may be enumerated to transfer the content into another depot.
+  std::size_t GetKeyBound() const {
+    return hashes_.GetNumPages() * hash_box_size_;
+  }
+
   // Computes a hash over the full content of this depot.
   absl::StatusOr<Hash> GetHash() const { return hashes_.GetHash(); }
 
@@ -91,6 +91,12 @@ class LevelDbDepot {
     return value.size();
   }
 
+  // Returns an upper bound for the keys of all values in this depot. It covers
+  // all hash boxes tracked for hashing, which includes all boxes with values.
+  std::size_t GetKeyBound() const {
+    return hashes_.GetNumPages() * hash_box_size_;
+  }
+
   // Computes a hash over the full content of this depot.
   absl::StatusOr<Hash> GetHash() const { return hashes_.GetHash(); }
 
@@ -11,35 +11,51 @@
 #pragma once
 
 #include <concepts>
+#include <cstdint>
 #include <filesystem>
+#include <string>
+#include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "backend/common/file.h"
 #include "backend/store/hash_tree.h"
 #include "backend/structure.h"
+#include "common/fstream.h"
 #include "common/hash.h"
 #include "common/memory_usage.h"
+#include "common/status_util.h"
 #include "common/type.h"
 
 namespace carmen::backend::depot {
 
-// In memory implementation of a Depot.
+// In memory implementation of a Depot. If opened for a directory, the content
+// of the depot is written to this directory on Flush and restored by the next
+// Open call. Items modified since the last flush are appended to a data file,
+// such that the cost of a flush is proportional to the size of the modified
+// items and the number of items, but not to the size of all items.
 template <std::integral K>
 class InMemoryDepot {
  public:
   // The type of the depot key.
   using key_type = K;
 
-  // A factory function creating an instance of this depot type.
-  static absl::StatusOr<InMemoryDepot> Open(Context&,
-                                            const std::filesystem::path&) {
-    return InMemoryDepot();
+  // A factory function creating an instance of this depot type. If the given
+  // directory contains data of a previous flush, this data is restored.
+  static absl::StatusOr<InMemoryDepot> Open(
+      Context&, const std::filesystem::path& directory) {
+    return Open(directory);
   }
 
   static absl::StatusOr<InMemoryDepot> Open(
-      const std::filesystem::path&, std::size_t hash_branching_factor = 32,
-      std::size_t hash_box_size = 4) {
-    return InMemoryDepot(hash_branching_factor, hash_box_size);
+      const std::filesystem::path& directory,
+      std::size_t hash_branching_factor = 32, std::size_t hash_box_size = 4) {
+    InMemoryDepot depot(hash_branching_factor, hash_box_size);
+    depot.directory_ = directory;
+    RETURN_IF_ERROR(depot.Load());
+    return depot;
   }
 
   // Creates a new InMemoryDepot using the provided branching factor and
@@ -57,8 +73,11 @@ class InMemoryDepot {
     if (key >= items_->size()) {
       items_->resize(key + 1);
     }
+    num_item_bytes_ += data.size();
+    num_item_bytes_ -= (*items_)[key].size();
     (*items_)[key] = Item{data.begin(), data.end()};
     hashes_.MarkDirty(GetBoxHashGroup(key));
+    modified_items_.insert(key);
     return absl::OkStatus();
   }
 
@@ -82,14 +101,97 @@ class InMemoryDepot {
     return (*items_)[key].size();
   }
 
+  // Returns an upper bound for the keys of all values in this depot, covering
+  // all hash boxes included in the depot's hash.
+  std::size_t GetKeyBound() const {
+    return hashes_.GetNumPages() * hash_box_size_;
+  }
+
   // Computes a hash over the full content of this depot.
   absl::StatusOr<Hash> GetHash() const { return hashes_.GetHash(); }
 
-  // Ignored, since depot is not backed by disk storage.
-  absl::Status Flush() { return absl::OkStatus(); }
+  // Writes the content of this depot to disk, if this depot is backed by a
+  // directory.
+  absl::Status Flush() {
+    if (directory_.empty() || modified_items_.empty()) {
+      return absl::OkStatus();
+    }
+    RETURN_IF_ERROR(CreateDirectory(directory_));
 
-  // Ignored, since depot does not maintain any resources.
-  absl::Status Close() { return absl::OkStatus(); }
+    // The depot is stored in three files:
+    //  - items_<generation>.dat: the concatenated data of items
+    //  - locations.dat: the generation of the items file in use, followed by
+    //    the location of each item in this file
+    //  - hash.dat: the hashes of the depot using the format of the HashTree
+    // Modified items are appended to the items file, leaving their previous
+    // data as garbage. Once the garbage would exceed the size of the live
+    // items, all items are written to the items file of a new generation. The
+    // locations are replaced atomically after the items got written, such that
+    // an interrupted flush leaves the depot in the state of the previous flush.
+    std::uint64_t num_modified_bytes = 0;
+    for (K key : modified_items_) {
+      num_modified_bytes += (*items_)[key].size();
+    }
+    const bool compact =
+        items_file_size_ + num_modified_bytes > 2 * num_item_bytes_;
+    const auto generation = compact ? generation_ + 1 : generation_;
+    auto locations = locations_;
+    locations.resize(items_->size());
+    std::uint64_t offset = compact ? 0 : items_file_size_;
+    {
+      auto mode = std::ios::binary | std::ios::out;
+      if (offset > 0) {
+        mode |= std::ios::in;  // < prevents truncation
+      }
+      ASSIGN_OR_RETURN(auto out, FStream::Open(GetItemsFile(generation), mode));
+      RETURN_IF_ERROR(out.Seekp(offset));
+      const auto write = [&](K key) -> absl::Status {
+        const Item& item = (*items_)[key];
+        locations[key] = Location{.offset = offset, .length = item.size()};
+        RETURN_IF_ERROR(out.Write(std::span<const std::byte>(item)));
+        offset += item.size();
+        return absl::OkStatus();
+      };
+      if (compact) {
+        for (std::size_t key = 0; key < items_->size(); key++) {
+          RETURN_IF_ERROR(write(key));
+        }
+      } else {
+        for (K key : modified_items_) {
+          RETURN_IF_ERROR(write(key));
+        }
+      }
+      RETURN_IF_ERROR(out.Close());
+    }
+    {
+      auto tmp_file = directory_ / "locations.dat.tmp";
+      ASSIGN_OR_RETURN(
+          auto out, FStream::Open(tmp_file, std::ios::binary | std::ios::out));
+      std::uint64_t num_items = locations.size();
+      RETURN_IF_ERROR(out.Write(generation));
+      RETURN_IF_ERROR(out.Write(num_items));
+      RETURN_IF_ERROR(out.Write(std::span<const Location>(locations)));
+      RETURN_IF_ERROR(out.Close());
+      std::error_code error;
+      std::filesystem::rename(tmp_file, directory_ / "locations.dat", error);
+      if (error) {
+        return absl::InternalError(absl::StrCat(
+            "Failed to replace depot locations: ", error.message()));
+      }
+    }
+    if (compact) {
+      std::error_code ignored;
+      std::filesystem::remove(GetItemsFile(generation_), ignored);
+    }
+    generation_ = generation;
+    locations_ = std::move(locations);
+    items_file_size_ = offset;
+    modified_items_.clear();
+    return hashes_.SaveToFile(directory_ / "hash.dat");
+  }
+
+  // Flushes the content of this depot and releases resources.
+  absl::Status Close() { return Flush(); }
 
   // Summarizes the memory usage of this instance.
   MemoryFootprint GetMemoryFootprint() const {
@@ -113,6 +215,53 @@ class InMemoryDepot {
     return key / hash_box_size_;
   }
 
+  // The location of the data of an item within the items file.
+  struct Location {
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+  };
+
+  // Returns the path of the items file of the given generation.
+  std::filesystem::path GetItemsFile(std::uint64_t generation) const {
+    return directory_ / ("items_" + std::to_string(generation) + ".dat");
+  }
+
+  // Loads the content of a previous flush from the directory of this depot.
+  absl::Status Load() {
+    auto locations_file = directory_ / "locations.dat";
+    if (directory_.empty() || !std::filesystem::exists(locations_file)) {
+      return absl::OkStatus();
+    }
+    {
+      ASSIGN_OR_RETURN(auto in, FStream::Open(locations_file,
+                                              std::ios::binary | std::ios::in));
+      std::uint64_t num_items;
+      RETURN_IF_ERROR(in.Read(generation_));
+      RETURN_IF_ERROR(in.Read(num_items));
+      locations_.resize(num_items);
+      RETURN_IF_ERROR(in.Read(std::span<Location>(locations_)));
+      RETURN_IF_ERROR(in.Close());
+    }
+    ASSIGN_OR_RETURN(auto in, FStream::Open(GetItemsFile(generation_),
+                                            std::ios::binary | std::ios::in));
+    RETURN_IF_ERROR(in.Seekg(0, std::ios::end));
+    ASSIGN_OR_RETURN(items_file_size_, in.Tellg());
+    items_->resize(locations_.size());
+    for (std::size_t key = 0; key < locations_.size(); key++) {
+      const Location& location = locations_[key];
+      if (location.offset + location.length > items_file_size_) {
+        return absl::InternalError("Invalid item location in depot.");
+      }
+      Item& item = (*items_)[key];
+      item.resize(location.length);
+      RETURN_IF_ERROR(in.Seekg(location.offset));
+      RETURN_IF_ERROR(in.Read(std::span<std::byte>(item)));
+      num_item_bytes_ += location.length;
+    }
+    RETURN_IF_ERROR(in.Close());
+    return hashes_.LoadFromFile(directory_ / "hash.dat");
+  }
+
   // A page source providing the owned hash tree access to the stored pages.
   class PageProvider : public store::PageSource {
    public:
@@ -170,6 +319,25 @@ class InMemoryDepot {
 
   // The data structure managing the hashing of states.
   mutable store::HashTree hashes_;
+
+  // The directory the content of this depot is flushed to. Empty if this depot
+  // is not backed by a directory.
+  std::filesystem::path directory_;
+
+  // The generation of the items file written by the last flush.
+  std::uint64_t generation_ = 0;
+
+  // The size of the items file, including the data of outdated items.
+  std::uint64_t items_file_size_ = 0;
+
+  // The locations of all items in the items file written by the last flush.
+  std::vector<Location> locations_;
+
+  // The total size of all items in this depot.
+  std::uint64_t num_item_bytes_ = 0;
+
+  // Items modified since the last flush.
+  absl::flat_hash_set<K> modified_items_;
 };
 
 }  // namespace carmen::backend::depot
@@ -10,14 +10,24 @@
 
 #include "backend/depot/memory/depot.h"
 
+#include <vector>
+
 #include "backend/depot/depot.h"
 #include "backend/depot/depot_test_suite.h"
+#include "backend/structure.h"
+#include "common/file_util.h"
+#include "common/status_test_util.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace carmen::backend::depot {
 namespace {
 
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+using ::testing::IsOkAndHolds;
+
 using TestDepot = InMemoryDepot<unsigned long>;
 using DepotTypes = ::testing::Types<
     // Branching size 3, Size of box 1.
@@ -34,5 +44,59 @@ INSTANTIATE_TYPED_TEST_SUITE_P(LevelDb, DepotTest, DepotTypes);
 
 TEST(InMemoryDepotTest, IsDepot) { EXPECT_TRUE(Depot<InMemoryDepot<int>>); }
 
+TEST(InMemoryDepotTest, FlushedDepotCanBeRestored) {
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto depot, TestDepot::Open(ctx, dir.GetPath()));
+    ASSERT_OK(depot.Set(1, std::vector{std::byte{1}, std::byte{2}}));
+    ASSERT_OK(depot.Set(3, std::vector{std::byte{3}}));
+    ASSERT_OK_AND_ASSIGN(hash, depot.GetHash());
+    ASSERT_OK(depot.Close());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto depot, TestDepot::Open(ctx, dir.GetPath()));
+    EXPECT_THAT(depot.Get(0), IsOkAndHolds(IsEmpty()));
+    EXPECT_THAT(depot.Get(1),
+                IsOkAndHolds(ElementsAre(std::byte{1}, std::byte{2})));
+    EXPECT_THAT(depot.Get(2), IsOkAndHolds(IsEmpty()));
+    EXPECT_THAT(depot.Get(3), IsOkAndHolds(ElementsAre(std::byte{3})));
+    EXPECT_THAT(depot.GetHash(), IsOkAndHolds(hash));
+  }
+}
+
+TEST(InMemoryDepotTest, ModificationsAcrossFlushesAreRestored) {
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto depot, TestDepot::Open(ctx, dir.GetPath()));
+    // Repeatedly updating the same items makes the depot switch to new
+    // generations of its items file.
+    for (int round = 0; round < 10; round++) {
+      for (unsigned long i = 0; i < 20; i++) {
+        if (i % 3 == round % 3) {
+          std::vector<std::byte> item(i + round, std::byte(round));
+          ASSERT_OK(depot.Set(i, item));
+        }
+      }
+      ASSERT_OK(depot.Flush());
+    }
+    ASSERT_OK_AND_ASSIGN(hash, depot.GetHash());
+    ASSERT_OK(depot.Close());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto depot, TestDepot::Open(ctx, dir.GetPath()));
+    for (unsigned long i = 0; i < 20; i++) {
+      // Item i was last set in the last round r with r % 3 == i % 3.
+      int round = 9 - (9 - i % 3) % 3;
+      std::vector<std::byte> item(i + round, std::byte(round));
+      EXPECT_THAT(depot.Get(i), IsOkAndHolds(ElementsAreArray(item)));
+    }
+    EXPECT_THAT(depot.GetHash(), IsOkAndHolds(hash));
+  }
+}
+
 }  // namespace
 }  // namespace carmen::backend::depot
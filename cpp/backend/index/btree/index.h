@@ -0,0 +1,254 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <concepts>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "backend/common/btree/btree_map.h"
+#include "backend/common/file.h"
+#include "backend/common/page_pool.h"
+#include "backend/index/index.h"
+#include "backend/structure.h"
+#include "common/fstream.h"
+#include "common/hash.h"
+#include "common/memory_usage.h"
+#include "common/status_util.h"
+#include "common/type.h"
+
+namespace carmen::backend::index {
+
+// A BTreeIndex implements the Index concept based on a BTreeMap mapping keys
+// to their ordinals. Unlike hash based indexes, keys are kept in their natural
+// order. Thus, keys close to each other in this order share the same or
+// neighboring pages, and the index supports ordered iteration and scans over
+// ranges of keys. Every lookup accesses a number of pages equal to the height
+// of the tree, which is logarithmic in the number of keys with a large base.
+//
+// Data is placed in two files: one containing the pages of the tree, the other
+// the hash of the index. The hash is computed incrementally over all keys in
+// the order of their insertion, the same way as for the FileIndex.
+template <Trivial K, std::integral I, template <std::size_t> class F>
+class BTreeIndex {
+ public:
+  using key_type = K;
+  using value_type = I;
+
+  // The type of the map used for maintaining the key/ordinal pairs.
+  using Map = BTreeMap<K, I, PagePool<F<kFileSystemPageSize>>>;
+
+  // A factory function creating an instance of this index type.
+  static absl::StatusOr<BTreeIndex> Open(
+      Context&, const std::filesystem::path& directory);
+
+  // BTree indexes are move-constructable.
+  BTreeIndex(BTreeIndex&&) = default;
+
+  // On destruction indexes are automatically flushed and closed.
+  ~BTreeIndex() { Close().IgnoreError(); }
+
+  // Retrieves the ordinal number for the given key. If the key is known, it
+  // will return a previously established value for the key. If the key has not
+  // been encountered before, a new ordinal value is assigned to the key and
+  // stored internally such that future lookups will return the same value.
+  absl::StatusOr<std::pair<I, bool>> GetOrAdd(const K& key);
+
+  // Retrieves the ordinal number for the given key if previously registered.
+  // Otherwise, returns a not found status.
+  absl::StatusOr<I> Get(const K& key) const;
+
+  // Calls the given operation for all keys in the range [from, to) and their
+  // ordinals, in the order of the keys.
+  absl::Status ForEach(const K& from, const K& to,
+                       const std::function<void(const K&, I)>& op) const;
+
+  // Calls the given operation for all keys of this index and their ordinals,
+  // in the order of the keys.
+  absl::Status ForEach(const std::function<void(const K&, I)>& op) const;
+
+  // Computes a hash over the full content of this index.
+  absl::StatusOr<Hash> GetHash() const;
+
+  // Creates a snapshot of the keys of this index in the order of their
+  // ordinals. The tree is scanned and the full list of keys is collected in
+  // memory.
+  absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>> CreateSnapshot() const;
+
+  // Flush unsaved index keys to disk.
+  absl::Status Flush();
+
+  // Close this index and release resources.
+  absl::Status Close();
+
+  // Summarizes the memory usage of this instance.
+  MemoryFootprint GetMemoryFootprint() const;
+
+ private:
+  // Creates an index based on the given map, persisting its hash in the given
+  // file.
+  BTreeIndex(Map map, std::unique_ptr<std::filesystem::path> hash_file);
+
+  // Calls the given operation for all entries starting at the given position
+  // up to the first key not less than the given bound, if present.
+  template <typename Iterator>
+  absl::Status Scan(Iterator pos, const K* to,
+                    const std::function<void(const K&, I)>& op) const;
+
+  // The map containing the ordinal of each key.
+  Map map_;
+
+  // The file used to store the hash of this index. The path is a unique ptr to
+  // manage ownership during moves. It is reset when the index is closed.
+  std::unique_ptr<std::filesystem::path> hash_file_;
+
+  // ---- Hash Support ----
+
+  mutable std::queue<K> unhashed_keys_;
+  mutable Sha256Hasher hasher_;
+  mutable Hash hash_{};
+};
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+absl::StatusOr<BTreeIndex<K, I, F>> BTreeIndex<K, I, F>::Open(
+    Context&, const std::filesystem::path& directory) {
+  ASSIGN_OR_RETURN(auto map, Map::Open(directory / "tree.dat"));
+  auto hash_file = directory / "hash.dat";
+  Hash hash{};
+  if (std::filesystem::exists(hash_file)) {
+    ASSIGN_OR_RETURN(auto in,
+                     FStream::Open(hash_file, std::ios::binary | std::ios::in));
+    RETURN_IF_ERROR(in.Read(hash));
+  }
+  auto index = BTreeIndex(std::move(map),
+                          std::make_unique<std::filesystem::path>(hash_file));
+  index.hash_ = hash;
+  return index;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+BTreeIndex<K, I, F>::BTreeIndex(
+    Map map, std::unique_ptr<std::filesystem::path> hash_file)
+    : map_(std::move(map)), hash_file_(std::move(hash_file)) {}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+absl::StatusOr<std::pair<I, bool>> BTreeIndex<K, I, F>::GetOrAdd(
+    const K& key) {
+  I value = map_.Size();
+  ASSIGN_OR_RETURN(auto result, map_.InsertOrGet(key, value));
+  if (result.second) {
+    unhashed_keys_.push(key);
+  }
+  return result;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+absl::StatusOr<I> BTreeIndex<K, I, F>::Get(const K& key) const {
+  ASSIGN_OR_RETURN(auto pos, map_.Find(key));
+  ASSIGN_OR_RETURN(auto end, map_.End());
+  if (pos == end) {
+    return absl::NotFoundError("Key not found.");
+  }
+  return (*pos).value;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+absl::Status BTreeIndex<K, I, F>::ForEach(
+    const K& from, const K& to,
+    const std::function<void(const K&, I)>& op) const {
+  ASSIGN_OR_RETURN(auto pos, map_.LowerBound(from));
+  return Scan(pos, &to, op);
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+absl::Status BTreeIndex<K, I, F>::ForEach(
+    const std::function<void(const K&, I)>& op) const {
+  ASSIGN_OR_RETURN(auto pos, map_.Begin());
+  return Scan(pos, nullptr, op);
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+template <typename Iterator>
+absl::Status BTreeIndex<K, I, F>::Scan(
+    Iterator pos, const K* to,
+    const std::function<void(const K&, I)>& op) const {
+  ASSIGN_OR_RETURN(auto end, map_.End());
+  while (pos != end) {
+    const auto& entry = *pos;
+    if (to != nullptr && !std::less<K>()(entry.key, *to)) {
+      break;
+    }
+    op(entry.key, entry.value);
+    RETURN_IF_ERROR(pos.Next());
+  }
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+absl::StatusOr<Hash> BTreeIndex<K, I, F>::GetHash() const {
+  while (!unhashed_keys_.empty()) {
+    hash_ = carmen::GetHash(hasher_, hash_, unhashed_keys_.front());
+    unhashed_keys_.pop();
+  }
+  return hash_;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>>
+BTreeIndex<K, I, F>::CreateSnapshot() const {
+  std::vector<K> keys(map_.Size());
+  absl::Status status;
+  RETURN_IF_ERROR(ForEach([&](const K& key, I value) {
+    if (static_cast<std::size_t>(value) >= keys.size()) {
+      status = absl::InternalError(absl::StrCat(
+          "Invalid ordinal ", value, " in index of size ", keys.size()));
+      return;
+    }
+    keys[value] = key;
+  }));
+  RETURN_IF_ERROR(status);
+  return std::make_unique<MaterializedIndexSnapshot<K>>(std::move(keys));
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+absl::Status BTreeIndex<K, I, F>::Flush() {
+  // Only owning instances, which have not been closed, need to be flushed.
+  if (!hash_file_) return absl::OkStatus();
+  RETURN_IF_ERROR(map_.Flush());
+  ASSIGN_OR_RETURN(auto out, FStream::Open(*hash_file_,
+                                           std::ios::binary | std::ios::out));
+  ASSIGN_OR_RETURN(auto hash, GetHash());
+  return out.Write(hash);
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+absl::Status BTreeIndex<K, I, F>::Close() {
+  if (!hash_file_) return absl::OkStatus();
+  RETURN_IF_ERROR(Flush());
+  hash_file_.reset();
+  return map_.Close();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F>
+MemoryFootprint BTreeIndex<K, I, F>::GetMemoryFootprint() const {
+  MemoryFootprint res(*this);
+  res.Add("map", map_.GetMemoryFootprint());
+  return res;
+}
+
+}  // namespace carmen::backend::index
@@ -0,0 +1,156 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/index/btree/index.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "backend/common/file.h"
+#include "backend/index/file/index.h"
+#include "backend/index/index_test_suite.h"
+#include "backend/structure.h"
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "common/type.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend::index {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::IsOkAndHolds;
+using ::testing::Pair;
+using ::testing::StatusIs;
+
+using TestIndex = BTreeIndex<int, int, InMemoryFile>;
+
+// Instantiates common index tests for the BTreeIndex index type.
+INSTANTIATE_TYPED_TEST_SUITE_P(BTree, IndexTest, TestIndex);
+
+// Keys can not be removed from BTree indexes, since the BTree does not support
+// the removal of entries.
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(RemovableIndexTest);
+
+TEST(BTreeIndexTest, FillTest) {
+  constexpr int N = 10000;
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  for (int i = 0; i < N; i++) {
+    EXPECT_THAT(index.GetOrAdd((i * 7919) % N), IsOkAndHolds(Pair(i, true)));
+  }
+  for (int i = 0; i < N; i++) {
+    EXPECT_THAT(index.Get((i * 7919) % N), IsOkAndHolds(i));
+  }
+  EXPECT_THAT(index.Get(N), StatusIs(absl::StatusCode::kNotFound, _));
+}
+
+TEST(BTreeIndexTest, HashesMatchFileIndex) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath() / "a"));
+  ASSERT_OK_AND_ASSIGN(auto reference,
+                       (FileIndex<int, int, InMemoryFile>::Open(
+                           ctx, dir.GetPath() / "b")));
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_OK(index.GetOrAdd(1000 - i * 7));
+    ASSERT_OK(reference.GetOrAdd(1000 - i * 7));
+  }
+  ASSERT_OK_AND_ASSIGN(auto hash, reference.GetHash());
+  EXPECT_THAT(index.GetHash(), IsOkAndHolds(hash));
+}
+
+TEST(BTreeIndexTest, KeysAreVisitedInOrder) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  for (int key : {5, 3, 9, 1}) {
+    ASSERT_OK(index.GetOrAdd(key));
+  }
+  std::vector<std::pair<int, int>> visited;
+  auto collect = [&](int key, int ordinal) {
+    visited.push_back({key, ordinal});
+  };
+  ASSERT_OK(index.ForEach(collect));
+  EXPECT_THAT(visited, ElementsAre(Pair(1, 3), Pair(3, 1), Pair(5, 0),
+                                   Pair(9, 2)));
+
+  visited.clear();
+  ASSERT_OK(index.ForEach(2, 9, collect));
+  EXPECT_THAT(visited, ElementsAre(Pair(3, 1), Pair(5, 0)));
+
+  visited.clear();
+  ASSERT_OK(index.ForEach(10, 20, collect));
+  EXPECT_THAT(visited, ElementsAre());
+}
+
+TEST(BTreeIndexTest, RangeScansCoverMultiplePages) {
+  constexpr int N = 100000;
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  for (int i = 0; i < N; i++) {
+    ASSERT_OK(index.GetOrAdd(N - i));
+  }
+  std::vector<int> keys;
+  ASSERT_OK(index.ForEach(1000, 50000, [&](int key, int ordinal) {
+    EXPECT_EQ(ordinal, N - key);
+    keys.push_back(key);
+  }));
+  ASSERT_EQ(keys.size(), 49000);
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    EXPECT_EQ(keys[i], 1000 + i);
+  }
+}
+
+TEST(BTreeIndexTest, IndexCanBeSavedAndRestored) {
+  using Index = BTreeIndex<int, int, SingleFile>;
+  const int kNumElements = 100000;
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < kNumElements; i++) {
+      EXPECT_THAT(index.GetOrAdd(i + 5), IsOkAndHolds(Pair(i, true)));
+    }
+    ASSERT_OK_AND_ASSIGN(hash, index.GetHash());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto restored, Index::Open(ctx, dir.GetPath()));
+    EXPECT_THAT(restored.GetHash(), IsOkAndHolds(hash));
+    for (int i = 0; i < kNumElements; i++) {
+      EXPECT_THAT(restored.Get(i + 5), IsOkAndHolds(i));
+    }
+    EXPECT_THAT(restored.GetOrAdd(0), IsOkAndHolds(Pair(kNumElements, true)));
+  }
+}
+
+TEST(BTreeIndexTest, SnapshotListsKeysInOrdinalOrder) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  std::vector<int> keys;
+  for (int i = 0; i < 5000; i++) {
+    keys.push_back((i * 31 + 7) % 5003);
+    ASSERT_OK(index.GetOrAdd(keys.back()));
+  }
+  ASSERT_OK_AND_ASSIGN(auto snapshot, index.CreateSnapshot());
+  EXPECT_EQ(snapshot->GetSize(), keys.size());
+  EXPECT_THAT(snapshot->GetKeys(0, keys.size()), ElementsAreArray(keys));
+}
+
+}  // namespace
+}  // namespace carmen::backend::index
@@ -42,6 +42,22 @@ class Cached {
     return Cached(std::move(index));
   }
 
+  // Creates a new cached index in the given directory by bulk loading the
+  // given keys into the wrapped index. Only available if the wrapped index
+  // supports bulk loading.
+  template <typename Keys>
+    requires requires(Context& context, const std::filesystem::path& path,
+                      Keys&& keys) {
+      I::BulkLoad(context, path, std::forward<Keys>(keys));
+    }
+  static absl::StatusOr<Cached> BulkLoad(Context& context,
+                                         const std::filesystem::path& path,
+                                         Keys&& keys) {
+    ASSIGN_OR_RETURN(auto index,
+                     I::BulkLoad(context, path, std::forward<Keys>(keys)));
+    return Cached(std::move(index));
+  }
+
   // Creates a new cached index wrapping the given index and using the given
   // maximum cache size.
   Cached(I index = {}, std::size_t max_entries = kDefaultSize)
@@ -87,6 +103,17 @@ class Cached {
     return *res;
   }
 
+  // Removes the given key from the wrapped index. Only available if the wrapped
+  // index supports the removal of keys. Since removals are not covered by index
+  // hashes, the cached hash remains valid.
+  absl::Status Remove(const key_type& key)
+    requires RemovableIndex<I>
+  {
+    RETURN_IF_ERROR(index_.Remove(key));
+    cache_.Set(key, absl::NotFoundError("Key not found"));
+    return absl::OkStatus();
+  }
+
   // Computes a hash over the full content of this index.
   absl::StatusOr<Hash> GetHash() {
     if (hash_.has_value()) {
@@ -97,6 +124,9 @@ class Cached {
     return *hash_;
   }
 
+  // Creates a snapshot of the keys of the wrapped index.
+  auto CreateSnapshot() const { return index_.CreateSnapshot(); }
+
   // Flush unsaved index keys to disk.
   absl::Status Flush() { return index_.Flush(); }
 
@@ -11,16 +11,22 @@
 #include "backend/index/cache/cache.h"
 
 #include <utility>
+#include <vector>
 
+#include "backend/common/file.h"
+#include "backend/index/file/index.h"
 #include "backend/index/index_test_suite.h"
 #include "backend/index/test_util.h"
+#include "common/file_util.h"
 #include "common/status_test_util.h"
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace carmen::backend::index {
 namespace {
 
 using ::testing::_;
+using ::testing::ElementsAre;
 using ::testing::IsOkAndHolds;
 using ::testing::Pair;
 using ::testing::Return;
@@ -31,6 +37,7 @@ using CachedIndex = Cached<TestIndex>;
 
 // Instantiates common index tests for the Cached index type.
 INSTANTIATE_TYPED_TEST_SUITE_P(Cached, IndexTest, CachedIndex);
+INSTANTIATE_TYPED_TEST_SUITE_P(Cached, RemovableIndexTest, CachedIndex);
 
 TEST(CachedIndex, CachedKeysAreNotFetched) {
   MockIndex<int, int> wrapper;
@@ -166,5 +173,24 @@ TEST(CachedIndex, CacheSizeLimitIsEnforced) {
   EXPECT_THAT(index.GetOrAdd(0), IsOkAndHolds(Pair(0, false)));
 }
 
+TEST(CachedIndex, SnapshotsCoverTheWrappedIndex) {
+  CachedIndex index;
+  ASSERT_OK(index.GetOrAdd(12));
+  ASSERT_OK(index.GetOrAdd(7));
+  auto snapshot = index.CreateSnapshot();
+  EXPECT_THAT(snapshot->GetKeys(0, snapshot->GetSize()), ElementsAre(12, 7));
+}
+
+TEST(CachedIndex, BulkLoadIsForwardedToWrappedIndex) {
+  using Index = Cached<FileIndex<int, int, InMemoryFile, 128>>;
+  TempDir dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(
+      auto index, Index::BulkLoad(ctx, dir.GetPath(), std::vector<int>{12, 7}));
+  EXPECT_THAT(index.Get(12), IsOkAndHolds(0));
+  EXPECT_THAT(index.Get(7), IsOkAndHolds(1));
+  EXPECT_THAT(index.GetOrAdd(3), IsOkAndHolds(Pair(2, true)));
+}
+
 }  // namespace
 }  // namespace carmen::backend::index
@@ -0,0 +1,449 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "backend/common/file.h"
+#include "backend/common/page_pool.h"
+#include "backend/index/file/hash_page.h"
+#include "backend/index/file/stable_hash.h"
+#include "backend/index/index.h"
+#include "backend/structure.h"
+#include "common/fstream.h"
+#include "common/hash.h"
+#include "common/memory_usage.h"
+#include "common/status_util.h"
+#include "common/type.h"
+
+namespace carmen::backend::index {
+
+// An ExtendibleFileIndex implements the Index concept based on extendible
+// hashing. Unlike the linear hashing based FileIndex, buckets never exceed a
+// single page. Keys are mapped to buckets through an in-memory directory of
+// 2^global_depth page IDs, indexed by the lower bits of the key's hash. Each
+// bucket has a local depth, the number of hash bits shared by all of its keys.
+// If a bucket runs full, it is split in two based on the next hash bit,
+// doubling the directory first if the bucket's local depth equals the global
+// depth.
+//
+// Thus, every lookup reads exactly one page, and inserts touch at most two
+// pages, independent of the distribution of keys. In exchange, the directory
+// needs to be kept in memory, using one PageId per directory slot. To bound
+// this memory, the global depth is limited to max_global_depth bits, which by
+// default allows for 2^26 slots occupying 512 MiB. Buckets whose keys share
+// all of these hash bits can not be split any further. Inserting into such a
+// bucket once it is full fails with a resource exhausted error, leaving the
+// index unchanged. Lookups are not affected and still read a single page.
+//
+// Data is placed in two files: one containing the bucket pages, the other the
+// directory, the local depths, and further metadata. The hash of the index is
+// the same as the one of a FileIndex containing the same keys.
+//
+// see: https://en.wikipedia.org/wiki/Extendible_hashing
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size = kFileSystemPageSize,
+          std::uint8_t max_global_depth = 26>
+class ExtendibleFileIndex {
+  static_assert(max_global_depth < sizeof(std::size_t) * 8,
+                "The global depth must be less than the number of hash bits.");
+
+ public:
+  using hash_t = std::size_t;
+  using key_type = K;
+  using value_type = I;
+
+  // The page type used by this index.
+  using Page = HashPage<hash_t, K, I, page_size>;
+
+  // The file-type used by instances for bucket pages.
+  using File = F<sizeof(Page)>;
+
+  // A factory function creating an instance of this index type.
+  static absl::StatusOr<ExtendibleFileIndex> Open(
+      Context&, const std::filesystem::path& directory);
+
+  // Extendible file indexes are move-constructable.
+  ExtendibleFileIndex(ExtendibleFileIndex&&) = default;
+
+  // On destruction indexes are automatically flushed and closed.
+  ~ExtendibleFileIndex() { Close().IgnoreError(); }
+
+  // Retrieves the ordinal number for the given key. If the key is known, it
+  // will return a previously established value for the key. If the key has not
+  // been encountered before, a new ordinal value is assigned to the key and
+  // stored internally such that future lookups will return the same value.
+  absl::StatusOr<std::pair<I, bool>> GetOrAdd(const K& key);
+
+  // Retrieves the ordinal number for the given key if previously registered.
+  // Otherwise, returns a not found status.
+  absl::StatusOr<I> Get(const K& key) const;
+
+  // Removes the given key from this index, if present. The ordinal of the key
+  // is reused for the next new key. Buckets are never merged.
+  absl::Status Remove(const K& key);
+
+  // Computes a hash over the full content of this index.
+  absl::StatusOr<Hash> GetHash() const;
+
+  // Creates a snapshot of the keys of this index in the order of their
+  // ordinals. All bucket pages are scanned to collect the keys in memory. Free
+  // ordinals of removed keys are listed with a default-initialized key.
+  absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>> CreateSnapshot() const;
+
+  // Returns the number of hash bits used for indexing the directory.
+  std::uint8_t GetGlobalDepth() const { return global_depth_; }
+
+  // Returns the number of bucket pages of this index.
+  std::size_t GetNumBuckets() const { return local_depths_.size(); }
+
+  // Flush unsaved index keys to disk.
+  absl::Status Flush();
+
+  // Close this index and release resources.
+  absl::Status Close();
+
+  // Summarizes the memory usage of this instance.
+  MemoryFootprint GetMemoryFootprint() const;
+
+ private:
+  // The type of one entry within a page (=one key/value pair).
+  using Entry = typename Page::Entry;
+
+  // Creates an empty index based on the given files.
+  ExtendibleFileIndex(std::unique_ptr<File> page_file,
+                      std::unique_ptr<std::filesystem::path> metadata_file,
+                      StableHashVersion version);
+
+  // Obtains the ID of the page of the bucket the given hash is located in.
+  PageId GetBucket(hash_t hash) const {
+    return directory_[hash & ((hash_t{1} << global_depth_) - 1)];
+  }
+
+  // Splits the bucket containing the given hash by moving all entries with the
+  // next hash bit set into a new bucket. The directory is doubled if needed.
+  absl::Status Split(hash_t hash);
+
+  // The page pool wrapping access to the bucket page file.
+  mutable PagePool<File> pool_;
+
+  // The file used to store meta information covering the values of the fields
+  // below. The path is a unique ptr to manage ownership during moves.
+  std::unique_ptr<std::filesystem::path> metadata_file_;
+
+  // A hasher to compute hashes for keys.
+  VersionedStableHash<K> key_hasher_;
+
+  // The number of elements in this index.
+  std::size_t size_ = 0;
+
+  // The number of hash bits used for indexing the directory.
+  std::uint8_t global_depth_ = 0;
+
+  // Maps the lower global_depth_ bits of hashes to bucket pages. Buckets with
+  // a local depth d are referenced by 2^(global_depth_ - d) entries.
+  std::vector<PageId> directory_;
+
+  // The local depth of each bucket, indexed by its page ID.
+  std::vector<std::uint8_t> local_depths_;
+
+  // The ordinals of removed keys, ready for reuse. Ordinals are reused in the
+  // reverse order of their release.
+  std::vector<I> free_ordinals_;
+
+  // ---- Hash Support ----
+
+  mutable std::queue<K> unhashed_keys_;
+  mutable Sha256Hasher hasher_;
+  mutable Hash hash_{};
+};
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+absl::StatusOr<ExtendibleFileIndex<K, I, F, page_size, max_global_depth>>
+ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::Open(
+    Context&, const std::filesystem::path& directory) {
+  ASSIGN_OR_RETURN(auto page_file, File::Open(directory / "buckets.dat"));
+
+  auto metadata_file = directory / "metadata.dat";
+  if (!std::filesystem::exists(metadata_file)) {
+    return ExtendibleFileIndex(
+        std::make_unique<File>(std::move(page_file)),
+        std::make_unique<std::filesystem::path>(metadata_file),
+        kLatestStableHashVersion);
+  }
+
+  ASSIGN_OR_RETURN(auto in, FStream::Open(metadata_file,
+                                          std::ios::binary | std::ios::in));
+  StableHashVersion version;
+  RETURN_IF_ERROR(in.Read(version));
+  if (!IsValid(version)) {
+    return absl::InternalError(absl::StrCat(
+        "Unsupported stable hash version ", static_cast<int>(version), " in ",
+        metadata_file.string()));
+  }
+
+  auto index = ExtendibleFileIndex(
+      std::make_unique<File>(std::move(page_file)),
+      std::make_unique<std::filesystem::path>(metadata_file), version);
+
+  // Start with scalars.
+  RETURN_IF_ERROR(in.Read(index.size_));
+  RETURN_IF_ERROR(in.Read(index.global_depth_));
+  RETURN_IF_ERROR(in.Read(index.hash_));
+  if (index.global_depth_ > max_global_depth) {
+    return absl::InternalError(absl::StrCat(
+        "Global depth ", static_cast<int>(index.global_depth_),
+        " exceeds the maximum of ", static_cast<int>(max_global_depth), " in ",
+        metadata_file.string()));
+  }
+
+  // Read the directory, the local depths, and the free ordinals.
+  std::size_t size;
+  index.directory_.resize(std::size_t{1} << index.global_depth_);
+  RETURN_IF_ERROR(in.Read(std::span(index.directory_)));
+  RETURN_IF_ERROR(in.Read(size));
+  index.local_depths_.resize(size);
+  RETURN_IF_ERROR(in.Read(std::span(index.local_depths_)));
+  RETURN_IF_ERROR(in.Read(size));
+  index.free_ordinals_.resize(size);
+  RETURN_IF_ERROR(in.Read(std::span(index.free_ordinals_)));
+  return index;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::ExtendibleFileIndex(
+    std::unique_ptr<File> page_file,
+    std::unique_ptr<std::filesystem::path> metadata_file,
+    StableHashVersion version)
+    : pool_(std::move(page_file)),
+      metadata_file_(std::move(metadata_file)),
+      key_hasher_(version),
+      directory_(1, 0),
+      local_depths_(1, 0) {}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+absl::StatusOr<std::pair<I, bool>>
+ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::GetOrAdd(
+    const K& key) {
+  auto hash = key_hasher_(key);
+  auto bucket = GetBucket(hash);
+  ASSIGN_OR_RETURN(Page * page, pool_.template Get<Page>(bucket));
+  if (auto entry = page->Find(hash, key)) {
+    return std::pair{entry->value, false};
+  }
+
+  // Split the target bucket until there is space for the new entry. Since the
+  // page is retained in the pool while the bucket is split, it is fetched
+  // again after each split. The ordinal is only assigned once the insertion
+  // can no longer fail, such that a failed split does not consume it.
+  while (page->IsFull()) {
+    RETURN_IF_ERROR(Split(hash));
+    bucket = GetBucket(hash);
+    ASSIGN_OR_RETURN(page, pool_.template Get<Page>(bucket));
+  }
+
+  I value;
+  if (free_ordinals_.empty()) {
+    value = size_++;
+  } else {
+    value = free_ordinals_.back();
+    free_ordinals_.pop_back();
+  }
+  page->Insert(hash, key, value);
+  pool_.MarkAsDirty(bucket);
+  unhashed_keys_.push(key);
+  return std::pair{value, true};
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+absl::StatusOr<I>
+ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::Get(
+    const K& key) const {
+  auto hash = key_hasher_(key);
+  ASSIGN_OR_RETURN(Page * page, pool_.template Get<Page>(GetBucket(hash)));
+  if (auto entry = page->Find(hash, key)) {
+    return entry->value;
+  }
+  return absl::NotFoundError("Key not found.");
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+absl::Status ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::Remove(
+    const K& key) {
+  auto hash = key_hasher_(key);
+  auto bucket = GetBucket(hash);
+  ASSIGN_OR_RETURN(Page * page, pool_.template Get<Page>(bucket));
+  if (auto entry = page->Remove(hash, key)) {
+    pool_.MarkAsDirty(bucket);
+    free_ordinals_.push_back(entry->value);
+  }
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+absl::Status ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::Split(
+    hash_t hash) {
+  const PageId bucket = GetBucket(hash);
+  const std::uint8_t depth = local_depths_[bucket];
+  const bool grow_directory = depth == global_depth_;
+  if (grow_directory && global_depth_ >= max_global_depth) {
+    return absl::ResourceExhaustedError(absl::StrCat(
+        "Unable to split bucket beyond the maximum global depth of ",
+        static_cast<int>(max_global_depth), "."));
+  }
+
+  // Entries with the next hash bit set are moved to the new bucket. Both
+  // buckets remain sorted by hash. The entries are partitioned in memory, since
+  // the pool may evict the page while the new page is fetched.
+  const hash_t bit = hash_t{1} << depth;
+  std::vector<Entry> kept;
+  std::vector<Entry> moved;
+  {
+    ASSIGN_OR_RETURN(Page * page, pool_.template Get<Page>(bucket));
+    for (std::size_t i = 0; i < page->Size(); i++) {
+      const Entry& entry = (*page)[i];
+      (entry.hash & bit ? moved : kept).push_back(entry);
+    }
+  }
+
+  // Pages are updated such that a failure to fetch one of them leaves the
+  // index unchanged: the new page is not referenced until the directory is
+  // updated below. Its content is overwritten entirely, since a previously
+  // failed split may have left entries in it.
+  const PageId new_bucket = local_depths_.size();
+  {
+    ASSIGN_OR_RETURN(Page * page, pool_.template Get<Page>(new_bucket));
+    std::copy(moved.begin(), moved.end(), &(*page)[0]);
+    page->Resize(moved.size());
+    pool_.MarkAsDirty(new_bucket);
+  }
+  {
+    ASSIGN_OR_RETURN(Page * page, pool_.template Get<Page>(bucket));
+    std::copy(kept.begin(), kept.end(), &(*page)[0]);
+    page->Resize(kept.size());
+    pool_.MarkAsDirty(bucket);
+  }
+
+  // Double the directory if the bucket is referenced by a single entry. The
+  // new upper half mirrors the lower half.
+  if (grow_directory) {
+    directory_.reserve(directory_.size() * 2);
+    directory_.insert(directory_.end(), directory_.begin(), directory_.end());
+    global_depth_++;
+  }
+  local_depths_[bucket] = depth + 1;
+  local_depths_.push_back(depth + 1);
+
+  // Redirect all directory entries of the old bucket with the bit set.
+  const hash_t step = bit << 1;
+  for (std::size_t i = (hash & (bit - 1)) | bit; i < directory_.size();
+       i += step) {
+    assert(directory_[i] == bucket);
+    directory_[i] = new_bucket;
+  }
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+absl::StatusOr<Hash>
+ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::GetHash() const {
+  while (!unhashed_keys_.empty()) {
+    hash_ = carmen::GetHash(hasher_, hash_, unhashed_keys_.front());
+    unhashed_keys_.pop();
+  }
+  return hash_;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>>
+ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::CreateSnapshot()
+    const {
+  std::vector<K> keys(size_);
+  for (PageId bucket = 0; bucket < local_depths_.size(); bucket++) {
+    ASSIGN_OR_RETURN(Page * page, pool_.template Get<Page>(bucket));
+    for (std::size_t i = 0; i < page->Size(); i++) {
+      const Entry& entry = (*page)[i];
+      if (static_cast<std::size_t>(entry.value) >= keys.size()) {
+        return absl::InternalError(absl::StrCat(
+            "Invalid ordinal ", entry.value, " in index of size ", size_));
+      }
+      keys[entry.value] = entry.key;
+    }
+  }
+  return std::make_unique<MaterializedIndexSnapshot<K>>(std::move(keys));
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+absl::Status
+ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::Flush() {
+  RETURN_IF_ERROR(pool_.Flush());
+
+  // Flush metadata if this is an owning instance.
+  if (!metadata_file_ || metadata_file_->empty()) return absl::OkStatus();
+
+  ASSIGN_OR_RETURN(auto out, FStream::Open(*metadata_file_,
+                                           std::ios::binary | std::ios::out));
+  RETURN_IF_ERROR(out.Write(key_hasher_.GetVersion()));
+  RETURN_IF_ERROR(out.Write(size_));
+  RETURN_IF_ERROR(out.Write(global_depth_));
+  ASSIGN_OR_RETURN(auto hash, GetHash());
+  RETURN_IF_ERROR(out.Write(hash));
+  RETURN_IF_ERROR(out.Write(std::span<const PageId>(directory_)));
+  RETURN_IF_ERROR(out.Write(local_depths_.size()));
+  RETURN_IF_ERROR(out.Write(std::span<const std::uint8_t>(local_depths_)));
+  RETURN_IF_ERROR(out.Write(free_ordinals_.size()));
+  RETURN_IF_ERROR(out.Write(std::span<const I>(free_ordinals_)));
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+absl::Status
+ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::Close() {
+  RETURN_IF_ERROR(Flush());
+  return pool_.Close();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::uint8_t max_global_depth>
+MemoryFootprint
+ExtendibleFileIndex<K, I, F, page_size, max_global_depth>::GetMemoryFootprint()
+    const {
+  MemoryFootprint res(*this);
+  res.Add("pool", pool_.GetMemoryFootprint());
+  res.Add("directory", SizeOf(directory_));
+  res.Add("local_depths", SizeOf(local_depths_));
+  res.Add("free_ordinals", SizeOf(free_ordinals_));
+  return res;
+}
+
+}  // namespace carmen::backend::index
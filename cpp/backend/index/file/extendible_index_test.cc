@@ -0,0 +1,205 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/index/file/extendible_index.h"
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "backend/common/file.h"
+#include "backend/index/file/index.h"
+#include "backend/index/index_test_suite.h"
+#include "backend/structure.h"
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "common/type.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend::index {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAreArray;
+using ::testing::Gt;
+using ::testing::IsOkAndHolds;
+using ::testing::Pair;
+using ::testing::StatusIs;
+
+using TestIndex = ExtendibleFileIndex<int, int, InMemoryFile, 128>;
+
+// Instantiates common index tests for the ExtendibleFileIndex index type.
+INSTANTIATE_TYPED_TEST_SUITE_P(ExtendibleFile, IndexTest, TestIndex);
+INSTANTIATE_TYPED_TEST_SUITE_P(ExtendibleFile, RemovableIndexTest, TestIndex);
+
+TEST(ExtendibleFileIndexTest, FillTest_SmallPages) {
+  using Index =
+      ExtendibleFileIndex<std::uint32_t, std::uint32_t, InMemoryFile, 64>;
+  constexpr int N = 1000;
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+  for (std::uint32_t i = 0; i < N; i++) {
+    EXPECT_THAT(index.GetOrAdd(i), IsOkAndHolds(Pair(i, true)));
+    for (std::uint32_t j = 0; j <= i; j++) {
+      EXPECT_THAT(index.Get(j), IsOkAndHolds(j)) << "Inserted: " << i << "\n";
+    }
+  }
+  EXPECT_THAT(index.Get(N), StatusIs(absl::StatusCode::kNotFound, _));
+}
+
+TEST(ExtendibleFileIndexTest, DirectoryGrowsWithNumberOfBuckets) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  EXPECT_EQ(index.GetGlobalDepth(), 0);
+  EXPECT_EQ(index.GetNumBuckets(), 1);
+  for (int i = 0; i < 10000; i++) {
+    ASSERT_OK(index.GetOrAdd(i));
+  }
+  // Every bucket is a single page, holding at most 7 entries of 16 bytes.
+  EXPECT_THAT(index.GetNumBuckets(), Gt(10000 / 7));
+  EXPECT_GE(std::size_t{1} << index.GetGlobalDepth(), index.GetNumBuckets());
+}
+
+TEST(ExtendibleFileIndexTest, HashesMatchFileIndex) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath() / "a"));
+  ASSERT_OK_AND_ASSIGN(auto reference,
+                       (FileIndex<int, int, InMemoryFile, 128>::Open(
+                           ctx, dir.GetPath() / "b")));
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_OK(index.GetOrAdd(i * 7));
+    ASSERT_OK(reference.GetOrAdd(i * 7));
+  }
+  ASSERT_OK_AND_ASSIGN(auto hash, reference.GetHash());
+  EXPECT_THAT(index.GetHash(), IsOkAndHolds(hash));
+}
+
+TEST(ExtendibleFileIndexTest, StoreCanBeSavedAndRestored) {
+  using Index = ExtendibleFileIndex<int, int, SingleFile>;
+  const int kNumElements = 100000;
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  std::size_t num_buckets;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < kNumElements; i++) {
+      EXPECT_THAT(index.GetOrAdd(i + 5), IsOkAndHolds(Pair(i, true)));
+    }
+    ASSERT_OK_AND_ASSIGN(hash, index.GetHash());
+    num_buckets = index.GetNumBuckets();
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto restored, Index::Open(ctx, dir.GetPath()));
+    EXPECT_THAT(restored.GetHash(), IsOkAndHolds(hash));
+    EXPECT_EQ(restored.GetNumBuckets(), num_buckets);
+    for (int i = 0; i < kNumElements; i++) {
+      EXPECT_THAT(restored.Get(i + 5), IsOkAndHolds(i));
+    }
+  }
+}
+
+TEST(ExtendibleFileIndexTest, SnapshotListsKeysInOrdinalOrder) {
+  using Index =
+      ExtendibleFileIndex<std::uint32_t, std::uint32_t, InMemoryFile, 64>;
+  TempDir dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+  std::vector<std::uint32_t> keys;
+  for (std::uint32_t i = 0; i < 5000; i++) {
+    keys.push_back(i * 31 + 7);
+    ASSERT_OK(index.GetOrAdd(keys.back()));
+  }
+  ASSERT_OK_AND_ASSIGN(auto snapshot, index.CreateSnapshot());
+  EXPECT_EQ(snapshot->GetSize(), keys.size());
+  EXPECT_THAT(snapshot->GetKeys(0, keys.size()), ElementsAreArray(keys));
+}
+
+TEST(ExtendibleFileIndexTest, RemovalsSurviveSplitsAndReopening) {
+  using Index =
+      ExtendibleFileIndex<std::uint32_t, std::uint32_t, SingleFile, 64>;
+  TempDir dir;
+  Context ctx;
+  std::map<std::uint32_t, std::uint32_t> reference;
+  std::uint32_t last_released;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+    for (std::uint32_t i = 0; i < 3000; i++) {
+      ASSERT_OK_AND_ASSIGN(auto res, index.GetOrAdd(i));
+      reference[i] = res.first;
+    }
+    for (std::uint32_t i = 0; i < 3000; i += 3) {
+      ASSERT_OK(index.Remove(i));
+      reference.erase(i);
+    }
+    for (std::uint32_t i = 3000; i < 6000; i++) {
+      ASSERT_OK_AND_ASSIGN(auto res, index.GetOrAdd(i));
+      reference[i] = res.first;
+    }
+    ASSERT_OK(index.Remove(4000));
+    last_released = reference[4000];
+    reference.erase(4000);
+    ASSERT_OK_AND_ASSIGN(hash, index.GetHash());
+    ASSERT_OK(index.Close());
+  }
+  ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+  EXPECT_THAT(index.GetHash(), IsOkAndHolds(hash));
+  for (std::uint32_t i = 0; i < 6000; i++) {
+    auto pos = reference.find(i);
+    if (pos == reference.end()) {
+      EXPECT_THAT(index.Get(i), StatusIs(absl::StatusCode::kNotFound, _));
+    } else {
+      EXPECT_THAT(index.Get(i), IsOkAndHolds(pos->second));
+    }
+  }
+  EXPECT_THAT(index.GetOrAdd(7000), IsOkAndHolds(Pair(last_released, true)));
+}
+
+TEST(ExtendibleFileIndexTest, FailedSplitsBeyondMaxGlobalDepthKeepIndexIntact) {
+  // With 3 entries per page and a global depth of at most 2, the index can hold
+  // at most 12 keys. Inserts into full buckets that can not be split any
+  // further fail without consuming ordinals or losing keys.
+  using Index =
+      ExtendibleFileIndex<std::uint32_t, std::uint32_t, InMemoryFile, 64, 2>;
+  TempDir dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+  std::map<std::uint32_t, std::uint32_t> reference;
+  std::vector<std::uint32_t> rejected;
+  for (std::uint32_t i = 0; i < 100; i++) {
+    auto res = index.GetOrAdd(i);
+    if (res.ok()) {
+      EXPECT_THAT(*res, Pair(reference.size(), true));
+      reference[i] = res->first;
+    } else {
+      EXPECT_THAT(res, StatusIs(absl::StatusCode::kResourceExhausted, _));
+      rejected.push_back(i);
+    }
+  }
+  EXPECT_LE(index.GetGlobalDepth(), 2);
+  EXPECT_LE(reference.size(), 12);
+  EXPECT_FALSE(rejected.empty());
+  for (const auto& [key, ordinal] : reference) {
+    EXPECT_THAT(index.Get(key), IsOkAndHolds(ordinal));
+  }
+  for (std::uint32_t key : rejected) {
+    EXPECT_THAT(index.Get(key), StatusIs(absl::StatusCode::kNotFound, _));
+  }
+  ASSERT_OK_AND_ASSIGN(auto snapshot, index.CreateSnapshot());
+  EXPECT_EQ(snapshot->GetSize(), reference.size());
+}
+
+}  // namespace
+}  // namespace carmen::backend::index
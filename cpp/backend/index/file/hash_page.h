@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <optional>
 
 #include "backend/common/page.h"
 #include "backend/common/page_id.h"
@@ -128,6 +129,21 @@ class alignas(kFileSystemPageSize) HashPage {
     return pos;
   }
 
+  // Removes the entry with the given hash and key from this page, keeping the
+  // remaining entries sorted. Returns a copy of the removed entry or nothing if
+  // no such entry is present.
+  std::optional<Entry> Remove(H hash, const K& key) {
+    Entry* entry = Find(hash, key);
+    if (entry == nullptr) {
+      return std::nullopt;
+    }
+    Entry res = *entry;
+    Entry* end = GetData().data() + Size();
+    std::memmove(entry, entry + 1, sizeof(Entry) * (end - entry - 1));
+    Resize(Size() - 1);
+    return res;
+  }
+
   // Determines whether this page is full.
   bool IsFull() const { return Size() == kNumEntries; }
 
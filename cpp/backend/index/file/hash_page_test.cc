@@ -19,6 +19,7 @@ namespace {
 
 using ::testing::FieldsAre;
 using ::testing::IsNull;
+using ::testing::Optional;
 using ::testing::Pointee;
 
 TEST(HashPageTest, IsPage) {
@@ -81,5 +82,25 @@ TEST(HashPageTest, InsertFailsIfSizeLimitIsReached) {
   EXPECT_THAT(page.Insert(limit + 1, 0, 0), IsNull());
 }
 
+TEST(HashPageTest, RemovedElementsAreNoLongerFound) {
+  TestPage page;
+  page.Clear();
+  page.Insert(0, 1, 6);
+  page.Insert(2, 3, 7);
+  page.Insert(4, 5, 8);
+
+  EXPECT_EQ(page.Remove(2, 1), std::nullopt);
+  EXPECT_THAT(page.Remove(2, 3), Optional(FieldsAre(2, 3, 7)));
+  EXPECT_EQ(page.Size(), 2);
+  EXPECT_THAT(page.Find(2, 3), IsNull());
+  EXPECT_EQ(page.Remove(2, 3), std::nullopt);
+
+  // Remaining entries stay sorted by their hash.
+  EXPECT_THAT(page.Find(0, 1), Pointee(FieldsAre(0, 1, 6)));
+  EXPECT_THAT(page.Find(4, 5), Pointee(FieldsAre(4, 5, 8)));
+  EXPECT_THAT(page.Insert(2, 9, 9), Pointee(FieldsAre(2, 9, 9)));
+  EXPECT_THAT(page[1], FieldsAre(2, 9, 9));
+}
+
 }  // namespace
 }  // namespace carmen::backend::index
@@ -10,12 +10,19 @@
 
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <concepts>
 #include <deque>
 #include <filesystem>
 #include <fstream>
 #include <memory>
 #include <optional>
 #include <queue>
+#include <ranges>
+#include <span>
+#include <tuple>
 #include <vector>
 
 #include "absl/status/status.h"
@@ -25,6 +32,7 @@
 #include "backend/common/page_pool.h"
 #include "backend/index/file/hash_page.h"
 #include "backend/index/file/stable_hash.h"
+#include "backend/index/index.h"
 #include "backend/structure.h"
 #include "common/fstream.h"
 #include "common/hash.h"
@@ -41,10 +49,10 @@ namespace carmen::backend::index {
 // All operations on this index require O(1) page accesses. In most cases, the
 // operations only require to access a single page.
 //
-// This implementation is currently incomplete. The following steps are missing:
-//  - implement metadata serialization
-//  - implement stable hashing
-// Thus, it can currently not be used to open existing data.
+// Keys are mapped to buckets using a StableHash. The version of the hash
+// function is recorded in the metadata, such that indexes created before the
+// introduction of a new version keep using the version they were created
+// with. Such indexes may be converted to a new version using Migrate(..).
 //
 // Internally, Key/value pairs are mapped to buckets which are represented
 // through linked lists of pages. The first, primary, page of each bucket is
@@ -52,6 +60,10 @@ namespace carmen::backend::index {
 // a second file. This simplifies the addressing of primary buckets and avoids
 // excessive file growing steps when performing splitting operations.
 //
+// Large sets of keys may be inserted into a new index using BulkLoad(..),
+// which computes the final number of buckets up front and writes all pages
+// sequentially instead of growing the table one split at a time.
+//
 // see: https://en.wikipedia.org/wiki/Linear_hashing
 template <Trivial K, std::integral I, template <std::size_t> class F,
           std::size_t page_size = kFileSystemPageSize>
@@ -67,10 +79,35 @@ class FileIndex {
   // The file-type used by instances for primary and overflow pages.
   using File = F<sizeof(Page)>;
 
-  // A factory function creating an instance of this index type.
+  // A factory function creating an instance of this index type. New indexes
+  // use the latest version of the stable hash function.
   static absl::StatusOr<FileIndex> Open(Context&,
                                         const std::filesystem::path& directory);
 
+  // Rewrites the index stored in the given directory to use the given version
+  // of the stable hash function. Ordinals and the index hash are preserved.
+  // The index must not be opened while being migrated. The migrated index is
+  // built next to the original one and committed by a marker file before its
+  // files are moved into place. A migration interrupted before the commit is
+  // discarded by the next Open(..), one interrupted afterwards is completed.
+  static absl::Status Migrate(
+      const std::filesystem::path& directory,
+      StableHashVersion version = kLatestStableHashVersion);
+
+  // Creates a new index in the given directory containing the given keys.
+  // Ordinals are assigned in the order of the range, and the resulting index,
+  // including its hash, is the same as if all keys had been added one by one
+  // using GetOrAdd(..). In particular, repeated keys keep the ordinal of their
+  // first occurrence. Keys are spilled to temporary files partitioned into runs
+  // of buckets, which are sorted one at a time, such that the memory used is
+  // bounded independently of the number of keys. Pages are written to the
+  // files directly, bypassing the page pools. The directory must not contain
+  // an index yet. The page pools of the result are configured by the context.
+  template <std::ranges::input_range Keys>
+    requires std::convertible_to<std::ranges::range_value_t<Keys>, K>
+  static absl::StatusOr<FileIndex> BulkLoad(
+      Context& context, const std::filesystem::path& directory, Keys&& keys);
+
   // File indexes are move-constructable.
   FileIndex(FileIndex&&) = default;
 
@@ -89,9 +126,30 @@ class FileIndex {
   // Otherwise, returns a not found status.
   absl::StatusOr<I> Get(const K& key) const;
 
+  // Removes the given key from this index, if present. The ordinal of the key
+  // is reused for the next new key. The space of the removed entry is only
+  // reclaimed when its bucket is split.
+  absl::Status Remove(const K& key);
+
   // Computes a hash over the full content of this index.
   absl::StatusOr<Hash> GetHash() const;
 
+  // Creates a snapshot of the keys of this index in the order of their
+  // ordinals. Since pages are organized by hash, all of them are scanned and
+  // the full list of keys is collected in memory. Free ordinals of removed
+  // keys are listed with a default-initialized key.
+  absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>> CreateSnapshot() const;
+
+  // Returns the number of ordinals assigned by this index, including free
+  // ordinals of removed keys. This matches the size of its snapshots.
+  std::size_t GetSize() const { return size_; }
+
+  // Returns the version of the stable hash function used for mapping keys to
+  // buckets.
+  StableHashVersion GetHashVersion() const {
+    return key_hasher_.GetVersion();
+  }
+
   // Flush unsaved index keys to disk.
   absl::Status Flush();
 
@@ -117,10 +175,48 @@ class FileIndex {
   // The log_2() of the initial size of an index.
   constexpr static const std::uint8_t kInitialHashLength = 2;
 
+  // The targeted ratio of used entries in primary pages of bulk loaded
+  // indexes. Leaving some space reduces the number of overflow pages caused
+  // by uneven bucket sizes and delays the need for splits on later inserts.
+  constexpr static const double kBulkLoadFillFactor = 0.75;
+
+  // The number of buckets sorted at a time by BulkLoad(..). The entries of a
+  // run are held in memory while it is sorted and written.
+  constexpr static const std::size_t kBulkLoadRunBuckets = 1 << 12;
+
+  // The number of keys transferred at a time between temporary files of
+  // BulkLoad(..) and memory.
+  constexpr static const std::size_t kBulkLoadBufferSize = 1 << 12;
+
+  // The name of the sub-directory temporary files of BulkLoad(..) are kept in.
+  constexpr static const char* kBulkLoadDirectory = "bulk_load";
+
+  // A marker at the start of the metadata file signaling that it is followed
+  // by the version of the stable hash function. Metadata files written before
+  // the introduction of hash versions start with the number of elements
+  // instead, which can never reach this value, and use StableHashVersion::kV1.
+  constexpr static const std::size_t kHashVersionMarker = ~std::size_t{0};
+
+  // The name of the sub-directory a migrated index is built in.
+  constexpr static const char* kMigrationDirectory = "migration";
+
+  // The name of the file marking a migration as completed, such that its
+  // files may be moved into place.
+  constexpr static const char* kMigrationMarker = "complete";
+
+  // Completes or discards a migration interrupted in the given directory.
+  static absl::Status RecoverMigration(const std::filesystem::path& directory);
+
+  // Same as the public Open(..) above, but new indexes use the given version
+  // of the stable hash function.
+  static absl::StatusOr<FileIndex> Open(const std::filesystem::path& directory,
+                                        StableHashVersion version);
+
   // Creates an index based on the given files.
   FileIndex(std::unique_ptr<File> primary_page_file,
             std::unique_ptr<File> overflow_page_file,
-            std::unique_ptr<std::filesystem::path> metadata_file);
+            std::unique_ptr<std::filesystem::path> metadata_file,
+            StableHashVersion version);
 
   // A helper function to locate an entry in this map. Returns a tuple
   // containing the key's hash, the containing bucket, and the containing entry.
@@ -132,6 +228,11 @@ class FileIndex {
   absl::StatusOr<std::tuple<hash_t, bucket_id_t, Entry*>> FindInternal(
       const K& key);
 
+  // Inserts a new entry for the given key with the given hash and value into
+  // the given bucket, splitting a bucket if needed. The key must not be present
+  // in the index.
+  absl::Status Insert(hash_t hash, bucket_id_t bucket, const K& key, I value);
+
   // Splits one bucket in the hash table causing the table to grow by one
   // bucket.
   absl::Status Split();
@@ -143,6 +244,15 @@ class FileIndex {
     return bucket >= num_buckets_ ? hash_key & low_mask_ : bucket;
   }
 
+  // Tests whether the given entry of the given bucket is a stale entry left in
+  // a bucket emptied by a split. Indexes written before FileIndex::Split kept
+  // emptied buckets empty may contain such entries. They are not reachable by
+  // lookups, but must be skipped when scanning all pages.
+  bool IsStaleEntry(bucket_id_t bucket, const Entry& entry) const {
+    return GetBucket(entry.hash) != bucket ||
+           key_hasher_(entry.key) != entry.hash;
+  }
+
   // Returns the overflow page being the tail fo the given bucket. Returns
   // defined null value if the given bucket has no overflow pages.
   PageId GetTail(bucket_id_t bucket) const {
@@ -195,7 +305,7 @@ class FileIndex {
   std::unique_ptr<std::filesystem::path> metadata_file_;
 
   // A hasher to compute hashes for keys.
-  StableHash<K> key_hasher_;
+  VersionedStableHash<K> key_hasher_;
 
   // The number of elements in this index.
   std::size_t size_ = 0;
@@ -226,6 +336,10 @@ class FileIndex {
   // Free pages in the overflow pool, ready for reuse.
   std::vector<PageId> overflow_page_free_list_;
 
+  // The ordinals of removed keys, ready for reuse. Ordinals are reused in the
+  // reverse order of their release.
+  std::vector<I> free_ordinals_;
+
   // ---- Hash Support ----
 
   mutable std::queue<K> unhashed_keys_;
@@ -236,26 +350,58 @@ class FileIndex {
 template <Trivial K, std::integral I, template <std::size_t> class F,
           std::size_t page_size>
 absl::StatusOr<FileIndex<K, I, F, page_size>>
-FileIndex<K, I, F, page_size>::Open(Context&,
+FileIndex<K, I, F, page_size>::Open(Context& context,
                                     const std::filesystem::path& directory) {
+  ASSIGN_OR_RETURN(auto index, Open(directory, kLatestStableHashVersion));
+  auto options = GetPagePoolOptions(context);
+  index.primary_pool_.EnableCompressedCache(options.compressed_cache_capacity);
+  index.overflow_pool_.EnableCompressedCache(options.compressed_cache_capacity);
+  return index;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::StatusOr<FileIndex<K, I, F, page_size>>
+FileIndex<K, I, F, page_size>::Open(const std::filesystem::path& directory,
+                                    StableHashVersion version) {
+  RETURN_IF_ERROR(RecoverMigration(directory));
   ASSIGN_OR_RETURN(auto primary_page_file,
                    File::Open(directory / "primary.dat"));
   ASSIGN_OR_RETURN(auto overflow_page_file,
                    File::Open(directory / "overflow.dat"));
 
-  auto index = FileIndex(
-      std::make_unique<File>(std::move(primary_page_file)),
-      std::make_unique<File>(std::move(overflow_page_file)),
-      std::make_unique<std::filesystem::path>(directory / "metadata.dat"));
-  if (!std::filesystem::exists(*index.metadata_file_)) {
-    return index;
+  auto metadata_file = directory / "metadata.dat";
+  if (!std::filesystem::exists(metadata_file)) {
+    return FileIndex(std::make_unique<File>(std::move(primary_page_file)),
+                     std::make_unique<File>(std::move(overflow_page_file)),
+                     std::make_unique<std::filesystem::path>(metadata_file),
+                     version);
   }
 
-  ASSIGN_OR_RETURN(auto in, FStream::Open(*index.metadata_file_,
+  ASSIGN_OR_RETURN(auto in, FStream::Open(metadata_file,
                                           std::ios::binary | std::ios::in));
 
+  // Determine the hash version, which is missing in legacy files.
+  std::size_t size;
+  RETURN_IF_ERROR(in.Read(size));
+  version = StableHashVersion::kV1;
+  if (size == kHashVersionMarker) {
+    RETURN_IF_ERROR(in.Read(version));
+    if (!IsValid(version)) {
+      return absl::InternalError(absl::StrCat(
+          "Unsupported stable hash version ", static_cast<int>(version),
+          " in ", metadata_file.string()));
+    }
+    RETURN_IF_ERROR(in.Read(size));
+  }
+
+  auto index = FileIndex(
+      std::make_unique<File>(std::move(primary_page_file)),
+      std::make_unique<File>(std::move(overflow_page_file)),
+      std::make_unique<std::filesystem::path>(metadata_file), version);
+
   // Start with scalars.
-  RETURN_IF_ERROR(in.Read(index.size_));
+  index.size_ = size;
   RETURN_IF_ERROR(in.Read(index.next_to_split_));
   RETURN_IF_ERROR(in.Read(index.low_mask_));
   RETURN_IF_ERROR(in.Read(index.high_mask_));
@@ -265,7 +411,6 @@ FileIndex<K, I, F, page_size>::Open(Context&,
 
   // Read bucket tail list.
   assert(sizeof(index.bucket_tails_.size()) == sizeof(std::size_t));
-  std::size_t size;
   RETURN_IF_ERROR(in.Read(size));
   index.bucket_tails_.resize(size);
   for (std::size_t i = 0; i < size; i++) {
@@ -280,6 +425,371 @@ FileIndex<K, I, F, page_size>::Open(Context&,
     RETURN_IF_ERROR(in.Read(index.overflow_page_free_list_[i]));
   }
 
+  // Read free ordinals, which are missing in files written before keys could
+  // be removed.
+  ASSIGN_OR_RETURN(auto num_read, in.ReadUntilEof(std::span(&size, 1)));
+  if (num_read == 1) {
+    index.free_ordinals_.resize(size);
+    RETURN_IF_ERROR(in.Read(std::span(index.free_ordinals_)));
+  }
+
+  return index;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::Status FileIndex<K, I, F, page_size>::Migrate(
+    const std::filesystem::path& directory, StableHashVersion version) {
+  // The migrated index is built in a sub-directory and moved into place once
+  // completed. Entries are copied bucket by bucket, keeping their ordinals.
+  auto target_directory = directory / kMigrationDirectory;
+  {
+    Context context;
+    ASSIGN_OR_RETURN(auto source, Open(context, directory));
+    if (source.GetHashVersion() == version) {
+      return source.Close();
+    }
+
+    RETURN_IF_ERROR(CreateDirectory(target_directory));
+    ASSIGN_OR_RETURN(auto target, Open(target_directory, version));
+    for (bucket_id_t bucket = 0; bucket < source.num_buckets_; bucket++) {
+      ASSIGN_OR_RETURN(Page * page,
+                       source.primary_pool_.template Get<Page>(bucket));
+      while (page != nullptr) {
+        for (std::size_t i = 0; i < page->Size(); i++) {
+          const Entry& entry = (*page)[i];
+          if (source.IsStaleEntry(bucket, entry)) {
+            continue;
+          }
+          auto hash = target.key_hasher_(entry.key);
+          RETURN_IF_ERROR(target.Insert(hash, target.GetBucket(hash),
+                                        entry.key, entry.value));
+        }
+        auto next = page->GetNext();
+        if (next == kNullPage) {
+          break;
+        }
+        ASSIGN_OR_RETURN(page, source.overflow_pool_.template Get<Page>(next));
+      }
+    }
+    target.size_ = source.size_;
+    target.free_ordinals_ = source.free_ordinals_;
+    ASSIGN_OR_RETURN(target.hash_, source.GetHash());
+    RETURN_IF_ERROR(target.Close());
+    RETURN_IF_ERROR(source.Close());
+  }
+
+  // Once the marker is written, the migration is committed and completed by
+  // RecoverMigration(..), even if the process is interrupted while moving
+  // files.
+  ASSIGN_OR_RETURN(auto marker,
+                   FStream::Open(target_directory / kMigrationMarker,
+                                 std::ios::binary | std::ios::out));
+  RETURN_IF_ERROR(marker.Close());
+  return RecoverMigration(directory);
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::Status FileIndex<K, I, F, page_size>::RecoverMigration(
+    const std::filesystem::path& directory) {
+  auto migration = directory / kMigrationDirectory;
+  std::error_code error;
+  if (!std::filesystem::exists(migration, error)) {
+    return absl::OkStatus();
+  }
+
+  // Files of a committed migration are moved into place. The metadata file is
+  // moved last, since it determines the hash version the page files are
+  // interpreted with. Files moved before an interruption are skipped.
+  if (std::filesystem::exists(migration / kMigrationMarker, error)) {
+    for (const char* file : {"primary.dat", "overflow.dat", "metadata.dat"}) {
+      if (!std::filesystem::exists(migration / file, error)) {
+        continue;
+      }
+      std::filesystem::rename(migration / file, directory / file, error);
+      if (error) {
+        return absl::InternalError(
+            absl::StrCat("Failed to move migrated file ", file, " into ",
+                         directory.string(), ": ", error.message()));
+      }
+    }
+  }
+
+  // Uncommitted migrations are discarded, leaving the original index intact.
+  std::filesystem::remove_all(migration, error);
+  if (error) {
+    return absl::InternalError(
+        absl::StrCat("Failed to remove migration directory ",
+                     migration.string(), ": ", error.message()));
+  }
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+template <std::ranges::input_range Keys>
+  requires std::convertible_to<std::ranges::range_value_t<Keys>, K>
+absl::StatusOr<FileIndex<K, I, F, page_size>>
+FileIndex<K, I, F, page_size>::BulkLoad(Context& context,
+                                        const std::filesystem::path& directory,
+                                        Keys&& keys) {
+  auto metadata_file = directory / "metadata.dat";
+  if (std::filesystem::exists(metadata_file)) {
+    return absl::FailedPreconditionError(absl::StrCat(
+        "Unable to bulk load into existing index in ", directory.string()));
+  }
+
+  // Temporary files left by an interrupted bulk load are discarded.
+  auto temp_directory = directory / kBulkLoadDirectory;
+  std::error_code error;
+  std::filesystem::remove_all(temp_directory, error);
+  if (error) {
+    return absl::InternalError(
+        absl::StrCat("Failed to remove bulk load directory ",
+                     temp_directory.string(), ": ", error.message()));
+  }
+  RETURN_IF_ERROR(CreateDirectory(temp_directory));
+
+  // Spill all keys to a file in insertion order, such that the input is only
+  // consumed once and its size becomes known.
+  auto keys_file = temp_directory / "keys.dat";
+  std::size_t num_keys = 0;
+  {
+    ASSIGN_OR_RETURN(auto out,
+                     FStream::Open(keys_file, std::ios::binary | std::ios::out |
+                                                  std::ios::trunc));
+    std::vector<K> buffer;
+    buffer.reserve(kBulkLoadBufferSize);
+    for (const auto& key : keys) {
+      buffer.push_back(key);
+      num_keys++;
+      if (buffer.size() == kBulkLoadBufferSize) {
+        RETURN_IF_ERROR(out.Write(std::span<const K>(buffer)));
+        buffer.clear();
+      }
+    }
+    RETURN_IF_ERROR(out.Write(std::span<const K>(buffer)));
+    RETURN_IF_ERROR(out.Close());
+  }
+
+  // Calls the given function with the position and the key of each spilled
+  // key in insertion order.
+  auto for_each_key = [&](auto op) -> absl::Status {
+    ASSIGN_OR_RETURN(auto in,
+                     FStream::Open(keys_file, std::ios::binary | std::ios::in));
+    std::vector<K> buffer(kBulkLoadBufferSize);
+    std::size_t pos = 0;
+    std::size_t num_read;
+    do {
+      ASSIGN_OR_RETURN(num_read, in.ReadUntilEof(std::span(buffer)));
+      for (std::size_t i = 0; i < num_read; i++) {
+        op(pos++, buffer[i]);
+      }
+    } while (num_read == buffer.size());
+    return in.Close();
+  };
+
+  // Determine the final number of buckets. The masks are set up to describe
+  // the same state linear hashing reaches when growing to this size.
+  const std::size_t num_buckets = std::max<std::size_t>(
+      1 << kInitialHashLength,
+      std::ceil(num_keys / (Page::kNumEntries * kBulkLoadFillFactor)));
+  const std::size_t low_mask = std::bit_floor(num_buckets) - 1;
+  const std::size_t high_mask = (low_mask << 1) | 0x1;
+  auto get_bucket = [&](hash_t hash) -> bucket_id_t {
+    bucket_id_t bucket = hash & high_mask;
+    return bucket >= num_buckets ? hash & low_mask : bucket;
+  };
+
+  // Partition entries into runs of consecutive buckets, each kept in its own
+  // file. The value of each entry is its position in the input until ordinals
+  // are fixed below. Entries are buffered in memory and appended to the files
+  // of their runs whenever the buffers hold as many entries as a run.
+  const std::size_t num_runs =
+      (num_buckets + kBulkLoadRunBuckets - 1) / kBulkLoadRunBuckets;
+  auto get_run_file = [&](std::size_t run) {
+    return temp_directory / absl::StrCat("run-", run, ".dat");
+  };
+  {
+    VersionedStableHash<K> key_hasher(kLatestStableHashVersion);
+    std::vector<std::vector<Entry>> buffers(num_runs);
+    std::size_t num_buffered = 0;
+    auto spill = [&]() -> absl::Status {
+      for (std::size_t run = 0; run < num_runs; run++) {
+        ASSIGN_OR_RETURN(auto out, FStream::Open(get_run_file(run),
+                                                 std::ios::binary |
+                                                     std::ios::out |
+                                                     std::ios::app));
+        RETURN_IF_ERROR(out.Write(std::span<const Entry>(buffers[run])));
+        RETURN_IF_ERROR(out.Close());
+        buffers[run].clear();
+      }
+      num_buffered = 0;
+      return absl::OkStatus();
+    };
+    absl::Status status;
+    RETURN_IF_ERROR(for_each_key([&](std::size_t pos, const K& key) {
+      if (!status.ok()) {
+        return;
+      }
+      auto hash = key_hasher(key);
+      buffers[get_bucket(hash) / kBulkLoadRunBuckets].push_back(
+          Entry{hash, key, static_cast<I>(pos)});
+      if (++num_buffered == kBulkLoadRunBuckets * Page::kNumEntries) {
+        status = spill();
+      }
+    }));
+    RETURN_IF_ERROR(status);
+    RETURN_IF_ERROR(spill());
+  }
+
+  ASSIGN_OR_RETURN(auto primary_page_file,
+                   File::Open(directory / "primary.dat"));
+  ASSIGN_OR_RETURN(auto overflow_page_file,
+                   File::Open(directory / "overflow.dat"));
+
+  // Load, sort, and write one run at a time. Buckets are sorted by hash and
+  // repeated keys are dropped, keeping the first occurrence of each key. Pages
+  // are written in the order of their IDs, primary pages and overflow pages
+  // each.
+  std::vector<std::size_t> repeated;
+  std::deque<PageId> bucket_tails;
+  std::size_t num_overflow_pages = 1;  // page zero remains always unused
+  Page page{};
+  for (std::size_t run = 0; run < num_runs; run++) {
+    auto run_file = get_run_file(run);
+    std::vector<Entry> entries(std::filesystem::file_size(run_file, error) /
+                               sizeof(Entry));
+    if (error) {
+      return absl::InternalError(
+          absl::StrCat("Failed to get the size of ", run_file.string(), ": ",
+                       error.message()));
+    }
+    {
+      ASSIGN_OR_RETURN(auto in, FStream::Open(run_file, std::ios::binary |
+                                                            std::ios::in));
+      RETURN_IF_ERROR(in.Read(std::span(entries)));
+      RETURN_IF_ERROR(in.Close());
+    }
+    std::sort(entries.begin(), entries.end(),
+              [&](const Entry& a, const Entry& b) {
+                return std::tuple(get_bucket(a.hash), a.hash, a.value) <
+                       std::tuple(get_bucket(b.hash), b.hash, b.value);
+              });
+
+    auto first = entries.begin();
+    const bucket_id_t run_end =
+        std::min(num_buckets, (run + 1) * kBulkLoadRunBuckets);
+    for (bucket_id_t bucket = run * kBulkLoadRunBuckets; bucket < run_end;
+         bucket++) {
+      auto last = std::find_if(first, entries.end(), [&](const Entry& entry) {
+        return get_bucket(entry.hash) != bucket;
+      });
+      auto out = first;
+      auto same_hash = first;  // the first kept entry with the current hash
+      for (auto cur = first; cur != last; ++cur) {
+        if (same_hash == out || same_hash->hash != cur->hash) {
+          same_hash = out;
+        }
+        auto is_same = [&](const Entry& entry) {
+          return entry.key == cur->key;
+        };
+        if (std::any_of(same_hash, out, is_same)) {
+          repeated.push_back(cur->value);
+          continue;
+        }
+        *out++ = *cur;
+      }
+
+      std::span<const Entry> content(first, out);
+      File* file = &primary_page_file;
+      PageId id = bucket;
+      while (true) {
+        auto size = std::min(content.size(), Page::kNumEntries);
+        std::copy_n(content.begin(), size, &page[0]);
+        page.Resize(size);
+        content = content.subspan(size);
+        PageId next = content.empty() ? kNullPage : num_overflow_pages++;
+        page.SetNext(next);
+        RETURN_IF_ERROR(file->StorePage(id, page.AsRawData()));
+        if (next == kNullPage) {
+          break;
+        }
+        file = &overflow_page_file;
+        id = next;
+      }
+      if (file == &overflow_page_file) {
+        bucket_tails.resize(bucket + 1);
+        bucket_tails[bucket] = id;
+      }
+      first = last;
+    }
+  }
+  std::sort(repeated.begin(), repeated.end());
+
+  // Convert input positions into ordinals by skipping repeated keys. Repeated
+  // keys are only known once all runs are written, so written pages are
+  // updated if there are any.
+  if (!repeated.empty()) {
+    auto update = [&](File& file, PageId id) -> absl::Status {
+      RETURN_IF_ERROR(file.LoadPage(id, page.AsRawData()));
+      for (std::size_t i = 0; i < page.Size(); i++) {
+        auto pos = static_cast<std::size_t>(page[i].value);
+        page[i].value = static_cast<I>(
+            pos - (std::lower_bound(repeated.begin(), repeated.end(), pos) -
+                   repeated.begin()));
+      }
+      return file.StorePage(id, page.AsRawData());
+    };
+    for (PageId id = 0; id < num_buckets; id++) {
+      RETURN_IF_ERROR(update(primary_page_file, id));
+    }
+    for (PageId id = 1; id < num_overflow_pages; id++) {
+      RETURN_IF_ERROR(update(overflow_page_file, id));
+    }
+  }
+  RETURN_IF_ERROR(primary_page_file.Flush());
+  RETURN_IF_ERROR(overflow_page_file.Flush());
+
+  // The index hash covers keys in the order they have been introduced.
+  Sha256Hasher hasher;
+  Hash hash{};
+  {
+    auto next_repeated = repeated.begin();
+    RETURN_IF_ERROR(for_each_key([&](std::size_t pos, const K& key) {
+      if (next_repeated != repeated.end() && *next_repeated == pos) {
+        ++next_repeated;
+        return;
+      }
+      hash = carmen::GetHash(hasher, hash, key);
+    }));
+  }
+
+  std::filesystem::remove_all(temp_directory, error);
+  if (error) {
+    return absl::InternalError(
+        absl::StrCat("Failed to remove bulk load directory ",
+                     temp_directory.string(), ": ", error.message()));
+  }
+
+  auto index = FileIndex(
+      std::make_unique<File>(std::move(primary_page_file)),
+      std::make_unique<File>(std::move(overflow_page_file)),
+      std::make_unique<std::filesystem::path>(metadata_file),
+      kLatestStableHashVersion);
+  index.size_ = num_keys - repeated.size();
+  index.next_to_split_ = num_buckets - (low_mask + 1);
+  index.low_mask_ = low_mask;
+  index.high_mask_ = high_mask;
+  index.num_buckets_ = num_buckets;
+  index.num_overflow_pages_ = num_overflow_pages;
+  index.bucket_tails_ = std::move(bucket_tails);
+  index.hash_ = hash;
+  RETURN_IF_ERROR(index.Flush());
+  auto options = GetPagePoolOptions(context);
+  index.primary_pool_.EnableCompressedCache(options.compressed_cache_capacity);
+  index.overflow_pool_.EnableCompressedCache(options.compressed_cache_capacity);
   return index;
 }
 
@@ -288,10 +798,12 @@ template <Trivial K, std::integral I, template <std::size_t> class F,
 FileIndex<K, I, F, page_size>::FileIndex(
     std::unique_ptr<File> primary_page_file,
     std::unique_ptr<File> overflow_page_file,
-    std::unique_ptr<std::filesystem::path> metadata_file)
+    std::unique_ptr<std::filesystem::path> metadata_file,
+    StableHashVersion version)
     : primary_pool_(std::move(primary_page_file)),
       overflow_pool_(std::move(overflow_page_file)),
       metadata_file_(std::move(metadata_file)),
+      key_hasher_(version),
       low_mask_((1 << kInitialHashLength) - 1),
       high_mask_((low_mask_ << 1) | 0x1),
       num_buckets_(1 << kInitialHashLength) {}
@@ -305,8 +817,49 @@ absl::StatusOr<std::pair<I, bool>> FileIndex<K, I, F, page_size>::GetOrAdd(
     return std::pair{entry->value, false};
   }
 
-  size_++;
+  I value;
+  if (free_ordinals_.empty()) {
+    value = size_++;
+  } else {
+    value = free_ordinals_.back();
+    free_ordinals_.pop_back();
+  }
+  RETURN_IF_ERROR(Insert(hash, bucket, key, value));
+  unhashed_keys_.push(key);
+  return std::pair{value, true};
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::Status FileIndex<K, I, F, page_size>::Remove(const K& key) {
+  auto hash = key_hasher_(key);
+  auto bucket = GetBucket(hash);
 
+  // Entries are only removed from their page. Emptied overflow pages remain
+  // part of the bucket until it is split.
+  ASSIGN_OR_RETURN(Page * page, primary_pool_.template Get<Page>(bucket));
+  if (auto entry = page->Remove(hash, key)) {
+    primary_pool_.MarkAsDirty(bucket);
+    free_ordinals_.push_back(entry->value);
+    return absl::OkStatus();
+  }
+  for (PageId next = page->GetNext(); next != kNullPage;
+       next = page->GetNext()) {
+    ASSIGN_OR_RETURN(page, overflow_pool_.template Get<Page>(next));
+    if (auto entry = page->Remove(hash, key)) {
+      overflow_pool_.MarkAsDirty(next);
+      free_ordinals_.push_back(entry->value);
+      return absl::OkStatus();
+    }
+  }
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::Status FileIndex<K, I, F, page_size>::Insert(hash_t hash,
+                                                   bucket_id_t bucket,
+                                                   const K& key, I value) {
   // Trigger a split if the bucket has an overflow bucket.
   if (GetTail(bucket) != kNullPage) {
     RETURN_IF_ERROR(Split());
@@ -326,7 +879,7 @@ absl::StatusOr<std::pair<I, bool>> FileIndex<K, I, F, page_size>::GetOrAdd(
     overflow_pool_.MarkAsDirty(tail);
   }
 
-  if (page->Insert(hash, key, size_ - 1) == nullptr) {
+  if (page->Insert(hash, key, value) == nullptr) {
     auto new_overflow_id = GetFreeOverflowPageId();
     page->SetNext(new_overflow_id);
     ASSIGN_OR_RETURN(Page * overflow_page,
@@ -334,12 +887,10 @@ absl::StatusOr<std::pair<I, bool>> FileIndex<K, I, F, page_size>::GetOrAdd(
     assert(overflow_page->Size() == 0);
     assert(overflow_page->GetNext() == 0);
     SetTail(bucket, new_overflow_id);
-    overflow_page->Insert(hash, key, size_ - 1);
+    overflow_page->Insert(hash, key, value);
     overflow_pool_.MarkAsDirty(new_overflow_id);
   }
-
-  unhashed_keys_.push(key);
-  return std::pair{size_ - 1, true};
+  return absl::OkStatus();
 }
 
 template <Trivial K, std::integral I, template <std::size_t> class F,
@@ -375,7 +926,9 @@ absl::Status FileIndex<K, I, F, page_size>::Flush() {
   ASSIGN_OR_RETURN(auto out, FStream::Open(*metadata_file_,
                                            std::ios::binary | std::ios::out));
 
-  // Start with scalars.
+  // Start with the hash version, followed by scalars.
+  RETURN_IF_ERROR(out.Write(kHashVersionMarker));
+  RETURN_IF_ERROR(out.Write(key_hasher_.GetVersion()));
   RETURN_IF_ERROR(out.Write(size_));
   RETURN_IF_ERROR(out.Write(next_to_split_));
   RETURN_IF_ERROR(out.Write(low_mask_));
@@ -396,6 +949,10 @@ absl::Status FileIndex<K, I, F, page_size>::Flush() {
   for (const auto& page_id : overflow_page_free_list_) {
     RETURN_IF_ERROR(out.Write(page_id));
   }
+
+  // Write free ordinals.
+  RETURN_IF_ERROR(out.Write(free_ordinals_.size()));
+  RETURN_IF_ERROR(out.Write(std::span<const I>(free_ordinals_)));
   return absl::OkStatus();
 }
 
@@ -408,6 +965,35 @@ absl::Status FileIndex<K, I, F, page_size>::Close() {
   return absl::OkStatus();
 }
 
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>>
+FileIndex<K, I, F, page_size>::CreateSnapshot() const {
+  std::vector<K> keys(size_);
+  for (bucket_id_t bucket = 0; bucket < num_buckets_; bucket++) {
+    ASSIGN_OR_RETURN(Page * page, primary_pool_.template Get<Page>(bucket));
+    while (page != nullptr) {
+      for (std::size_t i = 0; i < page->Size(); i++) {
+        const Entry& entry = (*page)[i];
+        if (IsStaleEntry(bucket, entry)) {
+          continue;
+        }
+        if (static_cast<std::size_t>(entry.value) >= keys.size()) {
+          return absl::InternalError(absl::StrCat(
+              "Invalid ordinal ", entry.value, " in index of size ", size_));
+        }
+        keys[entry.value] = entry.key;
+      }
+      auto next = page->GetNext();
+      if (next == kNullPage) {
+        break;
+      }
+      ASSIGN_OR_RETURN(page, overflow_pool_.template Get<Page>(next));
+    }
+  }
+  return std::make_unique<MaterializedIndexSnapshot<K>>(std::move(keys));
+}
+
 template <Trivial K, std::integral I, template <std::size_t> class F,
           std::size_t page_size>
 void FileIndex<K, I, F, page_size>::Dump() const {
@@ -430,7 +1016,7 @@ void FileIndex<K, I, F, page_size>::Dump() const {
         std::cout << "\t\tError: " << result.status() << "\n";
         break;
       }
-      page = next == 0 ? nullptr : result.AsPointer();
+      page = next == 0 ? nullptr : result->AsPointer();
     }
   }
 }
@@ -443,6 +1029,7 @@ MemoryFootprint FileIndex<K, I, F, page_size>::GetMemoryFootprint() const {
   res.Add("overflow_pool", overflow_pool_.GetMemoryFootprint());
   res.Add("bucket_tails", SizeOf(bucket_tails_));
   res.Add("free_list", SizeOf(overflow_page_free_list_));
+  res.Add("free_ordinals", SizeOf(free_ordinals_));
   return res;
 }
 
@@ -552,8 +1139,10 @@ absl::Status FileIndex<K, I, F, page_size>::Split() {
     }
     (*page)[i++] = entry;
   }
+  // The last page is only full if the bucket is not empty.
   auto remaining = old_bucket.size() % Page::kNumEntries;
-  page->Resize(remaining == 0 ? Page::kNumEntries : remaining);
+  page->Resize(remaining == 0 && !old_bucket.empty() ? Page::kNumEntries
+                                                     : remaining);
 
   // Free remaining overflow pages.
   while (page != nullptr) {
@@ -588,7 +1177,8 @@ absl::Status FileIndex<K, I, F, page_size>::Split() {
     (*page)[i++] = entry;
   }
   remaining = new_bucket.size() % Page::kNumEntries;
-  page->Resize(remaining == 0 ? Page::kNumEntries : remaining);
+  page->Resize(remaining == 0 && !new_bucket.empty() ? Page::kNumEntries
+                                                     : remaining);
 
   return absl::OkStatus();
 }
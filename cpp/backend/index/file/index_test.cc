@@ -10,11 +10,20 @@
 
 #include "backend/index/file/index.h"
 
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include "backend/common/file.h"
 #include "backend/index/index_test_suite.h"
 #include "backend/structure.h"
 #include "common/file_util.h"
 #include "common/status_test_util.h"
+#include "common/type.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -22,7 +31,10 @@ namespace carmen::backend::index {
 namespace {
 
 using ::testing::_;
+using ::testing::ElementsAreArray;
+using ::testing::HasSubstr;
 using ::testing::IsOkAndHolds;
+using ::testing::Not;
 using ::testing::Pair;
 using ::testing::StatusIs;
 
@@ -30,6 +42,7 @@ using TestIndex = FileIndex<int, int, InMemoryFile, 128>;
 
 // Instantiates common index tests for the FileIndex index type.
 INSTANTIATE_TYPED_TEST_SUITE_P(File, IndexTest, TestIndex);
+INSTANTIATE_TYPED_TEST_SUITE_P(File, RemovableIndexTest, TestIndex);
 
 TEST(FileIndexTest, FillTest) {
   constexpr int N = 1000;
@@ -77,6 +90,36 @@ TEST(FileIndexTest, FillTest_LargePages) {
   }
 }
 
+// Counts the entries stored in the pages of the given index, including stale
+// entries, using the output of Dump().
+template <typename Index>
+int CountEntries(const Index& index) {
+  ::testing::internal::CaptureStdout();
+  index.Dump();
+  std::istringstream dump(::testing::internal::GetCapturedStdout());
+  int num_entries = 0;
+  for (std::string line; std::getline(dump, line);) {
+    if (line.starts_with("\t\t\t")) {
+      num_entries++;
+    }
+  }
+  return num_entries;
+}
+
+TEST(FileIndexTest, SplitsLeaveNoStaleEntries) {
+  // With small pages, many splits move all entries of a bucket to the other
+  // bucket, which must leave the emptied page without entries.
+  using Index = FileIndex<std::uint32_t, std::uint32_t, InMemoryFile, 64>;
+  constexpr int N = 1000;
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+  for (std::uint32_t i = 0; i < N; i++) {
+    ASSERT_OK(index.GetOrAdd(i));
+  }
+  EXPECT_EQ(CountEntries(index), N);
+}
+
 TEST(FileIndexTest, LastInsertedElementIsPresent) {
   // The last element being missing was observed as a bug during development.
   // This test is present to prevent this issue from being re-introduced.
@@ -112,5 +155,416 @@ TEST(FileIndexTest, StoreCanBeSavedAndRestored) {
   }
 }
 
+using AddressIndex = FileIndex<Address, int, SingleFile, 256>;
+
+Address ToAddress(int i) {
+  Address res{};
+  res[0] = i >> 8;
+  res[1] = i;
+  res[19] = i >> 4;
+  return res;
+}
+
+TEST(FileIndexTest, CompressedCacheIsEnabledByContext) {
+  TempDir dir;
+  {
+    Context ctx;
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+    std::stringstream out;
+    out << index.GetMemoryFootprint();
+    EXPECT_THAT(out.str(), Not(HasSubstr("compressed_cache")));
+  }
+  {
+    Context ctx;
+    ctx.RegisterComponent(PagePoolOptions{.compressed_cache_capacity = 1024});
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+    std::stringstream out;
+    out << index.GetMemoryFootprint();
+    EXPECT_THAT(out.str(), HasSubstr("compressed_cache"));
+  }
+}
+
+TEST(FileIndexTest, NewIndexesUseLatestHashVersion) {
+  TempDir dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+  EXPECT_EQ(index.GetHashVersion(), kLatestStableHashVersion);
+}
+
+TEST(FileIndexTest, MigrationPreservesOrdinalsAndHash) {
+  const int kNumElements = 5000;
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < kNumElements; i++) {
+      ASSERT_THAT(index.GetOrAdd(ToAddress(i)), IsOkAndHolds(Pair(i, true)));
+    }
+    ASSERT_OK_AND_ASSIGN(hash, index.GetHash());
+  }
+  for (auto version : {StableHashVersion::kV1, StableHashVersion::kV2}) {
+    ASSERT_OK(AddressIndex::Migrate(dir.GetPath(), version));
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+    EXPECT_EQ(index.GetHashVersion(), version);
+    EXPECT_THAT(index.GetHash(), IsOkAndHolds(hash));
+    for (int i = 0; i < kNumElements; i++) {
+      EXPECT_THAT(index.Get(ToAddress(i)), IsOkAndHolds(i));
+    }
+    EXPECT_THAT(index.Get(ToAddress(kNumElements)),
+                StatusIs(absl::StatusCode::kNotFound, _));
+  }
+
+  ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+  EXPECT_THAT(index.GetOrAdd(ToAddress(kNumElements)),
+              IsOkAndHolds(Pair(kNumElements, true)));
+}
+
+TEST(FileIndexTest, MigrationSkipsStaleEntries) {
+  const int kNumElements = 1000;
+  TempDir dir;
+  Context ctx;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < kNumElements; i++) {
+      ASSERT_OK(index.GetOrAdd(ToAddress(i)));
+    }
+  }
+
+  // Add a copy of an entry of another bucket and a zero-initialized entry to
+  // a primary page, like the ones left in buckets emptied by earlier versions
+  // of FileIndex::Split.
+  {
+    using Page = AddressIndex::Page;
+    ASSERT_OK_AND_ASSIGN(auto file, AddressIndex::File::Open(dir.GetPath() /
+                                                             "primary.dat"));
+    Page source;
+    ASSERT_OK(file.LoadPage(0, source));
+    ASSERT_GT(source.Size(), 0);
+    Page page;
+    PageId id = 1;
+    for (; id < file.GetNumPages(); id++) {
+      ASSERT_OK(file.LoadPage(id, page));
+      if (page.Size() + 2 <= Page::kNumEntries) {
+        break;
+      }
+    }
+    ASSERT_LT(id, file.GetNumPages());
+    auto size = page.Size();
+    page.Resize(size + 2);
+    page[size] = source[0];
+    page[size + 1] = Page::Entry{};
+    ASSERT_OK(file.StorePage(id, page));
+  }
+
+  ASSERT_OK(AddressIndex::Migrate(dir.GetPath(), StableHashVersion::kV1));
+  ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+  for (int i = 0; i < kNumElements; i++) {
+    EXPECT_THAT(index.Get(ToAddress(i)), IsOkAndHolds(i));
+  }
+
+  EXPECT_EQ(CountEntries(index), kNumElements);
+}
+
+TEST(FileIndexTest, InterruptedMigrationsAreCompletedOrDiscarded) {
+  const int kNumElements = 1000;
+  TempDir dir;
+  Context ctx;
+  auto original = dir.GetPath() / "original";
+  auto migrated = dir.GetPath() / "migrated";
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, original));
+    for (int i = 0; i < kNumElements; i++) {
+      ASSERT_OK(index.GetOrAdd(ToAddress(i)));
+    }
+  }
+  std::filesystem::copy(original, migrated);
+  ASSERT_OK(AddressIndex::Migrate(migrated, StableHashVersion::kV1));
+
+  auto check = [&](StableHashVersion version) {
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, original));
+    EXPECT_EQ(index.GetHashVersion(), version);
+    for (int i = 0; i < kNumElements; i++) {
+      EXPECT_THAT(index.Get(ToAddress(i)), IsOkAndHolds(i));
+    }
+    EXPECT_FALSE(std::filesystem::exists(original / "migration"));
+  };
+
+  // A migration interrupted before being committed is discarded.
+  auto migration = original / "migration";
+  std::filesystem::create_directory(migration);
+  std::filesystem::copy(migrated / "primary.dat", migration);
+  check(kLatestStableHashVersion);
+
+  // A committed migration interrupted while moving files is completed.
+  std::filesystem::create_directory(migration);
+  std::filesystem::copy(migrated / "primary.dat", original / "primary.dat",
+                        std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::copy(migrated / "overflow.dat", migration);
+  std::filesystem::copy(migrated / "metadata.dat", migration);
+  std::ofstream(migration / "complete").close();
+  check(StableHashVersion::kV1);
+}
+
+TEST(FileIndexTest, IndexWithoutHashVersionUsesFirstVersion) {
+  TempDir dir;
+  Context ctx;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < 100; i++) {
+      ASSERT_OK(index.GetOrAdd(ToAddress(i)));
+    }
+  }
+  ASSERT_OK(AddressIndex::Migrate(dir.GetPath(), StableHashVersion::kV1));
+
+  // Strip the hash version from the metadata to obtain the legacy format.
+  auto metadata_file = dir.GetPath() / "metadata.dat";
+  std::vector<char> metadata;
+  {
+    std::ifstream in(metadata_file, std::ios::binary);
+    metadata.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  constexpr auto kHeaderSize =
+      sizeof(std::size_t) + sizeof(StableHashVersion);
+  ASSERT_GT(metadata.size(), kHeaderSize);
+  {
+    std::ofstream out(metadata_file, std::ios::binary | std::ios::trunc);
+    out.write(metadata.data() + kHeaderSize, metadata.size() - kHeaderSize);
+  }
+
+  ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+  EXPECT_EQ(index.GetHashVersion(), StableHashVersion::kV1);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_THAT(index.Get(ToAddress(i)), IsOkAndHolds(i));
+  }
+}
+
+TEST(FileIndexTest, UnknownHashVersionIsDetected) {
+  TempDir dir;
+  Context ctx;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+    ASSERT_OK(index.GetOrAdd(ToAddress(1)));
+  }
+  {
+    std::fstream file(dir.GetPath() / "metadata.dat",
+                      std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(sizeof(std::size_t));
+    std::uint32_t version = 1000;
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  }
+  EXPECT_THAT(AddressIndex::Open(ctx, dir.GetPath()),
+              StatusIs(absl::StatusCode::kInternal, _));
+}
+
+TEST(FileIndexTest, BulkLoadMatchesIncrementalInsertion) {
+  // Some keys are repeated to check that they keep their first ordinal.
+  std::vector<Address> keys;
+  for (int i = 0; i < 5000; i++) {
+    keys.push_back(ToAddress(i));
+    if (i % 7 == 0) {
+      keys.push_back(ToAddress(i / 2));
+    }
+  }
+
+  TempDir incremental_dir;
+  TempDir bulk_dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto incremental,
+                       AddressIndex::Open(ctx, incremental_dir.GetPath()));
+  for (const auto& key : keys) {
+    ASSERT_OK(incremental.GetOrAdd(key));
+  }
+  ASSERT_OK_AND_ASSIGN(auto hash, incremental.GetHash());
+  {
+    ASSERT_OK_AND_ASSIGN(auto bulk,
+                         AddressIndex::BulkLoad(ctx, bulk_dir.GetPath(), keys));
+    EXPECT_THAT(bulk.GetHash(), IsOkAndHolds(hash));
+    for (const auto& key : keys) {
+      ASSERT_OK_AND_ASSIGN(auto ordinal, incremental.Get(key));
+      EXPECT_THAT(bulk.Get(key), IsOkAndHolds(ordinal));
+    }
+  }
+
+  // The bulk loaded index is persistent and can be extended.
+  ASSERT_OK_AND_ASSIGN(auto bulk, AddressIndex::Open(ctx, bulk_dir.GetPath()));
+  EXPECT_THAT(bulk.GetHash(), IsOkAndHolds(hash));
+  for (int i = 5000; i < 6000; i++) {
+    ASSERT_OK_AND_ASSIGN(auto expected, incremental.GetOrAdd(ToAddress(i)));
+    EXPECT_THAT(bulk.GetOrAdd(ToAddress(i)), IsOkAndHolds(expected));
+  }
+  ASSERT_OK_AND_ASSIGN(hash, incremental.GetHash());
+  EXPECT_THAT(bulk.GetHash(), IsOkAndHolds(hash));
+  for (int i = 0; i < 6000; i++) {
+    ASSERT_OK_AND_ASSIGN(auto ordinal, incremental.Get(ToAddress(i)));
+    EXPECT_THAT(bulk.Get(ToAddress(i)), IsOkAndHolds(ordinal));
+  }
+}
+
+TEST(FileIndexTest, BulkLoadHandlesOverflowPages) {
+  // With small pages, buckets exceed a single page frequently.
+  using Index = FileIndex<std::uint32_t, std::uint32_t, InMemoryFile, 64>;
+  std::vector<std::uint32_t> keys;
+  for (std::uint32_t i = 0; i < 10000; i++) {
+    keys.push_back(i * 17);
+  }
+  TempDir dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto index, Index::BulkLoad(ctx, dir.GetPath(), keys));
+  for (std::uint32_t i = 0; i < keys.size(); i++) {
+    EXPECT_THAT(index.Get(keys[i]), IsOkAndHolds(i));
+  }
+  EXPECT_THAT(index.Get(1), StatusIs(absl::StatusCode::kNotFound, _));
+  for (std::uint32_t i = 0; i < 1000; i++) {
+    EXPECT_THAT(index.GetOrAdd(i * 17 + 1),
+                IsOkAndHolds(Pair(keys.size() + i, true)));
+  }
+  for (std::uint32_t i = 0; i < keys.size(); i++) {
+    EXPECT_THAT(index.Get(keys[i]), IsOkAndHolds(i));
+  }
+}
+
+TEST(FileIndexTest, BulkLoadOfMultipleRunsMatchesIncrementalInsertion) {
+  // With small pages, the buckets are sorted in multiple runs. Repeated keys
+  // are spread across runs to check that ordinals are fixed in all of them.
+  using Index = FileIndex<std::uint32_t, std::uint32_t, InMemoryFile, 64>;
+  std::vector<std::uint32_t> keys;
+  for (std::uint32_t i = 0; i < 30000; i++) {
+    keys.push_back(i);
+    if (i % 11 == 0) {
+      keys.push_back(i / 3);
+    }
+  }
+
+  TempDir incremental_dir;
+  TempDir bulk_dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto incremental,
+                       Index::Open(ctx, incremental_dir.GetPath()));
+  for (const auto& key : keys) {
+    ASSERT_OK(incremental.GetOrAdd(key));
+  }
+  ASSERT_OK_AND_ASSIGN(auto bulk,
+                       Index::BulkLoad(ctx, bulk_dir.GetPath(), keys));
+  EXPECT_THAT(bulk.GetHash(), IsOkAndHolds(*incremental.GetHash()));
+  for (const auto& key : keys) {
+    ASSERT_OK_AND_ASSIGN(auto ordinal, incremental.Get(key));
+    EXPECT_THAT(bulk.Get(key), IsOkAndHolds(ordinal));
+  }
+  EXPECT_EQ(CountEntries(bulk), 30000);
+
+  // Temporary files are removed.
+  EXPECT_FALSE(std::filesystem::exists(bulk_dir.GetPath() / "bulk_load"));
+}
+
+TEST(FileIndexTest, BulkLoadOfEmptyRangeProducesEmptyIndex) {
+  TempDir dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(
+      auto index,
+      AddressIndex::BulkLoad(ctx, dir.GetPath(), std::vector<Address>{}));
+  EXPECT_THAT(index.GetHash(), IsOkAndHolds(Hash{}));
+  EXPECT_THAT(index.GetOrAdd(ToAddress(1)), IsOkAndHolds(Pair(0, true)));
+}
+
+TEST(FileIndexTest, BulkLoadRequiresEmptyDirectory) {
+  TempDir dir;
+  Context ctx;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+    ASSERT_OK(index.GetOrAdd(ToAddress(1)));
+  }
+  EXPECT_THAT(AddressIndex::BulkLoad(ctx, dir.GetPath(),
+                                     std::vector<Address>{ToAddress(2)}),
+              StatusIs(absl::StatusCode::kFailedPrecondition, _));
+}
+
+TEST(FileIndexTest, SnapshotListsKeysInOrdinalOrder) {
+  // With small pages, keys are spread over primary and overflow pages.
+  using Index = FileIndex<std::uint32_t, std::uint32_t, InMemoryFile, 64>;
+  TempDir dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+  std::vector<std::uint32_t> keys;
+  for (std::uint32_t i = 0; i < 5000; i++) {
+    keys.push_back(i * 31 + 7);
+    ASSERT_OK(index.GetOrAdd(keys.back()));
+  }
+  ASSERT_OK_AND_ASSIGN(auto snapshot, index.CreateSnapshot());
+  EXPECT_EQ(snapshot->GetSize(), keys.size());
+  EXPECT_THAT(snapshot->GetKeys(0, keys.size()), ElementsAreArray(keys));
+}
+
+TEST(FileIndexTest, RemovalsSurviveSplitsAndReopening) {
+  // With small pages, removed entries are spread over primary and overflow
+  // pages, and later insertions trigger splits of buckets with removals.
+  using Index = FileIndex<std::uint32_t, std::uint32_t, SingleFile, 64>;
+  TempDir dir;
+  Context ctx;
+  std::map<std::uint32_t, std::uint32_t> reference;
+  std::uint32_t last_released;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+    for (std::uint32_t i = 0; i < 3000; i++) {
+      ASSERT_OK_AND_ASSIGN(auto res, index.GetOrAdd(i));
+      reference[i] = res.first;
+    }
+    std::vector<std::uint32_t> released;
+    for (std::uint32_t i = 0; i < 3000; i += 3) {
+      ASSERT_OK(index.Remove(i));
+      released.push_back(reference[i]);
+      reference.erase(i);
+    }
+    for (std::uint32_t i = 3000; i < 6000; i++) {
+      ASSERT_OK_AND_ASSIGN(auto res, index.GetOrAdd(i));
+      if (!released.empty()) {
+        EXPECT_EQ(res.first, released.back());
+        released.pop_back();
+      }
+      reference[i] = res.first;
+    }
+    ASSERT_OK(index.Remove(4000));
+    last_released = reference[4000];
+    reference.erase(4000);
+    ASSERT_OK_AND_ASSIGN(hash, index.GetHash());
+    ASSERT_OK(index.Close());
+  }
+  ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+  EXPECT_THAT(index.GetHash(), IsOkAndHolds(hash));
+  for (std::uint32_t i = 0; i < 6000; i++) {
+    auto pos = reference.find(i);
+    if (pos == reference.end()) {
+      EXPECT_THAT(index.Get(i), StatusIs(absl::StatusCode::kNotFound, _));
+    } else {
+      EXPECT_THAT(index.Get(i), IsOkAndHolds(pos->second));
+    }
+  }
+  // The ordinal released last before closing the index is reused first.
+  EXPECT_THAT(index.GetOrAdd(7000), IsOkAndHolds(Pair(last_released, true)));
+}
+
+TEST(FileIndexTest, IndexWithoutFreeOrdinalsCanBeOpened) {
+  TempDir dir;
+  Context ctx;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < 100; i++) {
+      ASSERT_OK(index.GetOrAdd(ToAddress(i)));
+    }
+  }
+
+  // Strip the empty list of free ordinals to obtain the legacy format.
+  auto metadata_file = dir.GetPath() / "metadata.dat";
+  auto size = std::filesystem::file_size(metadata_file);
+  std::filesystem::resize_file(metadata_file, size - sizeof(std::size_t));
+
+  ASSERT_OK_AND_ASSIGN(auto index, AddressIndex::Open(ctx, dir.GetPath()));
+  for (int i = 0; i < 100; i++) {
+    EXPECT_THAT(index.Get(ToAddress(i)), IsOkAndHolds(i));
+  }
+  EXPECT_THAT(index.GetOrAdd(ToAddress(100)), IsOkAndHolds(Pair(100, true)));
+}
+
 }  // namespace
 }  // namespace carmen::backend::index
@@ -0,0 +1,487 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "backend/common/file.h"
+#include "backend/index/file/index.h"
+#include "backend/index/file/stable_hash.h"
+#include "backend/index/index.h"
+#include "backend/structure.h"
+#include "common/fstream.h"
+#include "common/hash.h"
+#include "common/memory_usage.h"
+#include "common/parallel.h"
+#include "common/status_util.h"
+#include "common/type.h"
+
+namespace carmen::backend::index {
+
+// A ShardedFileIndex implements the Index concept by partitioning keys based
+// on their stable hash into a fixed number of independent FileIndex shards,
+// each maintaining its own files and page pools. Thus, batches of keys can be
+// looked up and inserted using one thread per shard.
+//
+// Ordinals are assigned by this index in the order keys are added, exactly
+// like for a single FileIndex, independent of the shard a key is located in.
+// For this, each shard keeps an in-memory table mapping the ordinals assigned
+// by the shard to the ordinals of this index, costing one ordinal per key. The
+// hash of the index is the same as the one of a FileIndex containing the same
+// keys.
+//
+// Keys can not be removed from this index.
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size = kFileSystemPageSize,
+          std::size_t num_shards = 8>
+class ShardedFileIndex {
+ public:
+  static_assert(num_shards > 0, "At least one shard is required.");
+  // Shards of keys in batches are recorded using a single byte per key.
+  static_assert(num_shards <= 256, "At most 256 shards are supported.");
+
+  using key_type = K;
+  using value_type = I;
+
+  // The type of the individual shards.
+  using Shard = FileIndex<K, I, F, page_size>;
+
+  // A factory function creating an instance of this index type.
+  static absl::StatusOr<ShardedFileIndex> Open(
+      Context&, const std::filesystem::path& directory);
+
+  // Sharded file indexes are move-constructable.
+  ShardedFileIndex(ShardedFileIndex&&) = default;
+
+  // On destruction indexes are automatically flushed and closed.
+  ~ShardedFileIndex() { Close().IgnoreError(); }
+
+  // Retrieves the ordinal number for the given key. If the key is known, it
+  // will return a previously established value for the key. If the key has not
+  // been encountered before, a new ordinal value is assigned to the key and
+  // stored internally such that future lookups will return the same value.
+  absl::StatusOr<std::pair<I, bool>> GetOrAdd(const K& key);
+
+  // Retrieves the ordinals of a batch of keys, adding unknown keys to the
+  // index. The shards are processed in parallel. New ordinals are assigned in
+  // the order of the keys in the batch, such that the result is the same as
+  // calling GetOrAdd(..) for each key in order. If an error occurs, keys added
+  // to shards before the error remain part of the index.
+  absl::Status GetOrAdd(std::span<const K> keys, std::span<I> ordinals);
+
+  // Retrieves the ordinal number for the given key if previously registered.
+  // Otherwise, returns a not found status.
+  absl::StatusOr<I> Get(const K& key) const;
+
+  // Retrieves the ordinals of a batch of keys, processing the shards in
+  // parallel. Returns a not found status if any of the keys is not present.
+  absl::Status Get(std::span<const K> keys, std::span<I> ordinals) const;
+
+  // Computes a hash over the full content of this index.
+  absl::StatusOr<Hash> GetHash() const;
+
+  // Creates a snapshot of the keys of this index in the order of their
+  // ordinals. The keys of all shards are collected in memory.
+  absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>> CreateSnapshot() const;
+
+  // Returns the number of keys located in the given shard.
+  std::size_t GetShardSize(std::size_t shard) const {
+    return shards_[shard].ordinals.size();
+  }
+
+  // Flush unsaved index keys to disk.
+  absl::Status Flush();
+
+  // Close this index and release resources.
+  absl::Status Close();
+
+  // Summarizes the memory usage of this instance.
+  MemoryFootprint GetMemoryFootprint() const;
+
+ private:
+  // Batches smaller than this are processed on the calling thread, since the
+  // overhead of starting threads would exceed the gains.
+  constexpr static const std::size_t kMinParallelBatchSize = 256;
+
+  // A shard of this index and the ordinal mapping of its keys.
+  struct ShardInfo {
+    Shard index;
+    // Maps the ordinals assigned by the shard to the ordinals of this index.
+    std::vector<I> ordinals;
+    // The number of leading ordinals already written to the ordinal file.
+    std::size_t num_persisted = 0;
+    // The file the ordinal mapping is persisted in.
+    std::filesystem::path ordinal_file;
+  };
+
+  // Creates an empty index based on the given shards.
+  ShardedFileIndex(std::unique_ptr<std::filesystem::path> metadata_file,
+                   StableHashVersion version, std::vector<ShardInfo> shards);
+
+  // Obtains the shard the given key is located in. The upper half of the hash
+  // is used, since the lower bits are used by the shards to locate buckets.
+  std::size_t GetShard(const K& key) const {
+    return (key_hasher_(key) >> 32) % num_shards;
+  }
+
+  // Runs the given per-shard tasks, in parallel if the batch is large enough.
+  static absl::Status Run(std::size_t batch_size, std::vector<Task> tasks);
+
+  // Appends the ordinals not yet persisted to the ordinal file of the shard.
+  static absl::Status WriteOrdinals(ShardInfo& shard);
+
+  // Writes the hash version, size, and hash to the metadata file.
+  absl::Status WriteMetadata();
+
+  // The file used to store meta information of this index. The path is a
+  // unique ptr to manage ownership during moves. It is reset when the index is
+  // closed.
+  std::unique_ptr<std::filesystem::path> metadata_file_;
+
+  // A hasher to compute hashes for keys, used for selecting shards.
+  VersionedStableHash<K> key_hasher_;
+
+  // The shards of this index.
+  std::vector<ShardInfo> shards_;
+
+  // The number of elements in this index.
+  std::size_t size_ = 0;
+
+  // ---- Hash Support ----
+
+  mutable std::queue<K> unhashed_keys_;
+  mutable Sha256Hasher hasher_;
+  mutable Hash hash_{};
+};
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::StatusOr<ShardedFileIndex<K, I, F, page_size, num_shards>>
+ShardedFileIndex<K, I, F, page_size, num_shards>::Open(
+    Context& context, const std::filesystem::path& directory) {
+  std::vector<ShardInfo> shards;
+  shards.reserve(num_shards);
+  std::size_t size = 0;
+  for (std::size_t i = 0; i < num_shards; i++) {
+    auto path = directory / absl::StrCat("shard_", i);
+    RETURN_IF_ERROR(CreateDirectory(path));
+    ASSIGN_OR_RETURN(auto shard, Shard::Open(context, path));
+    std::vector<I> ordinals;
+    auto ordinal_file = path / "ordinals.dat";
+    if (std::filesystem::exists(ordinal_file)) {
+      ASSIGN_OR_RETURN(auto in, FStream::Open(ordinal_file, std::ios::binary |
+                                                                std::ios::in));
+      ordinals.resize(std::filesystem::file_size(ordinal_file) / sizeof(I));
+      RETURN_IF_ERROR(in.Read(std::span(ordinals)));
+    }
+    // Each key of a shard needs to be mapped to an ordinal of this index.
+    if (ordinals.size() != shard.GetSize()) {
+      return absl::InternalError(absl::StrCat(
+          "Shard in ", path.string(), " with ", shard.GetSize(), " keys has ",
+          ordinals.size(), " ordinals in ", ordinal_file.string()));
+    }
+    const std::size_t num_ordinals = ordinals.size();
+    size += num_ordinals;
+    shards.push_back(ShardInfo{
+        .index = std::move(shard),
+        .ordinals = std::move(ordinals),
+        .num_persisted = num_ordinals,
+        .ordinal_file = std::move(ordinal_file),
+    });
+  }
+
+  auto metadata_file = directory / "metadata.dat";
+  if (!std::filesystem::exists(metadata_file)) {
+    if (size != 0) {
+      return absl::InternalError(absl::StrCat(
+          "Missing metadata for sharded index in ", directory.string()));
+    }
+    return ShardedFileIndex(
+        std::make_unique<std::filesystem::path>(metadata_file),
+        kLatestStableHashVersion, std::move(shards));
+  }
+
+  ASSIGN_OR_RETURN(auto in, FStream::Open(metadata_file,
+                                          std::ios::binary | std::ios::in));
+  StableHashVersion version;
+  RETURN_IF_ERROR(in.Read(version));
+  if (!IsValid(version)) {
+    return absl::InternalError(absl::StrCat(
+        "Unsupported stable hash version ", static_cast<int>(version), " in ",
+        metadata_file.string()));
+  }
+  auto index =
+      ShardedFileIndex(std::make_unique<std::filesystem::path>(metadata_file),
+                       version, std::move(shards));
+  RETURN_IF_ERROR(in.Read(index.size_));
+  RETURN_IF_ERROR(in.Read(index.hash_));
+  if (index.size_ != size) {
+    return absl::InternalError(
+        absl::StrCat("Sharded index in ", directory.string(), " of size ",
+                     index.size_, " has ", size, " ordinals in its shards"));
+  }
+  return index;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+ShardedFileIndex<K, I, F, page_size, num_shards>::ShardedFileIndex(
+    std::unique_ptr<std::filesystem::path> metadata_file,
+    StableHashVersion version, std::vector<ShardInfo> shards)
+    : metadata_file_(std::move(metadata_file)),
+      key_hasher_(version),
+      shards_(std::move(shards)) {}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::StatusOr<std::pair<I, bool>>
+ShardedFileIndex<K, I, F, page_size, num_shards>::GetOrAdd(const K& key) {
+  auto& shard = shards_[GetShard(key)];
+  ASSIGN_OR_RETURN((auto [local, added]), shard.index.GetOrAdd(key));
+  if (!added) {
+    return std::pair{shard.ordinals[local], false};
+  }
+  assert(static_cast<std::size_t>(local) == shard.ordinals.size());
+  shard.ordinals.push_back(size_++);
+  unhashed_keys_.push(key);
+  return std::pair{shard.ordinals.back(), true};
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::Status ShardedFileIndex<K, I, F, page_size, num_shards>::GetOrAdd(
+    std::span<const K> keys, std::span<I> ordinals) {
+  if (keys.size() != ordinals.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Got ", keys.size(), " keys but space for ",
+                     ordinals.size(), " ordinals"));
+  }
+
+  // The outcome of the shard-local insertion of each key in the batch.
+  enum Outcome : std::uint8_t { kFailed, kPresent, kAdded };
+
+  std::vector<std::uint8_t> shard_of(keys.size());
+  std::array<std::vector<std::size_t>, num_shards> positions;
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    shard_of[i] = GetShard(keys[i]);
+    positions[shard_of[i]].push_back(i);
+  }
+
+  // In the first phase, the keys are inserted into their shards in parallel,
+  // producing shard-local ordinals.
+  std::vector<std::uint8_t> outcomes(keys.size(), kFailed);
+  std::vector<Task> tasks;
+  for (std::size_t s = 0; s < num_shards; s++) {
+    if (positions[s].empty()) {
+      continue;
+    }
+    tasks.push_back([&, s]() -> absl::Status {
+      for (std::size_t i : positions[s]) {
+        ASSIGN_OR_RETURN((auto [local, added]),
+                         shards_[s].index.GetOrAdd(keys[i]));
+        ordinals[i] = local;
+        outcomes[i] = added ? kAdded : kPresent;
+      }
+      return absl::OkStatus();
+    });
+  }
+  auto status = Run(keys.size(), std::move(tasks));
+
+  // In the second phase, shard-local ordinals are mapped to ordinals of this
+  // index in batch order. Each shard assigns its ordinals in the order of the
+  // keys in the batch, and the first occurrence of a repeated key is the one
+  // being added. Keys added before a failure are still registered to keep the
+  // shards and the ordinal mapping consistent.
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    auto& shard = shards_[shard_of[i]];
+    if (outcomes[i] == kAdded) {
+      assert(static_cast<std::size_t>(ordinals[i]) == shard.ordinals.size());
+      shard.ordinals.push_back(size_++);
+      unhashed_keys_.push(keys[i]);
+      ordinals[i] = shard.ordinals.back();
+    } else if (outcomes[i] == kPresent) {
+      ordinals[i] = shard.ordinals[ordinals[i]];
+    }
+  }
+  return status;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::StatusOr<I> ShardedFileIndex<K, I, F, page_size, num_shards>::Get(
+    const K& key) const {
+  auto& shard = shards_[GetShard(key)];
+  ASSIGN_OR_RETURN(auto local, shard.index.Get(key));
+  return shard.ordinals[local];
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::Status ShardedFileIndex<K, I, F, page_size, num_shards>::Get(
+    std::span<const K> keys, std::span<I> ordinals) const {
+  if (keys.size() != ordinals.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Got ", keys.size(), " keys but space for ",
+                     ordinals.size(), " ordinals"));
+  }
+  std::array<std::vector<std::size_t>, num_shards> positions;
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    positions[GetShard(keys[i])].push_back(i);
+  }
+  // Since lookups do not modify the ordinal mapping, shard-local ordinals can
+  // be mapped right away.
+  std::vector<Task> tasks;
+  for (std::size_t s = 0; s < num_shards; s++) {
+    if (positions[s].empty()) {
+      continue;
+    }
+    tasks.push_back([&, s]() -> absl::Status {
+      const auto& shard = shards_[s];
+      for (std::size_t i : positions[s]) {
+        ASSIGN_OR_RETURN(auto local, shard.index.Get(keys[i]));
+        ordinals[i] = shard.ordinals[local];
+      }
+      return absl::OkStatus();
+    });
+  }
+  return Run(keys.size(), std::move(tasks));
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::StatusOr<Hash>
+ShardedFileIndex<K, I, F, page_size, num_shards>::GetHash() const {
+  while (!unhashed_keys_.empty()) {
+    hash_ = carmen::GetHash(hasher_, hash_, unhashed_keys_.front());
+    unhashed_keys_.pop();
+  }
+  return hash_;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>>
+ShardedFileIndex<K, I, F, page_size, num_shards>::CreateSnapshot() const {
+  std::vector<K> keys(size_);
+  for (const auto& shard : shards_) {
+    ASSIGN_OR_RETURN(auto snapshot, shard.index.CreateSnapshot());
+    auto shard_keys = snapshot->GetKeys(0, snapshot->GetSize());
+    for (std::size_t i = 0; i < shard_keys.size(); i++) {
+      keys[shard.ordinals[i]] = shard_keys[i];
+    }
+  }
+  return std::make_unique<MaterializedIndexSnapshot<K>>(std::move(keys));
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::Status ShardedFileIndex<K, I, F, page_size, num_shards>::Run(
+    std::size_t batch_size, std::vector<Task> tasks) {
+  if (batch_size >= kMinParallelBatchSize) {
+    return RunInParallel(std::move(tasks));
+  }
+  for (auto& task : tasks) {
+    RETURN_IF_ERROR(task());
+  }
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::Status ShardedFileIndex<K, I, F, page_size, num_shards>::WriteOrdinals(
+    ShardInfo& shard) {
+  if (shard.num_persisted == shard.ordinals.size()) {
+    return absl::OkStatus();
+  }
+  ASSIGN_OR_RETURN(auto out,
+                   FStream::Open(shard.ordinal_file, std::ios::binary |
+                                                         std::ios::out |
+                                                         std::ios::app));
+  RETURN_IF_ERROR(out.Write(
+      std::span<const I>(shard.ordinals).subspan(shard.num_persisted)));
+  RETURN_IF_ERROR(out.Close());
+  shard.num_persisted = shard.ordinals.size();
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::Status
+ShardedFileIndex<K, I, F, page_size, num_shards>::WriteMetadata() {
+  ASSIGN_OR_RETURN(auto out, FStream::Open(*metadata_file_, std::ios::binary |
+                                                                std::ios::out));
+  RETURN_IF_ERROR(out.Write(key_hasher_.GetVersion()));
+  RETURN_IF_ERROR(out.Write(size_));
+  ASSIGN_OR_RETURN(auto hash, GetHash());
+  RETURN_IF_ERROR(out.Write(hash));
+  return out.Close();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::Status ShardedFileIndex<K, I, F, page_size, num_shards>::Flush() {
+  // Only owning instances, which have not been closed, need to be flushed.
+  if (!metadata_file_) return absl::OkStatus();
+  std::vector<Task> tasks;
+  for (auto& shard : shards_) {
+    tasks.push_back([&shard]() -> absl::Status {
+      RETURN_IF_ERROR(shard.index.Flush());
+      return WriteOrdinals(shard);
+    });
+  }
+  RETURN_IF_ERROR(RunInParallel(std::move(tasks)));
+  return WriteMetadata();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+absl::Status ShardedFileIndex<K, I, F, page_size, num_shards>::Close() {
+  if (!metadata_file_) return absl::OkStatus();
+  std::vector<Task> tasks;
+  for (auto& shard : shards_) {
+    tasks.push_back([&shard]() -> absl::Status {
+      RETURN_IF_ERROR(shard.index.Close());
+      return WriteOrdinals(shard);
+    });
+  }
+  RETURN_IF_ERROR(RunInParallel(std::move(tasks)));
+  RETURN_IF_ERROR(WriteMetadata());
+  metadata_file_.reset();
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size, std::size_t num_shards>
+MemoryFootprint
+ShardedFileIndex<K, I, F, page_size, num_shards>::GetMemoryFootprint() const {
+  MemoryFootprint res(*this);
+  for (std::size_t i = 0; i < shards_.size(); i++) {
+    MemoryFootprint shard(shards_[i]);
+    shard.Add("index", shards_[i].index.GetMemoryFootprint());
+    shard.Add("ordinals", SizeOf(shards_[i].ordinals));
+    res.Add(absl::StrCat("shard_", i), std::move(shard));
+  }
+  return res;
+}
+
+}  // namespace carmen::backend::index
@@ -0,0 +1,205 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/index/file/sharded_index.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+#include "backend/common/file.h"
+#include "backend/index/file/index.h"
+#include "backend/index/index_test_suite.h"
+#include "backend/structure.h"
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "common/type.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend::index {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::Gt;
+using ::testing::HasSubstr;
+using ::testing::IsOkAndHolds;
+using ::testing::Pair;
+using ::testing::StatusIs;
+
+using TestIndex = ShardedFileIndex<int, int, InMemoryFile, 128, 4>;
+using ReferenceIndex = FileIndex<int, int, InMemoryFile, 128>;
+
+// Instantiates common index tests for the ShardedFileIndex index type.
+INSTANTIATE_TYPED_TEST_SUITE_P(Sharded, IndexTest, TestIndex);
+
+// Keys can not be removed from sharded indexes.
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(RemovableIndexTest);
+
+TEST(ShardedFileIndexTest, KeysAreDistributedAcrossShards) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_OK(index.GetOrAdd(i));
+  }
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < 4; i++) {
+    EXPECT_THAT(index.GetShardSize(i), Gt(150));
+    total += index.GetShardSize(i);
+  }
+  EXPECT_EQ(total, 1000);
+}
+
+TEST(ShardedFileIndexTest, OrdinalsAndHashesMatchFileIndex) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath() / "a"));
+  ASSERT_OK_AND_ASSIGN(auto reference,
+                       ReferenceIndex::Open(ctx, dir.GetPath() / "b"));
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dist(0, 5000);
+  for (int i = 0; i < 10000; i++) {
+    auto key = dist(gen);
+    ASSERT_OK_AND_ASSIGN(auto expected, reference.GetOrAdd(key));
+    EXPECT_THAT(index.GetOrAdd(key), IsOkAndHolds(expected));
+  }
+  ASSERT_OK_AND_ASSIGN(auto hash, reference.GetHash());
+  EXPECT_THAT(index.GetHash(), IsOkAndHolds(hash));
+}
+
+TEST(ShardedFileIndexTest, BatchedInsertsAssignOrdinalsInBatchOrder) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath() / "a"));
+  ASSERT_OK_AND_ASSIGN(auto reference,
+                       ReferenceIndex::Open(ctx, dir.GetPath() / "b"));
+
+  // Batches of varying sizes, covering sequential and parallel processing,
+  // with keys repeated within and across batches.
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dist(0, 20000);
+  for (std::size_t size : {1, 10, 100, 1000, 5000, 10000}) {
+    std::vector<int> keys(size);
+    for (auto& key : keys) {
+      key = dist(gen);
+    }
+    std::vector<int> ordinals(size);
+    ASSERT_OK(index.GetOrAdd(keys, ordinals));
+    for (std::size_t i = 0; i < size; i++) {
+      ASSERT_OK_AND_ASSIGN(auto expected, reference.GetOrAdd(keys[i]));
+      EXPECT_EQ(ordinals[i], expected.first);
+    }
+  }
+  ASSERT_OK_AND_ASSIGN(auto hash, reference.GetHash());
+  EXPECT_THAT(index.GetHash(), IsOkAndHolds(hash));
+}
+
+TEST(ShardedFileIndexTest, BatchedLookupsFindPresentKeys) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  std::vector<int> keys;
+  for (int i = 0; i < 1000; i++) {
+    keys.push_back(i * 7);
+    ASSERT_OK(index.GetOrAdd(keys.back()));
+  }
+  std::vector<int> ordinals(keys.size());
+  ASSERT_OK(index.Get(keys, ordinals));
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ(ordinals[i], i);
+  }
+
+  std::vector<int> missing{7, 8, 14};
+  std::vector<int> result(missing.size());
+  EXPECT_THAT(index.Get(missing, result),
+              StatusIs(absl::StatusCode::kNotFound, _));
+}
+
+TEST(ShardedFileIndexTest, BatchesNeedMatchingSizes) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  std::vector<int> keys{1, 2, 3};
+  std::vector<int> ordinals(2);
+  EXPECT_THAT(index.GetOrAdd(keys, ordinals),
+              StatusIs(absl::StatusCode::kInvalidArgument, _));
+  EXPECT_THAT(index.Get(keys, ordinals),
+              StatusIs(absl::StatusCode::kInvalidArgument, _));
+}
+
+TEST(ShardedFileIndexTest, SnapshotListsKeysInOrdinalOrder) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  std::vector<int> keys;
+  for (int i = 0; i < 2000; i++) {
+    keys.push_back(i * 31 + 7);
+  }
+  std::vector<int> ordinals(keys.size());
+  ASSERT_OK(index.GetOrAdd(keys, ordinals));
+  ASSERT_OK_AND_ASSIGN(auto snapshot, index.CreateSnapshot());
+  EXPECT_EQ(snapshot->GetSize(), keys.size());
+  EXPECT_THAT(snapshot->GetKeys(0, keys.size()), ElementsAreArray(keys));
+}
+
+TEST(ShardedFileIndexTest, IndexCanBeSavedAndRestored) {
+  using Index = ShardedFileIndex<int, int, SingleFile>;
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < 5000; i++) {
+      EXPECT_THAT(index.GetOrAdd(i + 5), IsOkAndHolds(Pair(i, true)));
+    }
+    // Ordinals are persisted incrementally by subsequent flushes.
+    ASSERT_OK(index.Flush());
+    for (int i = 5000; i < 8000; i++) {
+      EXPECT_THAT(index.GetOrAdd(i + 5), IsOkAndHolds(Pair(i, true)));
+    }
+    ASSERT_OK_AND_ASSIGN(hash, index.GetHash());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto restored, Index::Open(ctx, dir.GetPath()));
+    EXPECT_THAT(restored.GetHash(), IsOkAndHolds(hash));
+    for (int i = 0; i < 8000; i++) {
+      EXPECT_THAT(restored.Get(i + 5), IsOkAndHolds(i));
+    }
+    EXPECT_THAT(restored.GetOrAdd(0), IsOkAndHolds(Pair(8000, true)));
+    std::vector<int> keys{1, 5, 2};
+    std::vector<int> ordinals(keys.size());
+    ASSERT_OK(restored.GetOrAdd(keys, ordinals));
+    EXPECT_THAT(ordinals, ElementsAre(8001, 0, 8002));
+  }
+}
+
+TEST(ShardedFileIndexTest, ShardsWithMissingOrdinalsAreDetected) {
+  using Index = ShardedFileIndex<int, int, SingleFile>;
+  TempDir dir;
+  Context ctx;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_OK(index.GetOrAdd(i));
+    }
+  }
+  auto ordinal_file = dir.GetPath() / "shard_0" / "ordinals.dat";
+  std::filesystem::resize_file(
+      ordinal_file, std::filesystem::file_size(ordinal_file) - sizeof(int));
+  EXPECT_THAT(Index::Open(ctx, dir.GetPath()),
+              StatusIs(absl::StatusCode::kInternal, HasSubstr("shard_0")));
+}
+
+}  // namespace
+}  // namespace carmen::backend::index
@@ -11,14 +11,42 @@
 #pragma once
 
 #include <array>
+#include <bit>
 #include <concepts>
 #include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <type_traits>
 #include <utility>
 
 #include "absl/numeric/int128.h"
 
 namespace carmen::backend::index {
 
+// The versions of the stable hash function. Since stable hashes may be
+// persisted, each version must remain unchanged once introduced. New versions
+// may be added to improve performance.
+enum class StableHashVersion : std::uint32_t {
+  // Mixes arrays element by element.
+  kV1 = 1,
+  // Mixes arrays of bytes in words of 8 bytes.
+  kV2 = 2,
+};
+
+// The version of the stable hash function to be used for new data.
+constexpr static const StableHashVersion kLatestStableHashVersion =
+    StableHashVersion::kV2;
+
+// Returns true if the given version is a known version of the stable hash.
+constexpr bool IsValid(StableHashVersion version) {
+  return version == StableHashVersion::kV1 ||
+         version == StableHashVersion::kV2;
+}
+
+inline std::ostream& operator<<(std::ostream& out, StableHashVersion version) {
+  return out << "v" << static_cast<std::uint32_t>(version);
+}
+
 namespace internal {
 
 // Implements a stable hash that will not change over time. This can be used
@@ -26,6 +54,7 @@ namespace internal {
 // persistent storage.
 //
 // The implementation is derived from the absl::Hash infrastructure.
+template <StableHashVersion version>
 class StableHashState {
  public:
   // --------------------------------------------------------------------------
@@ -47,6 +76,9 @@ class StableHashState {
   // Support hashing for arrays of types.
   template <typename T, std::size_t N>
   static std::size_t hash(const std::array<T, N>& value) {
+    if constexpr (version != StableHashVersion::kV1 && IsByte<T>) {
+      return HashBytes(value);
+    }
     std::uint64_t res = 0;
     for (const T& cur : value) {
       res = Mix(res, hash(cur));
@@ -57,7 +89,7 @@ class StableHashState {
   // The fall-back support for types implementing the Absl hashing interface.
   template <typename T>
   requires(!std::is_integral_v<T>) static std::size_t hash(const T& value) {
-    return AbslHashValue(internal::StableHashState(), value).state_;
+    return AbslHashValue(StableHashState(), value).state_;
   }
 
   // --------------------------------------------------------------------------
@@ -79,6 +111,11 @@ class StableHashState {
   }
 
  private:
+  // Types that are hashed as raw bytes by word-wise versions of the hash.
+  template <typename T>
+  constexpr static bool IsByte =
+      sizeof(T) == 1 && (std::is_integral_v<T> || std::is_same_v<T, std::byte>);
+
   // A magic constant taken from asl::Hash used to produce value spread when
   // hashing integers.
   static constexpr std::uint64_t kMul = sizeof(std::size_t) == 4
@@ -100,6 +137,28 @@ class StableHashState {
     return static_cast<uint64_t>(m ^ (m >> (sizeof(m) * 8 / 2)));
   }
 
+  // Hashes an array of bytes by mixing in one little-endian 8-byte word at a
+  // time. A trailing partial word is padded with zeros. Since the length of
+  // the array is fixed by its type, it does not need to be mixed in.
+  template <typename T, std::size_t N>
+  static std::uint64_t HashBytes(const std::array<T, N>& value) {
+    static_assert(std::endian::native == std::endian::little,
+                  "Big endian architectures not yet supported.");
+    const auto* data = reinterpret_cast<const char*>(value.data());
+    std::uint64_t res = 0;
+    for (std::size_t i = 0; i + 8 <= N; i += 8) {
+      std::uint64_t word;
+      std::memcpy(&word, data + i, 8);
+      res = Mix(res, word);
+    }
+    if constexpr (N % 8 != 0) {
+      std::uint64_t word = 0;
+      std::memcpy(&word, data + N - N % 8, N % 8);
+      res = Mix(res, word);
+    }
+    return res;
+  }
+
   // The hash tracked by this class while being used through the Absl hash
   // infrastructure.
   std::uint64_t state_ = 0;
@@ -110,11 +169,35 @@ class StableHashState {
 // A utility class implementing the hashing of type T. The provided hash is
 // stable, thus it will not change over time and can be used for hash based
 // persistent storage.
-template <typename T>
+template <typename T, StableHashVersion version = StableHashVersion::kV1>
 struct StableHash {
   std::size_t operator()(const T& value) const {
-    return internal::StableHashState::hash(value);
+    return internal::StableHashState<version>::hash(value);
   }
 };
 
+// A stable hash for type T where the version of the hash function is selected
+// at runtime. This is intended for persistent data structures recording the
+// version of the hash used for their content.
+template <typename T>
+class VersionedStableHash {
+ public:
+  explicit VersionedStableHash(
+      StableHashVersion version = kLatestStableHashVersion)
+      : version_(version) {}
+
+  // Returns the version of the hash function used by this instance.
+  StableHashVersion GetVersion() const { return version_; }
+
+  std::size_t operator()(const T& value) const {
+    if (version_ == StableHashVersion::kV1) {
+      return StableHash<T, StableHashVersion::kV1>()(value);
+    }
+    return StableHash<T, StableHashVersion::kV2>()(value);
+  }
+
+ private:
+  StableHashVersion version_;
+};
+
 }  // namespace carmen::backend::index
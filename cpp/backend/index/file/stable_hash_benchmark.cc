@@ -19,6 +19,14 @@ namespace {
 // To run benchmarks, use the following command:
 //    bazel run -c opt //backend/index/file:stable_hash_benchmark
 
+// The first version of the stable hash, mixing arrays element by element.
+template <typename T>
+using StableHashV1 = StableHash<T, StableHashVersion::kV1>;
+
+// The second version of the stable hash, mixing arrays of bytes word by word.
+template <typename T>
+using StableHashV2 = StableHash<T, StableHashVersion::kV2>;
+
 // Evaluates the performance of hashing integers.
 template <template <typename T> class Hasher>
 void BM_IntegerHash(benchmark::State& state) {
@@ -30,22 +38,41 @@ void BM_IntegerHash(benchmark::State& state) {
   }
 }
 
-BENCHMARK(BM_IntegerHash<StableHash>);
+BENCHMARK(BM_IntegerHash<StableHashV1>);
+BENCHMARK(BM_IntegerHash<StableHashV2>);
 BENCHMARK(BM_IntegerHash<absl::Hash>);
 
 // Evaluates the performance of hashing Addresses.
 template <template <typename T> class Hasher>
 void BM_AddressHash(benchmark::State& state) {
   Hasher<Address> hasher;
-  Address addr;
+  Address addr{};
   for (auto _ : state) {
+    addr[0]++;
     auto hash = hasher(addr);
     benchmark::DoNotOptimize(hash);
   }
 }
 
-BENCHMARK(BM_AddressHash<StableHash>);
+BENCHMARK(BM_AddressHash<StableHashV1>);
+BENCHMARK(BM_AddressHash<StableHashV2>);
 BENCHMARK(BM_AddressHash<absl::Hash>);
 
+// Evaluates the performance of hashing Keys.
+template <template <typename T> class Hasher>
+void BM_KeyHash(benchmark::State& state) {
+  Hasher<Key> hasher;
+  Key key{};
+  for (auto _ : state) {
+    key[0]++;
+    auto hash = hasher(key);
+    benchmark::DoNotOptimize(hash);
+  }
+}
+
+BENCHMARK(BM_KeyHash<StableHashV1>);
+BENCHMARK(BM_KeyHash<StableHashV2>);
+BENCHMARK(BM_KeyHash<absl::Hash>);
+
 }  // namespace
 }  // namespace carmen::backend::index
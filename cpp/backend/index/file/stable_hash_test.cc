@@ -12,6 +12,7 @@
 
 #include "absl/container/flat_hash_set.h"
 #include "backend/common/page.h"
+#include "common/type.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -66,5 +67,74 @@ TEST(StableHash, HashHasLimitedCollisionsForArraysOfIntegers) {
   EXPECT_EQ(collisions, 0);  // < no collisions
 }
 
+TEST(StableHash, HashHasLimitedCollisionsForAddresses) {
+  constexpr int N = 1000;
+  StableHash<Address, StableHashVersion::kV2> hash;
+  int collisions = 0;
+  absl::flat_hash_set<std::size_t> seen;
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      Address address{};
+      address[0] = i;
+      address[7] = i >> 8;
+      address[8] = j;
+      address[19] = j >> 8;
+      if (!seen.insert(hash(address)).second) {
+        collisions++;
+      }
+    }
+  }
+  EXPECT_EQ(collisions, 0);  // < no collisions
+}
+
+TEST(StableHash, AllBytesOfKeysAreConsidered) {
+  StableHash<Key, StableHashVersion::kV2> hash;
+  absl::flat_hash_set<std::size_t> seen;
+  Key key{};
+  seen.insert(hash(key));
+  for (std::size_t i = 0; i < sizeof(Key); i++) {
+    Key modified = key;
+    modified[i] = 1;
+    EXPECT_TRUE(seen.insert(hash(modified)).second) << "Byte " << i;
+  }
+}
+
+TEST(StableHash, HashesOfVersionsAreStable) {
+  // Hashes may be persisted, thus existing versions must never change.
+  constexpr std::size_t kAddressHashV1 = 0xf6f5de48a05cc995;
+  constexpr std::size_t kAddressHashV2 = 0xbe97ee13fdccfc1d;
+  Address address{};
+  for (std::size_t i = 0; i < sizeof(Address); i++) {
+    address[i] = i + 1;
+  }
+  EXPECT_EQ((StableHash<Address, StableHashVersion::kV1>()(address)),
+            kAddressHashV1);
+  EXPECT_EQ((StableHash<Address, StableHashVersion::kV2>()(address)),
+            kAddressHashV2);
+}
+
+TEST(StableHash, VersionedHashUsesSelectedVersion) {
+  Address address{};
+  address[3] = 12;
+  for (auto version : {StableHashVersion::kV1, StableHashVersion::kV2}) {
+    VersionedStableHash<Address> hash(version);
+    EXPECT_EQ(hash.GetVersion(), version);
+  }
+  EXPECT_EQ(VersionedStableHash<Address>().GetVersion(),
+            kLatestStableHashVersion);
+  EXPECT_EQ(VersionedStableHash<Address>(StableHashVersion::kV1)(address),
+            (StableHash<Address, StableHashVersion::kV1>()(address)));
+  EXPECT_EQ(VersionedStableHash<Address>(StableHashVersion::kV2)(address),
+            (StableHash<Address, StableHashVersion::kV2>()(address)));
+  EXPECT_NE(VersionedStableHash<Address>(StableHashVersion::kV1)(address),
+            VersionedStableHash<Address>(StableHashVersion::kV2)(address));
+}
+
+TEST(StableHash, NonByteArraysAreHashedEqualInAllVersions) {
+  std::array<int, 3> value{1, 2, 3};
+  EXPECT_EQ((StableHash<std::array<int, 3>, StableHashVersion::kV1>()(value)),
+            (StableHash<std::array<int, 3>, StableHashVersion::kV2>()(value)));
+}
+
 }  // namespace
 }  // namespace carmen::backend::index
@@ -10,10 +10,15 @@
 
 #pragma once
 
+#include <algorithm>
 #include <concepts>
+#include <cstddef>
 #include <optional>
+#include <span>
 #include <utility>
+#include <vector>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "backend/structure.h"
 
@@ -43,6 +48,27 @@ class IndexSnapshot {
                                      std::size_t to) const = 0;
 };
 
+// A snapshot owning a copy of all keys of an index, ordered by their ordinal
+// values. It is intended for index implementations that do not maintain their
+// keys in ordinal order and thus need to collect them when creating snapshots.
+template <typename K>
+class MaterializedIndexSnapshot final : public IndexSnapshot<K> {
+ public:
+  explicit MaterializedIndexSnapshot(std::vector<K> keys)
+      : keys_(std::move(keys)) {}
+
+  std::size_t GetSize() const override { return keys_.size(); }
+
+  std::span<const K> GetKeys(std::size_t from, std::size_t to) const override {
+    to = std::min(to, keys_.size());
+    from = std::min(from, to);
+    return std::span<const K>(keys_).subspan(from, to - from);
+  }
+
+ private:
+  std::vector<K> keys_;
+};
+
 // Defines the interface expected for an Index I, mapping keys of type K to
 // integral values of type V.
 template <typename I>
@@ -65,4 +91,18 @@ concept Index = requires(I a, const I b) {
 // Indexes must satisfy the requirements for backend data structures.
 &&HashableStructure<I>;
 
+// An index supporting the removal of keys. The ordinals of removed keys are
+// recycled: keys added after a removal are assigned the most recently released
+// ordinal first, before new ordinals are introduced. The hash of such an index
+// still covers the keys in the order they have been assigned to ordinals, and
+// does not reflect removals. Thus, users removing keys need to cover the
+// effect of removals in some other hashed structure. Removing a key not present
+// in the index has no effect.
+template <typename I>
+concept RemovableIndex = Index<I> && requires(I a) {
+  {
+    a.Remove(std::declval<typename I::key_type>())
+    } -> std::same_as<absl::Status>;
+};
+
 }  // namespace carmen::backend::index
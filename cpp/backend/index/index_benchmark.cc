@@ -9,13 +9,19 @@
 // this software will be governed by the GNU Lesser General Public License v3.
 
 #include <random>
+#include <span>
+#include <vector>
 
 #include "backend/common/file.h"
+#include "backend/index/btree/index.h"
 #include "backend/index/cache/cache.h"
+#include "backend/index/file/extendible_index.h"
 #include "backend/index/file/index.h"
+#include "backend/index/file/sharded_index.h"
 #include "backend/index/index_handler.h"
 #include "backend/index/memory/index.h"
 #include "backend/index/memory/linear_hash_index.h"
+#include "backend/index/tiered/index.h"
 #include "benchmark/benchmark.h"
 #include "common/benchmark.h"
 #include "common/status_test_util.h"
@@ -32,6 +38,17 @@ using FileIndexInMemory =
     FileIndex<Key, std::uint32_t, InMemoryFile, kPageSize>;
 using FileIndexOnDisk = FileIndex<Key, std::uint32_t, SingleFile, kPageSize>;
 using CachedFileIndexOnDisk = Cached<FileIndexOnDisk>;
+using ExtendibleFileIndexOnDisk =
+    ExtendibleFileIndex<Key, std::uint32_t, SingleFile, kPageSize>;
+using CachedExtendibleFileIndexOnDisk = Cached<ExtendibleFileIndexOnDisk>;
+using ShardedFileIndexOnDisk =
+    ShardedFileIndex<Key, std::uint32_t, SingleFile, kPageSize>;
+using CachedShardedFileIndexOnDisk = Cached<ShardedFileIndexOnDisk>;
+using BTreeIndexOnDisk = BTreeIndex<Key, std::uint32_t, SingleFile>;
+using CachedBTreeIndexOnDisk = Cached<BTreeIndexOnDisk>;
+using TieredIndexOnDisk =
+    TieredIndex<Key, std::uint32_t, SingleFile, kPageSize>;
+using CachedTieredIndexOnDisk = Cached<TieredIndexOnDisk>;
 using SingleLevelDbIndex = LevelDbKeySpace<Key, std::uint32_t>;
 using CachedSingleLevelDbIndex = Cached<SingleLevelDbIndex>;
 using MultiLevelDbIndex = MultiLevelDbIndex<Key, std::uint32_t>;
@@ -43,7 +60,11 @@ using CachedMultiLevelDbIndex = Cached<MultiLevelDbIndex>;
 // Defines the list of configurations to be benchmarked.
 BENCHMARK_TYPE_LIST(IndexConfigList, InMemoryIndex, CachedInMemoryIndex,
                     InMemoryLinearHashIndex, FileIndexInMemory, FileIndexOnDisk,
-                    CachedFileIndexOnDisk, SingleLevelDbIndex,
+                    CachedFileIndexOnDisk, ExtendibleFileIndexOnDisk,
+                    CachedExtendibleFileIndexOnDisk, ShardedFileIndexOnDisk,
+                    CachedShardedFileIndexOnDisk, BTreeIndexOnDisk,
+                    CachedBTreeIndexOnDisk, TieredIndexOnDisk,
+                    CachedTieredIndexOnDisk, SingleLevelDbIndex,
                     CachedSingleLevelDbIndex, MultiLevelDbIndex,
                     CachedMultiLevelDbIndex);
 
@@ -79,6 +100,46 @@ void BM_Insert(benchmark::State& state) {
 
 BENCHMARK_ALL(BM_Insert, IndexConfigList)->ArgList(kSizes);
 
+// Benchmarks the insertion of blocks of keys into indexes. Indexes supporting
+// batched insertions process each block in one call, others key by key.
+template <typename Index>
+void BM_BlockInsert(benchmark::State& state) {
+  constexpr std::int64_t kBlockSize = 1000;
+  auto pre_loaded_num_elements = state.range(0);
+  ASSERT_OK_AND_ASSIGN(auto handler, IndexHandler<Index>::Create());
+  auto& index = handler.GetIndex();
+
+  // Fill in initial elements.
+  for (std::int64_t i = 0; i < pre_loaded_num_elements; i++) {
+    ASSERT_OK(index.GetOrAdd(ToKey(i)));
+  }
+
+  std::vector<Key> keys(kBlockSize);
+  std::vector<std::uint32_t> ids(kBlockSize);
+  auto i = pre_loaded_num_elements;
+  for (auto _ : state) {
+    for (auto& key : keys) {
+      key = ToKey(i++);
+    }
+    if constexpr (requires { index.GetOrAdd(keys, std::span(ids)); }) {
+      ASSERT_OK(index.GetOrAdd(keys, std::span(ids)));
+    } else {
+      for (std::int64_t j = 0; j < kBlockSize; j++) {
+        ASSERT_OK_AND_ASSIGN(auto res, index.GetOrAdd(keys[j]));
+        ids[j] = res.first;
+      }
+    }
+    benchmark::DoNotOptimize(ids);
+  }
+  state.SetItemsProcessed(state.iterations() * kBlockSize);
+}
+
+// Compares the sharded index processing blocks in parallel with its shards.
+BENCHMARK_TYPE_LIST(BlockInsertConfigList, FileIndexOnDisk,
+                    ShardedFileIndexOnDisk);
+
+BENCHMARK_ALL(BM_BlockInsert, BlockInsertConfigList)->ArgList(kSizes);
+
 template <typename Index>
 void BM_SequentialRead(benchmark::State& state) {
   auto pre_loaded_num_elements = state.range(0);
@@ -11,15 +11,19 @@
 #include "backend/index/memory/index.h"
 
 #include "backend/common/file.h"
+#include "backend/index/index.h"
 #include "common/status_test_util.h"
 #include "common/test_util.h"
 #include "common/type.h"
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace carmen::backend::index {
 namespace {
 
 using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
 using ::testing::StatusIs;
 using ::testing::StrEq;
 
@@ -71,5 +75,14 @@ TEST(IndexTest, KnownKeyIndexHashes) {
                     "d61bc957"));
 }
 
+TEST(MaterializedIndexSnapshotTest, KeysCanBeRetrievedInRanges) {
+  MaterializedIndexSnapshot<int> snapshot({1, 2, 3, 4});
+  EXPECT_EQ(snapshot.GetSize(), 4);
+  EXPECT_THAT(snapshot.GetKeys(0, 4), ElementsAre(1, 2, 3, 4));
+  EXPECT_THAT(snapshot.GetKeys(1, 3), ElementsAre(2, 3));
+  EXPECT_THAT(snapshot.GetKeys(3, 10), ElementsAre(4));
+  EXPECT_THAT(snapshot.GetKeys(5, 10), IsEmpty());
+}
+
 }  // namespace
 }  // namespace carmen::backend::index
@@ -147,4 +147,80 @@ REGISTER_TYPED_TEST_SUITE_P(
     GetRetrievesPresentKeys, EmptyIndexHasHashEqualsZero,
     IndexHashIsEqualToInsertionOrder, CanProduceMemoryFootprint,
     HashesMatchReferenceImplementation);
+
+// Implements a generic test suite for indexes supporting the removal of keys,
+// in addition to the properties covered by the IndexTest suite above.
+template <RemovableIndex I>
+class RemovableIndexTest : public testing::Test {};
+
+TYPED_TEST_SUITE_P(RemovableIndexTest);
+
+TYPED_TEST_P(RemovableIndexTest, RemovedKeysAreNoLongerPresent) {
+  ASSERT_OK_AND_ASSIGN(auto wrapper, IndexHandler<TypeParam>::Create());
+  auto& index = wrapper.GetIndex();
+  ASSERT_OK(index.GetOrAdd(1));
+  ASSERT_OK(index.GetOrAdd(2));
+  ASSERT_OK(index.Remove(1));
+  EXPECT_THAT(index.Get(1), StatusIs(absl::StatusCode::kNotFound, _));
+  EXPECT_THAT(index.Get(2), IsOkAndHolds(1));
+}
+
+TYPED_TEST_P(RemovableIndexTest, RemovingUnknownKeysHasNoEffect) {
+  ASSERT_OK_AND_ASSIGN(auto wrapper, IndexHandler<TypeParam>::Create());
+  auto& index = wrapper.GetIndex();
+  ASSERT_OK(index.GetOrAdd(1));
+  ASSERT_OK(index.Remove(2));
+  ASSERT_OK(index.Remove(2));
+  EXPECT_THAT(index.Get(1), IsOkAndHolds(0));
+  EXPECT_THAT(index.GetOrAdd(3), IsOkAndHolds(std::pair(1, true)));
+}
+
+TYPED_TEST_P(RemovableIndexTest, OrdinalsOfRemovedKeysAreReusedLastInFirst) {
+  ASSERT_OK_AND_ASSIGN(auto wrapper, IndexHandler<TypeParam>::Create());
+  auto& index = wrapper.GetIndex();
+  for (int i = 0; i < 5; i++) {
+    ASSERT_OK(index.GetOrAdd(i + 10));
+  }
+  ASSERT_OK(index.Remove(11));
+  ASSERT_OK(index.Remove(13));
+  EXPECT_THAT(index.GetOrAdd(20), IsOkAndHolds(std::pair(3, true)));
+  EXPECT_THAT(index.GetOrAdd(21), IsOkAndHolds(std::pair(1, true)));
+  EXPECT_THAT(index.GetOrAdd(22), IsOkAndHolds(std::pair(5, true)));
+  EXPECT_THAT(index.Get(20), IsOkAndHolds(3));
+  EXPECT_THAT(index.Get(21), IsOkAndHolds(1));
+}
+
+TYPED_TEST_P(RemovableIndexTest, RemovedKeysCanBeAddedAgain) {
+  ASSERT_OK_AND_ASSIGN(auto wrapper, IndexHandler<TypeParam>::Create());
+  auto& index = wrapper.GetIndex();
+  ASSERT_OK(index.GetOrAdd(1));
+  ASSERT_OK(index.GetOrAdd(2));
+  ASSERT_OK(index.Remove(1));
+  ASSERT_OK(index.Remove(2));
+  EXPECT_THAT(index.GetOrAdd(1), IsOkAndHolds(std::pair(1, true)));
+  EXPECT_THAT(index.GetOrAdd(1), IsOkAndHolds(std::pair(1, false)));
+  EXPECT_THAT(index.Get(2), StatusIs(absl::StatusCode::kNotFound, _));
+}
+
+TYPED_TEST_P(RemovableIndexTest, HashCoversKeysInOrderOfAssignment) {
+  Hash hash{};
+  ASSERT_OK_AND_ASSIGN(auto wrapper, IndexHandler<TypeParam>::Create());
+  auto& index = wrapper.GetIndex();
+  ASSERT_OK(index.GetOrAdd(12));
+  ASSERT_OK(index.GetOrAdd(14));
+  hash = GetSha256Hash(GetSha256Hash(hash, 12), 14);
+  ASSERT_OK(index.Remove(12));
+  EXPECT_THAT(index.GetHash(), IsOkAndHolds(hash));
+  ASSERT_OK(index.GetOrAdd(16));
+  ASSERT_OK(index.GetOrAdd(18));
+  hash = GetSha256Hash(GetSha256Hash(hash, 16), 18);
+  EXPECT_THAT(index.GetHash(), IsOkAndHolds(hash));
+}
+
+REGISTER_TYPED_TEST_SUITE_P(RemovableIndexTest, RemovedKeysAreNoLongerPresent,
+                            RemovingUnknownKeysHasNoEffect,
+                            OrdinalsOfRemovedKeysAreReusedLastInFirst,
+                            RemovedKeysCanBeAddedAgain,
+                            HashCoversKeysInOrderOfAssignment);
+
 }  // namespace carmen::backend::index
@@ -10,16 +10,23 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <queue>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "backend/common/leveldb/leveldb.h"
+#include "backend/index/index.h"
 #include "common/hash.h"
 #include "common/memory_usage.h"
 #include "common/status_util.h"
@@ -88,6 +95,50 @@ class LevelDbIndexBase {
     return GetLastHash();
   }
 
+  // Creates a snapshot of the keys of this index in the order of their
+  // ordinals. All keys of the index are read from the database and collected
+  // in memory.
+  absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>> CreateSnapshot() const {
+    std::vector<K> keys;
+    auto last_index = GetLastIndexFromDB();
+    if (absl::IsNotFound(last_index.status())) {
+      return std::make_unique<MaterializedIndexSnapshot<K>>(std::move(keys));
+    }
+    RETURN_IF_ERROR(last_index);
+    keys.resize(static_cast<std::size_t>(*last_index) + 1);
+
+    // All keys of this index share the same prefix, as do the entries for the
+    // hash and the last index, which need to be skipped.
+    const auto prefix = ToDBKey(K{});
+    const auto key_prefix = std::span<const char>(prefix).first(KPL);
+    const auto hash_key = GetHashKey();
+    const auto last_index_key = GetLastIndexKey();
+    std::size_t num_keys = 0;
+    ASSIGN_OR_RETURN(auto iter, GetDb().GetLowerBound(key_prefix));
+    while (!iter.IsEnd()) {
+      auto db_key = iter.Key();
+      if (!std::ranges::equal(db_key.first(std::min(KPL, db_key.size())),
+                              key_prefix)) {
+        break;
+      }
+      auto as_string = std::string_view(db_key.data(), db_key.size());
+      if (db_key.size() == prefix.size() && as_string != hash_key &&
+          as_string != last_index_key) {
+        ASSIGN_OR_RETURN(auto ordinal, ParseDBResult<I>(iter.Value()));
+        if (static_cast<std::size_t>(ordinal) >= keys.size()) {
+          return absl::InternalError("Invalid ordinal in index.");
+        }
+        std::memcpy(&keys[ordinal], db_key.data() + KPL, sizeof(K));
+        num_keys++;
+      }
+      RETURN_IF_ERROR(iter.Next());
+    }
+    if (num_keys != keys.size()) {
+      return absl::InternalError("Missing keys in index.");
+    }
+    return std::make_unique<MaterializedIndexSnapshot<K>>(std::move(keys));
+  }
+
   // Flush unsaved index keys to disk.
   absl::Status Flush() { return GetDb().Flush(); }
 
@@ -10,6 +10,8 @@
 
 #include "backend/index/leveldb/multi_db/index.h"
 
+#include <vector>
+
 #include "absl/status/status.h"
 #include "backend/index/index_test_suite.h"
 #include "common/file_util.h"
@@ -21,6 +23,7 @@ namespace carmen::backend::index {
 namespace {
 
 using ::testing::_;
+using ::testing::ElementsAreArray;
 using ::testing::IsOkAndHolds;
 using ::testing::StatusIs;
 
@@ -53,5 +56,21 @@ TEST(LevelDbMultiFileIndex, IndexIsPersistent) {
     EXPECT_THAT(index.Get(1), IsOkAndHolds(result.first));
   }
 }
+
+TEST(LevelDbMultiFileIndex, SnapshotListsKeysInOrdinalOrder) {
+  auto dir = TempDir();
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(dir.GetPath()));
+  ASSERT_OK_AND_ASSIGN(auto empty, index.CreateSnapshot());
+  EXPECT_EQ(empty->GetSize(), 0);
+
+  std::vector<int> keys = {42, 7, -3, 1000, 0};
+  for (int key : keys) {
+    ASSERT_OK(index.GetOrAdd(key));
+  }
+  ASSERT_OK(index.GetHash());
+  ASSERT_OK_AND_ASSIGN(auto snapshot, index.CreateSnapshot());
+  EXPECT_EQ(snapshot->GetSize(), keys.size());
+  EXPECT_THAT(snapshot->GetKeys(0, keys.size()), ElementsAreArray(keys));
+}
 }  // namespace
 }  // namespace carmen::backend::index
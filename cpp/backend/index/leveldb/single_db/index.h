@@ -48,14 +48,20 @@ class LevelDbKeySpace : public internal::LevelDbIndexBase<K, I, 1> {
   static absl::StatusOr<LevelDbKeySpace> Open(
       Context& context, const std::filesystem::path& path) {
     // Obtain shared LevelDB instance from context or create and register one if
-    // there is none so far.
+    // there is none so far. Key spaces of a state are opened concurrently (see
+    // s1::State::Open), so the shared instance must only be created within the
+    // factory passed to GetOrCreateComponent, which runs under the context's
+    // lock. Creating it outside would open the same database twice.
     using SharedLevelDb = std::shared_ptr<LevelDb>;
-    if (!context.HasComponent<SharedLevelDb>()) {
-      ASSIGN_OR_RETURN(auto db, LevelDb::Open(path / "common_level_db",
-                                              /*create_if_missing=*/true));
-      context.RegisterComponent(std::make_shared<LevelDb>(std::move(db)));
-    }
-    auto ldb = context.GetComponent<SharedLevelDb>();
+    ASSIGN_OR_RETURN(
+        auto ldb,
+        context.GetOrCreateComponent<SharedLevelDb>(
+            [&]() -> absl::StatusOr<SharedLevelDb> {
+              ASSIGN_OR_RETURN(auto db,
+                               LevelDb::Open(path / "common_level_db",
+                                             /*create_if_missing=*/true));
+              return std::make_shared<LevelDb>(std::move(db));
+            }));
 
     // Next, we need to find a proper key space for this instance.
     // TODO: this is not pretty, should be improved.
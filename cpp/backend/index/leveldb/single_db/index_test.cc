@@ -10,6 +10,8 @@
 
 #include "backend/index/leveldb/single_db/index.h"
 
+#include <vector>
+
 #include "absl/status/status.h"
 #include "backend/index/index_test_suite.h"
 #include "common/file_util.h"
@@ -21,6 +23,7 @@ namespace carmen::backend::index {
 namespace {
 
 using ::testing::_;
+using ::testing::ElementsAreArray;
 using ::testing::IsOkAndHolds;
 using ::testing::StatusIs;
 using ::testing::StrEq;
@@ -71,5 +74,21 @@ TEST(LevelDbIndexTest, IndexIsPersistent) {
   }
 }
 
+TEST(LevelDbIndexTest, SnapshotOnlyListsKeysOfItsKeySpace) {
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto db, SingleLevelDbIndex::Open(dir.GetPath()));
+  auto first = db.KeySpace<int, int>('a');
+  auto second = db.KeySpace<int, int>('b');
+  std::vector<int> keys = {42, 7, -3, 1000, 0};
+  for (int key : keys) {
+    ASSERT_OK(first.GetOrAdd(key));
+    ASSERT_OK(second.GetOrAdd(key + 1));
+  }
+  ASSERT_OK(first.GetHash());
+  ASSERT_OK_AND_ASSIGN(auto snapshot, first.CreateSnapshot());
+  EXPECT_THAT(snapshot->GetKeys(0, snapshot->GetSize()),
+              ElementsAreArray(keys));
+}
+
 }  // namespace
 }  // namespace carmen::backend::index
@@ -11,19 +11,25 @@
 #pragma once
 
 #include <concepts>
+#include <cstdint>
 #include <deque>
 #include <filesystem>
 #include <memory>
 #include <optional>
 #include <queue>
+#include <vector>
 
-#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "backend/common/file.h"
 #include "backend/index/index.h"
 #include "backend/structure.h"
+#include "common/fstream.h"
 #include "common/hash.h"
 #include "common/memory_usage.h"
+#include "common/status_util.h"
 #include "common/type.h"
 
 namespace carmen::backend::index {
@@ -36,6 +42,14 @@ namespace carmen::backend::index {
 // be hashed and compared. The type I is the type used for the
 // ordinal numbers and must be implicitly constructable from a
 // std::size_t.
+//
+// Each key is stored only once, in a list ordered by ordinals. The hash table
+// used for lookups only retains ordinals referencing positions in this list.
+//
+// If opened for a directory, the content of the index is written to this
+// directory on Flush and restored by the next Open call. New keys are
+// appended to the stored key list, such that the cost of a flush is
+// proportional to the number of keys added since the last flush.
 template <Trivial K, std::integral I>
 class InMemoryIndex {
  public:
@@ -44,9 +58,10 @@ class InMemoryIndex {
   // The value type of ordinal values mapped to keys.
   using value_type = I;
 
-  // A factory function creating an instance of this index type.
-  static absl::StatusOr<InMemoryIndex> Open(Context&,
-                                            const std::filesystem::path&);
+  // A factory function creating an instance of this index type. If the given
+  // directory contains data of a previous flush, this data is restored.
+  static absl::StatusOr<InMemoryIndex> Open(
+      Context&, const std::filesystem::path& directory);
 
   // Initializes an empty index.
   InMemoryIndex();
@@ -61,12 +76,25 @@ class InMemoryIndex {
   // internally such that future lookups will return the same
   // value.
   absl::StatusOr<std::pair<I, bool>> GetOrAdd(const K& key) {
-    auto [pos, is_new] = data_.insert({key, I{}});
-    if (is_new) {
-      pos->second = data_.size() - 1;
-      list_->push_back(key);
+    bool is_new = false;
+    auto pos = data_.lazy_emplace(key, [&](const auto& ctor) {
+      is_new = true;
+      ctor(Ordinal{Assign(key)});
+    });
+    return std::pair{pos->value, is_new};
+  }
+
+  // Removes the given key from this index. Its ordinal is reused for the next
+  // new key. Removing an unknown key has no effect.
+  absl::Status Remove(const K& key) {
+    auto pos = data_.find(key);
+    if (pos == data_.end()) {
+      return absl::OkStatus();
     }
-    return std::pair{pos->second, is_new};
+    free_ordinals_.push_back(pos->value);
+    data_.erase(pos);
+    free_ordinals_modified_ = true;
+    return absl::OkStatus();
   }
 
   // Retrieves the ordinal number for the given key if previously registered.
@@ -76,7 +104,7 @@ class InMemoryIndex {
     if (pos == data_.end()) {
       return absl::NotFoundError("Key not found");
     }
-    return pos->second;
+    return pos->value;
   }
 
   // Tests whether the given key is indexed by this container.
@@ -93,20 +121,24 @@ class InMemoryIndex {
 
   // Creates a snapshot of this index shielded from future additions that can be
   // safely accessed concurrently to other operations. It internally references
-  // state of this index and thus must not outlive this index object.
+  // state of this index and thus must not outlive this index object. Ordinals
+  // of removed keys are not covered: the snapshot lists an unspecified key for
+  // them, which may change if the ordinal is reused.
   std::unique_ptr<IndexSnapshot<K>> CreateSnapshot() const;
 
-  // Flush unsafed index keys to disk.
-  absl::Status Flush() { return absl::OkStatus(); }
+  // Writes keys added since the last flush to disk, if this index is backed
+  // by a directory.
+  absl::Status Flush();
 
-  // Close this index and release resources.
-  absl::Status Close() { return absl::OkStatus(); }
+  // Flushes the content of this index and releases resources.
+  absl::Status Close() { return Flush(); }
 
   // Summarizes the memory usage of this instance.
   MemoryFootprint GetMemoryFootprint() const {
     MemoryFootprint res(*this);
     res.Add("list", SizeOf(*list_));
     res.Add("index", SizeOf(data_));
+    res.Add("free_ordinals", SizeOf(free_ordinals_));
     return res;
   }
 
@@ -145,14 +177,77 @@ class InMemoryIndex {
     mutable std::vector<K> buffer_;
   };
 
+  // The ordinal of a key stored in the lookup table. It is wrapped in a type
+  // distinct from K and I to enable heterogeneous lookups by key.
+  struct Ordinal {
+    I value;
+  };
+
+  // Hashes ordinals by the key they are referencing, such that entries can be
+  // located using keys.
+  class KeyHash {
+   public:
+    using is_transparent = void;
+    explicit KeyHash(const std::deque<K>* list) : list_(list) {}
+    std::size_t operator()(const K& key) const { return absl::Hash<K>{}(key); }
+    std::size_t operator()(const Ordinal& ordinal) const {
+      return (*this)((*list_)[ordinal.value]);
+    }
+
+   private:
+    const std::deque<K>* list_;
+  };
+
+  // Compares ordinals and keys by the keys referenced by ordinals.
+  class KeyEq {
+   public:
+    using is_transparent = void;
+    explicit KeyEq(const std::deque<K>* list) : list_(list) {}
+    bool operator()(const Ordinal& a, const Ordinal& b) const {
+      return a.value == b.value;
+    }
+    bool operator()(const Ordinal& a, const K& b) const {
+      return (*list_)[a.value] == b;
+    }
+    bool operator()(const K& a, const Ordinal& b) const { return (*this)(b, a); }
+
+   private:
+    const std::deque<K>* list_;
+  };
+
+  // Assigns an ordinal to the given new key, reusing the ordinal of the most
+  // recently removed key if there is any.
+  I Assign(const K& key);
+
+  // Loads the content of a previous flush from the directory of this index.
+  absl::Status Load();
+
   // The full list of keys in order of insertion. Thus, a key at position i is
-  // mapped to value i. It is required for implementing snapshots. The list is
+  // mapped to value i. It is the only place keys are stored. The list is
   // wrapped into a unique_ptr to support pointer stability under move
-  // operations.
+  // operations, since the lookup table references it.
   std::unique_ptr<std::deque<K>> list_;
 
   // An index mapping keys to their identifier values.
-  absl::flat_hash_map<K, I> data_;
+  absl::flat_hash_set<Ordinal, KeyHash, KeyEq> data_;
+
+  // The directory the content of this index is flushed to. Empty if this index
+  // is not backed by a directory.
+  std::filesystem::path directory_;
+
+  // The ordinals of removed keys, ready for reuse. The most recently released
+  // ordinal is at the end.
+  std::vector<I> free_ordinals_;
+
+  // Set if the list of free ordinals has been modified since the last flush.
+  bool free_ordinals_modified_ = false;
+
+  // Positions of the key list below num_flushed_keys_ which have been assigned
+  // to new keys since the last flush.
+  std::vector<I> reused_ordinals_;
+
+  // The number of keys already written to the directory.
+  std::size_t num_flushed_keys_ = 0;
 
   mutable std::size_t next_to_hash_ = 0;
   mutable Sha256Hasher hasher_;
@@ -161,13 +256,17 @@ class InMemoryIndex {
 
 template <Trivial K, std::integral I>
 absl::StatusOr<InMemoryIndex<K, I>> InMemoryIndex<K, I>::Open(
-    Context&, const std::filesystem::path&) {
-  return InMemoryIndex();
+    Context&, const std::filesystem::path& directory) {
+  InMemoryIndex index;
+  index.directory_ = directory;
+  RETURN_IF_ERROR(index.Load());
+  return index;
 }
 
 template <Trivial K, std::integral I>
 InMemoryIndex<K, I>::InMemoryIndex()
-    : list_(std::make_unique<std::deque<K>>()) {}
+    : list_(std::make_unique<std::deque<K>>()),
+      data_(0, KeyHash(list_.get()), KeyEq(list_.get())) {}
 
 template <Trivial K, std::integral I>
 InMemoryIndex<K, I>::InMemoryIndex(const IndexSnapshot<K>& snapshot)
@@ -186,9 +285,138 @@ InMemoryIndex<K, I>::InMemoryIndex(const IndexSnapshot<K>& snapshot)
   GetHash().IgnoreError();
 }
 
+template <Trivial K, std::integral I>
+I InMemoryIndex<K, I>::Assign(const K& key) {
+  if (free_ordinals_.empty()) {
+    list_->push_back(key);
+    return static_cast<I>(list_->size() - 1);
+  }
+  // Keys are hashed in the order they are assigned to ordinals. Thus, all keys
+  // appended so far need to be hashed before the reused position is updated.
+  GetHash().IgnoreError();
+  I ordinal = free_ordinals_.back();
+  free_ordinals_.pop_back();
+  free_ordinals_modified_ = true;
+  (*list_)[ordinal] = key;
+  hash_ = carmen::GetHash(hasher_, hash_, key);
+  if (static_cast<std::size_t>(ordinal) < num_flushed_keys_) {
+    reused_ordinals_.push_back(ordinal);
+  }
+  return ordinal;
+}
+
 template <Trivial K, std::integral I>
 std::unique_ptr<IndexSnapshot<K>> InMemoryIndex<K, I>::CreateSnapshot() const {
   return std::make_unique<Snapshot>(*list_);
 }
 
+template <Trivial K, std::integral I>
+absl::Status InMemoryIndex<K, I>::Flush() {
+  if (directory_.empty() ||
+      (num_flushed_keys_ == list_->size() && !free_ordinals_modified_)) {
+    return absl::OkStatus();
+  }
+  RETURN_IF_ERROR(CreateDirectory(directory_));
+
+  // The index is stored in two files:
+  //  - keys.dat: the list of keys in the order of their ordinals
+  //  - metadata.dat: the number of valid keys in keys.dat, their hash, and the
+  //    ordinals of removed keys
+  // Keys are written first, such that an interrupted flush leaves the index in
+  // the state of the previous flush. Only keys assigned to reused ordinals are
+  // updated in place.
+  ASSIGN_OR_RETURN(auto hash, GetHash());
+  {
+    auto mode = std::ios::binary | std::ios::out;
+    if (num_flushed_keys_ > 0) {
+      mode |= std::ios::in;  // < prevents truncation
+    }
+    ASSIGN_OR_RETURN(auto out, FStream::Open(directory_ / "keys.dat", mode));
+    RETURN_IF_ERROR(out.Seekp(num_flushed_keys_ * sizeof(K)));
+    for (auto i = num_flushed_keys_; i < list_->size(); i++) {
+      RETURN_IF_ERROR(out.Write((*list_)[i]));
+    }
+    for (I ordinal : reused_ordinals_) {
+      RETURN_IF_ERROR(out.Seekp(ordinal * sizeof(K)));
+      RETURN_IF_ERROR(out.Write((*list_)[ordinal]));
+    }
+    RETURN_IF_ERROR(out.Close());
+  }
+  {
+    ASSIGN_OR_RETURN(auto out, FStream::Open(directory_ / "metadata.dat",
+                                             std::ios::binary | std::ios::out));
+    std::uint64_t num_keys = list_->size();
+    RETURN_IF_ERROR(out.Write(num_keys));
+    RETURN_IF_ERROR(out.Write(hash));
+    std::uint64_t num_free_ordinals = free_ordinals_.size();
+    RETURN_IF_ERROR(out.Write(num_free_ordinals));
+    RETURN_IF_ERROR(out.Write(std::span<const I>(free_ordinals_)));
+    RETURN_IF_ERROR(out.Close());
+  }
+  num_flushed_keys_ = list_->size();
+  reused_ordinals_.clear();
+  free_ordinals_modified_ = false;
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I>
+absl::Status InMemoryIndex<K, I>::Load() {
+  auto metadata_file = directory_ / "metadata.dat";
+  if (directory_.empty() || !std::filesystem::exists(metadata_file)) {
+    return absl::OkStatus();
+  }
+
+  std::uint64_t num_keys;
+  Hash hash;
+  {
+    ASSIGN_OR_RETURN(auto in,
+                     FStream::Open(metadata_file, std::ios::binary | std::ios::in));
+    RETURN_IF_ERROR(in.Read(num_keys));
+    RETURN_IF_ERROR(in.Read(hash));
+    // Metadata written before keys could be removed ends after the hash.
+    std::uint64_t num_free_ordinals = 0;
+    ASSIGN_OR_RETURN(auto num_read,
+                     in.ReadUntilEof(std::span(&num_free_ordinals, 1)));
+    if (num_read == 1) {
+      free_ordinals_.resize(num_free_ordinals);
+      RETURN_IF_ERROR(in.Read(std::span(free_ordinals_)));
+    }
+    RETURN_IF_ERROR(in.Close());
+  }
+
+  // Keys at the positions of free ordinals are outdated and not indexed.
+  std::vector<bool> is_free(num_keys);
+  for (I ordinal : free_ordinals_) {
+    if (static_cast<std::uint64_t>(ordinal) >= num_keys) {
+      return absl::InternalError("Invalid free ordinal in index metadata.");
+    }
+    is_free[ordinal] = true;
+  }
+
+  // Keys are read in blocks to reduce the number of file operations.
+  constexpr static const std::size_t kBlockSize = 1024;
+  ASSIGN_OR_RETURN(auto in, FStream::Open(directory_ / "keys.dat",
+                                          std::ios::binary | std::ios::in));
+  std::vector<K> buffer(kBlockSize);
+  data_.reserve(num_keys - free_ordinals_.size());
+  for (std::uint64_t i = 0; i < num_keys; i += kBlockSize) {
+    auto block = std::span(buffer).subspan(
+        0, std::min<std::uint64_t>(kBlockSize, num_keys - i));
+    RETURN_IF_ERROR(in.Read(block));
+    for (const auto& key : block) {
+      list_->push_back(key);
+      if (!is_free[list_->size() - 1]) {
+        data_.insert(Ordinal{static_cast<I>(list_->size() - 1)});
+      }
+    }
+  }
+  RETURN_IF_ERROR(in.Close());
+
+  // The hash of the loaded keys is restored instead of being recomputed.
+  hash_ = hash;
+  next_to_hash_ = num_keys;
+  num_flushed_keys_ = num_keys;
+  return absl::OkStatus();
+}
+
 }  // namespace carmen::backend::index
@@ -11,19 +11,24 @@
 #include "backend/index/memory/index.h"
 
 #include "backend/index/index_test_suite.h"
+#include "backend/structure.h"
+#include "common/file_util.h"
 #include "common/status_test_util.h"
 #include "gtest/gtest.h"
 
 namespace carmen::backend::index {
 namespace {
 
+using ::testing::_;
 using ::testing::IsOkAndHolds;
 using ::testing::Pair;
+using ::testing::StatusIs;
 
 using TestIndex = InMemoryIndex<int, int>;
 
 // Instantiates common index tests for the InMemory index type.
 INSTANTIATE_TYPED_TEST_SUITE_P(InMemory, IndexTest, TestIndex);
+INSTANTIATE_TYPED_TEST_SUITE_P(InMemory, RemovableIndexTest, TestIndex);
 
 TEST(InMemoryIndexTest, SnapshotShieldsMutations) {
   TestIndex index;
@@ -67,5 +72,105 @@ TEST(InMemoryIndexTest, LargeSnapshotRecoveryWorks) {
   EXPECT_THAT(restored.GetHash(), IsOkAndHolds(hash));
 }
 
+TEST(InMemoryIndexTest, FlushedIndexCanBeRestored) {
+  constexpr const int kNumElements = 100000;
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < kNumElements; i++) {
+      EXPECT_THAT(index.GetOrAdd(i + 5), IsOkAndHolds(Pair(i, true)));
+    }
+    ASSERT_OK_AND_ASSIGN(hash, index.GetHash());
+    ASSERT_OK(index.Close());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto restored, TestIndex::Open(ctx, dir.GetPath()));
+    EXPECT_THAT(restored.GetHash(), IsOkAndHolds(hash));
+    for (int i = 0; i < kNumElements; i++) {
+      EXPECT_THAT(restored.Get(i + 5), IsOkAndHolds(i));
+    }
+    EXPECT_THAT(restored.GetOrAdd(1), IsOkAndHolds(Pair(kNumElements, true)));
+  }
+}
+
+TEST(InMemoryIndexTest, KeysAddedAfterFlushAreAppendedByNextFlush) {
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+    ASSERT_OK(index.GetOrAdd(10));
+    ASSERT_OK(index.Flush());
+    ASSERT_OK(index.GetOrAdd(12));
+    ASSERT_OK(index.Flush());
+    ASSERT_OK(index.GetOrAdd(14));
+    ASSERT_OK_AND_ASSIGN(hash, index.GetHash());
+    ASSERT_OK(index.Close());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto restored, TestIndex::Open(ctx, dir.GetPath()));
+    EXPECT_THAT(restored.Get(10), IsOkAndHolds(0));
+    EXPECT_THAT(restored.Get(12), IsOkAndHolds(1));
+    EXPECT_THAT(restored.Get(14), IsOkAndHolds(2));
+    EXPECT_THAT(restored.GetHash(), IsOkAndHolds(hash));
+  }
+}
+
+TEST(InMemoryIndexTest, KeysAddedAfterLastFlushAreLost) {
+  TempDir dir;
+  Context ctx;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+    ASSERT_OK(index.GetOrAdd(10));
+    ASSERT_OK(index.Flush());
+    ASSERT_OK(index.GetOrAdd(12));
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto restored, TestIndex::Open(ctx, dir.GetPath()));
+    EXPECT_THAT(restored.Get(10), IsOkAndHolds(0));
+    EXPECT_THAT(restored.Get(12), StatusIs(absl::StatusCode::kNotFound, _));
+    EXPECT_THAT(restored.GetOrAdd(14), IsOkAndHolds(Pair(1, true)));
+  }
+}
+
+TEST(InMemoryIndexTest, RemovalsAndReusedOrdinalsAreRestored) {
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < 4; i++) {
+      ASSERT_OK(index.GetOrAdd(i + 10));
+    }
+    ASSERT_OK(index.Flush());
+    // Ordinal 1 is reused by a key flushed in place, ordinal 2 stays free.
+    ASSERT_OK(index.Remove(12));
+    ASSERT_OK(index.Remove(11));
+    EXPECT_THAT(index.GetOrAdd(20), IsOkAndHolds(Pair(1, true)));
+    ASSERT_OK_AND_ASSIGN(hash, index.GetHash());
+    ASSERT_OK(index.Close());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto restored, TestIndex::Open(ctx, dir.GetPath()));
+    EXPECT_THAT(restored.GetHash(), IsOkAndHolds(hash));
+    EXPECT_THAT(restored.Get(10), IsOkAndHolds(0));
+    EXPECT_THAT(restored.Get(20), IsOkAndHolds(1));
+    EXPECT_THAT(restored.Get(11), StatusIs(absl::StatusCode::kNotFound, _));
+    EXPECT_THAT(restored.Get(12), StatusIs(absl::StatusCode::kNotFound, _));
+    EXPECT_THAT(restored.Get(13), IsOkAndHolds(3));
+    EXPECT_THAT(restored.GetOrAdd(12), IsOkAndHolds(Pair(2, true)));
+    EXPECT_THAT(restored.GetOrAdd(21), IsOkAndHolds(Pair(4, true)));
+  }
+}
+
+TEST(InMemoryIndexTest, IndexWithoutDirectoryIgnoresFlush) {
+  TestIndex index;
+  ASSERT_OK(index.GetOrAdd(10));
+  EXPECT_OK(index.Flush());
+  EXPECT_OK(index.Close());
+}
+
 }  // namespace
 }  // namespace carmen::backend::index
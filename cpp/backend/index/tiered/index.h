@@ -0,0 +1,483 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "backend/common/file.h"
+#include "backend/index/file/index.h"
+#include "backend/index/index.h"
+#include "backend/index/tiered/perfect_hash_table.h"
+#include "backend/structure.h"
+#include "common/fstream.h"
+#include "common/hash.h"
+#include "common/memory_usage.h"
+#include "common/status_util.h"
+#include "common/type.h"
+
+namespace carmen::backend::index {
+
+// A TieredIndex implements the Index concept by combining an immutable base
+// tier with a mutable delta tier. Most keys of an index are added early and
+// are only looked up afterwards. Those keys are frozen into the base, a
+// PerfectHashTable taking a few bits per key beyond the keys and ordinals
+// themselves, and being accessed through a memory mapping. New keys are added
+// to the delta, a FileIndex, which is kept small.
+//
+// Ordinals [0, base size) are covered by the base, while all following
+// ordinals are covered by the delta. Lookups check the base first, requiring
+// at most two page accesses, and the delta second.
+//
+// Merges of the delta into the base are started on Flush() once the delta
+// exceeds a fraction of the base. The new base is built in the background,
+// while the index remains usable. It is installed by the first Flush() or
+// Close() after its completion, moving keys added in the meantime into a new
+// delta. The index hash is the same as the one of a FileIndex containing the
+// same keys.
+//
+// The files of the tiers are versioned by a generation, which is recorded in
+// the metadata file. A merge creates the tiers of the next generation next to
+// the current ones, and is committed by atomically replacing the metadata
+// file. Files of other generations, left by merges interrupted before or after
+// their commit, are removed when the index is opened.
+//
+// Keys can not be removed from this index, since the base is immutable.
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size = kFileSystemPageSize>
+class TieredIndex {
+ public:
+  using key_type = K;
+  using value_type = I;
+
+  // The type of the immutable base tier.
+  using Base = PerfectHashTable<K, I>;
+
+  // The type of the mutable delta tier.
+  using Delta = FileIndex<K, I, F, page_size>;
+
+  // A factory function creating an instance of this index type.
+  static absl::StatusOr<TieredIndex> Open(
+      Context&, const std::filesystem::path& directory);
+
+  // Tiered indexes are move-constructable.
+  TieredIndex(TieredIndex&&) = default;
+
+  // On destruction tiered indexes are automatically flushed and closed,
+  // waiting for the completion of running merges.
+  ~TieredIndex() { Close().IgnoreError(); }
+
+  // Retrieves the ordinal number for the given key. If the key is known, it
+  // will return a previously established value for the key. If the key has not
+  // been encountered before, a new ordinal value is assigned to the key and
+  // stored internally such that future lookups will return the same value.
+  absl::StatusOr<std::pair<I, bool>> GetOrAdd(const K& key);
+
+  // Retrieves the ordinal number for the given key if previously registered.
+  // Otherwise, returns a not found status.
+  absl::StatusOr<I> Get(const K& key) const;
+
+  // Computes a hash over the full content of this index.
+  absl::StatusOr<Hash> GetHash() const;
+
+  // Creates a snapshot of the keys of this index in the order of their
+  // ordinals, collecting the keys of both tiers in memory.
+  absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>> CreateSnapshot() const;
+
+  // Starts merging all keys of the delta into a new base in the background.
+  // Has no effect if a merge is already running or the delta is empty.
+  absl::Status StartMerge();
+
+  // Waits for the completion of a running merge, if any, and installs the new
+  // base.
+  absl::Status FinishMerge();
+
+  // Returns the number of keys in the base tier.
+  std::size_t GetBaseSize() const { return base_ ? base_->GetSize() : 0; }
+
+  // Returns the number of keys in the delta tier.
+  std::size_t GetDeltaSize() const { return size_ - GetBaseSize(); }
+
+  // Flushes the delta and metadata to disk. Installs completed merges and
+  // starts a new merge if the delta has grown too large.
+  absl::Status Flush();
+
+  // Close this index and release resources.
+  absl::Status Close();
+
+  // Summarizes the memory usage of this instance.
+  MemoryFootprint GetMemoryFootprint() const;
+
+ private:
+  // The minimum number of keys in the delta before a merge is started.
+  constexpr static const std::size_t kMinMergeSize = 1 << 16;
+
+  // A merge is started once the delta exceeds 1/kMergeRatio of the base.
+  constexpr static const std::size_t kMergeRatio = 8;
+
+  TieredIndex(std::unique_ptr<std::filesystem::path> directory, Delta delta);
+
+  // Collects the keys of both tiers in the order of their ordinals.
+  absl::StatusOr<std::vector<K>> GetKeys() const;
+
+  // Returns the path of the base file of the given generation.
+  static std::filesystem::path GetBaseFile(
+      const std::filesystem::path& directory, std::size_t generation) {
+    return directory / absl::StrCat("base-", generation, ".dat");
+  }
+
+  // Returns the path of the delta directory of the given generation.
+  static std::filesystem::path GetDeltaDirectory(
+      const std::filesystem::path& directory, std::size_t generation) {
+    return directory / absl::StrCat("delta-", generation);
+  }
+
+  // Removes the files of all tiers in the given directory not belonging to the
+  // given generation.
+  static absl::Status RemoveOtherGenerations(
+      const std::filesystem::path& directory, std::size_t generation);
+
+  // Writes the generation, size, and hash of this index to the metadata file.
+  // The file is replaced atomically, committing installed merges.
+  absl::Status WriteMetadata();
+
+  // The directory containing all files of this index. The path is a unique ptr
+  // to manage ownership during moves. It is reset when the index is closed.
+  std::unique_ptr<std::filesystem::path> directory_;
+
+  // A context providing the components of the context this index was opened
+  // with to deltas created by merges, since the latter does not outlive Open.
+  Context context_;
+
+  // The generation of the files of the current tiers.
+  std::size_t generation_ = 0;
+
+  // The immutable base tier, missing if no merge has been completed yet.
+  std::optional<Base> base_;
+
+  // The mutable delta tier.
+  std::optional<Delta> delta_;
+
+  // The number of keys in this index.
+  std::size_t size_ = 0;
+
+  // The result of a merge running in the background, if valid.
+  std::future<absl::Status> merge_;
+
+  // The number of keys covered by the base built by the running merge.
+  std::size_t merge_size_ = 0;
+
+  // ---- Hash Support ----
+
+  mutable std::queue<K> unhashed_keys_;
+  mutable Sha256Hasher hasher_;
+  mutable Hash hash_{};
+};
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::StatusOr<TieredIndex<K, I, F, page_size>>
+TieredIndex<K, I, F, page_size>::Open(Context& context,
+                                      const std::filesystem::path& directory) {
+  std::size_t generation = 0;
+  std::size_t size = 0;
+  Hash hash{};
+  auto metadata_file = directory / "metadata.dat";
+  if (std::filesystem::exists(metadata_file)) {
+    ASSIGN_OR_RETURN(auto in, FStream::Open(metadata_file,
+                                            std::ios::binary | std::ios::in));
+    RETURN_IF_ERROR(in.Read(generation));
+    RETURN_IF_ERROR(in.Read(size));
+    RETURN_IF_ERROR(in.Read(hash));
+  }
+  RETURN_IF_ERROR(RemoveOtherGenerations(directory, generation));
+
+  auto delta_directory = GetDeltaDirectory(directory, generation);
+  RETURN_IF_ERROR(CreateDirectory(delta_directory));
+  ASSIGN_OR_RETURN(auto delta, Delta::Open(context, delta_directory));
+  auto index =
+      TieredIndex(std::make_unique<std::filesystem::path>(directory),
+                  std::move(delta));
+  index.context_.RegisterComponent(GetPagePoolOptions(context));
+  index.generation_ = generation;
+  index.size_ = size;
+  index.hash_ = hash;
+
+  // The first generation has no base, all later ones have.
+  if (generation > 0) {
+    ASSIGN_OR_RETURN(auto base, Base::Open(GetBaseFile(directory, generation)));
+    index.base_.emplace(std::move(base));
+  }
+  if (index.size_ < index.GetBaseSize()) {
+    return absl::InternalError(absl::StrCat(
+        "Index in ", directory.string(), " of size ", index.size_,
+        " has a base of size ", index.GetBaseSize()));
+  }
+  return index;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::Status TieredIndex<K, I, F, page_size>::RemoveOtherGenerations(
+    const std::filesystem::path& directory, std::size_t generation) {
+  std::error_code error;
+  if (!std::filesystem::exists(directory, error)) {
+    return absl::OkStatus();
+  }
+  const auto base_file = GetBaseFile(directory, generation).filename();
+  const auto delta_directory =
+      GetDeltaDirectory(directory, generation).filename();
+  std::vector<std::filesystem::path> stale;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory, error)) {
+    auto name = entry.path().filename();
+    if (name == base_file || name == delta_directory) {
+      continue;
+    }
+    auto str = name.string();
+    if (str.starts_with("base-") || str.starts_with("delta-") ||
+        str == "metadata.dat.tmp") {
+      stale.push_back(entry.path());
+    }
+  }
+  if (error) {
+    return absl::InternalError(absl::StrCat("Failed to list files in ",
+                                            directory.string(), ": ",
+                                            error.message()));
+  }
+  for (const auto& path : stale) {
+    std::filesystem::remove_all(path, error);
+    if (error) {
+      return absl::InternalError(absl::StrCat(
+          "Failed to remove ", path.string(), ": ", error.message()));
+    }
+  }
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+TieredIndex<K, I, F, page_size>::TieredIndex(
+    std::unique_ptr<std::filesystem::path> directory, Delta delta)
+    : directory_(std::move(directory)) {
+  delta_.emplace(std::move(delta));
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::StatusOr<std::pair<I, bool>> TieredIndex<K, I, F, page_size>::GetOrAdd(
+    const K& key) {
+  if (base_) {
+    if (auto ordinal = base_->Find(key)) {
+      return std::pair{*ordinal, false};
+    }
+  }
+  ASSIGN_OR_RETURN((auto [ordinal, added]), delta_->GetOrAdd(key));
+  if (added) {
+    size_++;
+    unhashed_keys_.push(key);
+  }
+  return std::pair{static_cast<I>(ordinal + GetBaseSize()), added};
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::StatusOr<I> TieredIndex<K, I, F, page_size>::Get(const K& key) const {
+  if (base_) {
+    if (auto ordinal = base_->Find(key)) {
+      return *ordinal;
+    }
+  }
+  ASSIGN_OR_RETURN(auto ordinal, delta_->Get(key));
+  return static_cast<I>(ordinal + GetBaseSize());
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::StatusOr<Hash> TieredIndex<K, I, F, page_size>::GetHash() const {
+  while (!unhashed_keys_.empty()) {
+    hash_ = carmen::GetHash(hasher_, hash_, unhashed_keys_.front());
+    unhashed_keys_.pop();
+  }
+  return hash_;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::StatusOr<std::unique_ptr<IndexSnapshot<K>>>
+TieredIndex<K, I, F, page_size>::CreateSnapshot() const {
+  ASSIGN_OR_RETURN(auto keys, GetKeys());
+  return std::make_unique<MaterializedIndexSnapshot<K>>(std::move(keys));
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::StatusOr<std::vector<K>> TieredIndex<K, I, F, page_size>::GetKeys()
+    const {
+  std::vector<K> keys;
+  if (base_) {
+    keys = base_->GetKeys();
+  }
+  ASSIGN_OR_RETURN(auto delta, delta_->CreateSnapshot());
+  auto delta_keys = delta->GetKeys(0, delta->GetSize());
+  keys.insert(keys.end(), delta_keys.begin(), delta_keys.end());
+  return keys;
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::Status TieredIndex<K, I, F, page_size>::StartMerge() {
+  if (merge_.valid() || GetDeltaSize() == 0) {
+    return absl::OkStatus();
+  }
+  // Only the keys of the delta, which keeps changing while the merge is
+  // running, are collected up front. The keys of the immutable base are read
+  // by the background task through its own mapping of the base file.
+  ASSIGN_OR_RETURN(auto snapshot, delta_->CreateSnapshot());
+  auto range = snapshot->GetKeys(0, snapshot->GetSize());
+  std::vector<K> delta_keys(range.begin(), range.end());
+  std::optional<std::filesystem::path> base_file;
+  if (base_) {
+    base_file = GetBaseFile(*directory_, generation_);
+  }
+  merge_size_ = size_;
+  merge_ = std::async(
+      std::launch::async,
+      [base_file = std::move(base_file),
+       path = GetBaseFile(*directory_, generation_ + 1),
+       delta_keys = std::move(delta_keys)]() -> absl::Status {
+        std::vector<K> keys;
+        if (base_file) {
+          ASSIGN_OR_RETURN(auto base, Base::Open(*base_file));
+          keys = base.GetKeys();
+        }
+        keys.insert(keys.end(), delta_keys.begin(), delta_keys.end());
+        return Base::Build(path, keys);
+      });
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::Status TieredIndex<K, I, F, page_size>::FinishMerge() {
+  if (!merge_.valid()) {
+    return absl::OkStatus();
+  }
+  RETURN_IF_ERROR(merge_.get());
+  auto& directory = *directory_;
+  const auto generation = generation_ + 1;
+
+  // Keys added to the delta while the merge was running are moved into the
+  // delta of the new generation.
+  ASSIGN_OR_RETURN(auto snapshot, delta_->CreateSnapshot());
+  auto remaining = snapshot->GetKeys(merge_size_ - GetBaseSize(),
+                                     snapshot->GetSize());
+  auto delta_directory = GetDeltaDirectory(directory, generation);
+  std::error_code error;
+  std::filesystem::remove_all(delta_directory, error);
+  if (error) {
+    return absl::InternalError(
+        absl::StrCat("Failed to remove ", delta_directory.string(), ": ",
+                     error.message()));
+  }
+  RETURN_IF_ERROR(CreateDirectory(delta_directory));
+  ASSIGN_OR_RETURN(auto delta,
+                   Delta::BulkLoad(context_, delta_directory, remaining));
+  ASSIGN_OR_RETURN(auto base, Base::Open(GetBaseFile(directory, generation)));
+
+  // Switch to the new tiers. The merge is committed by writing the metadata
+  // naming the new generation. Until then, the tiers of the previous
+  // generation remain in place and are used when reopening the index.
+  RETURN_IF_ERROR(delta_->Close());
+  delta_.emplace(std::move(delta));
+  base_.emplace(std::move(base));
+  generation_ = generation;
+  RETURN_IF_ERROR(WriteMetadata());
+  return RemoveOtherGenerations(directory, generation_);
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::Status TieredIndex<K, I, F, page_size>::WriteMetadata() {
+  auto metadata_file = *directory_ / "metadata.dat";
+  auto temp_file = *directory_ / "metadata.dat.tmp";
+  {
+    ASSIGN_OR_RETURN(auto out, FStream::Open(temp_file, std::ios::binary |
+                                                            std::ios::out |
+                                                            std::ios::trunc));
+    RETURN_IF_ERROR(out.Write(generation_));
+    RETURN_IF_ERROR(out.Write(size_));
+    ASSIGN_OR_RETURN(auto hash, GetHash());
+    RETURN_IF_ERROR(out.Write(hash));
+    RETURN_IF_ERROR(out.Close());
+  }
+  std::error_code error;
+  std::filesystem::rename(temp_file, metadata_file, error);
+  if (error) {
+    return absl::InternalError(
+        absl::StrCat("Failed to replace ", metadata_file.string(), ": ",
+                     error.message()));
+  }
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::Status TieredIndex<K, I, F, page_size>::Flush() {
+  // Only owning instances, which have not been closed, need to be flushed.
+  if (!directory_) return absl::OkStatus();
+  if (merge_.valid() && merge_.wait_for(std::chrono::seconds(0)) ==
+                            std::future_status::ready) {
+    RETURN_IF_ERROR(FinishMerge());
+  }
+  RETURN_IF_ERROR(delta_->Flush());
+  RETURN_IF_ERROR(WriteMetadata());
+  if (GetDeltaSize() >=
+      std::max(kMinMergeSize, GetBaseSize() / kMergeRatio)) {
+    RETURN_IF_ERROR(StartMerge());
+  }
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+absl::Status TieredIndex<K, I, F, page_size>::Close() {
+  if (!directory_) return absl::OkStatus();
+  RETURN_IF_ERROR(FinishMerge());
+  RETURN_IF_ERROR(delta_->Close());
+  RETURN_IF_ERROR(WriteMetadata());
+  directory_.reset();
+  return absl::OkStatus();
+}
+
+template <Trivial K, std::integral I, template <std::size_t> class F,
+          std::size_t page_size>
+MemoryFootprint TieredIndex<K, I, F, page_size>::GetMemoryFootprint() const {
+  MemoryFootprint res(*this);
+  if (base_) {
+    res.Add("base", base_->GetMemoryFootprint());
+  }
+  res.Add("delta", delta_->GetMemoryFootprint());
+  return res;
+}
+
+}  // namespace carmen::backend::index
@@ -0,0 +1,207 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/index/tiered/index.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "backend/common/file.h"
+#include "backend/index/file/index.h"
+#include "backend/index/index_test_suite.h"
+#include "backend/structure.h"
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "common/type.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend::index {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAreArray;
+using ::testing::IsOkAndHolds;
+using ::testing::Pair;
+using ::testing::StatusIs;
+using ::testing::UnorderedElementsAre;
+
+using TestIndex = TieredIndex<int, int, InMemoryFile, 128>;
+
+// Instantiates common index tests for the TieredIndex index type.
+INSTANTIATE_TYPED_TEST_SUITE_P(Tiered, IndexTest, TestIndex);
+
+// Keys can not be removed from tiered indexes, since the base is immutable.
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(RemovableIndexTest);
+
+TEST(TieredIndexTest, KeysAreRetainedByMerges) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_THAT(index.GetOrAdd(i * 3), IsOkAndHolds(Pair(i, true)));
+  }
+  ASSERT_OK(index.StartMerge());
+
+  // Keys added while merging remain in the delta.
+  for (int i = 1000; i < 1500; i++) {
+    EXPECT_THAT(index.GetOrAdd(i * 3), IsOkAndHolds(Pair(i, true)));
+  }
+  ASSERT_OK(index.FinishMerge());
+  EXPECT_EQ(index.GetBaseSize(), 1000);
+  EXPECT_EQ(index.GetDeltaSize(), 500);
+
+  for (int i = 0; i < 1500; i++) {
+    EXPECT_THAT(index.Get(i * 3), IsOkAndHolds(i));
+    EXPECT_THAT(index.GetOrAdd(i * 3), IsOkAndHolds(Pair(i, false)));
+    EXPECT_THAT(index.Get(i * 3 + 1), StatusIs(absl::StatusCode::kNotFound, _));
+  }
+  EXPECT_THAT(index.GetOrAdd(1), IsOkAndHolds(Pair(1500, true)));
+}
+
+TEST(TieredIndexTest, HashesMatchFileIndex) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath() / "a"));
+  ASSERT_OK_AND_ASSIGN(auto reference,
+                       (FileIndex<int, int, InMemoryFile, 128>::Open(
+                           ctx, dir.GetPath() / "b")));
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_OK(index.GetOrAdd(i * 7));
+    ASSERT_OK(reference.GetOrAdd(i * 7));
+    if (i % 300 == 0) {
+      ASSERT_OK(index.StartMerge());
+      ASSERT_OK(index.FinishMerge());
+    }
+  }
+  ASSERT_OK_AND_ASSIGN(auto hash, reference.GetHash());
+  EXPECT_THAT(index.GetHash(), IsOkAndHolds(hash));
+}
+
+TEST(TieredIndexTest, MergesAreStartedByFlushes) {
+  // A merge is started once the delta reaches its minimum merge size.
+  constexpr int kNumKeys = 1 << 16;
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  for (int i = 0; i < kNumKeys - 1; i++) {
+    ASSERT_OK(index.GetOrAdd(i));
+  }
+  ASSERT_OK(index.Flush());
+  ASSERT_OK(index.FinishMerge());
+  EXPECT_EQ(index.GetBaseSize(), 0);
+
+  ASSERT_OK(index.GetOrAdd(kNumKeys));
+  ASSERT_OK(index.Flush());
+  ASSERT_OK(index.FinishMerge());
+  EXPECT_EQ(index.GetBaseSize(), kNumKeys);
+  EXPECT_EQ(index.GetDeltaSize(), 0);
+}
+
+TEST(TieredIndexTest, IndexCanBeSavedAndRestored) {
+  using Index = TieredIndex<int, int, SingleFile>;
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < 10000; i++) {
+      EXPECT_THAT(index.GetOrAdd(i + 5), IsOkAndHolds(Pair(i, true)));
+    }
+    ASSERT_OK(index.StartMerge());
+    for (int i = 10000; i < 12000; i++) {
+      EXPECT_THAT(index.GetOrAdd(i + 5), IsOkAndHolds(Pair(i, true)));
+    }
+    ASSERT_OK_AND_ASSIGN(hash, index.GetHash());
+    // Closing the index waits for the merge to be completed.
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto restored, Index::Open(ctx, dir.GetPath()));
+    EXPECT_EQ(restored.GetBaseSize(), 10000);
+    EXPECT_EQ(restored.GetDeltaSize(), 2000);
+    EXPECT_THAT(restored.GetHash(), IsOkAndHolds(hash));
+    for (int i = 0; i < 12000; i++) {
+      EXPECT_THAT(restored.Get(i + 5), IsOkAndHolds(i));
+    }
+    EXPECT_THAT(restored.GetOrAdd(0), IsOkAndHolds(Pair(12000, true)));
+  }
+}
+
+TEST(TieredIndexTest, MergesRemoveFilesOfPreviousGenerations) {
+  using Index = TieredIndex<int, int, SingleFile>;
+  TempDir dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+  for (int i = 0; i < 3; i++) {
+    ASSERT_OK(index.GetOrAdd(i));
+    ASSERT_OK(index.StartMerge());
+    ASSERT_OK(index.FinishMerge());
+  }
+  std::vector<std::string> files;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    files.push_back(entry.path().filename().string());
+  }
+  EXPECT_THAT(files,
+              UnorderedElementsAre("base-3.dat", "delta-3", "metadata.dat"));
+}
+
+TEST(TieredIndexTest, UncommittedMergesAreDiscardedOnOpen) {
+  using Index = TieredIndex<int, int, SingleFile>;
+  TempDir dir;
+  Context ctx;
+  {
+    ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < 100; i++) {
+      ASSERT_OK(index.GetOrAdd(i));
+    }
+    ASSERT_OK(index.StartMerge());
+    ASSERT_OK(index.FinishMerge());
+    ASSERT_OK(index.GetOrAdd(100));
+  }
+
+  // Simulate a merge interrupted before writing the new metadata.
+  { std::ofstream out(dir.GetPath() / "base-2.dat"); }
+  std::filesystem::create_directory(dir.GetPath() / "delta-2");
+  { std::ofstream out(dir.GetPath() / "metadata.dat.tmp"); }
+
+  ASSERT_OK_AND_ASSIGN(auto index, Index::Open(ctx, dir.GetPath()));
+  EXPECT_EQ(index.GetBaseSize(), 100);
+  EXPECT_EQ(index.GetDeltaSize(), 1);
+  for (int i = 0; i <= 100; i++) {
+    EXPECT_THAT(index.Get(i), IsOkAndHolds(i));
+  }
+  EXPECT_FALSE(std::filesystem::exists(dir.GetPath() / "base-2.dat"));
+  EXPECT_FALSE(std::filesystem::exists(dir.GetPath() / "delta-2"));
+  EXPECT_FALSE(std::filesystem::exists(dir.GetPath() / "metadata.dat.tmp"));
+}
+
+TEST(TieredIndexTest, SnapshotListsKeysOfBothTiersInOrdinalOrder) {
+  Context ctx;
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto index, TestIndex::Open(ctx, dir.GetPath()));
+  std::vector<int> keys;
+  for (int i = 0; i < 5000; i++) {
+    keys.push_back(i * 31 + 7);
+    ASSERT_OK(index.GetOrAdd(keys.back()));
+    if (i == 3000) {
+      ASSERT_OK(index.StartMerge());
+      ASSERT_OK(index.FinishMerge());
+    }
+  }
+  ASSERT_OK_AND_ASSIGN(auto snapshot, index.CreateSnapshot());
+  EXPECT_EQ(snapshot->GetSize(), keys.size());
+  EXPECT_THAT(snapshot->GetKeys(0, keys.size()), ElementsAreArray(keys));
+}
+
+}  // namespace
+}  // namespace carmen::backend::index
@@ -0,0 +1,338 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "backend/common/mapped_file.h"
+#include "backend/index/file/stable_hash.h"
+#include "common/fstream.h"
+#include "common/memory_usage.h"
+#include "common/status_util.h"
+#include "common/type.h"
+
+namespace carmen::backend::index {
+
+// A PerfectHashTable is an immutable map from keys to ordinals, stored in a
+// single file that is accessed through a memory mapping. Keys are located
+// using a perfect hash function, mapping each key to its own slot without any
+// collisions. The function is defined by a 16-bit pilot value per bucket of
+// on average kAverageBucketSize keys, thus taking a few bits per key. Each
+// slot holds the key, for verifying lookups, and its ordinal.
+//
+// Every lookup reads exactly one pilot and one slot, and thus accesses at most
+// two pages of the file, without any probing. Since the file is mapped, its
+// pages are cached by the operating system and do not occupy heap memory.
+//
+// The hash function is constructed following the hash-and-displace scheme:
+// keys are partitioned into buckets, which are processed in the order of
+// decreasing size. For each bucket, the first pilot mapping all of its keys
+// to free slots is selected. To keep pilots small, the table has slightly
+// more slots than keys (see kLoadFactor). Unused slots are marked by an
+// ordinal of kEmpty.
+//
+// see: https://en.wikipedia.org/wiki/Perfect_hash_function
+template <Trivial K, std::integral I>
+class PerfectHashTable {
+ public:
+  using key_type = K;
+  using value_type = I;
+
+  // Writes a table to the given file, mapping each of the given keys to its
+  // position in the given list. Keys must be unique.
+  static absl::Status Build(const std::filesystem::path& path,
+                            std::span<const K> keys);
+
+  // Opens the table stored in the given file.
+  static absl::StatusOr<PerfectHashTable> Open(
+      const std::filesystem::path& path);
+
+  // Returns the number of keys in this table.
+  std::size_t GetSize() const { return header_.num_keys; }
+
+  // Retrieves the ordinal of the given key, or nothing if it is not present.
+  std::optional<I> Find(const K& key) const;
+
+  // Returns all keys of this table in the order of their ordinals.
+  std::vector<K> GetKeys() const;
+
+  // Summarizes the memory usage of this instance, including the mapped file.
+  MemoryFootprint GetMemoryFootprint() const;
+
+ private:
+  // The header at the start of each file.
+  struct Header {
+    std::uint64_t num_keys;
+    std::uint64_t num_slots;
+    std::uint64_t num_buckets;
+    std::uint64_t seed;
+    std::uint64_t hash_version;
+  };
+
+  // A single slot of the table.
+  struct Entry {
+    K key;
+    I ordinal;
+  };
+  static_assert(alignof(Entry) <= alignof(Header));
+
+  // The ordinal marking unused slots.
+  constexpr static const I kEmpty = std::numeric_limits<I>::max();
+
+  // The average number of keys per bucket.
+  constexpr static const double kAverageBucketSize = 4;
+
+  // The ratio of keys and slots.
+  constexpr static const double kLoadFactor = 0.99;
+
+  // The number of seeds tried when building a table before giving up.
+  constexpr static const std::uint64_t kMaxSeeds = 16;
+
+  // Mixes the bits of the given value (see SplitMix64).
+  static std::uint64_t Mix(std::uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+  }
+
+  // Obtains the bucket of a key with the given hash.
+  static std::size_t GetBucket(const Header& header, std::uint64_t hash) {
+    return Mix(hash ^ header.seed) % header.num_buckets;
+  }
+
+  // Obtains the slot of a key with the given hash for the given pilot.
+  static std::size_t GetSlot(const Header& header, std::uint64_t hash,
+                             std::uint16_t pilot) {
+    auto base = Mix(hash + (header.seed ^ 0x9e3779b97f4a7c15));
+    return Mix(base ^ (pilot * 0x9e3779b97f4a7c15)) % header.num_slots;
+  }
+
+  // Returns the position of the first slot in a file.
+  static std::size_t GetEntryOffset(std::size_t num_buckets) {
+    auto end = sizeof(Header) + num_buckets * sizeof(std::uint16_t);
+    return (end + alignof(Header) - 1) / alignof(Header) * alignof(Header);
+  }
+
+  // Attempts to find a pilot for each bucket using the seed of the given
+  // header. On success, the slot of each key is recorded in the given list.
+  static std::optional<std::vector<std::uint16_t>> FindPilots(
+      const Header& header, std::span<const std::uint64_t> hashes,
+      std::vector<std::size_t>& slots);
+
+  PerfectHashTable(MappedFile file, const Header& header);
+
+  // The mapped content of the file.
+  MappedFile file_;
+
+  // A copy of the header of the file.
+  Header header_;
+
+  // A hasher to compute hashes for keys.
+  VersionedStableHash<K> key_hasher_;
+};
+
+template <Trivial K, std::integral I>
+absl::Status PerfectHashTable<K, I>::Build(const std::filesystem::path& path,
+                                           std::span<const K> keys) {
+  if (keys.size() >= static_cast<std::size_t>(kEmpty)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Too many keys for ordinal type: ", keys.size()));
+  }
+  VersionedStableHash<K> key_hasher(kLatestStableHashVersion);
+  std::vector<std::uint64_t> hashes(keys.size());
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    hashes[i] = key_hasher(keys[i]);
+  }
+
+  Header header{
+      .num_keys = keys.size(),
+      .num_slots = static_cast<std::uint64_t>(
+          std::ceil(keys.size() / kLoadFactor)),
+      .num_buckets = static_cast<std::uint64_t>(
+          std::ceil(keys.size() / kAverageBucketSize)),
+      .seed = 0,
+      .hash_version = static_cast<std::uint64_t>(kLatestStableHashVersion),
+  };
+  std::vector<std::size_t> slots(keys.size());
+  std::optional<std::vector<std::uint16_t>> pilots;
+  for (; header.seed < kMaxSeeds && !pilots; header.seed++) {
+    pilots = FindPilots(header, hashes, slots);
+  }
+  if (!pilots) {
+    return absl::InternalError(absl::StrCat(
+        "Unable to find perfect hash function for ", keys.size(), " keys"));
+  }
+  header.seed--;
+
+  std::vector<Entry> entries(header.num_slots, Entry{K{}, kEmpty});
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    entries[slots[i]] = Entry{keys[i], static_cast<I>(i)};
+  }
+
+  ASSIGN_OR_RETURN(auto out,
+                   FStream::Open(path, std::ios::binary | std::ios::out));
+  RETURN_IF_ERROR(out.Write(header));
+  RETURN_IF_ERROR(out.Write(std::span<const std::uint16_t>(*pilots)));
+  std::array<std::byte, alignof(Header)> padding{};
+  auto padding_size = GetEntryOffset(header.num_buckets) - sizeof(Header) -
+                      header.num_buckets * sizeof(std::uint16_t);
+  RETURN_IF_ERROR(out.Write(
+      std::span<const std::byte>(padding).subspan(0, padding_size)));
+  RETURN_IF_ERROR(out.Write(std::span<const Entry>(entries)));
+  return out.Close();
+}
+
+template <Trivial K, std::integral I>
+std::optional<std::vector<std::uint16_t>> PerfectHashTable<K, I>::FindPilots(
+    const Header& header, std::span<const std::uint64_t> hashes,
+    std::vector<std::size_t>& slots) {
+  // Partition keys by their bucket using a counting sort.
+  std::vector<std::size_t> begin(header.num_buckets + 1, 0);
+  for (auto hash : hashes) {
+    begin[GetBucket(header, hash) + 1]++;
+  }
+  std::partial_sum(begin.begin(), begin.end(), begin.begin());
+  std::vector<std::size_t> members(hashes.size());
+  {
+    std::vector<std::size_t> next(begin.begin(), begin.end() - 1);
+    for (std::size_t i = 0; i < hashes.size(); i++) {
+      members[next[GetBucket(header, hashes[i])]++] = i;
+    }
+  }
+
+  // Place large buckets first, while there are plenty of free slots.
+  std::vector<std::size_t> order(header.num_buckets);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+    return begin[a + 1] - begin[a] > begin[b + 1] - begin[b];
+  });
+
+  std::vector<std::uint16_t> pilots(header.num_buckets, 0);
+  std::vector<bool> taken(header.num_slots, false);
+  std::vector<std::size_t> candidates;
+  for (auto bucket : order) {
+    std::span<const std::size_t> keys(members.begin() + begin[bucket],
+                                      members.begin() + begin[bucket + 1]);
+    if (keys.empty()) {
+      break;
+    }
+    bool placed = false;
+    for (std::uint32_t pilot = 0; !placed && pilot <= 0xFFFF; pilot++) {
+      candidates.clear();
+      for (auto key : keys) {
+        auto slot = GetSlot(header, hashes[key], pilot);
+        if (taken[slot] || std::find(candidates.begin(), candidates.end(),
+                                     slot) != candidates.end()) {
+          break;
+        }
+        candidates.push_back(slot);
+      }
+      if (candidates.size() != keys.size()) {
+        continue;
+      }
+      for (std::size_t i = 0; i < keys.size(); i++) {
+        taken[candidates[i]] = true;
+        slots[keys[i]] = candidates[i];
+      }
+      pilots[bucket] = pilot;
+      placed = true;
+    }
+    if (!placed) {
+      return std::nullopt;
+    }
+  }
+  return pilots;
+}
+
+template <Trivial K, std::integral I>
+absl::StatusOr<PerfectHashTable<K, I>> PerfectHashTable<K, I>::Open(
+    const std::filesystem::path& path) {
+  ASSIGN_OR_RETURN(auto file, MappedFile::Open(path));
+  auto data = file.GetData();
+  Header header;
+  if (data.size() < sizeof(Header)) {
+    return absl::InternalError(
+        absl::StrCat("Invalid perfect hash table file ", path.string()));
+  }
+  std::memcpy(&header, data.data(), sizeof(Header));
+  auto version = static_cast<StableHashVersion>(header.hash_version);
+  if (!IsValid(version)) {
+    return absl::InternalError(absl::StrCat("Unsupported stable hash version ",
+                                            header.hash_version, " in ",
+                                            path.string()));
+  }
+  if (data.size() != GetEntryOffset(header.num_buckets) +
+                         header.num_slots * sizeof(Entry)) {
+    return absl::InternalError(absl::StrCat(
+        "Invalid size of perfect hash table file ", path.string()));
+  }
+  return PerfectHashTable(std::move(file), header);
+}
+
+template <Trivial K, std::integral I>
+PerfectHashTable<K, I>::PerfectHashTable(MappedFile file, const Header& header)
+    : file_(std::move(file)),
+      header_(header),
+      key_hasher_(static_cast<StableHashVersion>(header.hash_version)) {}
+
+template <Trivial K, std::integral I>
+std::optional<I> PerfectHashTable<K, I>::Find(const K& key) const {
+  if (header_.num_keys == 0) {
+    return std::nullopt;
+  }
+  auto data = file_.GetData().data();
+  auto pilots = reinterpret_cast<const std::uint16_t*>(data + sizeof(Header));
+  auto entries = reinterpret_cast<const Entry*>(
+      data + GetEntryOffset(header_.num_buckets));
+  auto hash = key_hasher_(key);
+  const Entry& entry =
+      entries[GetSlot(header_, hash, pilots[GetBucket(header_, hash)])];
+  if (entry.ordinal == kEmpty || !(entry.key == key)) {
+    return std::nullopt;
+  }
+  return entry.ordinal;
+}
+
+template <Trivial K, std::integral I>
+std::vector<K> PerfectHashTable<K, I>::GetKeys() const {
+  std::vector<K> keys(header_.num_keys);
+  auto entries = reinterpret_cast<const Entry*>(
+      file_.GetData().data() + GetEntryOffset(header_.num_buckets));
+  for (std::size_t i = 0; i < header_.num_slots; i++) {
+    if (entries[i].ordinal != kEmpty) {
+      keys[entries[i].ordinal] = entries[i].key;
+    }
+  }
+  return keys;
+}
+
+template <Trivial K, std::integral I>
+MemoryFootprint PerfectHashTable<K, I>::GetMemoryFootprint() const {
+  MemoryFootprint res(*this);
+  res.Add("mapped_file", Memory(file_.GetData().size()));
+  return res;
+}
+
+}  // namespace carmen::backend::index
@@ -0,0 +1,91 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "backend/index/tiered/perfect_hash_table.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "common/type.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen::backend::index {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+using ::testing::Lt;
+using ::testing::Optional;
+using ::testing::StatusIs;
+
+using Table = PerfectHashTable<std::uint32_t, std::uint32_t>;
+
+TEST(PerfectHashTableTest, EmptyTableContainsNothing) {
+  TempDir dir;
+  auto path = dir.GetPath() / "table.dat";
+  ASSERT_OK(Table::Build(path, {}));
+  ASSERT_OK_AND_ASSIGN(auto table, Table::Open(path));
+  EXPECT_EQ(table.GetSize(), 0);
+  EXPECT_EQ(table.Find(0), std::nullopt);
+  EXPECT_THAT(table.GetKeys(), IsEmpty());
+}
+
+TEST(PerfectHashTableTest, KeysAreMappedToTheirPosition) {
+  constexpr std::uint32_t kNumKeys = 100000;
+  TempDir dir;
+  auto path = dir.GetPath() / "table.dat";
+  std::vector<std::uint32_t> keys;
+  for (std::uint32_t i = 0; i < kNumKeys; i++) {
+    keys.push_back(i * 7 + 3);
+  }
+  ASSERT_OK(Table::Build(path, keys));
+  ASSERT_OK_AND_ASSIGN(auto table, Table::Open(path));
+  EXPECT_EQ(table.GetSize(), kNumKeys);
+  for (std::uint32_t i = 0; i < kNumKeys; i++) {
+    EXPECT_THAT(table.Find(i * 7 + 3), Optional(i));
+    EXPECT_EQ(table.Find(i * 7 + 4), std::nullopt);
+  }
+  EXPECT_THAT(table.GetKeys(), ElementsAreArray(keys));
+}
+
+TEST(PerfectHashTableTest, TableUsesFewBitsPerKeyBeyondSlots) {
+  constexpr std::uint32_t kNumKeys = 100000;
+  TempDir dir;
+  auto path = dir.GetPath() / "table.dat";
+  std::vector<Address> keys(kNumKeys);
+  for (std::uint32_t i = 0; i < kNumKeys; i++) {
+    keys[i][0] = i >> 16;
+    keys[i][1] = i >> 8;
+    keys[i][2] = i;
+  }
+  ASSERT_OK((PerfectHashTable<Address, std::uint32_t>::Build(path, keys)));
+  auto slot_size = sizeof(Address) + sizeof(std::uint32_t);
+  auto overhead = std::filesystem::file_size(path) - kNumKeys * slot_size;
+  // Pilots take 4 bits per key, the extra slots less than 1% of the keys.
+  EXPECT_THAT(overhead * 8 / kNumKeys, Lt(8));
+}
+
+TEST(PerfectHashTableTest, CorruptedFilesAreDetected) {
+  TempDir dir;
+  auto path = dir.GetPath() / "table.dat";
+  std::vector<std::uint32_t> keys = {1, 2, 3};
+  ASSERT_OK(Table::Build(path, keys));
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  EXPECT_THAT(Table::Open(path), StatusIs(absl::StatusCode::kInternal, _));
+}
+
+}  // namespace
+}  // namespace carmen::backend::index
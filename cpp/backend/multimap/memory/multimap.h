@@ -129,7 +129,9 @@ class InMemoryMultiMap {
     return res;
   }
 
-  // For testing only.
+  // Applies the given operation to all key/value pairs in this map, in the
+  // order of their keys. Mainly intended for testing and for transferring the
+  // content of this map into another map.
   template <typename Op>
   void ForEach(const Op& op) const {
     for (auto it = set_.begin(); it != set_.end(); ++it) {
@@ -10,11 +10,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
+#include "backend/common/eviction_policy.h"
 #include "backend/common/file.h"
 #include "backend/common/page.h"
 #include "backend/common/page_pool.h"
@@ -35,9 +41,11 @@ namespace internal {
 // The FileStoreBase is the common bases of file-backed implementations of a
 // mutable key/value store. It provides mutation, lookup, and global state
 // hashing support. Hashing can occur eager (before evicting pages) or lazy,
-// when requesting hash computations.
+// when requesting hash computations. Pages are cached in a page pool using the
+// given eviction policy.
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size = 32, bool eager_hashing = true>
+          std::size_t page_size = 32, bool eager_hashing = true,
+          EvictionPolicy E = LeastRecentlyUsedEvictionPolicy>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>>
 class FileStoreBase;
 
@@ -47,18 +55,20 @@ class FileStoreBase;
 // before pages are evicted, hashes are computed. This slows down reads
 // and updates, but improves hashing speed.
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size = 32>
+          std::size_t page_size = 32,
+          EvictionPolicy E = LeastRecentlyUsedEvictionPolicy>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>>
-using EagerFileStore = internal::FileStoreBase<K, V, F, page_size, true>;
+using EagerFileStore = internal::FileStoreBase<K, V, F, page_size, true, E>;
 
 // A FileStore implementation configured to perform lazy hashing. Thus,
 // pages are evicted without being hashes and need to be reloaded for computing
 // hashes when needed. This speeds up read/write operations at the expense of
 // hash performance.
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size = 32>
+          std::size_t page_size = 32,
+          EvictionPolicy E = LeastRecentlyUsedEvictionPolicy>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>>
-using LazyFileStore = internal::FileStoreBase<K, V, F, page_size, false>;
+using LazyFileStore = internal::FileStoreBase<K, V, F, page_size, false, E>;
 
 // ----------------------------------------------------------------------------
 //                              Definitions
@@ -67,7 +77,7 @@ using LazyFileStore = internal::FileStoreBase<K, V, F, page_size, false>;
 namespace internal {
 
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size, bool eager_hashing>
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>>
 class FileStoreBase {
  public:
@@ -87,6 +97,18 @@ class FileStoreBase {
       Context&, const std::filesystem::path& directory,
       std::size_t hash_branching_factor = 32);
 
+  // A writer filling a new store sequentially. See CreateBulkWriter(..).
+  class BulkWriter;
+
+  // Creates a writer populating a new store in the given directory from
+  // scratch, e.g. during state sync or migration. Instead of passing each
+  // update through the page pool, values are collected in a private buffer
+  // that is written to disk in large sequential chunks, while page hashes are
+  // computed on the fly. The directory must not contain a store yet.
+  static absl::StatusOr<BulkWriter> CreateBulkWriter(
+      Context&, const std::filesystem::path& directory,
+      std::size_t hash_branching_factor = 32);
+
   // Supports instances to be moved.
   FileStoreBase(FileStoreBase&&) = default;
 
@@ -101,6 +123,14 @@ class FileStoreBase {
   // value is returned.
   absl::StatusOr<V> Get(const K& key) const;
 
+  // Returns an upper bound for the keys of all values in this store, being the
+  // number of keys on the pages covered by the store's hash. Enumerating all
+  // keys below this bound may be used to transfer the content of the store,
+  // including its hash, into another store.
+  std::size_t GetKeyBound() const {
+    return hashes_->GetNumPages() * kNumElementsPerPage;
+  }
+
   // Computes a hash over the full content of this store.
   absl::StatusOr<Hash> GetHash() const;
 
@@ -115,7 +145,7 @@ class FileStoreBase {
 
  private:
   using Page = ArrayPage<V, page_size / sizeof(V)>;
-  using Pool = PagePool<F<sizeof(Page)>>;
+  using Pool = PagePool<F<sizeof(Page)>, E>;
 
   // The actual size of a page, which may be larger than the specified page size
   // due to padding.
@@ -135,9 +165,10 @@ class FileStoreBase {
     void BeforeEvict(PageId id, const RawPage<kFilePageSize>& page,
                      bool is_dirty) override {
       // Before we throw away a dirty page to make space for something else we
-      // update the hash to avoid having to reload it again later.
+      // update the hash to avoid having to reload it again later. The hash is
+      // computed in the background to keep it off the eviction path.
       if (eager_hashing && is_dirty) {
-        hashes_.UpdateHash(
+        hashes_.UpdateHashAsync(
             id, std::as_bytes(std::span(page.template As<Page>().AsArray())));
       }
     }
@@ -154,6 +185,9 @@ class FileStoreBase {
 
     absl::StatusOr<std::span<const std::byte>> GetPageData(PageId id) override {
       ASSIGN_OR_RETURN(Page & page, pool_.template Get<Page>(id));
+      // The page is requested for being hashed, so hashing is no longer
+      // pending when evicting it.
+      pool_.SetPendingWork(id, false);
       return std::as_bytes(std::span(page.AsArray()));
     }
 
@@ -187,11 +221,11 @@ class FileStoreBase {
 };
 
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size, bool eager_hashing>
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>>
-    absl::StatusOr<FileStoreBase<K, V, F, page_size, eager_hashing>>
-    FileStoreBase<K, V, F, page_size, eager_hashing>::Open(
-        Context&, const std::filesystem::path& directory,
+    absl::StatusOr<FileStoreBase<K, V, F, page_size, eager_hashing, E>>
+    FileStoreBase<K, V, F, page_size, eager_hashing, E>::Open(
+        Context& context, const std::filesystem::path& directory,
         std::size_t hash_branching_factor) {
   // Make sure the directory exists.
   RETURN_IF_ERROR(CreateDirectory(directory));
@@ -202,13 +236,141 @@ requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>>
   if (std::filesystem::exists(store.hash_file_)) {
     RETURN_IF_ERROR(store.hashes_->LoadFromFile(store.hash_file_));
   }
+  store.pool_->EnableCompressedCache(
+      GetPagePoolOptions(context).compressed_cache_capacity);
   return store;
 }
 
+// A writer filling a new store sequentially, created by CreateBulkWriter(..).
+// Values are collected in a buffer of pages, which is written to the store's
+// file in a single operation whenever a key beyond the buffered range is set.
+// Pages are hashed right before being written, such that the hashes of all
+// pages are known once writing is finished.
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size, bool eager_hashing>
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>>
-FileStoreBase<K, V, F, page_size, eager_hashing>::FileStoreBase(
+class FileStoreBase<K, V, F, page_size, eager_hashing, E>::BulkWriter {
+ public:
+  BulkWriter(BulkWriter&&) = default;
+
+  // Sets the value associated to the given key. Keys must be set in strictly
+  // increasing order. Values of skipped keys are zero-initialized.
+  absl::Status Set(const K& key, V value) {
+    if (key < next_key_) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Keys must be set in increasing order, got %d after %d.", key,
+          next_key_ - 1));
+    }
+    next_key_ = key + 1;
+    PageId page = key / kNumElementsPerPage;
+    if (page >= first_page_ + buffer_.size()) {
+      RETURN_IF_ERROR(WriteBuffer());
+      // Skipped pages are not written but have to be covered by the hash.
+      if (page > num_pages_) {
+        Page zero{};
+        auto hash =
+            carmen::GetHash(hasher_, std::as_bytes(std::span(zero.AsArray())));
+        hashes_.resize(page, hash);
+      }
+      first_page_ = page;
+    }
+    num_pages_ = std::max<std::size_t>(num_pages_, page + 1);
+    buffer_[page - first_page_][key % kNumElementsPerPage] = value;
+    return absl::OkStatus();
+  }
+
+  // Writes all buffered data and the hashes to disk and hands over the
+  // completed store. The writer must not be used afterwards.
+  absl::StatusOr<FileStoreBase> Finish() {
+    RETURN_IF_ERROR(WriteBuffer());
+    RETURN_IF_ERROR(file_->Flush());
+    auto store = FileStoreBase(std::move(file_), directory_ / "hash.dat",
+                               hash_branching_factor_);
+    for (std::size_t i = 0; i < hashes_.size(); i++) {
+      store.hashes_->UpdateHash(i, hashes_[i]);
+    }
+    RETURN_IF_ERROR(store.Flush());
+    return store;
+  }
+
+ private:
+  friend class FileStoreBase;
+
+  // The size of the buffer collecting pages before writing them to disk.
+  constexpr static std::size_t kBufferSize = 1 << 22;  // 4 MiB
+
+  BulkWriter(std::unique_ptr<F<kFilePageSize>> file,
+             std::filesystem::path directory,
+             std::size_t hash_branching_factor)
+      : file_(std::move(file)),
+        directory_(std::move(directory)),
+        hash_branching_factor_(hash_branching_factor),
+        buffer_(std::max<std::size_t>(kBufferSize / kFilePageSize, 1)) {}
+
+  // Hashes and writes all pages set since the last call in a single write
+  // operation, and resets the buffer for being reused.
+  absl::Status WriteBuffer() {
+    if (num_pages_ <= first_page_) {
+      return absl::OkStatus();
+    }
+    auto pages = std::span(buffer_).first(num_pages_ - first_page_);
+    for (const Page& page : pages) {
+      hashes_.push_back(carmen::GetHash(
+          hasher_, std::as_bytes(std::span(page.AsArray()))));
+    }
+    RETURN_IF_ERROR(StorePages(*file_, first_page_, std::as_bytes(pages)));
+    std::memset(pages.data(), 0, pages.size_bytes());
+    first_page_ = num_pages_;
+    return absl::OkStatus();
+  }
+
+  // The file the pages of the new store are written to.
+  std::unique_ptr<F<kFilePageSize>> file_;
+
+  // The directory of the new store.
+  std::filesystem::path directory_;
+
+  // The branching factor of the hash tree of the new store.
+  std::size_t hash_branching_factor_;
+
+  // Buffered pages, starting with the page with ID first_page_.
+  std::vector<Page> buffer_;
+  PageId first_page_ = 0;
+
+  // The number of pages covered by keys set so far.
+  std::size_t num_pages_ = 0;
+
+  // The smallest key that may be set next.
+  std::size_t next_key_ = 0;
+
+  // The hashes of all written and skipped pages.
+  std::vector<Hash> hashes_;
+  Sha256Hasher hasher_;
+};
+
+template <typename K, Trivial V, template <std::size_t> class F,
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
+requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>>
+    absl::StatusOr<typename FileStoreBase<K, V, F, page_size, eager_hashing,
+                                          E>::BulkWriter>
+    FileStoreBase<K, V, F, page_size, eager_hashing, E>::CreateBulkWriter(
+        Context&, const std::filesystem::path& directory,
+        std::size_t hash_branching_factor) {
+  RETURN_IF_ERROR(CreateDirectory(directory));
+  ASSIGN_OR_RETURN(auto file, F<kFilePageSize>::Open(directory / "data.dat"));
+  if (file.GetNumPages() > 0 ||
+      std::filesystem::exists(directory / "hash.dat")) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Unable to bulk write into existing store in %s", directory.string()));
+  }
+  return BulkWriter(std::make_unique<F<kFilePageSize>>(std::move(file)),
+                    directory, hash_branching_factor);
+}
+
+template <typename K, Trivial V, template <std::size_t> class F,
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
+requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>>
+FileStoreBase<K, V, F, page_size, eager_hashing, E>::FileStoreBase(
     std::unique_ptr<F<kFilePageSize>> file, std::filesystem::path hash_file,
     std::size_t hash_branching_factor)
     : num_pages_(file->GetNumPages()),
@@ -220,9 +382,10 @@ FileStoreBase<K, V, F, page_size, eager_hashing>::FileStoreBase(
 }
 
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size, bool eager_hashing>
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>> absl::Status
-FileStoreBase<K, V, F, page_size, eager_hashing>::Set(const K& key, V value) {
+FileStoreBase<K, V, F, page_size, eager_hashing, E>::Set(const K& key,
+                                                          V value) {
   num_pages_ = std::max(num_pages_, key / kNumElementsPerPage + 1);
   ASSIGN_OR_RETURN(Page & page,
                    pool_->template Get<Page>(key / kNumElementsPerPage));
@@ -231,14 +394,17 @@ FileStoreBase<K, V, F, page_size, eager_hashing>::Set(const K& key, V value) {
     trg = value;
     pool_->MarkAsDirty(key / kNumElementsPerPage);
     hashes_->MarkDirty(key / kNumElementsPerPage);
+    if constexpr (eager_hashing) {
+      pool_->SetPendingWork(key / kNumElementsPerPage, true);
+    }
   }
   return absl::OkStatus();
 }
 
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size, bool eager_hashing>
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>> absl::StatusOr<V>
-FileStoreBase<K, V, F, page_size, eager_hashing>::Get(const K& key)
+FileStoreBase<K, V, F, page_size, eager_hashing, E>::Get(const K& key)
 const {
   static const V kDefault{};
   auto page_id = key / kNumElementsPerPage;
@@ -251,16 +417,16 @@ const {
 }
 
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size, bool eager_hashing>
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>>
     absl::StatusOr<Hash>
-    FileStoreBase<K, V, F, page_size, eager_hashing>::GetHash()
+    FileStoreBase<K, V, F, page_size, eager_hashing, E>::GetHash()
 const { return hashes_->GetHash(); }
 
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size, bool eager_hashing>
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>> absl::Status
-FileStoreBase<K, V, F, page_size, eager_hashing>::Flush() {
+FileStoreBase<K, V, F, page_size, eager_hashing, E>::Flush() {
   if (pool_) {
     RETURN_IF_ERROR(pool_->Flush());
   }
@@ -271,9 +437,9 @@ FileStoreBase<K, V, F, page_size, eager_hashing>::Flush() {
 }
 
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size, bool eager_hashing>
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>> absl::Status
-FileStoreBase<K, V, F, page_size, eager_hashing>::Close() {
+FileStoreBase<K, V, F, page_size, eager_hashing, E>::Close() {
   RETURN_IF_ERROR(Flush());
   if (pool_) {
     RETURN_IF_ERROR(pool_->Close());
@@ -282,9 +448,9 @@ FileStoreBase<K, V, F, page_size, eager_hashing>::Close() {
 }
 
 template <typename K, Trivial V, template <std::size_t> class F,
-          std::size_t page_size, bool eager_hashing>
+          std::size_t page_size, bool eager_hashing, EvictionPolicy E>
 requires File<F<sizeof(ArrayPage<V, page_size / sizeof(V)>)>> MemoryFootprint
-FileStoreBase<K, V, F, page_size, eager_hashing>::GetMemoryFootprint()
+FileStoreBase<K, V, F, page_size, eager_hashing, E>::GetMemoryFootprint()
 const {
   MemoryFootprint res(*this);
   res.Add("pool", pool_->GetMemoryFootprint());
@@ -10,7 +10,12 @@
 
 #include "backend/store/file/store.h"
 
+#include <sstream>
+#include <vector>
+
+#include "backend/common/eviction_policy.h"
 #include "backend/common/file.h"
+#include "backend/common/striped_file.h"
 #include "backend/store/store_test_suite.h"
 #include "backend/structure.h"
 #include "common/file_util.h"
@@ -21,7 +26,11 @@
 namespace carmen::backend::store {
 namespace {
 
+using ::testing::_;
+using ::testing::HasSubstr;
 using ::testing::IsOkAndHolds;
+using ::testing::Not;
+using ::testing::StatusIs;
 
 template <typename K, typename V, std::size_t ps>
 using EagerInMemoryFileStore = EagerFileStore<K, V, InMemoryFile, ps>;
@@ -32,15 +41,25 @@ using EagerSingleFileStore = EagerFileStore<K, V, SingleFile, ps>;
 template <typename K, typename V, std::size_t ps>
 using LazySingleFileStore = LazyFileStore<K, V, SingleFile, ps>;
 
+template <typename K, typename V, std::size_t ps>
+using EagerLeastCostlySingleFileStore =
+    EagerFileStore<K, V, SingleFile, ps, LeastCostlyEvictionPolicy>;
+
+template <typename K, typename V, std::size_t ps>
+using EagerStripedFileStore = EagerFileStore<K, V, StripedFile, ps>;
+
 using StoreTypes = ::testing::Types<
     // Page size 32, branching size 32.
     StoreTestConfig<EagerInMemoryFileStore, 32, 32>,
     StoreTestConfig<EagerSingleFileStore, 32, 32>,
     StoreTestConfig<LazySingleFileStore, 32, 32>,
+    StoreTestConfig<EagerLeastCostlySingleFileStore, 32, 32>,
+    StoreTestConfig<EagerStripedFileStore, 32, 32>,
     // Page size 64, branching size 3.
     StoreTestConfig<EagerInMemoryFileStore, 64, 3>,
     StoreTestConfig<EagerSingleFileStore, 64, 3>,
     StoreTestConfig<LazySingleFileStore, 64, 3>,
+    StoreTestConfig<EagerLeastCostlySingleFileStore, 64, 3>,
     // Page size 64, branching size 8.
     StoreTestConfig<EagerInMemoryFileStore, 64, 8>,
     StoreTestConfig<EagerSingleFileStore, 64, 8>,
@@ -80,10 +99,104 @@ TYPED_TEST_P(FileStoreTest, StoreCanBeSavedAndRestored) {
   }
 }
 
-REGISTER_TYPED_TEST_SUITE_P(FileStoreTest, StoreCanBeSavedAndRestored);
+TYPED_TEST_P(FileStoreTest, BulkWrittenStoreMatchesIncrementallyFilledStore) {
+  using Store = TypeParam;
+  // Keys are spread to cover several buffer flushes and to leave gaps, some
+  // of them spanning full pages.
+  std::vector<int> keys;
+  for (int i = 0; i < 20000; i++) {
+    keys.push_back(i * 3);
+  }
+  keys.push_back(200000);
+  keys.push_back(200001);
+
+  TempDir incremental_dir;
+  TempDir bulk_dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto incremental,
+                       Store::Open(ctx, incremental_dir.GetPath()));
+  for (int key : keys) {
+    ASSERT_OK(incremental.Set(key, key + 1));
+  }
+  ASSERT_OK_AND_ASSIGN(auto hash, incremental.GetHash());
+  {
+    ASSERT_OK_AND_ASSIGN(auto writer,
+                         Store::CreateBulkWriter(ctx, bulk_dir.GetPath()));
+    for (int key : keys) {
+      ASSERT_OK(writer.Set(key, key + 1));
+    }
+    ASSERT_OK_AND_ASSIGN(auto store, writer.Finish());
+    EXPECT_THAT(store.GetHash(), IsOkAndHolds(hash));
+    for (int i = 0; i <= keys.back() + 1; i += 7) {
+      ASSERT_OK_AND_ASSIGN(auto value, incremental.Get(i));
+      EXPECT_THAT(store.Get(i), IsOkAndHolds(value));
+    }
+  }
+  ASSERT_OK_AND_ASSIGN(auto restored, Store::Open(ctx, bulk_dir.GetPath()));
+  EXPECT_THAT(restored.GetHash(), IsOkAndHolds(hash));
+  for (int key : keys) {
+    EXPECT_THAT(restored.Get(key), IsOkAndHolds(key + 1));
+  }
+}
+
+TYPED_TEST_P(FileStoreTest, BulkWriterRequiresIncreasingKeys) {
+  using Store = TypeParam;
+  TempDir dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto writer,
+                       Store::CreateBulkWriter(ctx, dir.GetPath()));
+  ASSERT_OK(writer.Set(5, 1));
+  EXPECT_THAT(writer.Set(5, 2),
+              StatusIs(absl::StatusCode::kInvalidArgument, _));
+  EXPECT_THAT(writer.Set(4, 2),
+              StatusIs(absl::StatusCode::kInvalidArgument, _));
+  ASSERT_OK(writer.Set(6, 2));
+  ASSERT_OK_AND_ASSIGN(auto store, writer.Finish());
+  EXPECT_THAT(store.Get(5), IsOkAndHolds(1));
+  EXPECT_THAT(store.Get(6), IsOkAndHolds(2));
+}
+
+TYPED_TEST_P(FileStoreTest, BulkWriterRequiresEmptyDirectory) {
+  using Store = TypeParam;
+  TempDir dir;
+  Context ctx;
+  {
+    ASSERT_OK_AND_ASSIGN(auto store, Store::Open(ctx, dir.GetPath()));
+    ASSERT_OK(store.Set(1, 2));
+  }
+  EXPECT_THAT(Store::CreateBulkWriter(ctx, dir.GetPath()),
+              StatusIs(absl::StatusCode::kFailedPrecondition, _));
+}
+
+TYPED_TEST_P(FileStoreTest, CompressedCacheIsEnabledByContext) {
+  using Store = TypeParam;
+  TempDir dir;
+  {
+    Context ctx;
+    ASSERT_OK_AND_ASSIGN(auto store, Store::Open(ctx, dir.GetPath() / "a"));
+    std::stringstream out;
+    out << store.GetMemoryFootprint();
+    EXPECT_THAT(out.str(), Not(HasSubstr("compressed_cache")));
+  }
+  {
+    Context ctx;
+    ctx.RegisterComponent(PagePoolOptions{.compressed_cache_capacity = 1024});
+    ASSERT_OK_AND_ASSIGN(auto store, Store::Open(ctx, dir.GetPath() / "b"));
+    std::stringstream out;
+    out << store.GetMemoryFootprint();
+    EXPECT_THAT(out.str(), HasSubstr("compressed_cache"));
+  }
+}
+
+REGISTER_TYPED_TEST_SUITE_P(FileStoreTest, StoreCanBeSavedAndRestored,
+                            BulkWrittenStoreMatchesIncrementallyFilledStore,
+                            BulkWriterRequiresIncreasingKeys,
+                            BulkWriterRequiresEmptyDirectory,
+                            CompressedCacheIsEnabledByContext);
 
-using FileStoreVariants = ::testing::Types<EagerFileStore<int, int, SingleFile>,
-                                           LazyFileStore<int, int, SingleFile>>;
+using FileStoreVariants = ::testing::Types<
+    EagerFileStore<int, int, SingleFile>, LazyFileStore<int, int, SingleFile>,
+    EagerFileStore<int, int, SingleFile, 32, LeastCostlyEvictionPolicy>>;
 
 INSTANTIATE_TYPED_TEST_SUITE_P(FileStoreTests, FileStoreTest,
                                FileStoreVariants);
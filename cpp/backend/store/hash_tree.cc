@@ -11,13 +11,19 @@
 #include "backend/store/hash_tree.h"
 
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <span>
 #include <sstream>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
 #include "backend/common/leveldb/leveldb.h"
 #include "backend/common/page_id.h"
 #include "common/byte_util.h"
@@ -29,6 +35,114 @@
 
 namespace carmen::backend::store {
 
+// The AsyncHasher hashes staged copies of pages on a single worker thread.
+// The number of staged pages is bounded; if the worker falls behind, new
+// submissions block until a slot becomes available. Staging buffers are
+// recycled to avoid memory allocations on the submission path.
+class HashTree::AsyncHasher {
+ public:
+  // The maximum number of pages staged or being hashed at any time.
+  constexpr static std::size_t kMaxStagedPages = 16;
+
+  // The hash of a page computed by the worker.
+  struct Result {
+    PageId id;
+    std::uint64_t ticket;
+    Hash hash;
+  };
+
+  AsyncHasher() : worker_([this] { Run(); }) {}
+
+  ~AsyncHasher() {
+    {
+      absl::MutexLock lock(&mutex_);
+      stop_ = true;
+    }
+    worker_.join();
+  }
+
+  // Copies the given page into a staging buffer and schedules its hashing.
+  void Submit(PageId id, std::uint64_t ticket,
+              std::span<const std::byte> page) {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &AsyncHasher::HasCapacity));
+    std::vector<std::byte> buffer;
+    if (!free_buffers_.empty()) {
+      buffer = std::move(free_buffers_.back());
+      free_buffers_.pop_back();
+    }
+    buffer.assign(page.begin(), page.end());
+    queue_.push_back({id, ticket, std::move(buffer)});
+  }
+
+  // Retrieves the results computed so far. If `wait` is set, all submitted
+  // pages are hashed before returning.
+  std::vector<Result> TakeResults(bool wait) {
+    absl::MutexLock lock(&mutex_);
+    if (wait) {
+      mutex_.Await(absl::Condition(this, &AsyncHasher::IsIdle));
+    }
+    return std::exchange(results_, {});
+  }
+
+ private:
+  // A page staged for hashing.
+  struct Task {
+    PageId id;
+    std::uint64_t ticket;
+    std::vector<std::byte> data;
+  };
+
+  bool HasCapacity() const {
+    return queue_.size() + num_busy_ < kMaxStagedPages;
+  }
+
+  bool IsIdle() const { return queue_.empty() && num_busy_ == 0; }
+
+  bool HasWorkOrStop() const { return stop_ || !queue_.empty(); }
+
+  // The main loop of the worker thread.
+  void Run() {
+    Sha256Hasher hasher;
+    mutex_.Lock();
+    while (true) {
+      mutex_.Await(absl::Condition(this, &AsyncHasher::HasWorkOrStop));
+      if (stop_) {
+        break;
+      }
+      Task task = std::move(queue_.front());
+      queue_.pop_front();
+      num_busy_ = 1;
+      mutex_.Unlock();
+
+      auto hash = carmen::GetHash(hasher, std::span(task.data));
+
+      mutex_.Lock();
+      num_busy_ = 0;
+      results_.push_back({task.id, task.ticket, hash});
+      free_buffers_.push_back(std::move(task.data));
+    }
+    mutex_.Unlock();
+  }
+
+  absl::Mutex mutex_;
+  std::deque<Task> queue_;
+  std::vector<Result> results_;
+  std::vector<std::vector<std::byte>> free_buffers_;
+  std::size_t num_busy_ = 0;
+  bool stop_ = false;
+
+  // The worker is started last, after all other fields are initialized.
+  std::thread worker_;
+};
+
+HashTree::HashTree(std::unique_ptr<PageSource> source, int branching_factor)
+    : branching_factor_(branching_factor), page_source_(std::move(source)) {}
+
+HashTree::HashTree(HashTree&&) = default;
+
+HashTree::~HashTree() = default;
+
 void HashTree::RegisterPage(PageId id) {
   // Make sure the data structure is aware of the existence of this page.
   TrackNumPages(id);
@@ -43,14 +157,57 @@ void HashTree::UpdateHash(PageId id, const Hash& hash) {
   GetMutableHash(0, id) = hash;
   dirty_pages_.erase(id);
   dirty_level_one_positions_.insert(id / branching_factor_);
+  if (!pending_hashes_.empty()) {
+    pending_hashes_.erase(id);
+  }
+}
+
+void HashTree::UpdateHashAsync(PageId id, std::span<const std::byte> page) {
+  // Without a second core to run the worker on, background hashing only adds
+  // the costs of handing over pages between threads.
+  static const bool kHasIdleCore = std::thread::hardware_concurrency() > 1;
+  if (!kHasIdleCore) {
+    UpdateHash(id, page);
+    return;
+  }
+  TrackNumPages(id);
+  if (async_hasher_ == nullptr) {
+    async_hasher_ = std::make_unique<AsyncHasher>();
+  }
+  // Consume available results to keep the list of results short.
+  ApplyAsyncHashes(/*wait=*/false);
+  auto ticket = next_ticket_++;
+  pending_hashes_[id] = ticket;
+  async_hasher_->Submit(id, ticket, page);
+}
+
+void HashTree::ApplyAsyncHashes(bool wait) {
+  if (async_hasher_ == nullptr) {
+    return;
+  }
+  for (const auto& result : async_hasher_->TakeResults(wait)) {
+    // Results of pages modified after the hash was requested are outdated.
+    auto pos = pending_hashes_.find(result.id);
+    if (pos == pending_hashes_.end() || pos->second != result.ticket) {
+      continue;
+    }
+    pending_hashes_.erase(pos);
+    UpdateHash(result.id, result.hash);
+  }
 }
 
 void HashTree::MarkDirty(PageId page) {
   TrackNumPages(page);
   dirty_pages_.insert(page);
+  if (!pending_hashes_.empty()) {
+    pending_hashes_.erase(page);
+  }
 }
 
 absl::StatusOr<Hash> HashTree::GetHash() {
+  // Integrate all hashes still computed in the background.
+  ApplyAsyncHashes(/*wait=*/true);
+
   // If there are no pages, the full hash is zero by definition.
   if (num_pages_ == 0) {
     return Hash{};
@@ -165,6 +322,9 @@ absl::Status HashTree::SaveToFile(const std::filesystem::path& file) {
 }
 
 absl::Status HashTree::LoadFromFile(const std::filesystem::path& file) {
+  // Pending background hashes refer to the content about to be discarded.
+  ApplyAsyncHashes(/*wait=*/true);
+
   ASSIGN_OR_RETURN(auto in,
                    FStream::Open(file, std::ios::binary | std::ios::in));
 
@@ -261,6 +421,9 @@ absl::Status HashTree::SaveToLevelDb(const std::filesystem::path& file) {
 }
 
 absl::Status HashTree::LoadFromLevelDb(const LevelDb& leveldb) {
+  // Pending background hashes refer to the content about to be discarded.
+  ApplyAsyncHashes(/*wait=*/true);
+
   // Load the branching factor.
   ASSIGN_OR_RETURN(auto result, leveldb.Get("ht_branching_factor"));
   ASSIGN_OR_RETURN(auto branching_factor,
@@ -324,6 +487,7 @@ MemoryFootprint HashTree::GetMemoryFootprint() const {
   res.Add("hashes", std::move(hashsize));
   res.Add("dirty_pages", SizeOf(dirty_pages_));
   res.Add("dirty_level_one_positions", SizeOf(dirty_level_one_positions_));
+  res.Add("pending_hashes", SizeOf(pending_hashes_));
   return res;
 }
 
@@ -11,9 +11,13 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <span>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -46,8 +50,10 @@ class HashTree {
   // computation of an aggregated hash over all pages. A value of 32 implies
   // that 32 hashes of one level are combined into a single hash on the next
   // level. The first level with a single hash defines the overall hash.
-  HashTree(std::unique_ptr<PageSource> source, int branching_factor = 32)
-      : branching_factor_(branching_factor), page_source_(std::move(source)) {}
+  HashTree(std::unique_ptr<PageSource> source, int branching_factor = 32);
+
+  HashTree(HashTree&&);
+  ~HashTree();
 
   // Informs the HashTree about the existence of the given page. This may lead
   // to and adaptation of the internal hash data structures and dirty pages.
@@ -65,13 +71,28 @@ class HashTree {
   // during page eviction).
   void UpdateHash(PageId id, std::span<const std::byte> page);
 
+  // A variant of the function above, where the hash of the page is computed by
+  // a background worker. The page data is copied into a staging buffer, so the
+  // given memory may be reused as soon as the call returns. Results are
+  // integrated before the next global hash is computed; a result is discarded
+  // if the page is marked dirty or updated again in the meantime. Use this
+  // variant where the latency of the hash computation matters, e.g. when
+  // evicting pages while serving a read or write request. On single-core
+  // systems the hash is computed synchronously.
+  void UpdateHashAsync(PageId id, std::span<const std::byte> page);
+
   // Marks the given page as being modified. Consequently, the page's hash will
   // have to be recomputed the next time a global hash is requested.
   void MarkDirty(PageId page);
 
+  // Returns the number of pages covered by this tree, which is one more than
+  // the highest ID of all pages registered so far.
+  std::size_t GetNumPages() const { return num_pages_; }
+
   // Computes a global hash for all pages managed by this HashTree. It will
-  // update outdated partial hashes cached internally, which may imply the need
-  // for fetching dirty pages.
+  // wait for hashes still computed in the background and update outdated
+  // partial hashes cached internally, which may imply the need for fetching
+  // dirty pages.
   absl::StatusOr<Hash> GetHash();
 
   // Saves the hashes of this tree into the given file. Before saving them, all
@@ -108,6 +129,14 @@ class HashTree {
   MemoryFootprint GetMemoryFootprint() const;
 
  private:
+  // A background worker computing hashes scheduled by UpdateHashAsync.
+  class AsyncHasher;
+
+  // Integrates the results of hashes computed in the background into the tree.
+  // If `wait` is set, all scheduled hashes are awaited, otherwise only results
+  // already available are consumed.
+  void ApplyAsyncHashes(bool wait);
+
   // Fetches the hashes of a given layer of the reduction tree. If the layer
   // does not exist, it is created.
   std::vector<Hash>& GetHashes(std::size_t level);
@@ -130,6 +159,14 @@ class HashTree {
   std::unique_ptr<PageSource> page_source_;
   absl::flat_hash_set<PageId> dirty_pages_;
   absl::flat_hash_set<int> dirty_level_one_positions_;
+
+  // The worker for asynchronous hash computations, created on first use.
+  std::unique_ptr<AsyncHasher> async_hasher_;
+
+  // Maps pages with a hash computation in flight to the ticket of the most
+  // recent request. Results with other tickets are outdated and discarded.
+  absl::flat_hash_map<PageId, std::uint64_t> pending_hashes_;
+  std::uint64_t next_ticket_ = 0;
 };
 
 }  // namespace carmen::backend::store
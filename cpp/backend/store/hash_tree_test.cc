@@ -187,6 +187,95 @@ TEST(HashTreeTest, UpdateingHashesOfDirtyPagesResetsDirtyFlag) {
   ASSERT_OK(tree.GetHash());
 }
 
+TEST(HashTreeTest, AsyncHashesAreEquivalentToSynchronousHashes) {
+  HashTree sync(std::make_unique<MockPageSource>());
+  HashTree async(std::make_unique<MockPageSource>());
+
+  for (int i = 0; i < 100; i++) {
+    auto value = std::array{std::byte(i), std::byte(i + 1)};
+    sync.UpdateHash(i, value);
+    async.UpdateHashAsync(i, value);
+  }
+  ASSERT_OK_AND_ASSIGN(auto should, sync.GetHash());
+  EXPECT_THAT(async.GetHash(), IsOkAndHolds(should));
+}
+
+TEST(HashTreeTest, AsyncHashesOperateOnACopyOfThePage) {
+  HashTree sync(std::make_unique<MockPageSource>());
+  HashTree async(std::make_unique<MockPageSource>());
+
+  auto value = std::array{std::byte{0x01}, std::byte{0x02}};
+  sync.UpdateHash(0, value);
+  async.UpdateHashAsync(0, value);
+  value[0] = std::byte{0x03};
+
+  ASSERT_OK_AND_ASSIGN(auto should, sync.GetHash());
+  EXPECT_THAT(async.GetHash(), IsOkAndHolds(should));
+}
+
+TEST(HashTreeTest, AsyncHashesResetDirtyFlag) {
+  auto source = std::make_unique<MockPageSource>();
+  auto& mock = *source.get();
+  HashTree tree(std::move(source));
+
+  auto value = std::array{std::byte{0x01}, std::byte{0x02}};
+
+  EXPECT_CALL(mock, GetPageData(0)).Times(0);
+  tree.MarkDirty(0);
+  tree.UpdateHashAsync(0, value);
+  ASSERT_OK(tree.GetHash());
+}
+
+TEST(HashTreeTest, PagesMarkedDirtyAfterAsyncHashesAreFetched) {
+  auto source = std::make_unique<MockPageSource>();
+  auto& mock = *source.get();
+  HashTree tree(std::move(source));
+
+  auto old_value = std::array{std::byte{0x01}, std::byte{0x02}};
+  auto new_value = std::array{std::byte{0x03}, std::byte{0x04}};
+
+  EXPECT_CALL(mock, GetPageData(0))
+      .WillOnce(Return(absl::StatusOr<std::span<const std::byte>>(new_value)));
+  tree.UpdateHashAsync(0, old_value);
+  tree.MarkDirty(0);
+  EXPECT_THAT(tree.GetHash(), IsOkAndHolds(GetSha256Hash(
+                                  std::span<const std::byte>(new_value))));
+}
+
+TEST(HashTreeTest, LatestAsyncHashOfAPageWins) {
+  HashTree tree(std::make_unique<MockPageSource>());
+
+  auto old_value = std::array{std::byte{0x01}, std::byte{0x02}};
+  auto new_value = std::array{std::byte{0x03}, std::byte{0x04}};
+
+  tree.UpdateHashAsync(0, old_value);
+  tree.UpdateHashAsync(0, new_value);
+  EXPECT_THAT(tree.GetHash(), IsOkAndHolds(GetSha256Hash(
+                                  std::span<const std::byte>(new_value))));
+
+  tree.UpdateHashAsync(0, old_value);
+  tree.UpdateHash(0, Hash{});
+  EXPECT_THAT(tree.GetHash(), IsOkAndHolds(Hash{}));
+}
+
+TEST(HashTreeTest, AsyncHashesAreIncludedWhenSaving) {
+  TempFile file;
+  auto value = std::array{std::byte{0x01}, std::byte{0x02}};
+  Hash hash;
+  {
+    HashTree tree(std::make_unique<MockPageSource>());
+    tree.UpdateHashAsync(0, value);
+    ASSERT_OK(tree.SaveToFile(file));
+    ASSERT_OK_AND_ASSIGN(hash, tree.GetHash());
+  }
+  EXPECT_EQ(hash, GetSha256Hash(std::span<const std::byte>(value)));
+  {
+    HashTree tree(std::make_unique<MockPageSource>());
+    ASSERT_OK(tree.LoadFromFile(file));
+    EXPECT_THAT(tree.GetHash(), IsOkAndHolds(hash));
+  }
+}
+
 TEST(HashTreeTest, RegistrationLeadsToTheIdentificationOfMissingPages) {
   auto source = std::make_unique<MockPageSource>();
   auto& mock = *source.get();
@@ -210,6 +299,18 @@ TEST(HashTreeTest, RegistrationLeadsToTheIdentificationOfMissingPages) {
   ASSERT_OK(tree.GetHash());
 }
 
+TEST(HashTreeTest, NumberOfPagesCoversHighestRegisteredPage) {
+  auto source = std::make_unique<MockPageSource>();
+  HashTree tree(std::move(source));
+  EXPECT_EQ(tree.GetNumPages(), 0);
+  tree.RegisterPage(3);
+  EXPECT_EQ(tree.GetNumPages(), 4);
+  tree.MarkDirty(1);
+  EXPECT_EQ(tree.GetNumPages(), 4);
+  tree.UpdateHash(7, Hash{});
+  EXPECT_EQ(tree.GetNumPages(), 8);
+}
+
 TEST(HashTreeTest, MissingPagesAreFetched) {
   auto source = std::make_unique<MockPageSource>();
   auto& mock = *source.get();
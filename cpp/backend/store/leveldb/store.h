@@ -86,6 +86,12 @@ class LevelDbStore {
     return result;
   }
 
+  // Returns an upper bound for the keys of all values in this store. It covers
+  // all pages tracked for hashing, which includes all pages with values.
+  std::size_t GetKeyBound() const {
+    return hashes_.GetNumPages() * elements_per_page;
+  }
+
   // Computes a hash over the full content of this store.
   absl::StatusOr<Hash> GetHash() const { return hashes_.GetHash(); }
 
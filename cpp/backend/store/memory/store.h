@@ -19,12 +19,16 @@
 #include <type_traits>
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "backend/common/file.h"
 #include "backend/store/hash_tree.h"
 #include "backend/store/store.h"
+#include "common/fstream.h"
 #include "common/hash.h"
 #include "common/memory_usage.h"
+#include "common/status_util.h"
 #include "common/type.h"
 
 namespace carmen::backend::store {
@@ -33,6 +37,11 @@ namespace carmen::backend::store {
 // store. It maps provided mutation and lookup support, as well as global
 // state hashing support enabling to obtain a quick hash for the entire
 // content.
+//
+// If opened for a directory, the content of the store is written to this
+// directory on Flush and restored by the next Open call. Only pages modified
+// since the last flush are written, such that the cost of a flush is
+// proportional to the number of modified pages.
 template <typename K, Trivial V, std::size_t page_size = 32>
 class InMemoryStore {
  public:
@@ -45,11 +54,15 @@ class InMemoryStore {
   // The page size in byte used by this store.
   constexpr static std::size_t kPageSize = page_size;
 
-  // A factory function creating an instance of this store type.
+  // A factory function creating an instance of this store type. If the given
+  // directory contains data of a previous flush, this data is restored.
   static absl::StatusOr<InMemoryStore> Open(
-      Context&, const std::filesystem::path&,
+      Context&, const std::filesystem::path& directory,
       std::size_t hash_branching_factor = 32) {
-    return InMemoryStore(hash_branching_factor);
+    InMemoryStore store(hash_branching_factor);
+    store.directory_ = directory;
+    RETURN_IF_ERROR(store.Load());
+    return store;
   }
 
   // Creates a new InMemoryStore using the provided value as the
@@ -75,6 +88,9 @@ class InMemoryStore {
     }
     (*pages_)[page_number][key % elements_per_page] = value;
     hashes_.MarkDirty(page_number);
+    if (page_number < num_flushed_pages_) {
+      modified_pages_.insert(page_number);
+    }
     return absl::OkStatus();
   }
 
@@ -90,6 +106,12 @@ class InMemoryStore {
     return (*pages_)[page_number][key % elements_per_page];
   }
 
+  // Returns an upper bound for the keys of all values in this store, covering
+  // all pages included in the store's hash.
+  std::size_t GetKeyBound() const {
+    return hashes_.GetNumPages() * elements_per_page;
+  }
+
   // Creates a snapshot of the data maintained in this store. Snapshots may be
   // used to transfer state information between instances without the need of
   // blocking other operations on the store.
@@ -100,11 +122,12 @@ class InMemoryStore {
   // Computes a hash over the full content of this store.
   absl::StatusOr<Hash> GetHash() const;
 
-  // Ignored, since store is not backed by disk storage.
-  absl::Status Flush() { return absl::OkStatus(); }
+  // Writes the content of this store to disk, if this store is backed by a
+  // directory.
+  absl::Status Flush();
 
-  // Ignored, since store does not maintain any resources.
-  absl::Status Close() { return absl::OkStatus(); }
+  // Flushes the content of this store and releases resources.
+  absl::Status Close() { return Flush(); }
 
   // Summarizes the memory usage of this instance.
   MemoryFootprint GetMemoryFootprint() const {
@@ -183,12 +206,25 @@ class InMemoryStore {
     Pages& pages_;
   };
 
+  // Loads the content of a previous flush from the directory of this store.
+  absl::Status Load();
+
   // An indexed list of pages containing the actual values. The container is
   // wrapped in a unique pointer to facilitate pointer stability under move.
   std::unique_ptr<Pages> pages_;
 
   // The data structure managing the hashing of states.
   mutable HashTree hashes_;
+
+  // The directory the content of this store is flushed to. Empty if this store
+  // is not backed by a directory.
+  std::filesystem::path directory_;
+
+  // The number of pages written to the directory by the last flush.
+  std::size_t num_flushed_pages_ = 0;
+
+  // Pages written by the last flush which have been modified since.
+  absl::flat_hash_set<std::size_t> modified_pages_;
 };
 
 template <typename K, Trivial V, std::size_t page_size>
@@ -219,4 +255,64 @@ std::unique_ptr<StoreSnapshot> InMemoryStore<K, V, page_size>::CreateSnapshot()
   return std::make_unique<DeepSnapshot>(*pages_);
 }
 
+template <typename K, Trivial V, std::size_t page_size>
+absl::Status InMemoryStore<K, V, page_size>::Flush() {
+  if (directory_.empty() ||
+      (num_flushed_pages_ == pages_->size() && modified_pages_.empty() &&
+       std::filesystem::exists(directory_ / "data.dat"))) {
+    return absl::OkStatus();
+  }
+  RETURN_IF_ERROR(CreateDirectory(directory_));
+
+  // The pages are stored in data.dat, prefixed by their number, while hashes
+  // are stored in hash.dat using the format of the HashTree. New and modified
+  // pages are written in place before the number of pages is updated, such
+  // that an interrupted flush never leaves a truncated data file.
+  {
+    auto mode = std::ios::binary | std::ios::out;
+    if (num_flushed_pages_ > 0) {
+      mode |= std::ios::in;  // < prevents truncation
+    }
+    ASSIGN_OR_RETURN(auto out, FStream::Open(directory_ / "data.dat", mode));
+    const Pages& pages = *pages_;
+    const auto get_offset = [](std::size_t page) {
+      return sizeof(std::uint64_t) + page * sizeof(Page);
+    };
+    for (std::size_t page : modified_pages_) {
+      RETURN_IF_ERROR(out.Seekp(get_offset(page)));
+      RETURN_IF_ERROR(out.Write(pages[page].AsBytes()));
+    }
+    RETURN_IF_ERROR(out.Seekp(get_offset(num_flushed_pages_)));
+    for (std::size_t i = num_flushed_pages_; i < pages.size(); i++) {
+      RETURN_IF_ERROR(out.Write(pages[i].AsBytes()));
+    }
+    std::uint64_t num_pages = pages_->size();
+    RETURN_IF_ERROR(out.Seekp(0));
+    RETURN_IF_ERROR(out.Write(num_pages));
+    RETURN_IF_ERROR(out.Close());
+  }
+  num_flushed_pages_ = pages_->size();
+  modified_pages_.clear();
+  return hashes_.SaveToFile(directory_ / "hash.dat");
+}
+
+template <typename K, Trivial V, std::size_t page_size>
+absl::Status InMemoryStore<K, V, page_size>::Load() {
+  auto data_file = directory_ / "data.dat";
+  if (directory_.empty() || !std::filesystem::exists(data_file)) {
+    return absl::OkStatus();
+  }
+  ASSIGN_OR_RETURN(auto in,
+                   FStream::Open(data_file, std::ios::binary | std::ios::in));
+  std::uint64_t num_pages;
+  RETURN_IF_ERROR(in.Read(num_pages));
+  pages_->resize(num_pages);
+  for (auto& page : *pages_) {
+    RETURN_IF_ERROR(in.Read(page.AsBytes()));
+  }
+  RETURN_IF_ERROR(in.Close());
+  num_flushed_pages_ = num_pages;
+  return hashes_.LoadFromFile(directory_ / "hash.dat");
+}
+
 }  // namespace carmen::backend::store
@@ -97,5 +97,70 @@ TEST(InMemoryStoreTest, LargeSnapshotRecoveryWorks) {
   EXPECT_THAT(restored.GetHash(), IsOkAndHolds(hash));
 }
 
+TEST(InMemoryStoreTest, FlushedStoreCanBeRestored) {
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto store, Store::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_OK(store.Set(i, i + 10));
+    }
+    ASSERT_OK_AND_ASSIGN(hash, store.GetHash());
+    ASSERT_OK(store.Close());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto store, Store::Open(ctx, dir.GetPath()));
+    for (int i = 0; i < 1000; i++) {
+      EXPECT_THAT(store.Get(i), IsOkAndHolds(i + 10));
+    }
+    EXPECT_THAT(store.GetHash(), IsOkAndHolds(hash));
+  }
+}
+
+TEST(InMemoryStoreTest, UpdatesAfterLastFlushAreLost) {
+  TempDir dir;
+  Context ctx;
+  {
+    ASSERT_OK_AND_ASSIGN(auto store, Store::Open(ctx, dir.GetPath()));
+    ASSERT_OK(store.Set(1, 10));
+    ASSERT_OK(store.Flush());
+    ASSERT_OK(store.Set(1, 20));
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto store, Store::Open(ctx, dir.GetPath()));
+    EXPECT_THAT(store.Get(1), IsOkAndHolds(10));
+  }
+}
+
+TEST(InMemoryStoreTest, ModificationsAcrossFlushesAreRestored) {
+  TempDir dir;
+  Context ctx;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto store, Store::Open(ctx, dir.GetPath()));
+    for (int round = 0; round < 5; round++) {
+      for (int i = 0; i < 100 * (round + 1); i += round + 1) {
+        ASSERT_OK(store.Set(i, i + round));
+      }
+      ASSERT_OK(store.Flush());
+    }
+    ASSERT_OK_AND_ASSIGN(hash, store.GetHash());
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(auto store, Store::Open(ctx, dir.GetPath()));
+    ASSERT_OK_AND_ASSIGN(auto fresh, Store::Open(ctx, dir.GetPath() / "x"));
+    for (int round = 0; round < 5; round++) {
+      for (int i = 0; i < 100 * (round + 1); i += round + 1) {
+        ASSERT_OK(fresh.Set(i, i + round));
+      }
+    }
+    for (int i = 0; i < 500; i++) {
+      EXPECT_THAT(store.Get(i), IsOkAndHolds(*fresh.Get(i)));
+    }
+    EXPECT_THAT(store.GetHash(), IsOkAndHolds(hash));
+  }
+}
+
 }  // namespace
 }  // namespace carmen::backend::store
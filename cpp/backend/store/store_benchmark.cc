@@ -10,6 +10,7 @@
 
 #include <random>
 
+#include "backend/common/eviction_policy.h"
 #include "backend/store/leveldb/store.h"
 #include "backend/store/store_handler.h"
 #include "benchmark/benchmark.h"
@@ -32,7 +33,11 @@ BENCHMARK_TYPE_LIST(StoreConfigList, (ReferenceStore<kPageSize>),
                     (LevelDbStore<int, Value, kPageSize>),
                     (EagerFileStore<int, Value, InMemoryFile, kPageSize>),
                     (EagerFileStore<int, Value, SingleFile, kPageSize>),
-                    (LazyFileStore<int, Value, SingleFile, kPageSize>));
+                    (LazyFileStore<int, Value, SingleFile, kPageSize>),
+                    (EagerFileStore<int, Value, SingleFile, kPageSize,
+                                    LeastCostlyEvictionPolicy>),
+                    (LazyFileStore<int, Value, SingleFile, kPageSize,
+                                   LeastCostlyEvictionPolicy>));
 
 // Defines the list of problem sizes.
 const auto kSizes = std::vector<int64_t>({1 << 20, 1 << 24});
@@ -213,6 +218,37 @@ void BM_ExponentialRandomWrite(benchmark::State& state) {
 
 BENCHMARK_ALL(BM_ExponentialRandomWrite, StoreConfigList)->ArgList(kSizes);
 
+// Benchmarks a write-heavy mix of random, exponentially distributed reads and
+// writes, where every second access is a write. Evictions thus involve a mix
+// of clean and dirty pages.
+template <typename Store>
+void BM_ExponentialRandomReadWrite(benchmark::State& state) {
+  auto num_elements = state.range(0);
+
+  // Initialize the store with the total number of elements.
+  TempDir dir;
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(auto store, Store::Open(ctx, dir, kBranchFactor));
+  InitStore(store, num_elements);
+
+  int i = 0;
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::exponential_distribution<> dist(double(10) / num_elements);
+  for (auto _ : state) {
+    auto key = static_cast<std::size_t>(dist(gen)) % num_elements;
+    if (i++ % 2 == 0) {
+      auto value = store.Get(key);
+      benchmark::DoNotOptimize(value);
+    } else {
+      ASSERT_OK(store.Set(key, Value{static_cast<std::uint8_t>(i)}));
+    }
+  }
+}
+
+BENCHMARK_ALL(BM_ExponentialRandomReadWrite, StoreConfigList)
+    ->ArgList(kSizes);
+
 template <typename Store, bool include_write_time>
 void RunHashSequentialUpdates(benchmark::State& state) {
   auto num_elements = state.range(0);
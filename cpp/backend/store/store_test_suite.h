@@ -310,6 +310,19 @@ TYPED_TEST_P(StoreTest, HashesRespectEmptyPages) {
   EXPECT_EQ(ref_hash, trg_hash);
 }
 
+TYPED_TEST_P(StoreTest, KeyBoundCoversAllValues) {
+  ASSERT_OK_AND_ASSIGN(auto wrapper, TypeParam::Create());
+  auto& store = wrapper.GetStore();
+  EXPECT_EQ(store.GetKeyBound(), 0);
+
+  ASSERT_OK(store.Set(10, Value{0x12}));
+  EXPECT_GT(store.GetKeyBound(), 10);
+  ASSERT_OK(store.Set(3, Value{0x12}));
+  EXPECT_GT(store.GetKeyBound(), 10);
+  ASSERT_OK(store.Set(10000, Value{0x12}));
+  EXPECT_GT(store.GetKeyBound(), 10000);
+}
+
 TYPED_TEST_P(StoreTest, CanProduceMemoryFootprint) {
   ASSERT_OK_AND_ASSIGN(auto wrapper, TypeParam::Create());
   auto& store = wrapper.GetStore();
@@ -324,7 +337,7 @@ REGISTER_TYPED_TEST_SUITE_P(
     HashesRespectBranchingFactor, HashesEqualReferenceImplementation,
     HashesRespectEmptyPages, HashesChangeWithUpdates,
     HashesDoNotChangeWithReads, HashesCoverMultiplePages,
-    CanProduceMemoryFootprint);
+    KeyBoundCoversAllValues, CanProduceMemoryFootprint);
 
 }  // namespace
 }  // namespace carmen::backend::store
@@ -10,14 +10,20 @@
 
 #pragma once
 
+#include <cassert>
 #include <concepts>
+#include <cstddef>
 #include <filesystem>
+#include <memory>
 #include <type_traits>
+#include <utility>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "common/heterogenous_map.h"
 #include "common/memory_usage.h"
+#include "common/status_util.h"
 #include "common/type.h"
 
 namespace carmen::backend {
@@ -27,6 +33,10 @@ namespace carmen::backend {
 // involving multiple indexes, stores, and depots. It is mainly intended to
 // provide access to shared components like a page pools or other resources.
 // It is also intended to contain runtime configuration parameters.
+//
+// Structures of a group may be opened concurrently. Thus, structures sharing
+// components need to obtain them through GetOrCreateComponent(), which may be
+// called from multiple threads. All other operations are not thread-safe.
 class Context {
  public:
   // Tests whether a component of the given type has been registered before.
@@ -49,10 +59,44 @@ class Context {
     components_.Set<T>(std::move(component));
   }
 
+  // Retrieves a copy of the component of the given type. If there is none so
+  // far, it is created by the given factory, which has to return an
+  // absl::StatusOr<T>, and registered. Concurrent calls are serialized, such
+  // that the component is only created once.
+  template <typename T, typename Factory>
+  absl::StatusOr<T> GetOrCreateComponent(Factory create) {
+    absl::MutexLock guard(mutex_.get());
+    if (!HasComponent<T>()) {
+      ASSIGN_OR_RETURN(T component, create());
+      RegisterComponent<T>(std::move(component));
+    }
+    return GetComponent<T>();
+  }
+
  private:
   HeterogenousMap components_;
+
+  // Serializes the creation of components in GetOrCreateComponent(). It is
+  // kept on the heap to keep contexts movable.
+  std::unique_ptr<absl::Mutex> mutex_ = std::make_unique<absl::Mutex>();
 };
 
+// Runtime options of the page pools of file-based structures. They may be
+// registered as a component of the Context structures are opened with.
+struct PagePoolOptions {
+  // The capacity in bytes of the compressed second cache tier of each page
+  // pool, see PagePool::EnableCompressedCache. Zero disables the tier.
+  std::size_t compressed_cache_capacity = 0;
+};
+
+// Obtains the page pool options registered in the given context, or the
+// default options if there are none.
+inline PagePoolOptions GetPagePoolOptions(Context& context) {
+  auto options = context.GetOrCreateComponent<PagePoolOptions>(
+      []() -> absl::StatusOr<PagePoolOptions> { return PagePoolOptions{}; });
+  return options.ok() ? *options : PagePoolOptions{};
+}
+
 // Defines universal requirements for all data structure implementations.
 template <typename S>
 concept Structure = requires(S a) {
@@ -71,8 +71,8 @@ Memory SizeOf(const std::deque<T>& list) {
 
 // Approximates the memory usage of the given set assuming the element type is a
 // stack-only type.
-template <typename T>
-Memory SizeOf(const absl::flat_hash_set<T>& set) {
+template <typename T, typename... Rest>
+Memory SizeOf(const absl::flat_hash_set<T, Rest...>& set) {
   return SizeOf<T>() * set.size();
 }
 
@@ -0,0 +1,53 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "common/parallel.h"
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+
+namespace carmen {
+
+absl::Status RunInParallel(std::vector<Task> tasks) {
+  std::vector<absl::Status> results(tasks.size());
+
+  // The first task is run on the calling thread.
+  std::vector<std::thread> workers;
+  workers.reserve(tasks.size());
+  for (std::size_t i = 1; i < tasks.size(); i++) {
+    workers.emplace_back([&, i]() { results[i] = tasks[i](); });
+  }
+  if (!tasks.empty()) {
+    results[0] = tasks[0]();
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  absl::Status res;
+  for (const auto& result : results) {
+    if (result.ok()) {
+      continue;
+    }
+    if (res.ok()) {
+      res = result;
+    } else {
+      res = absl::Status(res.code(),
+                         absl::StrCat(res.message(), "; ", result.message()));
+    }
+  }
+  return res;
+}
+
+}  // namespace carmen
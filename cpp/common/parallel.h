@@ -0,0 +1,34 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "absl/status/status.h"
+
+namespace carmen {
+
+// A task to be run by RunInParallel.
+using Task = std::function<absl::Status()>;
+
+// Runs the given tasks concurrently, each on its own thread, and waits until
+// all of them are completed. This is intended for a small number of
+// independent, I/O bound operations like opening or flushing the structures of
+// a state.
+//
+// Errors are aggregated deterministically: if any task fails, the error of the
+// first failing task in the given list is returned, irrespective of the order
+// in which the tasks completed. The messages of errors of subsequent failing
+// tasks are appended to its message.
+absl::Status RunInParallel(std::vector<Task> tasks);
+
+}  // namespace carmen
@@ -0,0 +1,88 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include "common/parallel.h"
+
+#include <atomic>
+#include <chrono>
+#include <latch>
+#include <thread>
+
+#include "absl/status/status.h"
+#include "common/status_test_util.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace carmen {
+namespace {
+
+using ::testing::StatusIs;
+
+TEST(RunInParallelTest, EmptyListOfTasksSucceeds) {
+  EXPECT_OK(RunInParallel({}));
+}
+
+TEST(RunInParallelTest, AllTasksAreRun) {
+  std::atomic<int> counter = 0;
+  std::vector<Task> tasks;
+  for (int i = 0; i < 10; i++) {
+    tasks.push_back([&]() {
+      counter++;
+      return absl::OkStatus();
+    });
+  }
+  EXPECT_OK(RunInParallel(std::move(tasks)));
+  EXPECT_EQ(counter, 10);
+}
+
+TEST(RunInParallelTest, TasksAreRunConcurrently) {
+  // Each task waits for all others to be started, which would block forever
+  // if tasks were run one after another.
+  constexpr int kNumTasks = 4;
+  std::latch started(kNumTasks);
+  std::vector<Task> tasks;
+  for (int i = 0; i < kNumTasks; i++) {
+    tasks.push_back([&]() {
+      started.arrive_and_wait();
+      return absl::OkStatus();
+    });
+  }
+  EXPECT_OK(RunInParallel(std::move(tasks)));
+}
+
+TEST(RunInParallelTest, ErrorsAreReported) {
+  EXPECT_THAT(RunInParallel({
+                  []() { return absl::OkStatus(); },
+                  []() { return absl::NotFoundError("missing"); },
+              }),
+              StatusIs(absl::StatusCode::kNotFound, "missing"));
+}
+
+TEST(RunInParallelTest, ErrorOfFirstFailingTaskInListIsReported) {
+  // The first task fails last, yet its error is reported first.
+  std::latch second_done(1);
+  auto status = RunInParallel({
+      [&]() {
+        second_done.wait();
+        return absl::InternalError("first");
+      },
+      [&]() {
+        second_done.count_down();
+        return absl::NotFoundError("second");
+      },
+      []() { return absl::OkStatus(); },
+      []() { return absl::InvalidArgumentError("third"); },
+  });
+  EXPECT_THAT(status,
+              StatusIs(absl::StatusCode::kInternal, "first; second; third"));
+}
+
+}  // namespace
+}  // namespace carmen
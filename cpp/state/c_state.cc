@@ -13,6 +13,7 @@
 #include <cstddef>
 #include <cstring>
 #include <filesystem>
+#include <memory_resource>
 #include <span>
 #include <sstream>
 #include <string_view>
@@ -382,7 +383,11 @@ void Carmen_Apply(C_State state, uint64_t block, C_Update update,
   auto& s = *reinterpret_cast<carmen::WorldState*>(state);
   std::span<const std::byte> data(reinterpret_cast<const std::byte*>(update),
                                   length);
-  auto change = carmen::Update::FromBytes(data);
+  // The decoded update is only needed while applying this block. Its content
+  // is placed in an arena released as a whole at the end of this call. The
+  // decoded size is close to the encoded size, thus one chunk usually suffices.
+  std::pmr::monotonic_buffer_resource arena(length);
+  auto change = carmen::Update::FromBytes(data, &arena);
   if (!change.ok()) {
     std::cout << "WARNING: Failed to decode update: " << change.status() << "\n"
               << std::flush;
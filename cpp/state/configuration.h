@@ -10,10 +10,42 @@
 
 #pragma once
 
+#include <cstddef>
+#include <type_traits>
+
+#include "backend/structure.h"
 #include "common/type.h"
 
 namespace carmen {
 
+// A page size policy defines the size of the pages used by the index or store
+// with a given key and value type through a member variable template
+// kPageSize<K, V>. This allows page sizes to be tuned per structure to match
+// its access density; for instance, stores of small values like balances may
+// benefit from different page sizes than stores of storage slot values.
+//
+// Note: the hashes of stores are computed over their pages. Thus, states using
+// different page sizes for their stores produce different state hashes.
+
+// A page size policy using the same page size for all structures.
+template <std::size_t page_size>
+struct UniformPageSize {
+  template <typename K, typename V>
+  constexpr static std::size_t kPageSize = page_size;
+};
+
+// A page size policy using the given page size for the structure mapping K to
+// V, and the page sizes of the Base policy for all other structures. Policies
+// may be nested to customize multiple structures.
+template <typename K, typename V, std::size_t page_size, typename Base>
+struct WithPageSize {
+  template <typename Key, typename Value>
+  constexpr static std::size_t kPageSize =
+      std::is_same_v<K, Key> && std::is_same_v<V, Value>
+          ? page_size
+          : Base::template kPageSize<Key, Value>;
+};
+
 // A configuration defines the implementation types of various primitives to be
 // combined by schemas to instantiate a state.
 template <template <typename K, typename V> class IndexType,
@@ -37,4 +69,77 @@ struct Configuration {
   using Archive = ArchiveType;
 };
 
+// Extends the given configuration by enabling the recycling of the storage
+// slots of deleted accounts in schemas supporting it. Recycling requires the
+// configured indexes to support the removal of keys. Since it alters the
+// content of hashed structures, it is a separate schema feature, see
+// StateFeature::kSlotRecycling.
+template <typename Config>
+struct WithSlotRecycling : Config {
+  constexpr static bool kRecycleSlots = true;
+};
+
+// Determines whether the given configuration enables the recycling of slots.
+template <typename Config>
+constexpr bool kRecyclesSlots = requires { requires Config::kRecycleSlots; };
+
+// Extends the given configuration by a compressed second cache tier of the
+// given capacity in bytes for each page pool of its file-based structures,
+// see PagePoolOptions. This only affects performance, not the content of the
+// state, and is thus no schema feature.
+template <typename Config, std::size_t capacity>
+struct WithCompressedPageCache : Config {
+  constexpr static std::size_t kCompressedCacheCapacity = capacity;
+};
+
+// The capacity of the compressed page cache tier of the given configuration,
+// zero if it is disabled.
+template <typename Config>
+constexpr std::size_t kCompressedPageCacheCapacity = 0;
+
+template <typename Config>
+requires requires { Config::kCompressedCacheCapacity; }
+constexpr std::size_t kCompressedPageCacheCapacity<Config> =
+    Config::kCompressedCacheCapacity;
+
+// Creates the context the structures of a state with the given configuration
+// are opened in, providing the runtime options defined by the configuration.
+template <typename Config>
+backend::Context CreateContext() {
+  backend::Context context;
+  context.RegisterComponent(backend::PagePoolOptions{
+      .compressed_cache_capacity = kCompressedPageCacheCapacity<Config>});
+  return context;
+}
+
+// Extends the given configuration by keeping the basic properties of accounts
+// in a single store of account records in schemas supporting it, instead of
+// one store per property. Records are hashed as a whole, which makes this a
+// separate schema feature, see StateFeature::kAccountRecords.
+template <typename Config>
+struct WithAccountRecords : Config {
+  constexpr static bool kUseAccountRecords = true;
+};
+
+// Determines whether the given configuration keeps accounts in records.
+template <typename Config>
+constexpr bool kUsesAccountRecords =
+    requires { requires Config::kUseAccountRecords; };
+
+// Extends the given configuration by keeping storage slots in an ordered map
+// of the given type in schemas supporting it, instead of mapping them to dense
+// IDs through an index. Ordered by account, the slots of a contract share a
+// few pages. The map is hashed by its layout, which makes this a separate
+// schema feature, see StateFeature::kStorageTrees.
+template <typename Config, template <typename K, typename V> class MapType>
+struct WithStorageTrees : Config {
+  template <Trivial K, Trivial V>
+  using OrderedMap = MapType<K, V>;
+};
+
+// Determines whether the given configuration keeps slots in ordered maps.
+template <typename Config>
+constexpr bool kUsesStorageTrees =
+    requires { typename Config::template OrderedMap<Key, Value>; };
+
 }  // namespace carmen
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "archive/archive.h"
+#include "backend/common/btree/hashed_btree_map.h"
 #include "backend/depot/file/depot.h"
 #include "backend/depot/leveldb/depot.h"
 #include "backend/depot/memory/depot.h"
@@ -47,27 +48,54 @@ using InMemoryMultiMap = backend::multimap::InMemoryMultiMap<K, V>;
 template <Archive Archive>
 using InMemoryConfig = Configuration<InMemoryIndex, InMemoryStore,
                                      InMemoryDepot, InMemoryMultiMap, Archive>;
-
 // ----------------------------------------------------------------------------
 //                         File-Based Configuration
 // ----------------------------------------------------------------------------
 
+// Defines the page sizes of the file-based structures of a state.
+using DefaultPageSizes = UniformPageSize<kPageSize>;
+
+// Defines the file-based index and store types using the page sizes of the
+// given page size policy.
+template <typename PageSizes>
+struct FileBased {
+  template <typename K, typename I>
+  using Index = backend::index::Cached<
+      backend::index::FileIndex<K, I, backend::SingleFile,
+                                PageSizes::template kPageSize<K, I>>>;
+
+  template <typename K, typename V>
+  using Store =
+      backend::store::EagerFileStore<K, V, backend::SingleFile,
+                                     PageSizes::template kPageSize<K, V>>;
+};
+
 template <typename K, typename I>
-using FileBasedIndex = backend::index::Cached<
-    backend::index::FileIndex<K, I, backend::SingleFile, kPageSize>>;
+using FileBasedIndex = FileBased<DefaultPageSizes>::Index<K, I>;
 
 template <typename K, typename V>
-using FileBasedStore =
-    backend::store::EagerFileStore<K, V, backend::SingleFile, kPageSize>;
+using FileBasedStore = FileBased<DefaultPageSizes>::Store<K, V>;
 
 template <typename K>
 using FileBasedDepot = backend::depot::FileDepot<K>;
 
-template <Archive Archive>
-using FileBasedConfig =
-    Configuration<FileBasedIndex, FileBasedStore, FileBasedDepot,
+// The ordered map type for configurations using storage trees, see
+// WithStorageTrees. Since B-tree pages are cached in memory, it is also used
+// for in-memory configurations.
+template <typename K, typename V>
+using FileBasedOrderedMap = backend::HashedBTreeMap<K, V, backend::SingleFile>;
+
+// A file-based configuration with page sizes selected per structure by the
+// given page size policy. Use the page_size_benchmark to find suitable sizes.
+template <typename PageSizes, Archive Archive>
+using FileBasedConfigWithPageSizes =
+    Configuration<FileBased<PageSizes>::template Index,
+                  FileBased<PageSizes>::template Store, FileBasedDepot,
                   InMemoryMultiMap, Archive>;
 
+template <Archive Archive>
+using FileBasedConfig = FileBasedConfigWithPageSizes<DefaultPageSizes, Archive>;
+
 // ----------------------------------------------------------------------------
 //                         LevelDB-Based Configuration
 // ----------------------------------------------------------------------------
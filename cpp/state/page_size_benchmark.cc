@@ -0,0 +1,247 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "backend/structure.h"
+#include "benchmark/benchmark.h"
+#include "common/file_util.h"
+#include "common/status_test_util.h"
+#include "common/type.h"
+#include "state/configuration.h"
+#include "state/configurations.h"
+
+// Sweeps the page sizes of the file-based indexes and stores of the state by
+// replaying the same synthetic block workload on each structure for each page
+// size. After all benchmarks have been run, the page size leading to the
+// lowest time per block is recommended for each structure. The results may be
+// used to define a page size policy for FileBasedConfigWithPageSizes.
+//
+// To run benchmarks, use the following command:
+//    bazel run -c opt //state:page_size_benchmark
+//
+// To only sweep a single structure, add a filter like
+//    bazel run -c opt //state:page_size_benchmark --
+//    --benchmark_filter=Replay/balances/
+
+namespace carmen {
+namespace {
+
+// The number of blocks in the replayed trace.
+constexpr int kNumBlocks = 1000;
+
+// The number of leading blocks of the trace used to fill structures before
+// measurements start.
+constexpr int kNumWarmupBlocks = 500;
+
+// The number of operations per block.
+constexpr int kOperationsPerBlock = 1000;
+
+// The fraction of operations introducing new elements.
+constexpr double kNewElementRatio = 0.1;
+
+// The fraction of operations on existing elements that are writes.
+constexpr double kWriteRatio = 0.5;
+
+// The mean distance of accessed elements to the most recently added element.
+// Recently added elements are more likely to be accessed than older ones.
+constexpr double kMeanAccessDistance = 10000;
+
+// An operation of the replayed workload, touching the element with the given
+// dense ID. IDs are introduced in order, starting at zero.
+struct Operation {
+  std::uint32_t id;
+  bool write;
+};
+
+// A block of operations, concluded by a hash computation.
+using Block = std::vector<Operation>;
+
+// Generates the replayed trace. A fixed seed makes sure that all structures
+// and page sizes are evaluated on the same sequence of operations.
+std::vector<Block> GenerateTrace() {
+  std::mt19937 gen(42);
+  std::bernoulli_distribution is_new(kNewElementRatio);
+  std::bernoulli_distribution is_write(kWriteRatio);
+  std::exponential_distribution<> distance(1 / kMeanAccessDistance);
+  std::uint32_t num_elements = 0;
+  std::vector<Block> trace(kNumBlocks);
+  for (auto& block : trace) {
+    block.reserve(kOperationsPerBlock);
+    for (int i = 0; i < kOperationsPerBlock; i++) {
+      if (num_elements == 0 || is_new(gen)) {
+        block.push_back({num_elements++, true});
+        continue;
+      }
+      auto offset = static_cast<std::uint32_t>(distance(gen)) % num_elements;
+      block.push_back({num_elements - 1 - offset, is_write(gen)});
+    }
+  }
+  return trace;
+}
+
+const std::vector<Block>& GetTrace() {
+  static const std::vector<Block> trace = GenerateTrace();
+  return trace;
+}
+
+// Converts the given ID into a value of a trivial type, filling its leading
+// bytes with the big-endian representation of the ID.
+template <Trivial T>
+T ToValue(std::uint32_t id) {
+  T res{};
+  auto bytes = std::as_writable_bytes(std::span(&res, 1));
+  for (std::size_t i = 0; i < std::min<std::size_t>(bytes.size(), 4); i++) {
+    bytes[i] = std::byte(id >> (24 - 8 * i));
+  }
+  return res;
+}
+
+// Applies a single operation to the given structure. For indexes, writes are
+// mapped to insertions and reads to lookups.
+template <typename Structure>
+void Apply(Structure& structure, const Operation& op) {
+  using K = typename Structure::key_type;
+  using V = typename Structure::value_type;
+  constexpr bool is_index = requires(Structure s) { s.GetOrAdd(K{}); };
+  if constexpr (is_index) {
+    if (op.write) {
+      auto id = structure.GetOrAdd(ToValue<K>(op.id));
+      benchmark::DoNotOptimize(id);
+    } else {
+      auto id = structure.Get(ToValue<K>(op.id));
+      benchmark::DoNotOptimize(id);
+    }
+  } else {
+    if (op.write) {
+      ASSERT_OK(structure.Set(op.id, ToValue<V>(op.id + 1)));
+    } else {
+      auto value = structure.Get(op.id);
+      benchmark::DoNotOptimize(value);
+    }
+  }
+}
+
+// Replays blocks of the trace on the given structure, one per iteration.
+template <typename Structure>
+void BM_Replay(benchmark::State& state) {
+  const auto& trace = GetTrace();
+  TempDir dir;
+  backend::Context context;
+  ASSERT_OK_AND_ASSIGN(auto structure, Structure::Open(context, dir));
+
+  auto replay = [&](const Block& block) {
+    for (const auto& op : block) {
+      Apply(structure, op);
+    }
+    auto hash = structure.GetHash();
+    benchmark::DoNotOptimize(hash);
+  };
+
+  for (int i = 0; i < kNumWarmupBlocks; i++) {
+    replay(trace[i]);
+  }
+
+  int next = kNumWarmupBlocks;
+  for (auto _ : state) {
+    replay(trace[next]);
+    next = next + 1 < kNumBlocks ? next + 1 : kNumWarmupBlocks;
+  }
+  state.SetItemsProcessed(state.iterations() * kOperationsPerBlock);
+  ASSERT_OK(structure.Close());
+}
+
+// Registers the replay benchmarks of all swept structures for a page size.
+template <std::size_t page_size>
+void RegisterPageSize() {
+  using Config = FileBased<UniformPageSize<page_size>>;
+  auto add = [](const char* structure, auto function) {
+    auto name = "Replay/" + std::string(structure) + "/" +
+                std::to_string(page_size);
+    benchmark::RegisterBenchmark(name.c_str(), function)
+        ->Unit(benchmark::kMicrosecond);
+  };
+  add("balances", &BM_Replay<typename Config::template Store<std::uint32_t,
+                                                             Balance>>);
+  add("nonces",
+      &BM_Replay<typename Config::template Store<std::uint32_t, Nonce>>);
+  add("values",
+      &BM_Replay<typename Config::template Store<std::uint32_t, Value>>);
+  add("addresses",
+      &BM_Replay<typename Config::template Index<Address, std::uint32_t>>);
+  add("keys", &BM_Replay<typename Config::template Index<Key, std::uint32_t>>);
+}
+
+// A console reporter additionally collecting the time per block of each
+// benchmark to recommend the page size with the lowest time per structure.
+class RecommendingReporter : public benchmark::ConsoleReporter {
+ public:
+  void ReportRuns(const std::vector<Run>& runs) override {
+    ConsoleReporter::ReportRuns(runs);
+    for (const auto& run : runs) {
+      if (run.error_occurred || run.run_type != Run::RT_Iteration) {
+        continue;
+      }
+      // Names are of the form Replay/<structure>/<page_size>.
+      const auto& name = run.run_name.function_name;
+      auto first = name.find('/');
+      auto last = name.rfind('/');
+      if (first == std::string::npos || first == last) {
+        continue;
+      }
+      auto structure = name.substr(first + 1, last - first - 1);
+      auto page_size = std::stoul(name.substr(last + 1));
+      auto time = run.GetAdjustedRealTime();
+      auto [pos, added] = best_.try_emplace(structure, page_size, time);
+      if (!added && time < pos->second.second) {
+        pos->second = {page_size, time};
+      }
+    }
+  }
+
+  void Finalize() override {
+    ConsoleReporter::Finalize();
+    auto& out = GetOutputStream();
+    out << "\nRecommended page sizes:\n";
+    for (const auto& [structure, best] : best_) {
+      out << "  " << structure << ": " << best.first << " bytes ("
+          << best.second << " us per block)\n";
+    }
+  }
+
+ private:
+  // Maps structures to their best page size and its time per block.
+  std::map<std::string, std::pair<std::size_t, double>> best_;
+};
+
+}  // namespace
+}  // namespace carmen
+
+int main(int argc, char** argv) {
+  carmen::RegisterPageSize<1 << 10>();
+  carmen::RegisterPageSize<1 << 11>();
+  carmen::RegisterPageSize<1 << 12>();
+  carmen::RegisterPageSize<1 << 13>();
+  carmen::RegisterPageSize<1 << 14>();
+  carmen::RegisterPageSize<1 << 15>();
+
+  benchmark::Initialize(&argc, argv);
+  carmen::RecommendingReporter reporter;
+  benchmark::RunSpecifiedBenchmarks(&reporter);
+  benchmark::Shutdown();
+  return 0;
+}
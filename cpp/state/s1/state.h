@@ -10,25 +10,52 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <optional>
 #include <utility>
+#include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "archive/archive.h"
+#include "backend/copy.h"
 #include "backend/structure.h"
 #include "common/account_state.h"
 #include "common/hash.h"
 #include "common/memory_usage.h"
+#include "common/parallel.h"
 #include "common/status_util.h"
 #include "common/type.h"
+#include "state/configuration.h"
 #include "state/schema.h"
 #include "state/update.h"
 
 namespace carmen::s1 {
 
+namespace internal {
+
+// Identifies a single slot by its address/key IDs. The type is shared by all
+// configurations of the state, such that slot indexes can be copied between
+// them.
+struct Slot {
+  std::uint32_t address;
+  std::uint32_t key;
+
+  friend auto operator<=>(const Slot& a, const Slot& b) = default;
+
+  template <typename H>
+  friend H AbslHashValue(H h, const Slot& l) {
+    return H::combine(std::move(h), l.address, l.key);
+  }
+};
+
+}  // namespace internal
+
 // A state maintains all persistent state of the blockchain. In particular,
 // it maintains the balance of accounts, accounts nonces, and storage.
 //
@@ -46,17 +73,7 @@ class State {
   using SlotId = std::uint32_t;
 
   // Identifies a single slot by its address/key values.
-  struct Slot {
-    AddressId address;
-    KeyId key;
-
-    friend auto operator<=>(const Slot& a, const Slot& b) = default;
-
-    template <typename H>
-    friend H AbslHashValue(H h, const Slot& l) {
-      return H::combine(std::move(h), l.address, l.key);
-    }
-  };
+  using Slot = internal::Slot;
 
   // This implementation utilizes address and key indexing.
   static constexpr Schema GetSchema() {
@@ -67,6 +84,13 @@ class State {
   static absl::StatusOr<State> Open(const std::filesystem::path& directory,
                                     bool with_archive = false);
 
+  // Creates a new state in the given directory holding a copy of the given
+  // state, which may be based on a different configuration. All structures
+  // are copied concurrently. The archive of the source state is not copied.
+  template <typename OtherConfig>
+  static absl::StatusOr<State> CopyFrom(const State<OtherConfig>& source,
+                                        const std::filesystem::path& directory);
+
   State() = default;
   State(State&&) = default;
 
@@ -110,6 +134,12 @@ class State {
   // Applies the changes of the provided update to the current state.
   absl::Status ApplyToState(const Update& update);
 
+  // Exports the content of this state as a sequence of updates which, applied
+  // to an empty state of any schema, reproduce the content of this state.
+  // Accounts are exported before storage slots.
+  absl::Status Export(
+      absl::FunctionRef<absl::Status(const Update&)> consumer) const;
+
   // Retrieves a pointer to the owned archive or nullptr, if no archive is
   // maintained.
   Archive* GetArchive() { return archive_.get(); }
@@ -118,12 +148,14 @@ class State {
   // entire maintained state.
   absl::StatusOr<Hash> GetHash();
 
-  // Syncs internally modified write-buffers to disk.
+  // Syncs internally modified write-buffers to disk. The structures of the
+  // state are flushed concurrently. If some of them fail, the error of the
+  // first of those in declaration order is reported.
   absl::Status Flush();
 
   // Flushes the content of the state to disk and closes all resource
   // references. After the state has been closed, no more operations may be
-  // performed on it.
+  // performed on it. Like Flush(), structures are closed concurrently.
   absl::Status Close();
 
   // Summarizes the memory usage of this state object.
@@ -153,8 +185,19 @@ class State {
         MultiMap<AddressId, SlotId> address_to_slots,
         std::unique_ptr<Archive> archive);
 
+  // States of other configurations need access to the structures of this
+  // state to copy them.
+  template <typename>
+  friend class State;
+
   absl::Status ClearAccount(AddressId addr_id);
 
+  // Creates a list of tasks applying the given operation to each of the
+  // structures of this state, including the archive, if present. The tasks
+  // are independent and may be run concurrently.
+  template <typename Op>
+  std::vector<Task> GetTasks(Op op);
+
   // Indexes for mapping address, keys, and slots to dense, numeric IDs.
   Index<Address, AddressId> address_index_;
   Index<Key, KeyId> key_index_;
@@ -196,47 +239,119 @@ const Hash State<Config>::kEmptyCodeHash = GetKeccak256Hash({});
 template <typename Config>
 absl::StatusOr<State<Config>> State<Config>::Open(
     const std::filesystem::path& dir, bool with_archive) {
-  backend::Context context;
+  backend::Context context = CreateContext<Config>();
   const auto live_dir = dir / "live";
-  ASSIGN_OR_RETURN(auto address_index, (Index<Address, AddressId>::Open(
-                                           context, live_dir / "addresses")));
-  ASSIGN_OR_RETURN(auto key_index,
-                   (Index<Key, KeyId>::Open(context, live_dir / "keys")));
-  ASSIGN_OR_RETURN(auto slot_index,
-                   (Index<Slot, SlotId>::Open(context, live_dir / "slots")));
-
-  ASSIGN_OR_RETURN(auto balances, (Store<AddressId, Balance>::Open(
-                                      context, live_dir / "balances")));
-  ASSIGN_OR_RETURN(auto nonces, (Store<AddressId, Nonce>::Open(
-                                    context, live_dir / "nonces")));
-  ASSIGN_OR_RETURN(auto values,
-                   (Store<SlotId, Value>::Open(context, live_dir / "values")));
-  ASSIGN_OR_RETURN(auto account_state,
-                   (Store<AddressId, AccountState>::Open(
-                       context, live_dir / "account_states")));
-  ASSIGN_OR_RETURN(auto code_hashes, (Store<AddressId, Hash>::Open(
-                                         context, live_dir / "code_hashes")));
-
-  ASSIGN_OR_RETURN(auto codes,
-                   (Depot<AddressId>::Open(context, live_dir / "codes")));
-
-  ASSIGN_OR_RETURN(auto address_to_slots,
-                   (MultiMap<AddressId, SlotId>::Open(
-                       context, live_dir / "address_to_slots")));
 
+  // Structures are opened concurrently. Those sharing resources, like the
+  // LevelDB instance of the LevelDbKeySpace indexes, obtain them through the
+  // context's GetOrCreateComponent, which serializes their creation.
+  std::optional<Index<Address, AddressId>> address_index;
+  std::optional<Index<Key, KeyId>> key_index;
+  std::optional<Index<Slot, SlotId>> slot_index;
+  std::optional<Store<AddressId, Balance>> balances;
+  std::optional<Store<AddressId, Nonce>> nonces;
+  std::optional<Store<SlotId, Value>> values;
+  std::optional<Store<AddressId, AccountState>> account_state;
+  std::optional<Store<AddressId, Hash>> code_hashes;
+  std::optional<Depot<AddressId>> codes;
+  std::optional<MultiMap<AddressId, SlotId>> address_to_slots;
   std::unique_ptr<Archive> archive;
+
+  // Creates a task opening a structure of type S in the given directory.
+  auto open = [&]<typename S>(std::optional<S>& result,
+                              const char* name) -> Task {
+    return [&context, &result, path = live_dir / name]() -> absl::Status {
+      ASSIGN_OR_RETURN(auto structure, S::Open(context, path));
+      result.emplace(std::move(structure));
+      return absl::OkStatus();
+    };
+  };
+
+  std::vector<Task> tasks = {
+      open(address_index, "addresses"),
+      open(key_index, "keys"),
+      open(slot_index, "slots"),
+      open(balances, "balances"),
+      open(nonces, "nonces"),
+      open(values, "values"),
+      open(account_state, "account_states"),
+      open(code_hashes, "code_hashes"),
+      open(codes, "codes"),
+      open(address_to_slots, "address_to_slots"),
+  };
   if (with_archive) {
-    ASSIGN_OR_RETURN(auto instance, Archive::Open(dir / "archive"));
-    archive = std::make_unique<Archive>(std::move(instance));
+    tasks.push_back([&]() -> absl::Status {
+      ASSIGN_OR_RETURN(auto instance, Archive::Open(dir / "archive"));
+      archive = std::make_unique<Archive>(std::move(instance));
+      return absl::OkStatus();
+    });
   }
+  RETURN_IF_ERROR(RunInParallel(std::move(tasks)));
 
-  return State(std::move(address_index), std::move(key_index),
-               std::move(slot_index), std::move(balances), std::move(nonces),
-               std::move(values), std::move(account_state), std::move(codes),
-               std::move(code_hashes), std::move(address_to_slots),
+  return State(std::move(*address_index), std::move(*key_index),
+               std::move(*slot_index), std::move(*balances),
+               std::move(*nonces), std::move(*values),
+               std::move(*account_state), std::move(*codes),
+               std::move(*code_hashes), std::move(*address_to_slots),
                std::move(archive));
 }
 
+template <typename Config>
+template <typename OtherConfig>
+absl::StatusOr<State<Config>> State<Config>::CopyFrom(
+    const State<OtherConfig>& source, const std::filesystem::path& dir) {
+  const auto live_dir = dir / "live";
+  if (std::filesystem::exists(live_dir)) {
+    return absl::FailedPreconditionError(
+        "Target directory already contains a state.");
+  }
+  backend::Context context = CreateContext<Config>();
+
+  // Like for opening a state, all structures are copied concurrently.
+  std::optional<Index<Address, AddressId>> address_index;
+  std::optional<Index<Key, KeyId>> key_index;
+  std::optional<Index<Slot, SlotId>> slot_index;
+  std::optional<Store<AddressId, Balance>> balances;
+  std::optional<Store<AddressId, Nonce>> nonces;
+  std::optional<Store<SlotId, Value>> values;
+  std::optional<Store<AddressId, AccountState>> account_state;
+  std::optional<Store<AddressId, Hash>> code_hashes;
+  std::optional<Depot<AddressId>> codes;
+  std::optional<MultiMap<AddressId, SlotId>> address_to_slots;
+
+  // Creates a task copying the given structure into a new structure of type S
+  // in the given directory.
+  auto copy = [&]<typename S>(std::optional<S>& result, const auto& structure,
+                              const char* name) -> Task {
+    return [&context, &result, &structure,
+            path = live_dir / name]() -> absl::Status {
+      ASSIGN_OR_RETURN(auto copy, backend::Copy<S>(context, structure, path));
+      result.emplace(std::move(copy));
+      return absl::OkStatus();
+    };
+  };
+
+  RETURN_IF_ERROR(RunInParallel({
+      copy(address_index, source.address_index_, "addresses"),
+      copy(key_index, source.key_index_, "keys"),
+      copy(slot_index, source.slot_index_, "slots"),
+      copy(balances, source.balances_, "balances"),
+      copy(nonces, source.nonces_, "nonces"),
+      copy(values, source.value_store_, "values"),
+      copy(account_state, source.account_states_, "account_states"),
+      copy(code_hashes, source.code_hashes_, "code_hashes"),
+      copy(codes, source.codes_, "codes"),
+      copy(address_to_slots, source.address_to_slots_, "address_to_slots"),
+  }));
+
+  return State(std::move(*address_index), std::move(*key_index),
+               std::move(*slot_index), std::move(*balances),
+               std::move(*nonces), std::move(*values),
+               std::move(*account_state), std::move(*codes),
+               std::move(*code_hashes), std::move(*address_to_slots),
+               /*archive=*/nullptr);
+}
+
 template <typename Config>
 State<Config>::State(Index<Address, AddressId> address_index,
                      Index<Key, KeyId> key_index,
@@ -476,6 +591,70 @@ absl::Status State<Config>::ApplyToState(const Update& update) {
   return absl::OkStatus();
 }
 
+template <typename Config>
+absl::Status State<Config>::Export(
+    absl::FunctionRef<absl::Status(const Update&)> consumer) const {
+  // The number of accounts or slots covered by a single exported update.
+  constexpr static std::size_t kBatchSize = 1 << 16;
+  ASSIGN_OR_RETURN(auto addresses, backend::GetSnapshot(address_index_));
+  ASSIGN_OR_RETURN(auto keys, backend::GetSnapshot(key_index_));
+  ASSIGN_OR_RETURN(auto slots, backend::GetSnapshot(slot_index_));
+
+  const std::size_t num_addresses = addresses->GetSize();
+  for (std::size_t from = 0; from < num_addresses; from += kBatchSize) {
+    Update update;
+    auto batch =
+        addresses->GetKeys(from, std::min(from + kBatchSize, num_addresses));
+    for (std::size_t i = 0; i < batch.size(); i++) {
+      const Address& address = batch[i];
+      const auto addr_id = static_cast<AddressId>(from + i);
+      ASSIGN_OR_RETURN(auto account_state, account_states_.Get(addr_id));
+      if (account_state == AccountState::kExists) {
+        update.Create(address);
+      }
+      ASSIGN_OR_RETURN(auto balance, balances_.Get(addr_id));
+      if (balance != Balance{}) {
+        update.Set(address, balance);
+      }
+      ASSIGN_OR_RETURN(auto nonce, nonces_.Get(addr_id));
+      if (nonce != Nonce{}) {
+        update.Set(address, nonce);
+      }
+      auto code = codes_.Get(addr_id);
+      if (!absl::IsNotFound(code.status())) {
+        RETURN_IF_ERROR(code);
+        if (!code->empty()) {
+          update.Set(address, Code(*code));
+        }
+      }
+    }
+    RETURN_IF_ERROR(consumer(update));
+  }
+
+  // Values of deleted accounts are reset, so all non-zero values are live.
+  const std::size_t num_slots = slots->GetSize();
+  for (std::size_t from = 0; from < num_slots; from += kBatchSize) {
+    Update update;
+    auto batch = slots->GetKeys(from, std::min(from + kBatchSize, num_slots));
+    for (std::size_t i = 0; i < batch.size(); i++) {
+      ASSIGN_OR_RETURN(auto value,
+                       value_store_.Get(static_cast<SlotId>(from + i)));
+      if (value == Value{}) {
+        continue;
+      }
+      const Slot& slot = batch[i];
+      auto address = addresses->GetKeys(slot.address, slot.address + 1);
+      auto key = keys->GetKeys(slot.key, slot.key + 1);
+      if (address.empty() || key.empty()) {
+        return absl::InternalError("Slot refers to unknown address or key.");
+      }
+      update.Set(address[0], key[0], value);
+    }
+    RETURN_IF_ERROR(consumer(update));
+  }
+  return absl::OkStatus();
+}
+
 template <typename Config>
 absl::StatusOr<Hash> State<Config>::GetHash() {
   ASSIGN_OR_RETURN(auto addr_idx_hash, address_index_.GetHash());
@@ -493,38 +672,37 @@ absl::StatusOr<Hash> State<Config>::GetHash() {
 
 template <typename Config>
 absl::Status State<Config>::Flush() {
-  RETURN_IF_ERROR(address_index_.Flush());
-  RETURN_IF_ERROR(key_index_.Flush());
-  RETURN_IF_ERROR(slot_index_.Flush());
-  RETURN_IF_ERROR(account_states_.Flush());
-  RETURN_IF_ERROR(balances_.Flush());
-  RETURN_IF_ERROR(nonces_.Flush());
-  RETURN_IF_ERROR(value_store_.Flush());
-  RETURN_IF_ERROR(codes_.Flush());
-  RETURN_IF_ERROR(code_hashes_.Flush());
-  RETURN_IF_ERROR(address_to_slots_.Flush());
-  if (archive_) {
-    RETURN_IF_ERROR(archive_->Flush());
-  }
-  return absl::OkStatus();
+  return RunInParallel(GetTasks([](auto& structure) {
+    return structure.Flush();
+  }));
 }
 
 template <typename Config>
 absl::Status State<Config>::Close() {
-  RETURN_IF_ERROR(address_index_.Close());
-  RETURN_IF_ERROR(key_index_.Close());
-  RETURN_IF_ERROR(slot_index_.Close());
-  RETURN_IF_ERROR(account_states_.Close());
-  RETURN_IF_ERROR(balances_.Close());
-  RETURN_IF_ERROR(nonces_.Close());
-  RETURN_IF_ERROR(value_store_.Close());
-  RETURN_IF_ERROR(codes_.Close());
-  RETURN_IF_ERROR(code_hashes_.Close());
-  RETURN_IF_ERROR(address_to_slots_.Close());
+  return RunInParallel(GetTasks([](auto& structure) {
+    return structure.Close();
+  }));
+}
+
+template <typename Config>
+template <typename Op>
+std::vector<Task> State<Config>::GetTasks(Op op) {
+  std::vector<Task> tasks = {
+      [&, op]() { return op(address_index_); },
+      [&, op]() { return op(key_index_); },
+      [&, op]() { return op(slot_index_); },
+      [&, op]() { return op(account_states_); },
+      [&, op]() { return op(balances_); },
+      [&, op]() { return op(nonces_); },
+      [&, op]() { return op(value_store_); },
+      [&, op]() { return op(codes_); },
+      [&, op]() { return op(code_hashes_); },
+      [&, op]() { return op(address_to_slots_); },
+  };
   if (archive_) {
-    RETURN_IF_ERROR(archive_->Close());
+    tasks.push_back([&, op]() { return op(*archive_); });
   }
-  return absl::OkStatus();
+  return tasks;
 }
 
 template <typename Config>
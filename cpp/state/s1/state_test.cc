@@ -23,6 +23,7 @@
 #include "backend/store/memory/store.h"
 #include "backend/store/test_util.h"
 #include "common/account_state.h"
+#include "common/file_util.h"
 #include "common/status_test_util.h"
 #include "common/type.h"
 #include "gmock/gmock.h"
@@ -43,13 +44,113 @@ using ::testing::StatusIs;
 
 using TestArchive = archive::leveldb::LevelDbArchive;
 
-using StateConfigurations =
-    ::testing::Types<State<InMemoryConfig<TestArchive>>,
-                     State<FileBasedConfig<TestArchive>>,
-                     State<LevelDbBasedConfig<TestArchive>>>;
+// A page size policy customizing the page sizes of the balance and value
+// stores, as well as the address index. All IDs are 32-bit integers.
+using TunedPageSizes = WithPageSize<
+    std::uint32_t, Balance, 1 << 10,
+    WithPageSize<std::uint32_t, Value, 1 << 13,
+                 WithPageSize<Address, std::uint32_t, 1 << 14,
+                              DefaultPageSizes>>>;
+
+static_assert(TunedPageSizes::kPageSize<std::uint32_t, Balance> == 1 << 10);
+static_assert(TunedPageSizes::kPageSize<std::uint32_t, Value> == 1 << 13);
+static_assert(TunedPageSizes::kPageSize<Address, std::uint32_t> == 1 << 14);
+static_assert(TunedPageSizes::kPageSize<std::uint32_t, Nonce> == kPageSize);
+
+using StateConfigurations = ::testing::Types<
+    State<InMemoryConfig<TestArchive>>, State<FileBasedConfig<TestArchive>>,
+    State<FileBasedConfigWithPageSizes<TunedPageSizes, TestArchive>>,
+    State<WithCompressedPageCache<FileBasedConfig<TestArchive>, 1 << 20>>,
+    State<LevelDbBasedConfig<TestArchive>>>;
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Schema_1, StateTest, StateConfigurations);
 
+// Fills the given state with accounts, code, and storage, including a deleted
+// account whose storage got cleared.
+template <typename State>
+void FillState(State& state) {
+  Address a{0x01};
+  Address b{0x02};
+  Address c{0x03};
+  Key k{0x01};
+  ASSERT_OK(state.CreateAccount(a));
+  ASSERT_OK(state.SetBalance(a, Balance{0x12}));
+  ASSERT_OK(state.SetNonce(a, Nonce{0x34}));
+  ASSERT_OK(state.SetCode(a, Code{0x56, 0x78}));
+  ASSERT_OK(state.SetStorageValue(a, k, Value{0x9a}));
+  ASSERT_OK(state.CreateAccount(b));
+  ASSERT_OK(state.SetStorageValue(b, k, Value{0xbc}));
+  ASSERT_OK(state.DeleteAccount(b));
+  ASSERT_OK(state.SetBalance(c, Balance{0xde}));
+}
+
+// Checks that the given state has the content produced by FillState().
+template <typename State>
+void CheckState(const State& state) {
+  Address a{0x01};
+  Address b{0x02};
+  Address c{0x03};
+  Key k{0x01};
+  EXPECT_THAT(state.GetAccountState(a), IsOkAndHolds(AccountState::kExists));
+  EXPECT_THAT(state.GetBalance(a), IsOkAndHolds(Balance{0x12}));
+  EXPECT_THAT(state.GetNonce(a), IsOkAndHolds(Nonce{0x34}));
+  EXPECT_THAT(state.GetCode(a), IsOkAndHolds(Code{0x56, 0x78}));
+  EXPECT_THAT(state.GetStorageValue(a, k), IsOkAndHolds(Value{0x9a}));
+  EXPECT_THAT(state.GetAccountState(b), IsOkAndHolds(AccountState::kUnknown));
+  EXPECT_THAT(state.GetStorageValue(b, k), IsOkAndHolds(Value{}));
+  EXPECT_THAT(state.GetAccountState(c), IsOkAndHolds(AccountState::kUnknown));
+  EXPECT_THAT(state.GetBalance(c), IsOkAndHolds(Balance{0xde}));
+}
+
+TEST(StateCopyTest, CopiesHaveTheSameContentAndHash) {
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto source, State<FileBasedConfig<TestArchive>>::Open(
+                                        dir.GetPath() / "source"));
+  FillState(source);
+  ASSERT_OK_AND_ASSIGN(auto hash, source.GetHash());
+
+  ASSERT_OK_AND_ASSIGN(auto memory,
+                       State<InMemoryConfig<TestArchive>>::CopyFrom(
+                           source, dir.GetPath() / "memory"));
+  CheckState(memory);
+  EXPECT_THAT(memory.GetHash(), IsOkAndHolds(hash));
+
+  ASSERT_OK_AND_ASSIGN(auto leveldb,
+                       State<LevelDbBasedConfig<TestArchive>>::CopyFrom(
+                           memory, dir.GetPath() / "leveldb"));
+  CheckState(leveldb);
+  EXPECT_THAT(leveldb.GetHash(), IsOkAndHolds(hash));
+  EXPECT_OK(leveldb.Close());
+
+  // The copy is persistent and can be reopened.
+  ASSERT_OK_AND_ASSIGN(auto reopened,
+                       State<LevelDbBasedConfig<TestArchive>>::Open(
+                           dir.GetPath() / "leveldb"));
+  CheckState(reopened);
+  EXPECT_THAT(reopened.GetHash(), IsOkAndHolds(hash));
+}
+
+TEST(StateCopyTest, CopiesCanOnlyBeCreatedInEmptyDirectories) {
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(
+      auto source, State<FileBasedConfig<TestArchive>>::Open(dir.GetPath()));
+  EXPECT_THAT(
+      State<InMemoryConfig<TestArchive>>::CopyFrom(source, dir.GetPath()),
+      StatusIs(absl::StatusCode::kFailedPrecondition, _));
+}
+
+TEST(StateCopyTest, ExportedUpdatesReproduceState) {
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto source, State<FileBasedConfig<TestArchive>>::Open(
+                                        dir.GetPath() / "source"));
+  FillState(source);
+  ASSERT_OK_AND_ASSIGN(auto target, State<InMemoryConfig<TestArchive>>::Open(
+                                        dir.GetPath() / "target"));
+  EXPECT_OK(source.Export(
+      [&](const Update& update) { return target.ApplyToState(update); }));
+  CheckState(target);
+}
+
 // ------------------------ Error Handling Tests ------------------------------
 
 template <typename K, typename V>
@@ -664,6 +765,39 @@ TEST_F(MockStateTest, CloseErrorIsForwarded) {
               StatusIs(absl::StatusCode::kInternal, "Archive error"));
 }
 
+TEST_F(MockStateTest, FlushErrorsAreReportedInDeclarationOrder) {
+  auto& state = GetState();
+
+  // Structures are flushed concurrently, yet the reported error does not
+  // depend on the order in which they fail.
+  EXPECT_CALL(state.GetAddressToSlotsMap(), Flush())
+      .WillOnce(Return(absl::InternalError("Address to slot multimap error")));
+  EXPECT_CALL(state.GetKeyIndex(), Flush())
+      .WillOnce(Return(absl::NotFoundError("Key index error")));
+  EXPECT_THAT(state.Flush(),
+              StatusIs(absl::StatusCode::kNotFound,
+                       "Key index error; Address to slot multimap error"));
+}
+
+TEST_F(MockStateTest, AllStructuresAreClosedEvenIfSomeFail) {
+  auto& state = GetState();
+
+  EXPECT_CALL(state.GetAddressIndex(), Close())
+      .WillOnce(Return(absl::InternalError("Address index error")));
+  EXPECT_CALL(state.GetKeyIndex(), Close());
+  EXPECT_CALL(state.GetSlotIndex(), Close());
+  EXPECT_CALL(state.GetBalancesStore(), Close());
+  EXPECT_CALL(state.GetNoncesStore(), Close());
+  EXPECT_CALL(state.GetValueStore(), Close());
+  EXPECT_CALL(state.GetAccountStatesStore(), Close());
+  EXPECT_CALL(state.GetCodesDepot(), Close());
+  EXPECT_CALL(state.GetCodeHashesStore(), Close());
+  EXPECT_CALL(state.GetAddressToSlotsMap(), Close());
+  EXPECT_CALL(state.GetArchive(), Close());
+  EXPECT_THAT(state.Close(),
+              StatusIs(absl::StatusCode::kInternal, "Address index error"));
+}
+
 TEST_F(MockStateTest, ApplyArchiveErrorIsForwarded) {
   auto& state = GetState();
 
@@ -10,25 +10,51 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <utility>
+#include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "archive/archive.h"
+#include "backend/copy.h"
 #include "backend/structure.h"
 #include "common/account_state.h"
 #include "common/hash.h"
 #include "common/memory_usage.h"
+#include "common/parallel.h"
 #include "common/status_util.h"
 #include "common/type.h"
+#include "state/configuration.h"
 #include "state/schema.h"
 #include "state/update.h"
 
 namespace carmen::s2 {
 
+namespace internal {
+
+// Identifies a single slot by its address ID and key. The type is shared by
+// all configurations of the state, such that slot indexes can be copied
+// between them.
+struct Slot {
+  std::uint32_t address;
+  Key key;
+
+  friend auto operator<=>(const Slot& a, const Slot& b) = default;
+
+  template <typename H>
+  friend H AbslHashValue(H h, const Slot& l) {
+    return H::combine(std::move(h), l.address, l.key);
+  }
+};
+
+}  // namespace internal
+
 // This implementation of a state utilizes a schema where Addresses are indexed,
 // but slot keys are not.
 //
@@ -50,6 +76,13 @@ class State {
   static absl::StatusOr<State> Open(const std::filesystem::path& directory,
                                     bool with_archive = false);
 
+  // Creates a new state in the given directory holding a copy of the given
+  // state, which may be based on a different configuration. The structures of
+  // the state are copied concurrently, its archive is not copied.
+  template <typename OtherConfig>
+  static absl::StatusOr<State> CopyFrom(const State<OtherConfig>& source,
+                                        const std::filesystem::path& directory);
+
   State() = default;
   State(State&&) = default;
 
@@ -93,6 +126,12 @@ class State {
   // Applies the changes of the provided update to the current state.
   absl::Status ApplyToState(const Update& update);
 
+  // Exports the content of this state as a sequence of updates reproducing it
+  // when applied to an empty state of any schema. Accounts are exported first,
+  // followed by storage slots.
+  absl::Status Export(
+      absl::FunctionRef<absl::Status(const Update&)> consumer) const;
+
   // Retrieves a pointer to the owned archive or nullptr, if no archive is
   // maintained.
   Archive* GetArchive() { return archive_.get(); }
@@ -126,17 +165,7 @@ class State {
   using MultiMap = typename Config::template MultiMap<K, V>;
 
   // Identifies a single slot by its address/key values.
-  struct Slot {
-    AddressId address;
-    Key key;
-
-    friend auto operator<=>(const Slot& a, const Slot& b) = default;
-
-    template <typename H>
-    friend H AbslHashValue(H h, const Slot& l) {
-      return H::combine(std::move(h), l.address, l.key);
-    }
-  };
+  using Slot = internal::Slot;
 
   // Make sure the slot value is packed without padding since it is stored on
   // disk as a trivial value, included in hashing.
@@ -153,6 +182,11 @@ class State {
         MultiMap<AddressId, SlotId> address_to_slots,
         std::unique_ptr<Archive> archive);
 
+  // Copying states of other configurations requires access to their
+  // structures.
+  template <typename>
+  friend class State;
+
   absl::Status ClearAccount(AddressId addr_id);
 
   // Indexes for mapping address and slots to dense, numeric IDs.
@@ -195,7 +229,7 @@ const Hash State<Config>::kEmptyCodeHash = GetKeccak256Hash({});
 template <typename Config>
 absl::StatusOr<State<Config>> State<Config>::Open(
     const std::filesystem::path& dir, bool with_archive) {
-  backend::Context context;
+  backend::Context context = CreateContext<Config>();
   const auto live_dir = dir / "live";
   ASSIGN_OR_RETURN(auto address_index, (Index<Address, AddressId>::Open(
                                            context, live_dir / "addresses")));
@@ -234,6 +268,59 @@ absl::StatusOr<State<Config>> State<Config>::Open(
                std::move(archive));
 }
 
+template <typename Config>
+template <typename OtherConfig>
+absl::StatusOr<State<Config>> State<Config>::CopyFrom(
+    const State<OtherConfig>& source, const std::filesystem::path& dir) {
+  const auto live_dir = dir / "live";
+  if (std::filesystem::exists(live_dir)) {
+    return absl::FailedPreconditionError(
+        "Target directory already contains a state.");
+  }
+  backend::Context context = CreateContext<Config>();
+
+  std::optional<Index<Address, AddressId>> address_index;
+  std::optional<Index<Slot, SlotId>> slot_index;
+  std::optional<Store<AddressId, Balance>> balances;
+  std::optional<Store<AddressId, Nonce>> nonces;
+  std::optional<Store<SlotId, Value>> values;
+  std::optional<Store<AddressId, AccountState>> account_state;
+  std::optional<Store<AddressId, Hash>> code_hashes;
+  std::optional<Depot<AddressId>> codes;
+  std::optional<MultiMap<AddressId, SlotId>> address_to_slots;
+
+  // Creates a task copying the given structure into a new structure of type S
+  // in the given directory.
+  auto copy = [&]<typename S>(std::optional<S>& result, const auto& structure,
+                              const char* name) -> Task {
+    return [&context, &result, &structure,
+            path = live_dir / name]() -> absl::Status {
+      ASSIGN_OR_RETURN(auto copy, backend::Copy<S>(context, structure, path));
+      result.emplace(std::move(copy));
+      return absl::OkStatus();
+    };
+  };
+
+  // The structures are independent, so they can be copied concurrently.
+  RETURN_IF_ERROR(RunInParallel({
+      copy(address_index, source.address_index_, "addresses"),
+      copy(slot_index, source.slot_index_, "slots"),
+      copy(balances, source.balances_, "balances"),
+      copy(nonces, source.nonces_, "nonces"),
+      copy(values, source.value_store_, "values"),
+      copy(account_state, source.account_states_, "account_states"),
+      copy(code_hashes, source.code_hashes_, "code_hashes"),
+      copy(codes, source.codes_, "codes"),
+      copy(address_to_slots, source.address_to_slots_, "address_to_slots"),
+  }));
+
+  return State(std::move(*address_index), std::move(*slot_index),
+               std::move(*balances), std::move(*nonces), std::move(*values),
+               std::move(*account_state), std::move(*codes),
+               std::move(*code_hashes), std::move(*address_to_slots),
+               /*archive=*/nullptr);
+}
+
 template <typename Config>
 State<Config>::State(Index<Address, AddressId> address_index,
                      Index<Slot, SlotId> slot_index,
@@ -465,6 +552,69 @@ absl::Status State<Config>::ApplyToState(const Update& update) {
   return absl::OkStatus();
 }
 
+template <typename Config>
+absl::Status State<Config>::Export(
+    absl::FunctionRef<absl::Status(const Update&)> consumer) const {
+  // The number of accounts or slots covered by a single exported update.
+  constexpr static std::size_t kBatchSize = 1 << 16;
+  ASSIGN_OR_RETURN(auto addresses, backend::GetSnapshot(address_index_));
+  ASSIGN_OR_RETURN(auto slots, backend::GetSnapshot(slot_index_));
+
+  const std::size_t num_addresses = addresses->GetSize();
+  for (std::size_t from = 0; from < num_addresses; from += kBatchSize) {
+    Update update;
+    auto batch =
+        addresses->GetKeys(from, std::min(from + kBatchSize, num_addresses));
+    for (std::size_t i = 0; i < batch.size(); i++) {
+      const Address& address = batch[i];
+      const auto addr_id = static_cast<AddressId>(from + i);
+      ASSIGN_OR_RETURN(auto account_state, account_states_.Get(addr_id));
+      if (account_state == AccountState::kExists) {
+        update.Create(address);
+      }
+      ASSIGN_OR_RETURN(auto balance, balances_.Get(addr_id));
+      if (balance != Balance{}) {
+        update.Set(address, balance);
+      }
+      ASSIGN_OR_RETURN(auto nonce, nonces_.Get(addr_id));
+      if (nonce != Nonce{}) {
+        update.Set(address, nonce);
+      }
+      auto code = codes_.Get(addr_id);
+      if (!absl::IsNotFound(code.status())) {
+        RETURN_IF_ERROR(code);
+        if (!code->empty()) {
+          update.Set(address, Code(*code));
+        }
+      }
+    }
+    RETURN_IF_ERROR(consumer(update));
+  }
+
+  // Slots of deleted accounts are reset to zero, so only non-zero values need
+  // to be exported.
+  const std::size_t num_slots = slots->GetSize();
+  for (std::size_t from = 0; from < num_slots; from += kBatchSize) {
+    Update update;
+    auto batch = slots->GetKeys(from, std::min(from + kBatchSize, num_slots));
+    for (std::size_t i = 0; i < batch.size(); i++) {
+      ASSIGN_OR_RETURN(auto value,
+                       value_store_.Get(static_cast<SlotId>(from + i)));
+      if (value == Value{}) {
+        continue;
+      }
+      const Slot& slot = batch[i];
+      auto address = addresses->GetKeys(slot.address, slot.address + 1);
+      if (address.empty()) {
+        return absl::InternalError("Slot refers to unknown address.");
+      }
+      update.Set(address[0], slot.key, value);
+    }
+    RETURN_IF_ERROR(consumer(update));
+  }
+  return absl::OkStatus();
+}
+
 template <typename Config>
 absl::StatusOr<Hash> State<Config>::GetHash() {
   ASSIGN_OR_RETURN(auto addr_idx_hash, address_index_.GetHash());
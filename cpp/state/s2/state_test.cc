@@ -10,6 +10,8 @@
 
 #include "state/s2/state.h"
 
+#include <vector>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "archive/leveldb/archive.h"
@@ -23,6 +25,7 @@
 #include "backend/store/memory/store.h"
 #include "backend/store/test_util.h"
 #include "common/account_state.h"
+#include "common/file_util.h"
 #include "common/status_test_util.h"
 #include "common/type.h"
 #include "gmock/gmock.h"
@@ -35,6 +38,7 @@ namespace carmen::s2 {
 namespace {
 
 using ::testing::_;
+using ::testing::ElementsAre;
 using ::testing::IsOkAndHolds;
 using ::testing::Return;
 using ::testing::StatusIs;
@@ -50,6 +54,60 @@ using StateConfigurations =
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Schema_2, StateTest, StateConfigurations);
 
+TEST(StateCopyTest, CopiesHaveTheSameContentAndHash) {
+  Address a{0x01};
+  Address b{0x02};
+  Key k{0x01};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto source, State<FileBasedConfig<TestArchive>>::Open(
+                                        dir.GetPath() / "source"));
+  ASSERT_OK(source.CreateAccount(a));
+  ASSERT_OK(source.SetBalance(a, Balance{0x12}));
+  ASSERT_OK(source.SetCode(a, Code{0x34}));
+  ASSERT_OK(source.SetStorageValue(a, k, Value{0x56}));
+  ASSERT_OK(source.SetStorageValue(b, k, Value{0x78}));
+  ASSERT_OK(source.DeleteAccount(b));
+  ASSERT_OK_AND_ASSIGN(auto hash, source.GetHash());
+
+  ASSERT_OK_AND_ASSIGN(auto copy,
+                       State<InMemoryConfig<TestArchive>>::CopyFrom(
+                           source, dir.GetPath() / "copy"));
+  EXPECT_THAT(copy.GetHash(), IsOkAndHolds(hash));
+  EXPECT_THAT(copy.GetAccountState(a), IsOkAndHolds(AccountState::kExists));
+  EXPECT_THAT(copy.GetBalance(a), IsOkAndHolds(Balance{0x12}));
+  EXPECT_THAT(copy.GetCode(a), IsOkAndHolds(Code{0x34}));
+  EXPECT_THAT(copy.GetStorageValue(a, k), IsOkAndHolds(Value{0x56}));
+  EXPECT_THAT(copy.GetStorageValue(b, k), IsOkAndHolds(Value{}));
+
+  // Deleting the account in the copy needs the copied address-to-slot map.
+  ASSERT_OK(copy.DeleteAccount(a));
+  EXPECT_THAT(copy.GetStorageValue(a, k), IsOkAndHolds(Value{}));
+}
+
+TEST(StateCopyTest, ExportedUpdatesOnlyContainLiveSlots) {
+  Address a{0x01};
+  Address b{0x02};
+  Key k{0x01};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto source, State<InMemoryConfig<TestArchive>>::Open(
+                                        dir.GetPath() / "source"));
+  ASSERT_OK(source.SetNonce(a, Nonce{0x12}));
+  ASSERT_OK(source.SetStorageValue(a, k, Value{0x34}));
+  ASSERT_OK(source.SetStorageValue(b, k, Value{0x56}));
+  ASSERT_OK(source.DeleteAccount(b));
+
+  std::vector<Update> updates;
+  ASSERT_OK(source.Export([&](const Update& update) {
+    updates.push_back(update);
+    return absl::OkStatus();
+  }));
+  ASSERT_EQ(updates.size(), 2);
+  EXPECT_THAT(updates[0].GetNonces(),
+              ElementsAre(Update::NonceUpdate{a, Nonce{0x12}}));
+  EXPECT_THAT(updates[1].GetStorage(),
+              ElementsAre(Update::SlotUpdate{a, k, Value{0x34}}));
+}
+
 // ------------------------ Error Handling Tests ------------------------------
 
 template <typename K, typename V>
@@ -10,29 +10,105 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <utility>
+#include <variant>
+#include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "archive/archive.h"
+#include "backend/copy.h"
+#include "backend/index/index.h"
 #include "backend/structure.h"
 #include "common/account_state.h"
 #include "common/hash.h"
 #include "common/memory_usage.h"
+#include "common/parallel.h"
 #include "common/status_util.h"
 #include "common/type.h"
+#include "state/configuration.h"
 #include "state/schema.h"
 #include "state/update.h"
 
 namespace carmen::s3 {
 
+namespace internal {
+
+// The types of slots and slot values are shared by all configurations of the
+// state, such that the structures containing them can be copied between
+// states of different configurations.
+
+// Identifies a single slot by its address ID and key.
+struct Slot {
+  std::uint32_t address;
+  Key key;
+
+  friend auto operator<=>(const Slot& a, const Slot& b) = default;
+
+  template <typename H>
+  friend H AbslHashValue(H h, const Slot& l) {
+    return H::combine(std::move(h), l.address, l.key);
+  }
+};
+
+// The value stored per storage slot, tagged with the reincarnation of the
+// account it was written in.
+struct SlotValue {
+  std::uint32_t reincarnation;
+  Value value;
+  friend auto operator<=>(const SlotValue& a, const SlotValue& b) = default;
+};
+
+// The basic properties of an account, kept in a single record by states using
+// account records.
+struct AccountRecord {
+  AccountState state;
+  Balance balance;
+  Nonce nonce;
+  Hash code_hash;
+  friend bool operator==(const AccountRecord&, const AccountRecord&) = default;
+};
+
+// Resolves the type of the ordered map keeping storage slots in the given
+// configuration, or std::monostate if storage trees are not used.
+template <typename Config>
+struct StorageTreeOf {
+  using type = std::monostate;
+};
+
+template <typename Config>
+  requires kUsesStorageTrees<Config>
+struct StorageTreeOf<Config> {
+  using type = typename Config::template OrderedMap<Slot, SlotValue>;
+};
+
+}  // namespace internal
+
 // This implementation of a state utilizes a schema where Addresses are indexed,
 // but slot keys are not. Also, it utilizes account reincarnation numbers to
 // lazily purge the state of deleted accounts.
 //
+// Configurations enabling slot recycling (see WithSlotRecycling) additionally
+// release the slots of deleted accounts incrementally while blocks are
+// applied. Released slot IDs are reused for new slots, which keeps the slot
+// index and the value store from growing with every self-destruct.
+//
+// Configurations using account records (see WithAccountRecords) keep the
+// state, balance, nonce, and code hash of each account in a single store
+// instead of four separate stores.
+//
+// Configurations using storage trees (see WithStorageTrees) keep all slots in
+// a single map ordered by address ID and key instead of the slot index and the
+// value store. The slots of an account are thereby kept on a few neighboring
+// pages, rather than being spread by the order in which they were first
+// written.
+//
 // This implementation of the state can be parameterized by the implementation
 // of index and store types, which are instantiated internally to form the
 // data infrastructure required to maintain all necessary information.
@@ -46,14 +122,55 @@ class State {
   using SlotId = std::uint32_t;
   using Reincarnation = std::uint32_t;
 
+  // Whether stale slots are released and their IDs reused.
+  constexpr static bool kRecycleSlots = kRecyclesSlots<Config>;
+
+  // The number of slot IDs inspected for stale slots per applied block.
+  constexpr static std::size_t kSlotsCollectedPerBlock = 256;
+
+  // Whether account properties are kept in a single store of records.
+  constexpr static bool kUseAccountRecords = kUsesAccountRecords<Config>;
+
+  // Whether storage slots are kept in an ordered map instead of being indexed.
+  constexpr static bool kUseStorageTrees = kUsesStorageTrees<Config>;
+
+  // Whether the structures of this state can be copied one-by-one into states
+  // of other configurations, see CopyFrom.
+  constexpr static bool kCopyable =
+      !kRecycleSlots && !kUseAccountRecords && !kUseStorageTrees;
+
   static constexpr Schema GetSchema() {
-    return StateFeature::kAddressId & StateFeature::kAccountReincarnation;
+    Schema schema =
+        StateFeature::kAddressId & StateFeature::kAccountReincarnation;
+    if constexpr (kRecycleSlots) {
+      schema = schema & StateFeature::kSlotRecycling;
+    }
+    if constexpr (kUseAccountRecords) {
+      schema = schema & StateFeature::kAccountRecords;
+    }
+    if constexpr (kUseStorageTrees) {
+      schema = schema & StateFeature::kStorageTrees;
+    }
+    return schema;
   }
 
   // Creates a new state by opening the content stored in the given directory.
   static absl::StatusOr<State> Open(const std::filesystem::path& directory,
                                     bool with_archive = false);
 
+  // Creates a new state in the given directory holding a copy of the given
+  // state, which may be based on a different configuration. Reincarnation
+  // numbers and outdated slot values are copied as they are, such that the
+  // copy has the same hash as the source. The archive is not copied. States
+  // recycling slots or using account records can not be copied this way,
+  // since their indexes may have gaps which are not reproduced by copies or
+  // their structures differ; they may be exported instead. The same holds for
+  // states using storage trees.
+  template <typename OtherConfig>
+  static absl::StatusOr<State> CopyFrom(const State<OtherConfig>& source,
+                                        const std::filesystem::path& directory)
+    requires(kCopyable && State<OtherConfig>::kCopyable);
+
   State() = default;
   State(State&&) = default;
 
@@ -91,12 +208,28 @@ class State {
   // Retrieves the hash of the code stored under the given address.
   absl::StatusOr<Hash> GetCodeHash(const Address& address) const;
 
-  // Applies the given block updates to this state.
+  // Applies the given block updates to this state. If slots are recycled,
+  // stale slots are collected afterwards, see CollectStaleSlots.
   absl::Status Apply(BlockId block, const Update& update);
 
   // Applies the changes of the provided update to the current state.
   absl::Status ApplyToState(const Update& update);
 
+  // Releases stale slots among the kSlotsCollectedPerBlock slot IDs assigned to
+  // the given block. A slot is stale if it belongs to an earlier reincarnation
+  // of its account or holds a zero value. Stale slots are removed from the slot
+  // index and their values are reset, such that their IDs can be reused. The
+  // ranges assigned to consecutive blocks cycle through all slot IDs, making
+  // the collection deterministic for a given sequence of blocks.
+  absl::Status CollectStaleSlots(BlockId block)
+    requires kRecycleSlots;
+
+  // Exports the content of this state as a sequence of updates reproducing it
+  // when applied to an empty state of any schema. Accounts are exported first,
+  // followed by the storage slots of their current reincarnation.
+  absl::Status Export(
+      absl::FunctionRef<absl::Status(const Update&)> consumer) const;
+
   // Retrieves a pointer to the owned archive or nullptr, if no archive is
   // maintained.
   Archive* GetArchive() { return archive_.get(); }
@@ -127,71 +260,120 @@ class State {
   using Depot = typename Config::template Depot<K>;
 
   // Identifies a single slot by its address/key values.
-  struct Slot {
-    AddressId address;
-    Key key;
-
-    friend auto operator<=>(const Slot& a, const Slot& b) = default;
-
-    template <typename H>
-    friend H AbslHashValue(H h, const Slot& l) {
-      return H::combine(std::move(h), l.address, l.key);
-    }
-  };
+  using Slot = internal::Slot;
 
   // Make sure the slot identifier is packed without padding since it is stored
   // on disk as a trivial value, included in hashing.
   static_assert(sizeof(Slot) == sizeof(AddressId) + sizeof(Key));
 
   // The value stored per storage slot.
-  struct SlotValue {
-    Reincarnation reincarnation;
-    Value value;
-    friend auto operator<=>(const SlotValue& a, const SlotValue& b) = default;
-  };
+  using SlotValue = internal::SlotValue;
 
   // Make sure the slot value is packed without padding since it is stored on
   // disk as a trivial value, included in hashing.
   static_assert(sizeof(SlotValue) == sizeof(Reincarnation) + sizeof(Value));
 
+  // The record of an account's properties.
+  using AccountRecord = internal::AccountRecord;
+
+  // The ordered map of slots and their values, if storage trees are used.
+  using StorageTree = typename internal::StorageTreeOf<Config>::type;
+
+  // Like slots, account records are hashed as trivial values and need to be
+  // packed without padding.
+  static_assert(sizeof(AccountRecord) == sizeof(AccountState) +
+                                             sizeof(Balance) + sizeof(Nonce) +
+                                             sizeof(Hash));
+
+  // Releasing stale slots requires the removal of keys from the slot index.
+  static_assert(!kRecycleSlots ||
+                    backend::index::RemovableIndex<Index<Slot, SlotId>>,
+                "Slot recycling requires a slot index supporting removals.");
+
+  // Slots kept in storage trees have no IDs that could be recycled.
+  static_assert(!kRecycleSlots || !kUseStorageTrees,
+                "Slot recycling is not supported for storage trees.");
+
   // Make the state constructor protected to prevent direct instantiation. The
   // state should be created by calling the static Open method. This allows
   // the state to be mocked in tests.
-  State(Index<Address, AddressId> address_index, Index<Slot, SlotId> slot_index,
-        Store<AddressId, Balance> balances, Store<AddressId, Nonce> nonces,
+  State(Index<Address, AddressId> address_index,
+        std::optional<Index<Slot, SlotId>> slot_index,
+        std::optional<Store<AddressId, Balance>> balances,
+        std::optional<Store<AddressId, Nonce>> nonces,
         Store<AddressId, Reincarnation> reincarnations,
-        Store<SlotId, SlotValue> value_store,
-        Store<AddressId, AccountState> account_states, Depot<AddressId> codes,
-        Store<AddressId, Hash> code_hashes, std::unique_ptr<Archive> archive);
-
-  // Indexes for mapping address and slots to dense, numeric IDs.
+        std::optional<Store<SlotId, SlotValue>> value_store,
+        std::optional<Store<AddressId, AccountState>> account_states,
+        Depot<AddressId> codes,
+        std::optional<Store<AddressId, Hash>> code_hashes,
+        std::unique_ptr<Archive> archive,
+        std::optional<Store<SlotId, Slot>> slot_keys = std::nullopt,
+        std::optional<Store<AddressId, AccountRecord>> accounts = std::nullopt,
+        std::optional<StorageTree> storage = std::nullopt);
+
+  // Obtains a property of the given account from its record or, if account
+  // records are not used, from the given store dedicated to the property.
+  template <auto field, typename V>
+  absl::StatusOr<V> GetAccountProperty(
+      const std::optional<Store<AddressId, V>>& store, AddressId id) const;
+
+  // Updates a property of the given account in its record or, if account
+  // records are not used, in the given store dedicated to the property.
+  template <auto field, typename V>
+  absl::Status SetAccountProperty(std::optional<Store<AddressId, V>>& store,
+                                  AddressId id, const V& value);
+
+  // Copying states of other configurations requires access to their
+  // structures.
+  template <typename>
+  friend class State;
+
+  // Indexes for mapping address and slots to dense, numeric IDs. Slots are
+  // only indexed if storage trees are not used.
   Index<Address, AddressId> address_index_;
-  Index<Slot, SlotId> slot_index_;
+  std::optional<Index<Slot, SlotId>> slot_index_;
 
-  // A store retaining the current balance of all accounts.
-  Store<AddressId, Balance> balances_;
+  // A store retaining the current balance of all accounts, unless account
+  // records are used.
+  std::optional<Store<AddressId, Balance>> balances_;
 
-  // A store retaining the current nonces of all accounts.
-  Store<AddressId, Nonce> nonces_;
+  // A store retaining the current nonces of all accounts, unless account
+  // records are used.
+  std::optional<Store<AddressId, Nonce>> nonces_;
 
   // A store retaining the current reincarnation of all accounts.
   Store<AddressId, Reincarnation> reincarnations_;
 
-  // The store retaining all values for the covered storage slots.
-  Store<SlotId, SlotValue> value_store_;
+  // The store retaining all values for the covered storage slots, unless
+  // storage trees are used.
+  std::optional<Store<SlotId, SlotValue>> value_store_;
 
-  // The store retaining account state information.
-  Store<AddressId, AccountState> account_states_;
+  // The store retaining account state information, unless account records
+  // are used.
+  std::optional<Store<AddressId, AccountState>> account_states_;
 
   // The code depot to retain account contracts.
   Depot<AddressId> codes_;
 
-  // A store to retain code hashes.
-  Store<AddressId, Hash> code_hashes_;
+  // A store to retain code hashes, unless account records are used.
+  std::optional<Store<AddressId, Hash>> code_hashes_;
 
   // A pointer to the optionally included archive.
   std::unique_ptr<Archive> archive_;
 
+  // If slots are recycled, a store mapping slot IDs back to their slots, which
+  // is required for locating stale slots in the slot index. It is derived from
+  // the slot index and thus not included in the state hash.
+  std::optional<Store<SlotId, Slot>> slot_keys_;
+
+  // If account records are used, the store retaining the state, balance,
+  // nonce, and code hash of all accounts, replacing the individual stores.
+  std::optional<Store<AddressId, AccountRecord>> accounts_;
+
+  // If storage trees are used, the map retaining all slots and their values,
+  // replacing the slot index and the value store.
+  std::optional<StorageTree> storage_;
+
   // A constant for the hash of the empty code.
   static const Hash kEmptyCodeHash;
 };
@@ -204,27 +386,57 @@ const Hash State<Config>::kEmptyCodeHash = GetKeccak256Hash({});
 template <typename Config>
 absl::StatusOr<State<Config>> State<Config>::Open(
     const std::filesystem::path& dir, bool with_archive) {
-  backend::Context context;
+  backend::Context context = CreateContext<Config>();
   const auto live_dir = dir / "live";
   ASSIGN_OR_RETURN(auto address_index, (Index<Address, AddressId>::Open(
                                            context, live_dir / "addresses")));
-  ASSIGN_OR_RETURN(auto slot_index,
-                   (Index<Slot, SlotId>::Open(context, live_dir / "slots")));
-
-  ASSIGN_OR_RETURN(auto balances, (Store<AddressId, Balance>::Open(
-                                      context, live_dir / "balances")));
-  ASSIGN_OR_RETURN(auto nonces, (Store<AddressId, Nonce>::Open(
-                                    context, live_dir / "nonces")));
   ASSIGN_OR_RETURN(auto reincarnations,
                    (Store<AddressId, Reincarnation>::Open(
                        context, live_dir / "reincarnations")));
-  ASSIGN_OR_RETURN(auto values, (Store<SlotId, SlotValue>::Open(
-                                    context, live_dir / "values")));
-  ASSIGN_OR_RETURN(auto account_state,
-                   (Store<AddressId, AccountState>::Open(
-                       context, live_dir / "account_states")));
-  ASSIGN_OR_RETURN(auto code_hashes, (Store<AddressId, Hash>::Open(
-                                         context, live_dir / "code_hashes")));
+
+  // Slots are either kept in a storage tree or indexed and stored by ID.
+  std::optional<StorageTree> storage;
+  std::optional<Index<Slot, SlotId>> slot_index;
+  std::optional<Store<SlotId, SlotValue>> values;
+  if constexpr (kUseStorageTrees) {
+    ASSIGN_OR_RETURN(auto tree,
+                     StorageTree::Open(context, live_dir / "storage"));
+    storage.emplace(std::move(tree));
+  } else {
+    ASSIGN_OR_RETURN(auto index, (Index<Slot, SlotId>::Open(
+                                     context, live_dir / "slots")));
+    slot_index.emplace(std::move(index));
+    ASSIGN_OR_RETURN(auto value_store, (Store<SlotId, SlotValue>::Open(
+                                           context, live_dir / "values")));
+    values.emplace(std::move(value_store));
+  }
+
+  // Account properties are either kept in records or in individual stores.
+  std::optional<Store<AddressId, AccountRecord>> accounts;
+  std::optional<Store<AddressId, Balance>> balances;
+  std::optional<Store<AddressId, Nonce>> nonces;
+  std::optional<Store<AddressId, AccountState>> account_state;
+  std::optional<Store<AddressId, Hash>> code_hashes;
+  if constexpr (kUseAccountRecords) {
+    ASSIGN_OR_RETURN(auto records, (Store<AddressId, AccountRecord>::Open(
+                                       context, live_dir / "accounts")));
+    accounts.emplace(std::move(records));
+  } else {
+    ASSIGN_OR_RETURN(auto balance_store, (Store<AddressId, Balance>::Open(
+                                             context, live_dir / "balances")));
+    balances.emplace(std::move(balance_store));
+    ASSIGN_OR_RETURN(auto nonce_store, (Store<AddressId, Nonce>::Open(
+                                           context, live_dir / "nonces")));
+    nonces.emplace(std::move(nonce_store));
+    ASSIGN_OR_RETURN(auto account_state_store,
+                     (Store<AddressId, AccountState>::Open(
+                         context, live_dir / "account_states")));
+    account_state.emplace(std::move(account_state_store));
+    ASSIGN_OR_RETURN(auto code_hash_store,
+                     (Store<AddressId, Hash>::Open(
+                         context, live_dir / "code_hashes")));
+    code_hashes.emplace(std::move(code_hash_store));
+  }
 
   ASSIGN_OR_RETURN(auto codes,
                    (Depot<AddressId>::Open(context, live_dir / "codes")));
@@ -235,23 +447,90 @@ absl::StatusOr<State<Config>> State<Config>::Open(
     archive = std::make_unique<Archive>(std::move(instance));
   }
 
+  std::optional<Store<SlotId, Slot>> slot_keys;
+  if constexpr (kRecycleSlots) {
+    ASSIGN_OR_RETURN(auto keys, (Store<SlotId, Slot>::Open(
+                                    context, live_dir / "slot_keys")));
+    slot_keys.emplace(std::move(keys));
+  }
+
   return State(std::move(address_index), std::move(slot_index),
                std::move(balances), std::move(nonces),
                std::move(reincarnations), std::move(values),
                std::move(account_state), std::move(codes),
-               std::move(code_hashes), std::move(archive));
+               std::move(code_hashes), std::move(archive),
+               std::move(slot_keys), std::move(accounts), std::move(storage));
+}
+
+template <typename Config>
+template <typename OtherConfig>
+absl::StatusOr<State<Config>> State<Config>::CopyFrom(
+    const State<OtherConfig>& source, const std::filesystem::path& dir)
+  requires(kCopyable && State<OtherConfig>::kCopyable)
+{
+  const auto live_dir = dir / "live";
+  if (std::filesystem::exists(live_dir)) {
+    return absl::FailedPreconditionError(
+        "Target directory already contains a state.");
+  }
+  backend::Context context = CreateContext<Config>();
+
+  std::optional<Index<Address, AddressId>> address_index;
+  std::optional<Index<Slot, SlotId>> slot_index;
+  std::optional<Store<AddressId, Balance>> balances;
+  std::optional<Store<AddressId, Nonce>> nonces;
+  std::optional<Store<AddressId, Reincarnation>> reincarnations;
+  std::optional<Store<SlotId, SlotValue>> values;
+  std::optional<Store<AddressId, AccountState>> account_state;
+  std::optional<Store<AddressId, Hash>> code_hashes;
+  std::optional<Depot<AddressId>> codes;
+
+  // Creates a task copying the given structure into a new structure of type S
+  // in the given directory.
+  auto copy = [&]<typename S>(std::optional<S>& result, const auto& structure,
+                              const char* name) -> Task {
+    return [&context, &result, &structure,
+            path = live_dir / name]() -> absl::Status {
+      ASSIGN_OR_RETURN(auto copy, backend::Copy<S>(context, structure, path));
+      result.emplace(std::move(copy));
+      return absl::OkStatus();
+    };
+  };
+
+  // The structures are independent, so they can be copied concurrently.
+  RETURN_IF_ERROR(RunInParallel({
+      copy(address_index, source.address_index_, "addresses"),
+      copy(slot_index, *source.slot_index_, "slots"),
+      copy(balances, *source.balances_, "balances"),
+      copy(nonces, *source.nonces_, "nonces"),
+      copy(reincarnations, source.reincarnations_, "reincarnations"),
+      copy(values, *source.value_store_, "values"),
+      copy(account_state, *source.account_states_, "account_states"),
+      copy(code_hashes, *source.code_hashes_, "code_hashes"),
+      copy(codes, source.codes_, "codes"),
+  }));
+
+  return State(std::move(*address_index), std::move(slot_index),
+               std::move(balances), std::move(nonces),
+               std::move(*reincarnations), std::move(values),
+               std::move(account_state), std::move(*codes),
+               std::move(code_hashes), /*archive=*/nullptr);
 }
 
 template <typename Config>
-State<Config>::State(Index<Address, AddressId> address_index,
-                     Index<Slot, SlotId> slot_index,
-                     Store<AddressId, Balance> balances,
-                     Store<AddressId, Nonce> nonces,
-                     Store<AddressId, Reincarnation> reincarnations,
-                     Store<SlotId, SlotValue> value_store,
-                     Store<AddressId, AccountState> account_states,
-                     Depot<AddressId> codes, Store<AddressId, Hash> code_hashes,
-                     std::unique_ptr<Archive> archive)
+State<Config>::State(
+    Index<Address, AddressId> address_index,
+    std::optional<Index<Slot, SlotId>> slot_index,
+    std::optional<Store<AddressId, Balance>> balances,
+    std::optional<Store<AddressId, Nonce>> nonces,
+    Store<AddressId, Reincarnation> reincarnations,
+    std::optional<Store<SlotId, SlotValue>> value_store,
+    std::optional<Store<AddressId, AccountState>> account_states,
+    Depot<AddressId> codes, std::optional<Store<AddressId, Hash>> code_hashes,
+    std::unique_ptr<Archive> archive,
+    std::optional<Store<SlotId, Slot>> slot_keys,
+    std::optional<Store<AddressId, AccountRecord>> accounts,
+    std::optional<StorageTree> storage)
     : address_index_(std::move(address_index)),
       slot_index_(std::move(slot_index)),
       balances_(std::move(balances)),
@@ -261,12 +540,41 @@ State<Config>::State(Index<Address, AddressId> address_index,
       account_states_(std::move(account_states)),
       codes_(std::move(codes)),
       code_hashes_(std::move(code_hashes)),
-      archive_(std::move(archive)) {}
+      archive_(std::move(archive)),
+      slot_keys_(std::move(slot_keys)),
+      accounts_(std::move(accounts)),
+      storage_(std::move(storage)) {}
+
+template <typename Config>
+template <auto field, typename V>
+absl::StatusOr<V> State<Config>::GetAccountProperty(
+    const std::optional<Store<AddressId, V>>& store, AddressId id) const {
+  if constexpr (kUseAccountRecords) {
+    ASSIGN_OR_RETURN(AccountRecord record, accounts_->Get(id));
+    return record.*field;
+  } else {
+    return store->Get(id);
+  }
+}
+
+template <typename Config>
+template <auto field, typename V>
+absl::Status State<Config>::SetAccountProperty(
+    std::optional<Store<AddressId, V>>& store, AddressId id, const V& value) {
+  if constexpr (kUseAccountRecords) {
+    ASSIGN_OR_RETURN(AccountRecord record, accounts_->Get(id));
+    record.*field = value;
+    return accounts_->Set(id, record);
+  } else {
+    return store->Set(id, value);
+  }
+}
 
 template <typename Config>
 absl::Status State<Config>::CreateAccount(const Address& address) {
   ASSIGN_OR_RETURN(auto addr_id, address_index_.GetOrAdd(address));
-  RETURN_IF_ERROR(account_states_.Set(addr_id.first, AccountState::kExists));
+  RETURN_IF_ERROR(SetAccountProperty<&AccountRecord::state>(
+      account_states_, addr_id.first, AccountState::kExists));
   ASSIGN_OR_RETURN(auto reincarnation, reincarnations_.Get(addr_id.first));
   return reincarnations_.Set(addr_id.first, reincarnation + 1);
 }
@@ -279,7 +587,7 @@ absl::StatusOr<AccountState> State<Config>::GetAccountState(
     return AccountState::kUnknown;
   }
   RETURN_IF_ERROR(addr_id);
-  return account_states_.Get(*addr_id);
+  return GetAccountProperty<&AccountRecord::state>(account_states_, *addr_id);
 }
 
 template <typename Config>
@@ -289,7 +597,8 @@ absl::Status State<Config>::DeleteAccount(const Address& address) {
     return absl::OkStatus();
   }
   RETURN_IF_ERROR(addr_id);
-  RETURN_IF_ERROR(account_states_.Set(*addr_id, AccountState::kUnknown));
+  RETURN_IF_ERROR(SetAccountProperty<&AccountRecord::state>(
+      account_states_, *addr_id, AccountState::kUnknown));
   ASSIGN_OR_RETURN(auto reincarnation, reincarnations_.Get(*addr_id));
   return reincarnations_.Set(*addr_id, reincarnation + 1);
 }
@@ -303,13 +612,14 @@ absl::StatusOr<Balance> State<Config>::GetBalance(
     return kZero;
   }
   RETURN_IF_ERROR(addr_id);
-  return balances_.Get(*addr_id);
+  return GetAccountProperty<&AccountRecord::balance>(balances_, *addr_id);
 }
 
 template <typename Config>
 absl::Status State<Config>::SetBalance(const Address& address, Balance value) {
   ASSIGN_OR_RETURN(auto addr_id, address_index_.GetOrAdd(address));
-  return balances_.Set(addr_id.first, value);
+  return SetAccountProperty<&AccountRecord::balance>(balances_, addr_id.first,
+                                                     value);
 }
 
 template <typename Config>
@@ -320,13 +630,14 @@ absl::StatusOr<Nonce> State<Config>::GetNonce(const Address& address) const {
     return kZero;
   }
   RETURN_IF_ERROR(addr_id);
-  return nonces_.Get(*addr_id);
+  return GetAccountProperty<&AccountRecord::nonce>(nonces_, *addr_id);
 }
 
 template <typename Config>
 absl::Status State<Config>::SetNonce(const Address& address, Nonce value) {
   ASSIGN_OR_RETURN(auto addr_id, address_index_.GetOrAdd(address));
-  return nonces_.Set(addr_id.first, value);
+  return SetAccountProperty<&AccountRecord::nonce>(nonces_, addr_id.first,
+                                                   value);
 }
 
 template <typename Config>
@@ -339,13 +650,23 @@ absl::StatusOr<Value> State<Config>::GetStorageValue(const Address& address,
   }
   RETURN_IF_ERROR(addr_id);
   Slot slot{*addr_id, key};
-  auto slot_id = slot_index_.Get(slot);
+  if constexpr (kUseStorageTrees) {
+    ASSIGN_OR_RETURN(auto pos, storage_->Find(slot));
+    ASSIGN_OR_RETURN(auto end, storage_->End());
+    if (pos == end) {
+      return kZero;
+    }
+    const SlotValue value = (*pos).value;
+    ASSIGN_OR_RETURN(auto reincarnation, reincarnations_.Get(*addr_id));
+    return value.reincarnation == reincarnation ? value.value : kZero;
+  }
+  auto slot_id = slot_index_->Get(slot);
   if (absl::IsNotFound(slot_id.status())) {
     return kZero;
   }
   RETURN_IF_ERROR(slot_id);
   ASSIGN_OR_RETURN(auto reincarnation, reincarnations_.Get(*addr_id));
-  ASSIGN_OR_RETURN(const SlotValue& value, value_store_.Get(*slot_id));
+  ASSIGN_OR_RETURN(const SlotValue& value, value_store_->Get(*slot_id));
   return value.reincarnation == reincarnation ? value.value : kZero;
 }
 
@@ -355,10 +676,18 @@ absl::Status State<Config>::SetStorageValue(const Address& address,
                                             const Value& value) {
   ASSIGN_OR_RETURN(auto addr_id, address_index_.GetOrAdd(address));
   Slot slot{addr_id.first, key};
-  ASSIGN_OR_RETURN(auto slot_id, slot_index_.GetOrAdd(slot));
+  if constexpr (kUseStorageTrees) {
+    ASSIGN_OR_RETURN(auto reincarnation, reincarnations_.Get(addr_id.first));
+    return storage_->InsertOrAssign(slot, SlotValue{reincarnation, value})
+        .status();
+  }
+  ASSIGN_OR_RETURN(auto slot_id, slot_index_->GetOrAdd(slot));
+  if (slot_keys_ && slot_id.second) {
+    RETURN_IF_ERROR(slot_keys_->Set(slot_id.first, slot));
+  }
   ASSIGN_OR_RETURN(auto reincarnation, reincarnations_.Get(addr_id.first));
   RETURN_IF_ERROR(
-      value_store_.Set(slot_id.first, SlotValue{reincarnation, value}));
+      value_store_->Set(slot_id.first, SlotValue{reincarnation, value}));
   return absl::OkStatus();
 }
 
@@ -383,8 +712,9 @@ absl::Status State<Config>::SetCode(const Address& address,
                                     std::span<const std::byte> code) {
   ASSIGN_OR_RETURN(auto addr_id, address_index_.GetOrAdd(address));
   RETURN_IF_ERROR(codes_.Set(addr_id.first, code));
-  return code_hashes_.Set(
-      addr_id.first, code.empty() ? kEmptyCodeHash : GetKeccak256Hash(code));
+  return SetAccountProperty<&AccountRecord::code_hash>(
+      code_hashes_, addr_id.first,
+      code.empty() ? kEmptyCodeHash : GetKeccak256Hash(code));
 }
 
 template <typename Config>
@@ -411,7 +741,9 @@ absl::StatusOr<Hash> State<Config>::GetCodeHash(const Address& address) const {
     return kEmptyCodeHash;
   }
   RETURN_IF_ERROR(addr_id);
-  ASSIGN_OR_RETURN(auto code_hash, code_hashes_.Get(*addr_id));
+  ASSIGN_OR_RETURN(auto code_hash,
+                   GetAccountProperty<&AccountRecord::code_hash>(code_hashes_,
+                                                                 *addr_id));
   // The default value of hashes in the store is the zero hash.
   // However, for empty codes, the hash of an empty code should
   // be returned. The only exception would be the very unlikely
@@ -434,6 +766,9 @@ absl::Status State<Config>::Apply(BlockId block, const Update& update) {
     // TODO: run in background thread
     RETURN_IF_ERROR(archive_->Add(block, update));
   }
+  if constexpr (kRecycleSlots) {
+    RETURN_IF_ERROR(CollectStaleSlots(block));
+  }
   return absl::OkStatus();
 }
 
@@ -461,15 +796,169 @@ absl::Status State<Config>::ApplyToState(const Update& update) {
   return absl::OkStatus();
 }
 
+template <typename Config>
+absl::Status State<Config>::CollectStaleSlots(BlockId block)
+  requires kRecycleSlots
+{
+  const std::size_t bound = value_store_->GetKeyBound();
+  if (bound == 0) {
+    return absl::OkStatus();
+  }
+  const std::size_t count = std::min(kSlotsCollectedPerBlock, bound);
+  const std::size_t start = (block * kSlotsCollectedPerBlock) % bound;
+  for (std::size_t i = 0; i < count; i++) {
+    const auto id = static_cast<SlotId>((start + i) % bound);
+    ASSIGN_OR_RETURN(SlotValue value, value_store_->Get(id));
+    ASSIGN_OR_RETURN(Slot slot, slot_keys_->Get(id));
+    if (value.value != Value{}) {
+      ASSIGN_OR_RETURN(auto reincarnation, reincarnations_.Get(slot.address));
+      if (value.reincarnation == reincarnation) {
+        continue;
+      }
+    }
+    // The slot key store is not updated on removals, so released IDs still
+    // refer to their former slots, which may have been added again since.
+    auto current = slot_index_->Get(slot);
+    if (absl::IsNotFound(current.status())) {
+      continue;
+    }
+    RETURN_IF_ERROR(current);
+    if (*current != id) {
+      continue;
+    }
+    RETURN_IF_ERROR(slot_index_->Remove(slot));
+    RETURN_IF_ERROR(value_store_->Set(id, SlotValue{}));
+  }
+  return absl::OkStatus();
+}
+
+template <typename Config>
+absl::Status State<Config>::Export(
+    absl::FunctionRef<absl::Status(const Update&)> consumer) const {
+  // The number of accounts or slots covered by a single exported update.
+  constexpr static std::size_t kBatchSize = 1 << 16;
+  ASSIGN_OR_RETURN(auto addresses, backend::GetSnapshot(address_index_));
+
+  const std::size_t num_addresses = addresses->GetSize();
+  for (std::size_t from = 0; from < num_addresses; from += kBatchSize) {
+    Update update;
+    auto batch =
+        addresses->GetKeys(from, std::min(from + kBatchSize, num_addresses));
+    for (std::size_t i = 0; i < batch.size(); i++) {
+      const Address& address = batch[i];
+      const auto addr_id = static_cast<AddressId>(from + i);
+      ASSIGN_OR_RETURN(auto account_state,
+                       GetAccountProperty<&AccountRecord::state>(
+                           account_states_, addr_id));
+      if (account_state == AccountState::kExists) {
+        update.Create(address);
+      }
+      ASSIGN_OR_RETURN(auto balance,
+                       GetAccountProperty<&AccountRecord::balance>(balances_,
+                                                                   addr_id));
+      if (balance != Balance{}) {
+        update.Set(address, balance);
+      }
+      ASSIGN_OR_RETURN(auto nonce, GetAccountProperty<&AccountRecord::nonce>(
+                                       nonces_, addr_id));
+      if (nonce != Nonce{}) {
+        update.Set(address, nonce);
+      }
+      auto code = codes_.Get(addr_id);
+      if (!absl::IsNotFound(code.status())) {
+        RETURN_IF_ERROR(code);
+        if (!code->empty()) {
+          update.Set(address, Code(*code));
+        }
+      }
+    }
+    RETURN_IF_ERROR(consumer(update));
+  }
+
+  // Values written in former reincarnations of an account are outdated and
+  // are not exported.
+  auto add_slot = [&](Update& update, const Slot& slot,
+                      const SlotValue& value) -> absl::Status {
+    if (value.value == Value{}) {
+      return absl::OkStatus();
+    }
+    ASSIGN_OR_RETURN(auto reincarnation, reincarnations_.Get(slot.address));
+    if (value.reincarnation != reincarnation) {
+      return absl::OkStatus();
+    }
+    auto address = addresses->GetKeys(slot.address, slot.address + 1);
+    if (address.empty()) {
+      return absl::InternalError("Slot refers to unknown address.");
+    }
+    update.Set(address[0], slot.key, value.value);
+    return absl::OkStatus();
+  };
+
+  if constexpr (kUseStorageTrees) {
+    ASSIGN_OR_RETURN(auto pos, storage_->Begin());
+    ASSIGN_OR_RETURN(auto end, storage_->End());
+    while (pos != end) {
+      Update update;
+      for (std::size_t i = 0; i < kBatchSize && pos != end; i++) {
+        const auto entry = *pos;
+        RETURN_IF_ERROR(add_slot(update, entry.key, entry.value));
+        RETURN_IF_ERROR(pos.Next());
+      }
+      RETURN_IF_ERROR(consumer(update));
+    }
+    return absl::OkStatus();
+  }
+
+  ASSIGN_OR_RETURN(auto slots, backend::GetSnapshot(*slot_index_));
+  const std::size_t num_slots = slots->GetSize();
+  for (std::size_t from = 0; from < num_slots; from += kBatchSize) {
+    Update update;
+    auto batch = slots->GetKeys(from, std::min(from + kBatchSize, num_slots));
+    for (std::size_t i = 0; i < batch.size(); i++) {
+      ASSIGN_OR_RETURN(SlotValue value,
+                       value_store_->Get(static_cast<SlotId>(from + i)));
+      RETURN_IF_ERROR(add_slot(update, batch[i], value));
+    }
+    RETURN_IF_ERROR(consumer(update));
+  }
+  return absl::OkStatus();
+}
+
 template <typename Config>
 absl::StatusOr<Hash> State<Config>::GetHash() {
   ASSIGN_OR_RETURN(auto addr_idx_hash, address_index_.GetHash());
-  ASSIGN_OR_RETURN(auto slot_idx_hash, slot_index_.GetHash());
-  ASSIGN_OR_RETURN(auto bal_hash, balances_.GetHash());
-  ASSIGN_OR_RETURN(auto nonces_hash, nonces_.GetHash());
+  // With storage trees, all slots and their values are covered by the hash of
+  // the tree, taking the place of the slot index hash. The hash of the missing
+  // value store is zero.
+  auto get_slot_idx_hash = [&]() -> absl::StatusOr<Hash> {
+    if constexpr (kUseStorageTrees) {
+      return storage_->GetHash();
+    } else {
+      return slot_index_->GetHash();
+    }
+  };
+  auto get_val_store_hash = [&]() -> absl::StatusOr<Hash> {
+    if constexpr (kUseStorageTrees) {
+      return Hash{};
+    } else {
+      return value_store_->GetHash();
+    }
+  };
+  ASSIGN_OR_RETURN(auto slot_idx_hash, get_slot_idx_hash());
+  if constexpr (kUseAccountRecords) {
+    // All account properties are covered by the hash of the account records.
+    ASSIGN_OR_RETURN(auto accounts_hash, accounts_->GetHash());
+    ASSIGN_OR_RETURN(auto reincarnation_hash, reincarnations_.GetHash());
+    ASSIGN_OR_RETURN(auto val_store_hash, get_val_store_hash());
+    ASSIGN_OR_RETURN(auto codes_hash, codes_.GetHash());
+    return GetSha256Hash(addr_idx_hash, slot_idx_hash, accounts_hash,
+                         reincarnation_hash, val_store_hash, codes_hash);
+  }
+  ASSIGN_OR_RETURN(auto bal_hash, balances_->GetHash());
+  ASSIGN_OR_RETURN(auto nonces_hash, nonces_->GetHash());
   ASSIGN_OR_RETURN(auto reincarnation_hash, reincarnations_.GetHash());
-  ASSIGN_OR_RETURN(auto val_store_hash, value_store_.GetHash());
-  ASSIGN_OR_RETURN(auto acc_states_hash, account_states_.GetHash());
+  ASSIGN_OR_RETURN(auto val_store_hash, get_val_store_hash());
+  ASSIGN_OR_RETURN(auto acc_states_hash, account_states_->GetHash());
   ASSIGN_OR_RETURN(auto codes_hash, codes_.GetHash());
   return GetSha256Hash(addr_idx_hash, slot_idx_hash, bal_hash, nonces_hash,
                        reincarnation_hash, val_store_hash, acc_states_hash,
@@ -479,14 +968,25 @@ absl::StatusOr<Hash> State<Config>::GetHash() {
 template <typename Config>
 absl::Status State<Config>::Flush() {
   RETURN_IF_ERROR(address_index_.Flush());
-  RETURN_IF_ERROR(slot_index_.Flush());
-  RETURN_IF_ERROR(account_states_.Flush());
-  RETURN_IF_ERROR(balances_.Flush());
-  RETURN_IF_ERROR(nonces_.Flush());
+  if constexpr (kUseStorageTrees) {
+    RETURN_IF_ERROR(storage_->Flush());
+  } else {
+    RETURN_IF_ERROR(slot_index_->Flush());
+    RETURN_IF_ERROR(value_store_->Flush());
+  }
+  if (accounts_) {
+    RETURN_IF_ERROR(accounts_->Flush());
+  } else {
+    RETURN_IF_ERROR(account_states_->Flush());
+    RETURN_IF_ERROR(balances_->Flush());
+    RETURN_IF_ERROR(nonces_->Flush());
+    RETURN_IF_ERROR(code_hashes_->Flush());
+  }
   RETURN_IF_ERROR(reincarnations_.Flush());
-  RETURN_IF_ERROR(value_store_.Flush());
   RETURN_IF_ERROR(codes_.Flush());
-  RETURN_IF_ERROR(code_hashes_.Flush());
+  if (slot_keys_) {
+    RETURN_IF_ERROR(slot_keys_->Flush());
+  }
   if (archive_) {
     RETURN_IF_ERROR(archive_->Flush());
   }
@@ -496,14 +996,25 @@ absl::Status State<Config>::Flush() {
 template <typename Config>
 absl::Status State<Config>::Close() {
   RETURN_IF_ERROR(address_index_.Close());
-  RETURN_IF_ERROR(slot_index_.Close());
-  RETURN_IF_ERROR(account_states_.Close());
-  RETURN_IF_ERROR(balances_.Close());
-  RETURN_IF_ERROR(nonces_.Close());
-  RETURN_IF_ERROR(value_store_.Close());
+  if constexpr (kUseStorageTrees) {
+    RETURN_IF_ERROR(storage_->Close());
+  } else {
+    RETURN_IF_ERROR(slot_index_->Close());
+    RETURN_IF_ERROR(value_store_->Close());
+  }
+  if (accounts_) {
+    RETURN_IF_ERROR(accounts_->Close());
+  } else {
+    RETURN_IF_ERROR(account_states_->Close());
+    RETURN_IF_ERROR(balances_->Close());
+    RETURN_IF_ERROR(nonces_->Close());
+    RETURN_IF_ERROR(code_hashes_->Close());
+  }
   RETURN_IF_ERROR(codes_.Close());
-  RETURN_IF_ERROR(code_hashes_.Close());
   RETURN_IF_ERROR(reincarnations_.Close());
+  if (slot_keys_) {
+    RETURN_IF_ERROR(slot_keys_->Close());
+  }
   if (archive_) {
     RETURN_IF_ERROR(archive_->Close());
   }
@@ -514,13 +1025,25 @@ template <typename Config>
 MemoryFootprint State<Config>::GetMemoryFootprint() const {
   MemoryFootprint res(*this);
   res.Add("address_index", address_index_.GetMemoryFootprint());
-  res.Add("slot_index", slot_index_.GetMemoryFootprint());
-  res.Add("balances", balances_.GetMemoryFootprint());
-  res.Add("nonces", nonces_.GetMemoryFootprint());
-  res.Add("value_store", value_store_.GetMemoryFootprint());
+  if constexpr (kUseStorageTrees) {
+    res.Add("storage", storage_->GetMemoryFootprint());
+  } else {
+    res.Add("slot_index", slot_index_->GetMemoryFootprint());
+    res.Add("value_store", value_store_->GetMemoryFootprint());
+  }
+  if (accounts_) {
+    res.Add("accounts", accounts_->GetMemoryFootprint());
+  } else {
+    res.Add("balances", balances_->GetMemoryFootprint());
+    res.Add("nonces", nonces_->GetMemoryFootprint());
+    res.Add("account_states", account_states_->GetMemoryFootprint());
+    res.Add("code_hashes", code_hashes_->GetMemoryFootprint());
+  }
   res.Add("codes", codes_.GetMemoryFootprint());
-  res.Add("code_hashes", code_hashes_.GetMemoryFootprint());
   res.Add("reincarnations", reincarnations_.GetMemoryFootprint());
+  if (slot_keys_) {
+    res.Add("slot_keys", slot_keys_->GetMemoryFootprint());
+  }
   if (archive_) {
     res.Add("archive", archive_->GetMemoryFootprint());
   }
@@ -10,6 +10,8 @@
 
 #include "state/s3/state.h"
 
+#include <array>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "archive/leveldb/archive.h"
@@ -23,11 +25,14 @@
 #include "backend/store/memory/store.h"
 #include "backend/store/test_util.h"
 #include "common/account_state.h"
+#include "common/file_util.h"
+#include "common/hash.h"
 #include "common/status_test_util.h"
 #include "common/type.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "state/configurations.h"
+#include "state/s1/state.h"
 #include "state/state_test_suite.h"
 #include "state/update.h"
 
@@ -36,6 +41,8 @@ namespace {
 
 using ::testing::_;
 using ::testing::IsOkAndHolds;
+using ::testing::Lt;
+using ::testing::Not;
 using ::testing::Return;
 using ::testing::StatusIs;
 
@@ -46,10 +53,426 @@ using TestArchive = archive::leveldb::LevelDbArchive;
 using StateConfigurations =
     ::testing::Types<State<InMemoryConfig<TestArchive>>,
                      State<FileBasedConfig<TestArchive>>,
-                     State<LevelDbBasedConfig<TestArchive>>>;
+                     State<LevelDbBasedConfig<TestArchive>>,
+                     State<WithSlotRecycling<InMemoryConfig<TestArchive>>>,
+                     State<WithSlotRecycling<FileBasedConfig<TestArchive>>>,
+                     State<WithAccountRecords<InMemoryConfig<TestArchive>>>,
+                     State<WithAccountRecords<FileBasedConfig<TestArchive>>>,
+                     State<WithStorageTrees<InMemoryConfig<TestArchive>,
+                                            FileBasedOrderedMap>>,
+                     State<WithStorageTrees<FileBasedConfig<TestArchive>,
+                                            FileBasedOrderedMap>>>;
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Schema_3, StateTest, StateConfigurations);
 
+TEST(StateCopyTest, CopiesRetainOutdatedSlotsAndTheHash) {
+  Address a{0x01};
+  Key k{0x01};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto source, State<FileBasedConfig<TestArchive>>::Open(
+                                        dir.GetPath() / "source"));
+  ASSERT_OK(source.CreateAccount(a));
+  ASSERT_OK(source.SetStorageValue(a, k, Value{0x12}));
+  ASSERT_OK(source.DeleteAccount(a));
+  ASSERT_OK(source.SetBalance(a, Balance{0x34}));
+  ASSERT_OK_AND_ASSIGN(auto hash, source.GetHash());
+
+  ASSERT_OK_AND_ASSIGN(auto copy,
+                       State<InMemoryConfig<TestArchive>>::CopyFrom(
+                           source, dir.GetPath() / "copy"));
+  EXPECT_THAT(copy.GetHash(), IsOkAndHolds(hash));
+  EXPECT_THAT(copy.GetBalance(a), IsOkAndHolds(Balance{0x34}));
+  EXPECT_THAT(copy.GetStorageValue(a, k), IsOkAndHolds(Value{}));
+
+  // Recreating the account in the copy does not revive the outdated slot.
+  ASSERT_OK(copy.CreateAccount(a));
+  EXPECT_THAT(copy.GetStorageValue(a, k), IsOkAndHolds(Value{}));
+}
+
+TEST(StateCopyTest, ExportedUpdatesCanBeAppliedToOtherSchemas) {
+  Address a{0x01};
+  Address b{0x02};
+  Key k{0x01};
+  Key l{0x02};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto source, State<InMemoryConfig<TestArchive>>::Open(
+                                        dir.GetPath() / "source"));
+  ASSERT_OK(source.CreateAccount(a));
+  ASSERT_OK(source.SetStorageValue(a, k, Value{0x12}));
+  ASSERT_OK(source.CreateAccount(a));
+  ASSERT_OK(source.SetStorageValue(a, l, Value{0x34}));
+  ASSERT_OK(source.SetCode(b, Code{0x56}));
+
+  ASSERT_OK_AND_ASSIGN(auto target,
+                       s1::State<FileBasedConfig<TestArchive>>::Open(
+                           dir.GetPath() / "target"));
+  ASSERT_OK(source.Export(
+      [&](const Update& update) { return target.ApplyToState(update); }));
+  EXPECT_THAT(target.GetAccountState(a), IsOkAndHolds(AccountState::kExists));
+  EXPECT_THAT(target.GetStorageValue(a, k), IsOkAndHolds(Value{}));
+  EXPECT_THAT(target.GetStorageValue(a, l), IsOkAndHolds(Value{0x34}));
+  EXPECT_THAT(target.GetAccountState(b), IsOkAndHolds(AccountState::kUnknown));
+  EXPECT_THAT(target.GetCode(b), IsOkAndHolds(Code{0x56}));
+}
+
+// ------------------------- Slot Recycling Tests -----------------------------
+
+// Extends a state by an accessor for the IDs assigned to slots.
+template <typename State>
+class SlotIdProbe : public State {
+ public:
+  SlotIdProbe(State state) : State(std::move(state)) {}
+
+  absl::StatusOr<std::uint32_t> GetSlotId(const Address& address,
+                                          const Key& key) const {
+    ASSIGN_OR_RETURN(auto address_id, this->address_index_.Get(address));
+    return this->slot_index_->Get({address_id, key});
+  }
+};
+
+template <typename State>
+class SlotRecyclingTest : public ::testing::Test {};
+
+using RecyclingConfigurations =
+    ::testing::Types<State<WithSlotRecycling<InMemoryConfig<TestArchive>>>,
+                     State<WithSlotRecycling<FileBasedConfig<TestArchive>>>>;
+
+TYPED_TEST_SUITE(SlotRecyclingTest, RecyclingConfigurations);
+
+TYPED_TEST(SlotRecyclingTest, SchemaIncludesSlotRecycling) {
+  EXPECT_TRUE(
+      TypeParam::GetSchema().HashFeature(StateFeature::kSlotRecycling));
+  EXPECT_FALSE(State<InMemoryConfig<TestArchive>>::GetSchema().HashFeature(
+      StateFeature::kSlotRecycling));
+}
+
+TYPED_TEST(SlotRecyclingTest, SlotsOfDeletedAccountsAreReused) {
+  constexpr int kNumSlots = 10;
+  Address a{0x01};
+  Address b{0x02};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto opened, TypeParam::Open(dir));
+  SlotIdProbe<TypeParam> state(std::move(opened));
+
+  Update update;
+  update.Create(a);
+  for (int i = 0; i < kNumSlots; i++) {
+    update.Set(a, Key{static_cast<std::uint8_t>(i)}, Value{0x01});
+  }
+  ASSERT_OK(state.Apply(0, update));
+
+  // Deleting the account makes its slots stale, they are released at the end
+  // of the same block.
+  Update deletion;
+  deletion.Delete(a);
+  ASSERT_OK(state.Apply(1, deletion));
+  for (int i = 0; i < kNumSlots; i++) {
+    Key key{static_cast<std::uint8_t>(i)};
+    EXPECT_THAT(state.GetStorageValue(a, key), IsOkAndHolds(Value{}));
+    EXPECT_THAT(state.GetSlotId(a, key),
+                StatusIs(absl::StatusCode::kNotFound, _));
+  }
+
+  // Many generations of slots keep reusing the IDs of the first one.
+  for (int round = 0; round < 100; round++) {
+    Update next;
+    next.Create(b);
+    for (int i = 0; i < kNumSlots; i++) {
+      Key key{static_cast<std::uint8_t>(round), static_cast<std::uint8_t>(i)};
+      next.Set(b, key, Value{static_cast<std::uint8_t>(i + 1)});
+    }
+    ASSERT_OK(state.Apply(2 * round + 2, next));
+    for (int i = 0; i < kNumSlots; i++) {
+      Key key{static_cast<std::uint8_t>(round), static_cast<std::uint8_t>(i)};
+      EXPECT_THAT(state.GetStorageValue(b, key),
+                  IsOkAndHolds(Value{static_cast<std::uint8_t>(i + 1)}));
+      EXPECT_THAT(state.GetSlotId(b, key), IsOkAndHolds(Lt(kNumSlots)));
+    }
+    Update deletion;
+    deletion.Delete(b);
+    ASSERT_OK(state.Apply(2 * round + 3, deletion));
+  }
+}
+
+TYPED_TEST(SlotRecyclingTest, LiveSlotsAreRetained) {
+  Address a{0x01};
+  Key k{0x01};
+  Key l{0x02};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto opened, TypeParam::Open(dir));
+  SlotIdProbe<TypeParam> state(std::move(opened));
+  Update update;
+  update.Create(a);
+  update.Set(a, k, Value{0x12});
+  update.Set(a, l, Value{0x34});
+  ASSERT_OK(state.Apply(0, update));
+  for (BlockId block = 1; block < 10; block++) {
+    ASSERT_OK(state.Apply(block, Update{}));
+  }
+  EXPECT_THAT(state.GetStorageValue(a, k), IsOkAndHolds(Value{0x12}));
+  EXPECT_THAT(state.GetStorageValue(a, l), IsOkAndHolds(Value{0x34}));
+  EXPECT_THAT(state.GetSlotId(a, k), IsOkAndHolds(0));
+  EXPECT_THAT(state.GetSlotId(a, l), IsOkAndHolds(1));
+}
+
+TYPED_TEST(SlotRecyclingTest, ReleasedSlotsAreRestoredAfterReopening) {
+  Address a{0x01};
+  Address b{0x02};
+  Key k{0x01};
+  Key l{0x02};
+  TempDir dir;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto state, TypeParam::Open(dir));
+    Update update;
+    update.Create(a);
+    update.Set(a, k, Value{0x12});
+    update.Set(a, l, Value{0x34});
+    ASSERT_OK(state.Apply(0, update));
+    Update deletion;
+    deletion.Delete(a);
+    ASSERT_OK(state.Apply(1, deletion));
+    ASSERT_OK_AND_ASSIGN(hash, state.GetHash());
+    ASSERT_OK(state.Close());
+  }
+  ASSERT_OK_AND_ASSIGN(auto opened, TypeParam::Open(dir));
+  SlotIdProbe<TypeParam> state(std::move(opened));
+  EXPECT_THAT(state.GetHash(), IsOkAndHolds(hash));
+  EXPECT_THAT(state.GetStorageValue(a, k), IsOkAndHolds(Value{}));
+
+  // New slots reuse the released IDs, most recently released first.
+  Update update;
+  update.Create(b);
+  update.Set(b, k, Value{0x56});
+  update.Set(b, l, Value{0x78});
+  ASSERT_OK(state.Apply(2, update));
+  EXPECT_THAT(state.GetStorageValue(b, k), IsOkAndHolds(Value{0x56}));
+  EXPECT_THAT(state.GetStorageValue(b, l), IsOkAndHolds(Value{0x78}));
+  EXPECT_THAT(state.GetStorageValue(a, k), IsOkAndHolds(Value{}));
+  EXPECT_THAT(state.GetSlotId(b, k), IsOkAndHolds(1));
+  EXPECT_THAT(state.GetSlotId(b, l), IsOkAndHolds(0));
+}
+
+TEST(SlotRecyclingTest, HashesOnlyDifferOnceSlotsAreReleased) {
+  Address a{0x01};
+  Key k{0x01};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto plain, State<InMemoryConfig<TestArchive>>::Open(
+                                       dir.GetPath() / "plain"));
+  ASSERT_OK_AND_ASSIGN(
+      auto recycling,
+      State<WithSlotRecycling<InMemoryConfig<TestArchive>>>::Open(
+          dir.GetPath() / "recycling"));
+
+  Update update;
+  update.Create(a);
+  update.Set(a, k, Value{0x12});
+  ASSERT_OK(plain.Apply(0, update));
+  ASSERT_OK(recycling.Apply(0, update));
+  ASSERT_OK_AND_ASSIGN(auto hash, plain.GetHash());
+  EXPECT_THAT(recycling.GetHash(), IsOkAndHolds(hash));
+
+  Update deletion;
+  deletion.Delete(a);
+  ASSERT_OK(plain.Apply(1, deletion));
+  ASSERT_OK(recycling.Apply(1, deletion));
+  ASSERT_OK_AND_ASSIGN(hash, plain.GetHash());
+  EXPECT_THAT(recycling.GetHash(), Not(IsOkAndHolds(hash)));
+}
+
+// ------------------------- Account Record Tests -----------------------------
+
+template <typename State>
+class AccountRecordTest : public ::testing::Test {};
+
+using AccountRecordConfigurations =
+    ::testing::Types<State<WithAccountRecords<InMemoryConfig<TestArchive>>>,
+                     State<WithAccountRecords<FileBasedConfig<TestArchive>>>>;
+
+TYPED_TEST_SUITE(AccountRecordTest, AccountRecordConfigurations);
+
+TYPED_TEST(AccountRecordTest, SchemaIncludesAccountRecords) {
+  EXPECT_TRUE(
+      TypeParam::GetSchema().HashFeature(StateFeature::kAccountRecords));
+  EXPECT_FALSE(State<InMemoryConfig<TestArchive>>::GetSchema().HashFeature(
+      StateFeature::kAccountRecords));
+}
+
+TYPED_TEST(AccountRecordTest, PropertiesOfAnAccountAreIndependent) {
+  Address a{0x01};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto state, TypeParam::Open(dir));
+  ASSERT_OK(state.CreateAccount(a));
+  ASSERT_OK(state.SetBalance(a, Balance{0x12}));
+  ASSERT_OK(state.SetNonce(a, Nonce{0x34}));
+  ASSERT_OK(state.SetCode(a, Code{0x56}));
+  ASSERT_OK(state.DeleteAccount(a));
+
+  EXPECT_THAT(state.GetAccountState(a), IsOkAndHolds(AccountState::kUnknown));
+  EXPECT_THAT(state.GetBalance(a), IsOkAndHolds(Balance{0x12}));
+  EXPECT_THAT(state.GetNonce(a), IsOkAndHolds(Nonce{0x34}));
+  EXPECT_THAT(state.GetCodeHash(a),
+              IsOkAndHolds(GetKeccak256Hash(std::array{std::byte{0x56}})));
+}
+
+TYPED_TEST(AccountRecordTest, RecordsAreRestoredAfterReopening) {
+  Address a{0x01};
+  Address b{0x02};
+  TempDir dir;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto state, TypeParam::Open(dir));
+    ASSERT_OK(state.CreateAccount(a));
+    ASSERT_OK(state.SetBalance(a, Balance{0x12}));
+    ASSERT_OK(state.SetNonce(b, Nonce{0x34}));
+    ASSERT_OK_AND_ASSIGN(hash, state.GetHash());
+    ASSERT_OK(state.Close());
+  }
+  ASSERT_OK_AND_ASSIGN(auto state, TypeParam::Open(dir));
+  EXPECT_THAT(state.GetHash(), IsOkAndHolds(hash));
+  EXPECT_THAT(state.GetAccountState(a), IsOkAndHolds(AccountState::kExists));
+  EXPECT_THAT(state.GetBalance(a), IsOkAndHolds(Balance{0x12}));
+  EXPECT_THAT(state.GetNonce(b), IsOkAndHolds(Nonce{0x34}));
+}
+
+TYPED_TEST(AccountRecordTest, ExportedUpdatesReproduceTheState) {
+  Address a{0x01};
+  Address b{0x02};
+  Key k{0x01};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto plain, State<InMemoryConfig<TestArchive>>::Open(
+                                       dir.GetPath() / "plain"));
+  ASSERT_OK(plain.CreateAccount(a));
+  ASSERT_OK(plain.SetBalance(a, Balance{0x12}));
+  ASSERT_OK(plain.SetNonce(b, Nonce{0x34}));
+  ASSERT_OK(plain.SetCode(b, Code{0x56}));
+  ASSERT_OK(plain.SetStorageValue(a, k, Value{0x78}));
+
+  ASSERT_OK_AND_ASSIGN(auto records, TypeParam::Open(dir.GetPath() / "rec"));
+  ASSERT_OK(plain.Export(
+      [&](const Update& update) { return records.ApplyToState(update); }));
+  EXPECT_THAT(records.GetAccountState(a), IsOkAndHolds(AccountState::kExists));
+  EXPECT_THAT(records.GetBalance(a), IsOkAndHolds(Balance{0x12}));
+  EXPECT_THAT(records.GetNonce(b), IsOkAndHolds(Nonce{0x34}));
+  EXPECT_THAT(records.GetCode(b), IsOkAndHolds(Code{0x56}));
+  EXPECT_THAT(records.GetStorageValue(a, k), IsOkAndHolds(Value{0x78}));
+
+  // Records are hashed differently than individual stores.
+  ASSERT_OK_AND_ASSIGN(auto hash, plain.GetHash());
+  EXPECT_THAT(records.GetHash(), Not(IsOkAndHolds(hash)));
+
+  // Exporting the records again reproduces the original content.
+  ASSERT_OK_AND_ASSIGN(
+      auto copy,
+      State<InMemoryConfig<TestArchive>>::Open(dir.GetPath() / "copy"));
+  ASSERT_OK(records.Export(
+      [&](const Update& update) { return copy.ApplyToState(update); }));
+  ASSERT_OK_AND_ASSIGN(auto reexported, copy.GetHash());
+  ASSERT_OK_AND_ASSIGN(
+      auto direct,
+      State<InMemoryConfig<TestArchive>>::Open(dir.GetPath() / "direct"));
+  ASSERT_OK(plain.Export(
+      [&](const Update& update) { return direct.ApplyToState(update); }));
+  EXPECT_THAT(direct.GetHash(), IsOkAndHolds(reexported));
+}
+
+// -------------------------- Storage Tree Tests ------------------------------
+
+template <typename State>
+class StorageTreeTest : public ::testing::Test {};
+
+using StorageTreeConfigurations = ::testing::Types<
+    State<WithStorageTrees<InMemoryConfig<TestArchive>, FileBasedOrderedMap>>,
+    State<WithStorageTrees<FileBasedConfig<TestArchive>, FileBasedOrderedMap>>>;
+
+TYPED_TEST_SUITE(StorageTreeTest, StorageTreeConfigurations);
+
+TYPED_TEST(StorageTreeTest, SchemaIncludesStorageTrees) {
+  EXPECT_TRUE(TypeParam::GetSchema().HashFeature(StateFeature::kStorageTrees));
+  EXPECT_FALSE(State<InMemoryConfig<TestArchive>>::GetSchema().HashFeature(
+      StateFeature::kStorageTrees));
+}
+
+TYPED_TEST(StorageTreeTest, SlotsAreRestoredAfterReopening) {
+  constexpr int kNumSlots = 1000;
+  Address a{0x01};
+  Address b{0x02};
+  TempDir dir;
+  Hash hash;
+  {
+    ASSERT_OK_AND_ASSIGN(auto state, TypeParam::Open(dir));
+    ASSERT_OK(state.CreateAccount(a));
+    for (int i = 0; i < kNumSlots; i++) {
+      Key key{static_cast<std::uint8_t>(i >> 8), static_cast<std::uint8_t>(i)};
+      ASSERT_OK(state.SetStorageValue(a, key, Value{0x12}));
+      ASSERT_OK(state.SetStorageValue(b, key, Value{0x34}));
+    }
+    ASSERT_OK_AND_ASSIGN(hash, state.GetHash());
+    ASSERT_OK(state.Close());
+  }
+  ASSERT_OK_AND_ASSIGN(auto state, TypeParam::Open(dir));
+  EXPECT_THAT(state.GetHash(), IsOkAndHolds(hash));
+  for (int i = 0; i < kNumSlots; i++) {
+    Key key{static_cast<std::uint8_t>(i >> 8), static_cast<std::uint8_t>(i)};
+    EXPECT_THAT(state.GetStorageValue(a, key), IsOkAndHolds(Value{0x12}));
+    EXPECT_THAT(state.GetStorageValue(b, key), IsOkAndHolds(Value{0x34}));
+  }
+}
+
+TYPED_TEST(StorageTreeTest, ExportedUpdatesReproduceTheState) {
+  Address a{0x01};
+  Address b{0x02};
+  Key k{0x01};
+  Key l{0x02};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto plain, State<InMemoryConfig<TestArchive>>::Open(
+                                       dir.GetPath() / "plain"));
+  ASSERT_OK(plain.CreateAccount(a));
+  ASSERT_OK(plain.SetStorageValue(a, k, Value{0x12}));
+  ASSERT_OK(plain.CreateAccount(a));
+  ASSERT_OK(plain.SetStorageValue(a, l, Value{0x34}));
+  ASSERT_OK(plain.SetStorageValue(b, k, Value{0x56}));
+
+  ASSERT_OK_AND_ASSIGN(auto trees, TypeParam::Open(dir.GetPath() / "trees"));
+  ASSERT_OK(plain.Export(
+      [&](const Update& update) { return trees.ApplyToState(update); }));
+  EXPECT_THAT(trees.GetStorageValue(a, k), IsOkAndHolds(Value{}));
+  EXPECT_THAT(trees.GetStorageValue(a, l), IsOkAndHolds(Value{0x34}));
+  EXPECT_THAT(trees.GetStorageValue(b, k), IsOkAndHolds(Value{0x56}));
+
+  // Storage trees are hashed differently than the slot index and values.
+  ASSERT_OK_AND_ASSIGN(auto hash, plain.GetHash());
+  EXPECT_THAT(trees.GetHash(), Not(IsOkAndHolds(hash)));
+
+  // Exporting the trees again reproduces the exported content.
+  ASSERT_OK_AND_ASSIGN(
+      auto copy,
+      State<InMemoryConfig<TestArchive>>::Open(dir.GetPath() / "copy"));
+  ASSERT_OK(trees.Export(
+      [&](const Update& update) { return copy.ApplyToState(update); }));
+  ASSERT_OK_AND_ASSIGN(
+      auto direct,
+      State<InMemoryConfig<TestArchive>>::Open(dir.GetPath() / "direct"));
+  ASSERT_OK(plain.Export(
+      [&](const Update& update) { return direct.ApplyToState(update); }));
+  ASSERT_OK_AND_ASSIGN(hash, direct.GetHash());
+  EXPECT_THAT(copy.GetHash(), IsOkAndHolds(hash));
+}
+
+TYPED_TEST(StorageTreeTest, SlotsOfDeletedAccountsAreNotRevived) {
+  Address a{0x01};
+  Key k{0x01};
+  TempDir dir;
+  ASSERT_OK_AND_ASSIGN(auto state, TypeParam::Open(dir));
+  ASSERT_OK(state.CreateAccount(a));
+  ASSERT_OK(state.SetStorageValue(a, k, Value{0x12}));
+  ASSERT_OK(state.DeleteAccount(a));
+  ASSERT_OK(state.CreateAccount(a));
+  EXPECT_THAT(state.GetStorageValue(a, k), IsOkAndHolds(Value{}));
+  ASSERT_OK(state.SetStorageValue(a, k, Value{0x34}));
+  EXPECT_THAT(state.GetStorageValue(a, k), IsOkAndHolds(Value{0x34}));
+}
+
 // ------------------------ Error Handling Tests ------------------------------
 
 template <typename K, typename V>
@@ -87,18 +510,18 @@ class MockStateTest : public ::testing::Test {
               MockStore<AddressId, AccountState>(), MockDepot<AddressId>(),
               MockStore<AddressId, Hash>(), std::make_unique<MockArchive>()) {}
     auto& GetAddressIndex() { return this->address_index_.GetMockIndex(); }
-    auto& GetSlotIndex() { return this->slot_index_.GetMockIndex(); }
-    auto& GetBalancesStore() { return this->balances_.GetMockStore(); }
-    auto& GetNoncesStore() { return this->nonces_.GetMockStore(); }
+    auto& GetSlotIndex() { return this->slot_index_->GetMockIndex(); }
+    auto& GetBalancesStore() { return this->balances_->GetMockStore(); }
+    auto& GetNoncesStore() { return this->nonces_->GetMockStore(); }
     auto& GetReincarnationsStore() {
       return this->reincarnations_.GetMockStore();
     }
-    auto& GetValueStore() { return this->value_store_.GetMockStore(); }
+    auto& GetValueStore() { return this->value_store_->GetMockStore(); }
     auto& GetAccountStatesStore() {
-      return this->account_states_.GetMockStore();
+      return this->account_states_->GetMockStore();
     }
     auto& GetCodesDepot() { return this->codes_.GetMockDepot(); }
-    auto& GetCodeHashesStore() { return this->code_hashes_.GetMockStore(); }
+    auto& GetCodeHashesStore() { return this->code_hashes_->GetMockStore(); }
     // archive will always be available, because it is created in the
     // constructor.
     auto& GetArchive() { return this->archive_->GetMockArchive(); }
@@ -20,11 +20,17 @@ std::ostream& operator<<(std::ostream& out, const Schema& s) {
       StateFeature::kAddressId,
       StateFeature::kKeyId,
       StateFeature::kAccountReincarnation,
+      StateFeature::kSlotRecycling,
+      StateFeature::kAccountRecords,
+      StateFeature::kStorageTrees,
   };
   static const std::string_view names[] = {
       "address_id",
       "key_id",
       "account_reincarnation",
+      "slot_recycling",
+      "account_records",
+      "storage_trees",
   };
 
   out << '{';
@@ -37,6 +37,30 @@ enum class StateFeature : std::uint8_t {
   // different state hashes to be produced. Thus, implementations with this
   // feature are not compatible with implementations without this feature.
   kAccountReincarnation = 1 << 2,
+
+  // An implementation recycling storage slots is incrementally releasing the
+  // slots of deleted accounts and reusing their internal IDs for new slots.
+  // This bounds the growth of the slot structures of chains frequently
+  // deleting accounts, but the released slots and reused IDs lead to different
+  // state hashes. Thus, implementations with this feature are not compatible
+  // with implementations without this feature.
+  kSlotRecycling = 1 << 3,
+
+  // An implementation using account records keeps all basic properties of an
+  // account -- its state, balance, nonce, and code hash -- in a single record
+  // instead of maintaining a separate structure per property. Accessing or
+  // hashing an account thus touches a single page, yet the records are hashed
+  // differently than the separate structures. Thus, implementations with this
+  // feature are not compatible with implementations without this feature.
+  kAccountRecords = 1 << 4,
+
+  // An implementation using storage trees keeps the storage slots of all
+  // accounts in an ordered tree, grouping the slots of each account on the
+  // same pages instead of scattering them by the order of their creation. The
+  // tree is hashed by its pages, which depend on the tree's layout. Thus,
+  // implementations with this feature are not compatible with implementations
+  // without this feature.
+  kStorageTrees = 1 << 5,
 };
 
 // A state Schema is a description of the internal organization of Carmen State
@@ -27,6 +27,12 @@ TEST(Schema, CanBePrinted) {
   EXPECT_THAT(PrintToString(Schema(F::kKeyId)), "{key_id}");
   EXPECT_THAT(PrintToString(F::kKeyId & F::kAccountReincarnation),
               "{key_id,account_reincarnation}");
+  EXPECT_THAT(PrintToString(F::kAccountReincarnation & F::kSlotRecycling),
+              "{account_reincarnation,slot_recycling}");
+  EXPECT_THAT(PrintToString(F::kAddressId & F::kAccountRecords),
+              "{address_id,account_records}");
+  EXPECT_THAT(PrintToString(F::kAccountReincarnation & F::kStorageTrees),
+              "{account_reincarnation,storage_trees}");
 }
 
 TEST(Schema, FeaturesHaveSetSemantic) {
@@ -11,6 +11,7 @@
 #include "state/update.h"
 
 #include <algorithm>
+#include <memory_resource>
 #include <span>
 #include <sstream>
 #include <vector>
@@ -30,7 +31,8 @@ constexpr const std::uint8_t kVersion0 = 0;
 
 class Reader {
  public:
-  Reader(std::span<const std::byte> data) : data_(data) {}
+  Reader(std::span<const std::byte> data, std::pmr::memory_resource* resource)
+      : data_(data), resource_(resource) {}
 
   absl::StatusOr<std::uint8_t> ReadUint8() {
     RETURN_IF_ERROR(CheckEnd(1));
@@ -73,19 +75,21 @@ class Reader {
   }
 
   template <Trivial T>
-  absl::StatusOr<std::vector<T>> ReadList(std::size_t length) {
-    std::vector<T> result;
-    result.reserve(length);
-    for (std::size_t i = 0; i < length; i++) {
-      ASSIGN_OR_RETURN(auto cur, Read<T>());
-      result.push_back(std::move(cur));
+  absl::StatusOr<std::pmr::vector<T>> ReadList(std::size_t length) {
+    // Lists of trivial elements are copied in one step. The size is checked in
+    // a way that can not overflow, since the length is part of the input.
+    if (length > (data_.size() - pos_) / sizeof(T)) {
+      return absl::InvalidArgumentError("end of data");
     }
+    std::pmr::vector<T> result(length, resource_);
+    std::memcpy(result.data(), data_.data() + pos_, length * sizeof(T));
+    pos_ += length * sizeof(T);
     return result;
   }
 
-  absl::StatusOr<std::vector<Update::CodeUpdate>> ReadCodeUpdates(
+  absl::StatusOr<std::pmr::vector<Update::CodeUpdate>> ReadCodeUpdates(
       std::size_t length) {
-    std::vector<Update::CodeUpdate> result;
+    std::pmr::vector<Update::CodeUpdate> result(resource_);
     result.reserve(length);
     for (std::size_t i = 0; i < length; i++) {
       ASSIGN_OR_RETURN(auto address, Read<Address>());
@@ -105,6 +109,8 @@ class Reader {
 
   std::span<const std::byte> data_;
 
+  std::pmr::memory_resource* resource_;
+
   std::size_t pos_ = 0;
 };
 
@@ -158,11 +164,6 @@ class Writer {
     return *this;
   }
 
-  template <Trivial T>
-  Writer& Append(const std::vector<T>& list) {
-    return Append(std::span<const T>(list));
-  }
-
   std::size_t Size() const { return buffer_.size(); }
 
   std::vector<std::byte> Build() && { return std::move(buffer_); }
@@ -173,7 +174,16 @@ class Writer {
 
 }  // namespace
 
-absl::StatusOr<Update> Update::FromBytes(std::span<const std::byte> data) {
+Update::Update(std::pmr::memory_resource* resource)
+    : deleted_accounts_(resource),
+      created_accounts_(resource),
+      balances_(resource),
+      nonces_(resource),
+      codes_(resource),
+      storage_(resource) {}
+
+absl::StatusOr<Update> Update::FromBytes(std::span<const std::byte> data,
+                                         std::pmr::memory_resource* resource) {
   // The encoding should at least have the version number and the number of
   // entries.
   if (data.size() < 1 + 6 * 4) {
@@ -182,7 +192,7 @@ absl::StatusOr<Update> Update::FromBytes(std::span<const std::byte> data) {
   }
 
   // Decode the version number and lengths.
-  Reader reader(data);
+  Reader reader(data, resource);
   ASSIGN_OR_RETURN(auto version, reader.ReadUint8());
   if (version != kVersion0) {
     return absl::InvalidArgumentError(
@@ -196,7 +206,7 @@ absl::StatusOr<Update> Update::FromBytes(std::span<const std::byte> data) {
   ASSIGN_OR_RETURN(auto nonces_size, reader.ReadUint32());
   ASSIGN_OR_RETURN(auto storage_size, reader.ReadUint32());
 
-  Update update;
+  Update update(resource);
   ASSIGN_OR_RETURN(update.deleted_accounts_,
                    reader.ReadList<Address>(deleted_account_size));
   ASSIGN_OR_RETURN(update.created_accounts_,
@@ -260,9 +270,27 @@ absl::StatusOr<std::vector<std::byte>> Update::ToBytes() const {
   return std::move(out).Build();
 }
 
-absl::flat_hash_map<Address, AccountUpdate> AccountUpdate::From(
-    const Update& update) {
-  absl::flat_hash_map<Address, AccountUpdate> res;
+AccountUpdate::AccountUpdate(const AccountUpdate& other,
+                             const allocator_type& alloc)
+    : deleted(other.deleted),
+      created(other.created),
+      balance(other.balance),
+      nonce(other.nonce),
+      code(other.code),
+      storage(other.storage, alloc) {}
+
+AccountUpdate::AccountUpdate(AccountUpdate&& other,
+                             const allocator_type& alloc)
+    : deleted(other.deleted),
+      created(other.created),
+      balance(std::move(other.balance)),
+      nonce(std::move(other.nonce)),
+      code(std::move(other.code)),
+      storage(std::move(other.storage), alloc) {}
+
+AccountUpdate::Map AccountUpdate::From(const Update& update,
+                                       std::pmr::memory_resource* resource) {
+  Map res(Map::allocator_type{resource});
   for (const auto& address : update.GetCreatedAccounts()) {
     res[address].created = true;
   }
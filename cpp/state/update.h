@@ -11,10 +11,13 @@
 #pragma once
 
 #include <cstddef>
+#include <functional>
+#include <memory_resource>
 #include <span>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
 #include "absl/status/statusor.h"
 #include "common/type.h"
 
@@ -23,6 +26,11 @@ namespace carmen {
 // A BlockUpdate summarizes all the updates produced by processing a block in
 // the chain. It is the unit of data used to update archives and to synchronize
 // data between archive instances.
+//
+// The content of an update may be placed in a user-provided memory resource.
+// Since updates are typically short-lived and discarded after processing a
+// single block, a std::pmr::monotonic_buffer_resource released after each
+// block avoids the cost of many small individual allocations.
 class Update {
  public:
   struct BalanceUpdate {
@@ -52,6 +60,14 @@ class Update {
     friend auto operator<=>(const SlotUpdate&, const SlotUpdate&) = default;
   };
 
+  // Creates an empty update allocating its content from the default memory
+  // resource.
+  Update() = default;
+
+  // Creates an empty update allocating its content from the given memory
+  // resource, which must outlive this update.
+  explicit Update(std::pmr::memory_resource* resource);
+
   // --- Mutators ---
 
   // Adds the given account to the list of deleted accounts. May invalidate
@@ -93,13 +109,13 @@ class Update {
 
   // Returns a span of deleted addresses, valid until the next modification or
   // the end of the life cycle of this update.
-  const std::vector<Address>& GetDeletedAccounts() const {
+  std::span<const Address> GetDeletedAccounts() const {
     return deleted_accounts_;
   }
 
   // Returns a span of created addresses, valid until the next modification or
   // the end of the life cycle of this update.
-  const std::vector<Address>& GetCreatedAccounts() const {
+  std::span<const Address> GetCreatedAccounts() const {
     return created_accounts_;
   }
 
@@ -121,8 +137,12 @@ class Update {
 
   // --- Serialization ---
 
-  // Parses the encoded update into an update object.
-  static absl::StatusOr<Update> FromBytes(std::span<const std::byte> data);
+  // Parses the encoded update into an update object. The content of the
+  // resulting update is allocated from the given memory resource, which must
+  // outlive the update.
+  static absl::StatusOr<Update> FromBytes(
+      std::span<const std::byte> data,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
   // Encodes this update into a byte string.
   absl::StatusOr<std::vector<std::byte>> ToBytes() const;
@@ -138,29 +158,35 @@ class Update {
 
  private:
   // The list of accounts that should be deleted / cleared by this update.
-  std::vector<Address> deleted_accounts_;
+  std::pmr::vector<Address> deleted_accounts_;
 
   // The list of accounts that should be created by this update. Note, accounts
   // may be deleted and (re-)created in the same update.
-  std::vector<Address> created_accounts_;
+  std::pmr::vector<Address> created_accounts_;
 
   // The list of balance updates.
-  std::vector<BalanceUpdate> balances_;
+  std::pmr::vector<BalanceUpdate> balances_;
 
   // The list of nonce updates.
-  std::vector<NonceUpdate> nonces_;
+  std::pmr::vector<NonceUpdate> nonces_;
 
   // The list of code updates.
-  std::vector<CodeUpdate> codes_;
+  std::pmr::vector<CodeUpdate> codes_;
 
   // Retains all storage modifications of slots.
-  std::vector<SlotUpdate> storage_;
+  std::pmr::vector<SlotUpdate> storage_;
 };
 
 // An AccountUpdate combines the updates applied to a single account in one
 // block. Its main intention is to be utilized as the diff unit for hashing
 // incremental updates on accounts in archives.
+//
+// AccountUpdates are allocator-aware. When stored in a container using a
+// polymorphic allocator, the slot updates share the container's memory
+// resource.
 struct AccountUpdate {
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
   // The update of a slot.
   struct SlotUpdate {
     Key key;
@@ -169,9 +195,27 @@ struct AccountUpdate {
     friend std::ostream& operator<<(std::ostream& out, const SlotUpdate&);
   };
 
+  // A map of account updates, indexed by the updated account.
+  using Map = absl::flat_hash_map<
+      Address, AccountUpdate, absl::Hash<Address>, std::equal_to<Address>,
+      std::pmr::polymorphic_allocator<std::pair<const Address, AccountUpdate>>>;
+
+  AccountUpdate() = default;
+  explicit AccountUpdate(const allocator_type& alloc) : storage(alloc) {}
+  AccountUpdate(const AccountUpdate&) = default;
+  AccountUpdate(AccountUpdate&&) = default;
+  AccountUpdate(const AccountUpdate& other, const allocator_type& alloc);
+  AccountUpdate(AccountUpdate&& other, const allocator_type& alloc);
+  AccountUpdate& operator=(const AccountUpdate&) = default;
+  AccountUpdate& operator=(AccountUpdate&&) = default;
+
   // Converts the provided update in a list of account updates. If the update
-  // was normalized, the entries of the resulting list are normalized.
-  static absl::flat_hash_map<Address, AccountUpdate> From(const Update& update);
+  // was normalized, the entries of the resulting list are normalized. The
+  // resulting map and its entries are allocated from the given memory
+  // resource, which must outlive the result.
+  static Map From(
+      const Update& update,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
   // --- Normalization ---
 
@@ -200,7 +244,7 @@ struct AccountUpdate {
   std::optional<Balance> balance;
   std::optional<Nonce> nonce;
   std::optional<Code> code;
-  std::vector<SlotUpdate> storage;
+  std::pmr::vector<SlotUpdate> storage;
 };
 
 }  // namespace carmen
@@ -10,6 +10,9 @@
 
 #include "state/update.h"
 
+#include <array>
+#include <memory_resource>
+#include <optional>
 #include <type_traits>
 
 #include "common/hash.h"
@@ -209,6 +212,37 @@ TEST(Update, TruncatedInputIsHandledSafely) {
   EXPECT_OK(Update::FromBytes(data));
 }
 
+TEST(Update, ContentCanBePlacedInCustomMemoryResource) {
+  // The arena fails if it runs out of its local buffer.
+  std::array<std::byte, 1 << 12> buffer;
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                            std::pmr::null_memory_resource());
+  Update update(&arena);
+  update.Delete(Address{0x01});
+  update.Create(Address{0x02});
+  update.Set(Address{0x03}, Balance{0x04});
+  update.Set(Address{0x05}, Nonce{0x06});
+  update.Set(Address{0x07}, Key{0x08}, Value{0x09});
+
+  Update expected;
+  expected.Delete(Address{0x01});
+  expected.Create(Address{0x02});
+  expected.Set(Address{0x03}, Balance{0x04});
+  expected.Set(Address{0x05}, Nonce{0x06});
+  expected.Set(Address{0x07}, Key{0x08}, Value{0x09});
+  EXPECT_EQ(update, expected);
+}
+
+TEST(Update, UpdateCanBeRestoredIntoCustomMemoryResource) {
+  auto update = GetExampleUpdate();
+  ASSERT_OK_AND_ASSIGN(auto data, update.ToBytes());
+  std::array<std::byte, 1 << 12> buffer;
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                            std::pmr::null_memory_resource());
+  ASSERT_OK_AND_ASSIGN(auto restored, Update::FromBytes(data, &arena));
+  EXPECT_EQ(restored, update);
+}
+
 TEST(Update, KnownEncodings) {
   // The hashes for the empty update and the example update are aligned between
   // the C++ and Go version.
@@ -222,6 +256,38 @@ TEST(Update, KnownEncodings) {
       "0xd16bcf097cba34ece949ae64db100861c15f0058a1366003ad8f90a0dadf351b");
 }
 
+TEST(AccountUpdate, FromGroupsUpdatesByAccount) {
+  Update update;
+  update.Create(Address{0x01});
+  update.Set(Address{0x01}, Balance{0x02});
+  update.Set(Address{0x02}, Nonce{0x03});
+  update.Set(Address{0x01}, Key{0x04}, Value{0x05});
+  update.Set(Address{0x01}, Key{0x06}, Value{0x07});
+
+  auto res = AccountUpdate::From(update);
+  ASSERT_EQ(res.size(), 2);
+  EXPECT_TRUE(res[Address{0x01}].created);
+  EXPECT_EQ(res[Address{0x01}].balance, Balance{0x02});
+  EXPECT_EQ(res[Address{0x01}].nonce, std::nullopt);
+  EXPECT_THAT(res[Address{0x01}].storage,
+              ElementsAre(AccountUpdate::SlotUpdate{Key{0x04}, Value{0x05}},
+                          AccountUpdate::SlotUpdate{Key{0x06}, Value{0x07}}));
+  EXPECT_FALSE(res[Address{0x02}].created);
+  EXPECT_EQ(res[Address{0x02}].nonce, Nonce{0x03});
+}
+
+TEST(AccountUpdate, FromPlacesResultInCustomMemoryResource) {
+  auto update = GetExampleUpdate();
+  std::array<std::byte, 1 << 14> buffer;
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                            std::pmr::null_memory_resource());
+  auto res = AccountUpdate::From(update, &arena);
+  EXPECT_EQ(res, AccountUpdate::From(update));
+  for (const auto& [_, account_update] : res) {
+    EXPECT_EQ(account_update.storage.get_allocator().resource(), &arena);
+  }
+}
+
 TEST(AccountUpdate, IsNormalizedDetectsOutOfOrderSlotUpdates) {
   AccountUpdate update;
   update.storage.push_back({Key{0x02}, Value{}});
@@ -0,0 +1,166 @@
+// Copyright (c) 2024 Fantom Foundation
+//
+// Use of this software is governed by the Business Source License included
+// in the LICENSE file and at fantom.foundation/bsl11.
+//
+// Change Date: 2028-4-16
+//
+// On the date above, in accordance with the Business Source License, use of
+// this software will be governed by the GNU Lesser General Public License v3.
+
+// This file provides an executable converting a state from one schema or
+// configuration into another, e.g. to migrate a file-based state into a
+// LevelDB-based one. States of the same schema are converted by copying their
+// data structures concurrently, using bulk-load paths where available, and the
+// hash of the result is verified against the hash of the source. States of
+// different schemas are converted by replaying the content of the source on
+// the target. Archives are not converted.
+
+#include <stdlib.h>
+
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+#include <type_traits>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/time.h"
+#include "archive/leveldb/archive.h"
+#include "common/status_util.h"
+#include "state/configurations.h"
+#include "state/s1/state.h"
+#include "state/s2/state.h"
+#include "state/s3/state.h"
+#include "state/update.h"
+
+// To run this binary with bazel, use the following command:
+//   bazel run -c opt //tools:convert_state <args>
+
+namespace carmen {
+namespace {
+
+using ::carmen::archive::leveldb::LevelDbArchive;
+
+std::string FormatMinutes(absl::Duration duration) {
+  auto sec = absl::ToInt64Seconds(duration);
+  return absl::StrFormat("%d:%02d", sec / 60, sec % 60);
+}
+
+template <typename Source, typename Target>
+absl::Status Convert(const std::filesystem::path& source_dir,
+                     const std::filesystem::path& target_dir) {
+  if (std::filesystem::exists(target_dir) &&
+      !std::filesystem::is_empty(target_dir)) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Target directory %s is not empty", target_dir.string()));
+  }
+
+  std::cout << "Opening " << source_dir << " ..\n";
+  ASSIGN_OR_RETURN(auto source, Source::Open(source_dir));
+  auto start = absl::Now();
+  ASSIGN_OR_RETURN(auto hash, source.GetHash());
+  std::cout << "\tSource Hash: " << hash << " (took "
+            << FormatMinutes(absl::Now() - start) << ")\n";
+
+  // States of the same schema can copy each other's data structures. For all
+  // others, the content of the source is replayed on the target.
+  constexpr bool kSameSchema =
+      requires(const Source& s) { Target::CopyFrom(s, target_dir); };
+  std::cout << "Converting into " << target_dir << " ..\n";
+  start = absl::Now();
+  ASSIGN_OR_RETURN(auto target, [&]() -> absl::StatusOr<Target> {
+    if constexpr (kSameSchema) {
+      return Target::CopyFrom(source, target_dir);
+    } else {
+      ASSIGN_OR_RETURN(auto target, Target::Open(target_dir));
+      int num_updates = 0;
+      RETURN_IF_ERROR(source.Export([&](const Update& update) {
+        num_updates++;
+        return target.ApplyToState(update);
+      }));
+      std::cout << "\tReplayed " << num_updates << " updates\n";
+      return target;
+    }
+  }());
+  std::cout << "\tConversion done (took " << FormatMinutes(absl::Now() - start)
+            << ")\n";
+
+  start = absl::Now();
+  ASSIGN_OR_RETURN(auto target_hash, target.GetHash());
+  std::cout << "\tTarget Hash: " << target_hash << " (took "
+            << FormatMinutes(absl::Now() - start) << ")\n";
+  if (kSameSchema && hash != target_hash) {
+    return absl::InternalError("Hash of converted state does not match.");
+  }
+  if (!kSameSchema) {
+    std::cout << "\tHashes of different schemas can not be compared\n";
+  }
+
+  RETURN_IF_ERROR(source.Close());
+  return target.Close();
+}
+
+// Invokes the given function with the type identity of the state of the given
+// schema and implementation, which is one of memory, file, or leveldb.
+template <template <typename> class State, typename Function>
+absl::Status WithState(std::string_view impl, Function&& function) {
+  if (impl == "memory") {
+    return function(
+        std::type_identity<State<InMemoryConfig<LevelDbArchive>>>());
+  } else if (impl == "file") {
+    return function(
+        std::type_identity<State<FileBasedConfig<LevelDbArchive>>>());
+  } else if (impl == "leveldb") {
+    return function(
+        std::type_identity<State<LevelDbBasedConfig<LevelDbArchive>>>());
+  }
+  return absl::InvalidArgumentError(
+      absl::StrFormat("Unknown implementation: %s", impl));
+}
+
+template <typename Function>
+absl::Status WithState(std::string_view schema, std::string_view impl,
+                       Function&& function) {
+  if (schema == "1") {
+    return WithState<s1::State>(impl, function);
+  } else if (schema == "2") {
+    return WithState<s2::State>(impl, function);
+  } else if (schema == "3") {
+    return WithState<s3::State>(impl, function);
+  }
+  return absl::InvalidArgumentError(
+      absl::StrFormat("Unknown schema: %s", schema));
+}
+
+absl::Status Main(int argc, char** argv) {
+  if (argc != 7) {
+    std::cout << "Usage: convert_state <source_schema> <source_impl> "
+                 "<source_dir> <target_schema> <target_impl> <target_dir>\n";
+    std::cout << "\tschemas ........ 1, 2, or 3\n";
+    std::cout << "\timplementations  memory, file, or leveldb\n";
+    return absl::InvalidArgumentError("missing arguments");
+  }
+  std::filesystem::path source_dir = argv[3];
+  std::filesystem::path target_dir = argv[6];
+  return WithState(argv[1], argv[2], [&]<typename Source>(
+                                         std::type_identity<Source>) {
+    return WithState(argv[4], argv[5], [&]<typename Target>(
+                                           std::type_identity<Target>) {
+      return Convert<Source, Target>(source_dir, target_dir);
+    });
+  });
+}
+
+}  // namespace
+}  // namespace carmen
+
+int main(int argc, char** argv) {
+  auto status = carmen::Main(argc, argv);
+  if (status.ok()) {
+    return EXIT_SUCCESS;
+  }
+  std::cerr << "Execution failed: " << status.message() << "\n";
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,220 @@
+# Copyright (c) 2024 Fantom Foundation
+#
+# Use of this software is governed by the Business Source License included
+# in the LICENSE file and at fantom.foundation/bsl11.
+#
+# Change Date: 2028-4-16
+#
+# On the date above, in accordance with the Business Source License, use of
+# this software will be governed by the GNU Lesser General Public License v3.
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+# This script runs a curated subset of the C++ benchmarks of Carmen, collects the
+# results in a single machine-readable JSON file, and compares them against a
+# checked-in baseline. Each benchmark is run multiple times and the median is
+# used for comparisons. The tolerated deviation of a benchmark is derived from
+# the noise observed in the current run and in the baseline, such that noisy
+# benchmarks do not produce false alarms while stable ones are checked tightly.
+#
+# The script needs bazel to be installed and has to be run from within the
+# Carmen repository. Baselines are machine specific; they should be recorded
+# using --update-baseline on the machine the suite is regularly executed on.
+#
+# Example: python3 scripts/benchmark-suite.py --output results.json
+#          python3 scripts/benchmark-suite.py --update-baseline
+
+# The curated list of benchmarks covering the hot paths of the C++ backend. Each
+# entry names a bazel target and a regular expression selecting the benchmarks
+# of this target to be included in the suite.
+SUITE = [
+    {
+        "name": "store",
+        "target": "//backend/store:store_benchmark",
+        "filter": "BM_(UniformRandomRead|UniformRandomWrite|UniformWriteAndHash)<.*FileStore.*>/1048576$",
+    },
+    {
+        "name": "index",
+        "target": "//backend/index:index_benchmark",
+        "filter": "BM_(Insert|UniformRandomRead|Hash)<(InMemoryIndex|FileIndexInMemory|CachedFileIndexOnDisk)>/1048576$",
+    },
+    {
+        "name": "depot",
+        "target": "//backend/depot:depot_benchmark",
+        "filter": "BM_(UniformRandomRead|UniformRandomWrite|UniformWriteAndHash)<.*FileDepot.*>/1048576$",
+    },
+    {
+        "name": "file",
+        "target": "//backend/common:file_benchmark",
+        "filter": "BM_(SequentialFileFilling|RandomFileRead)<(SingleFile|PosixFile)<4096>>/(1048576|67108864)$",
+    },
+    {
+        "name": "hash",
+        "target": "//common:hash_benchmark",
+        "filter": "BM_(Sha256Hash|Keccak256Hashing)/(64|4096)$",
+    },
+    {
+        "name": "btree_set",
+        "target": "//backend/common/btree:btree_set_benchmark",
+        "filter": "BM_(IntInsertion|ValueInsertion)<(Sequential|Uniform)>",
+    },
+    {
+        "name": "state",
+        "target": "//state:state_benchmark",
+        "filter": "BM_OpenClose<.*(InMemoryConfig|FileBasedConfig).*>",
+    },
+]
+
+# Factors for normalizing the time units reported by google benchmark to ns.
+TIME_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+script_dir = os.path.dirname(os.path.abspath(__file__))
+cpp_dir = os.path.join(os.path.dirname(script_dir), "cpp")
+
+parser = argparse.ArgumentParser(prog="BENCHMARK SUITE",
+                                 description="Runs a curated subset of the C++ benchmarks, emits the results as JSON, "
+                                             "and compares them against a recorded baseline.")
+
+# --- Parameters --- #
+parser.add_argument("--output", type=str, help="Path of the JSON file the results are written to.",
+                    default="benchmark-results.json")
+parser.add_argument("--baseline", type=str, help="Path of the baseline JSON file to compare with.",
+                    default=os.path.join(script_dir, "benchmark-baseline.json"))
+parser.add_argument("--input", type=str,
+                    help="Compare the results of the given JSON file instead of running the benchmarks.")
+parser.add_argument("--update-baseline", action=argparse.BooleanOptionalAction,
+                    help="If enabled, the results of this run replace the content of the baseline file.")
+parser.add_argument("--only", type=str, nargs="*", help="Restricts the run to the given suite entries.")
+parser.add_argument("--repetitions", type=int, help="Number of repetitions of each benchmark.", default=5)
+parser.add_argument("--min-time", type=float, help="Minimum time in seconds spent on each repetition.",
+                    default=0.5)
+parser.add_argument("--threshold", type=float,
+                    help="Minimum relative deviation of the median reported as a change.", default=0.05)
+parser.add_argument("--noise-factor", type=float,
+                    help="Multiple of the combined coefficient of variation tolerated as noise.", default=3.0)
+parser.add_argument("--bazel", type=str, help="The bazel binary to be used.", default="bazel")
+
+
+# Function which runs the benchmarks of a single suite entry and returns google benchmark's JSON report.
+def run_entry(entry, args):
+    with tempfile.TemporaryDirectory(prefix="carmen-benchmark_") as tmp:
+        out_file = os.path.join(tmp, "out.json")
+        command = [args.bazel, "run", "-c", "opt", entry["target"], "--",
+                   f"--benchmark_filter={entry['filter']}",
+                   f"--benchmark_repetitions={args.repetitions}",
+                   f"--benchmark_min_time={args.min_time}",
+                   "--benchmark_report_aggregates_only=true",
+                   f"--benchmark_out={out_file}",
+                   "--benchmark_out_format=json"]
+        print(f"Running {entry['name']}: {' '.join(command)}", flush=True)
+        result = subprocess.run(command, cwd=cpp_dir)
+        if result.returncode != 0:
+            print(f"Benchmark {entry['target']} failed with exit code {result.returncode}")
+            sys.exit(1)
+        with open(out_file, "r") as f:
+            return json.load(f)
+
+
+# Function which condenses a google benchmark JSON report into one record per benchmark, holding the
+# median, mean and standard deviation of the real time in ns.
+def summarize(entry, report, args):
+    results = {}
+    for run in report.get("benchmarks", []):
+        # The coefficient of variation is recomputed below from mean and stddev.
+        if run.get("aggregate_name") == "cv":
+            continue
+        name = run.get("run_name", run["name"])
+        record = results.setdefault(name, {"suite": entry["name"], "target": entry["target"]})
+        time = run["real_time"] * TIME_UNITS[run.get("time_unit", "ns")]
+        if run.get("run_type") == "aggregate":
+            record[run["aggregate_name"]] = time
+            record["repetitions"] = run.get("repetitions", args.repetitions)
+        else:
+            # Without repetitions there are no aggregates; a single run is its own median.
+            record.setdefault("median", time)
+            record.setdefault("mean", time)
+            record.setdefault("stddev", 0.0)
+            record["repetitions"] = 1
+    for record in results.values():
+        mean = record.get("mean", 0.0)
+        record["cv"] = record.get("stddev", 0.0) / mean if mean > 0 else 0.0
+    return results
+
+
+# Function which compares current results against a baseline and returns the list of regressions.
+def compare(current, baseline, args):
+    regressions = []
+    print()
+    print(f"{'benchmark':<90} {'baseline':>12} {'current':>12} {'change':>8} {'tolerance':>9}  verdict")
+    for name in sorted(current.keys()):
+        cur = current[name]
+        base = baseline.get(name)
+        if base is None:
+            print(f"{name:<90} {'-':>12} {cur['median']:>12.1f} {'-':>8} {'-':>9}  new")
+            continue
+        change = cur["median"] / base["median"] - 1.0 if base["median"] > 0 else 0.0
+        noise = math.sqrt(cur.get("cv", 0.0) ** 2 + base.get("cv", 0.0) ** 2)
+        tolerance = max(args.threshold, args.noise_factor * noise)
+        if change > tolerance:
+            verdict = "REGRESSION"
+            regressions.append(name)
+        elif change < -tolerance:
+            verdict = "improvement"
+        else:
+            verdict = "ok"
+        print(f"{name:<90} {base['median']:>12.1f} {cur['median']:>12.1f} {change:>+8.1%} {tolerance:>9.1%}  {verdict}")
+    for name in sorted(set(baseline.keys()) - set(current.keys())):
+        print(f"{name:<90} {baseline[name]['median']:>12.1f} {'-':>12} {'-':>8} {'-':>9}  missing")
+    print()
+    return regressions
+
+
+# --- Script --- #
+
+args = parser.parse_args()
+
+if args.input:
+    with open(args.input, "r") as f:
+        results = json.load(f)
+else:
+    results = {"context": {}, "benchmarks": {}}
+    for entry in SUITE:
+        if args.only and entry["name"] not in args.only:
+            continue
+        report = run_entry(entry, args)
+        if not results["context"]:
+            results["context"] = report.get("context", {})
+        results["benchmarks"].update(summarize(entry, report, args))
+    with open(args.output, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+    print(f"Results written to {args.output}")
+
+if args.update_baseline:
+    with open(args.baseline, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+    print(f"Baseline {args.baseline} updated")
+    sys.exit(0)
+
+baseline = {}
+if os.path.exists(args.baseline):
+    with open(args.baseline, "r") as f:
+        baseline = json.load(f).get("benchmarks", {})
+if args.only:
+    baseline = {name: record for name, record in baseline.items() if record.get("suite") in args.only}
+if not baseline:
+    print(f"Baseline {args.baseline} contains no results, nothing to compare")
+    sys.exit(0)
+
+regressions = compare(results["benchmarks"], baseline, args)
+if regressions:
+    print(f"{len(regressions)} benchmark(s) regressed:")
+    for name in regressions:
+        print(f"\t{name}")
+    sys.exit(1)
+print("No regressions detected")